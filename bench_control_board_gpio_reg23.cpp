@@ -0,0 +1,39 @@
+// bench_control_board_gpio_reg23.cpp
+//
+// Not a unit test. Measures the latency of the register #23 functors'
+// getter and setter calls, and reports their percentiles.
+// See latency_histogram.h
+//
+// usage: make bench
+
+#include <cstdlib>      //  std::atoi
+#include <iostream>     //  std::cout
+
+#include "control_board_gpio_reg23.h"
+#include "latency_histogram.h"
+
+int main(int argc, char* argv[])
+{
+    const int iterations = (argc > 1 ? std::atoi(argv[1]) : 1000000);
+
+    static struct genpurpIO_register23 mock_reg23;   // This is masquerading as GPIO register #23
+
+    gpio_register_23< solenoid2_t, latency_instrumentation > vac_solenoid2{ &mock_reg23 };
+    gpio_register_23< solenoid3_t, latency_instrumentation > vac_solenoid3{ &mock_reg23 };
+    gpio_register_23< lamp_t,      latency_instrumentation > lamp42{ &mock_reg23 };
+
+    cycle_counter_hz();     // calibrate before the clock starts
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        vac_solenoid2((i & 1) ? vacuum::ON : vacuum::OFF);
+        vac_solenoid3(vac_solenoid2());
+        lamp42(static_cast<lamp_t>(i & FULL_ILLUMINATION));
+        lamp42();
+    }
+
+    std::cout << iterations << " iterations. register #23 fields: 0 == solenoid2, 1 == solenoid3, 2 == lamp_pwr" << std::endl;
+    dump_latency(std::cout);
+
+    return 0;
+}
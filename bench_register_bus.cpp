@@ -0,0 +1,87 @@
+// bench_register_bus.cpp
+//
+// Not a unit test. Measures how long it takes to update all 16 outputs of
+// an MCP23017 behind a simulated I2C bus, one functor call per pin:
+//
+//      direct   -- through a bus_window, a round trip per register access
+//      batched  -- through a bus_batch: one fetch, one flush
+//
+// The simulated latency roughly matches a 1MHz (Fast-mode Plus) I2C bus
+// driven from user space. See register_bus.h
+//
+// usage: make bench
+
+#include <chrono>       //  std::chrono::steady_clock, std::chrono::microseconds
+#include <cstdint>      //  std::uint8_t, std::uint64_t
+#include <cstdlib>      //  std::atoi
+#include <iomanip>      //  std::setw
+#include <iostream>     //  std::cout
+
+#include "ic_register_driver.h"
+#include "mcp23017.h"
+#include "register_bus.h"
+
+const std::uint8_t EXPANDER_ADDR { 0x20 };
+
+// sets every output pin of both ports to level, one functor call per pin
+template< typename access, std::uint8_t PIN = 0 >
+void set_all_pins(access window, std::uint16_t level)
+{
+    ic_field_functor< mcp23017_output< mcp23017_port::A, PIN >, access >{ window }(level);
+    ic_field_functor< mcp23017_output< mcp23017_port::B, PIN >, access >{ window }(level);
+
+    if constexpr (PIN < 7)
+    {
+        set_all_pins< access, PIN + 1 >(window, level);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int updates = (argc > 1 ? std::atoi(argv[1]) : 100);
+
+    const bus_latency fm_plus { std::chrono::microseconds(50),      // the driver's round trip
+                                std::chrono::microseconds(20),      // start, device and register address
+                                std::chrono::microseconds(9) };     // 9 bit times per byte
+
+    std::cout << "16 output pins, mean of " << updates << " updates (us)" << std::endl;
+    std::cout << "access    update  round trips" << std::endl;
+
+    {
+        simulated_bus bus{ fm_plus };
+        bus.attach(EXPANDER_ADDR);
+
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int u = 0; u < updates; ++u)
+        {
+            set_all_pins(bus_window{ bus, EXPANDER_ADDR }, u & 1);
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+
+        std::cout << "direct " << std::fixed << std::setprecision(1)
+                  << std::setw(9) << std::chrono::duration<double, std::micro>(t1 - t0).count() / updates
+                  << std::setw(13) << static_cast<double>(bus.round_trips()) / updates << std::endl;
+    }
+
+    {
+        simulated_bus bus{ fm_plus };
+        bus.attach(EXPANDER_ADDR);
+
+        bus_batch< mcp23017_map > batch{ bus, EXPANDER_ADDR };
+
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int u = 0; u < updates; ++u)
+        {
+            batch.fetch(MCP23017_OLATA, 2);
+            set_all_pins(batch.window(), u & 1);
+            batch.flush();
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+
+        std::cout << "batched" << std::fixed << std::setprecision(1)
+                  << std::setw(9) << std::chrono::duration<double, std::micro>(t1 - t0).count() / updates
+                  << std::setw(13) << static_cast<double>(bus.round_trips()) / updates << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+// bench_register_fleet_query.cpp
+//
+// Not a unit test. Measures how long the fleet query kernels take to
+// scan a supervisory dashboard's worth of board images, at each SIMD
+// level the CPU supports. See register_fleet_query.h
+//
+// usage: make bench
+
+#include <chrono>       //  std::chrono::steady_clock
+#include <cstdint>      //  std::uint16_t, std::uint32_t
+#include <cstdlib>      //  std::atoi
+#include <iomanip>      //  std::setw
+#include <iostream>     //  std::cout
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "register_fleet_query.h"
+
+int main(int argc, char* argv[])
+{
+    const std::size_t boards = (argc > 1 ? std::atoi(argv[1]) : 50000);
+    const int         scans  = 1000;
+
+    register_image_array images{ boards, 0 };
+
+    std::uint32_t state = 2463534242u;      // xorshift32
+    for (std::size_t i = 0; i < boards; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        images[i] = static_cast<std::uint16_t>(state);
+    }
+
+    std::cout << boards << " boards, mean of " << scans << " scans (us)" << std::endl;
+    std::cout << "level     count  histogram  differs" << std::endl;
+
+    std::vector<std::uint32_t> indices(boards);     // room for every board, made once
+
+    std::size_t sink = 0;   // keeps the scans from being optimized away
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        if (usable_simd_level(level) != level)
+        {
+            continue;
+        }
+
+        double us[3];
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int s = 0; s < scans; ++s)
+        {
+            sink += fleet_count_field(images, SOLENOID2_FIELD, 1, level);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        us[0] = std::chrono::duration<double, std::micro>(t1 - t0).count() / scans;
+
+        t0 = std::chrono::steady_clock::now();
+        for (int s = 0; s < scans; ++s)
+        {
+            sink += fleet_field_histogram(images, LAMP_PWR_FIELD, level)[MOOD_LIGHTING];
+        }
+        t1 = std::chrono::steady_clock::now();
+        us[1] = std::chrono::duration<double, std::micro>(t1 - t0).count() / scans;
+
+        t0 = std::chrono::steady_clock::now();
+        for (int s = 0; s < scans; ++s)
+        {
+            sink += fleet_find_field_differs(images, LAMP_PWR_FIELD, MOOD_LIGHTING, indices.data(), level);
+        }
+        t1 = std::chrono::steady_clock::now();
+        us[2] = std::chrono::duration<double, std::micro>(t1 - t0).count() / scans;
+
+        std::cout << std::left << std::setw(6) << simd_level_name(level) << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(9) << us[0] << std::setw(11) << us[1] << std::setw(9) << us[2] << std::endl;
+    }
+
+    return sink == 0;
+}
@@ -0,0 +1,366 @@
+// board_controller.h
+//
+// control_board -- one board's register #23 shadow, with its own set of
+//                  register #23 accessors (see board_handle.h)
+//
+// board_controller -- a runtime owning N boards, which runs each tick's
+//                     per-board control work on a pool of worker threads
+//
+//      The boards are split into one contiguous range per worker. Each
+//      worker allocates and constructs its own range's boards, so on a
+//      NUMA machine their memory is local to the worker's core (Note1),
+//      and pins itself to a core of its own (Note2).
+//
+//      Each tick a worker first claims chunks of its own range. Once that
+//      is exhausted it steals chunks from the other workers' ranges, so a
+//      worker held up by slow boards (or by the OS) doesn't hold up the
+//      tick (Note3).
+//
+//      tick() returns once every board has been worked on. An exception
+//      thrown by the work on one board doesn't stop the work on the others:
+//      the first is rethrown by tick() once the tick completes.
+//
+//      If a worker can't build its boards (e.g., std::bad_alloc), or a
+//      worker's thread can't be started, the constructor stops and joins
+//      the workers already started, then rethrows the first failure.
+//
+//  Note1:  Linux places a page on the NUMA node of the thread which first
+//          touches it. No libnuma required.
+//
+//  Note2:  worker w is pinned to the w'th CPU (modulo their number) in the
+//          controller's creator's affinity mask. Pinning is only attempted
+//          on Linux, and a failure to pin is not an error.
+//
+//  Note3:  a range's cursor is claimed with fetch_add, so its owner and any
+//          number of thieves may claim chunks from it at the same time, and
+//          each chunk is claimed exactly once. Cursors sit on cache lines of
+//          their own, so claiming doesn't bounce the neighbours' cursors.
+
+#ifndef BOARD_CONTROLLER_H
+#define BOARD_CONTROLLER_H
+
+#include <algorithm>            //  std::min
+#include <atomic>               //  std::atomic
+#include <condition_variable>   //  std::condition_variable
+#include <cstddef>              //  std::size_t
+#include <cstdint>              //  std::uint64_t
+#include <exception>            //  std::exception_ptr
+#include <mutex>                //  std::mutex, std::unique_lock
+#include <thread>               //  std::thread
+#include <type_traits>          //  std::remove_reference
+#include <vector>               //  std::vector
+
+#ifdef __linux__
+#include <pthread.h>            //  pthread_setaffinity_np
+#include <sched.h>              //  cpu_set_t
+#endif
+
+#include "board_handle.h"
+#include "field_instrumentation.h"
+#include "register_arena.h"
+
+// control_board -- a board's register #23 shadow and accessors, on a
+//                  cache line of its own. See board_handle.h
+template< typename instrumentation = no_instrumentation >
+using control_board = board_handle< instrumentation >;
+
+
+template< typename instrumentation = no_instrumentation >
+class board_controller
+{
+public:
+    typedef control_board< instrumentation > board_t;
+
+    static const std::size_t CHUNK { 8 };   // boards claimed at a time
+
+    // workers == 0 means one per hardware thread
+    board_controller(std::size_t boards, std::size_t workers = 0, bool pin_workers = true)
+        : boards_(boards),
+          workers_(workers != 0 ? workers : std::max<std::size_t>(1, std::thread::hardware_concurrency())),
+          per_worker_(std::max<std::size_t>(1, (boards_ + workers_ - 1) / workers_)),
+          ranges_(make_register_array<range>(workers_))
+    {
+        const std::vector<int> cpus = pin_workers ? affinity_cpus() : std::vector<int>{};
+
+        for (std::size_t w = 0; w < workers_; ++w)
+        {
+            ranges_[w].begin = std::min(boards_, w * per_worker_);
+            ranges_[w].end   = std::min(boards_, ranges_[w].begin + per_worker_);
+            ranges_[w].next.store(ranges_[w].end, std::memory_order_relaxed);      // nothing to claim yet
+        }
+
+        threads_.reserve(workers_);
+        try
+        {
+            for (std::size_t w = 0; w < workers_; ++w)
+            {
+                const int cpu = cpus.empty() ? -1 : cpus[w % cpus.size()];
+                threads_.emplace_back(&board_controller::worker, this, w, cpu);
+            }
+        }
+        catch (...)
+        {
+            stop_workers();
+            throw;
+        }
+
+        // wait for the workers to build their boards, or to fail to
+        std::exception_ptr failure;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            done_cv_.wait(lock, [this]() { return built_ == workers_; });
+            failure.swap(failure_);
+        }
+
+        if (failure)
+        {
+            stop_workers();
+            std::rethrow_exception(failure);
+        }
+    }
+
+    board_controller(const board_controller&)            = delete;
+    board_controller& operator=(const board_controller&) = delete;
+
+    ~board_controller()
+    {
+        stop_workers();
+    }
+
+    std::size_t boards()  const { return boards_; }
+    std::size_t workers() const { return workers_; }
+
+    board_t& board(std::size_t i)
+    {
+        return (*ranges_[i / per_worker_].boards)[i % per_worker_];
+    }
+
+    // tick() -- calls work(board, index) once for every board, spread over
+    //           the workers, and returns when every call has returned
+    template< typename work_t >
+    void tick(work_t&& work)
+    {
+        typedef typename std::remove_reference< work_t >::type callable_t;
+
+        std::unique_lock<std::mutex> lock(mtx_);
+
+        job_     = &call_work< callable_t >;
+        job_ctx_ = const_cast< void* >(static_cast< const void* >(&work));
+        failure_ = nullptr;
+
+        for (std::size_t w = 0; w < workers_; ++w)
+        {
+            ranges_[w].next.store(ranges_[w].begin, std::memory_order_relaxed);
+        }
+
+        finished_ = 0;
+        ++generation_;
+        start_cv_.notify_all();
+
+        done_cv_.wait(lock, [this]() { return finished_ == workers_; });
+
+        ++ticks_;
+
+        if (failure_)
+        {
+            std::rethrow_exception(failure_);
+        }
+    }
+
+    std::uint64_t ticks()  const { return ticks_; }
+
+    // stolen() -- the number of chunks workers have claimed from other
+    //             workers' ranges, over every tick so far
+    std::uint64_t stolen() const { return stolen_.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) range                                   // Note3
+    {
+        typedef board_handle_array< instrumentation > boards_t;
+
+        std::atomic<std::size_t>    next  {0};
+        std::size_t                 begin {0};
+        std::size_t                 end   {0};
+        register_ptr<boards_t>      boards;
+    };
+
+    typedef void (*job_t)(void* ctx, board_t& board, std::size_t index);
+
+    template< typename work_t >
+    static void call_work(void* ctx, board_t& board, std::size_t index)
+    {
+        (*static_cast<work_t*>(ctx))(board, index);
+    }
+
+    // stops the workers started so far, and waits for them to exit
+    void stop_workers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stopping_ = true;
+        }
+        start_cv_.notify_all();
+
+        for (std::thread& t : threads_)
+        {
+            t.join();
+        }
+    }
+
+    static std::vector<int> affinity_cpus()
+    {
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &set))
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        return cpus;
+    }
+
+    static void pin_to(int cpu)                                             // Note2
+    {
+#ifdef __linux__
+        if (cpu >= 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+#else
+        (void)cpu;
+#endif
+    }
+
+    // claims and works on chunks of range r until it is exhausted. The
+    // first exception thrown by the work is kept in failure, and the work
+    // goes on with the next board. Returns the number of chunks claimed
+    std::size_t drain(range& r, job_t job, void* ctx, std::exception_ptr& failure)
+    {
+        std::size_t chunks = 0;
+        for (;;)
+        {
+            const std::size_t first = r.next.fetch_add(CHUNK, std::memory_order_relaxed);
+            if (first >= r.end)
+            {
+                return chunks;
+            }
+
+            const std::size_t last = std::min(first + CHUNK, r.end);
+            for (std::size_t i = first; i < last; ++i)
+            {
+                try
+                {
+                    job(ctx, (*r.boards)[i - r.begin], i);
+                }
+                catch (...)
+                {
+                    if (!failure)
+                    {
+                        failure = std::current_exception();
+                    }
+                }
+            }
+            ++chunks;
+        }
+    }
+
+    void worker(std::size_t w, int cpu)
+    {
+        pin_to(cpu);
+
+        range& own = ranges_[w];
+
+        // a worker that fails to build its boards still reports in, so that
+        // the constructor can rethrow the failure rather than wait forever
+        std::exception_ptr build_failure;
+        try
+        {
+            own.boards = make_register<typename range::boards_t>(own.end - own.begin);  // Note1
+        }
+        catch (...)
+        {
+            build_failure = std::current_exception();
+        }
+
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (build_failure && !failure_)
+        {
+            failure_ = build_failure;
+        }
+        if (++built_ == workers_)
+        {
+            done_cv_.notify_all();
+        }
+
+        std::uint64_t seen = generation_;
+        for (;;)
+        {
+            start_cv_.wait(lock, [&]() { return stopping_ || generation_ != seen; });
+            if (stopping_)
+            {
+                return;
+            }
+            seen = generation_;
+
+            const job_t job = job_;
+            void*       ctx = job_ctx_;
+            lock.unlock();
+
+            std::exception_ptr failure;
+            drain(own, job, ctx, failure);
+
+            // then steal from the others, starting with the next worker
+            for (std::size_t k = 1; k < workers_; ++k)
+            {
+                const std::size_t chunks = drain(ranges_[(w + k) % workers_], job, ctx, failure);
+                if (chunks != 0)
+                {
+                    stolen_.fetch_add(chunks, std::memory_order_relaxed);
+                }
+            }
+
+            lock.lock();
+            if (failure && !failure_)
+            {
+                failure_ = failure;
+            }
+            if (++finished_ == workers_)
+            {
+                done_cv_.notify_all();
+            }
+        }
+    }
+
+    const std::size_t               boards_;
+    const std::size_t               workers_;
+    const std::size_t               per_worker_;
+    register_array<range>           ranges_;
+    register_vector<std::thread>    threads_;
+
+    std::mutex                      mtx_;
+    std::condition_variable         start_cv_;
+    std::condition_variable         done_cv_;
+    std::size_t                     built_      {0};
+    std::size_t                     finished_   {0};
+    std::uint64_t                   generation_ {0};
+    bool                            stopping_   {false};
+    job_t                           job_        {nullptr};
+    void*                           job_ctx_    {nullptr};
+    std::exception_ptr              failure_;
+
+    std::uint64_t                   ticks_      {0};
+    std::atomic<std::uint64_t>      stolen_     {0};
+};
+
+#endif // BOARD_CONTROLLER_H
@@ -0,0 +1,220 @@
+// board_handle.h
+//
+// board_handle -- all of a board's register #23 field accessors, its
+//                 register #23 shadow, and its access counts, packed into
+//                 a single cache line
+//
+//      Three gpio_register_23 functors carry three copies of the register
+//      pointer, each in an object of its own, which may land anywhere.
+//      A board_handle carries one pointer, shared by its accessors, and
+//      keeps it on the same cache line as the shadow and the counts the
+//      accessors update. Touching a board touches one line, and two
+//      boards never share one, so workers busy with adjacent boards
+//      don't falsely share. See Note1
+//
+//      The accessors behave exactly as the functors do (write elision,
+//      range checking, instrumentation hooks, rate limiting; see
+//      control_board_gpio_reg23.h), their setters sharing the functors'
+//      reg23_write_field(), and are named after the functors they replace:
+//
+//          board.vac_solenoid2(vacuum::ON);
+//          board.lamp42(MOOD_LIGHTING);
+//          std::uint16_t pwr = board.lamp42();
+//
+//      By default a handle's accessors drive the handle's own shadow,
+//      which stands in for the board's register #23. A handle may instead
+//      be pointed at a real register, in which case the shadow is unused.
+//
+// board_handle_array -- a cache line aligned array of board handles
+//
+//  Note1:  a board's counts are plain integers. A board is worked on by one
+//          thread at a time (see board_controller.h), so they need not be
+//          atomic.
+//
+//  Note2:  with coil_rate_limit the handle keeps a reference to each
+//          solenoid's toggle_bucket, the one every accessor of the
+//          register's field shares. See solenoid_rate_limit.h
+//
+//  Note3:  the register is loaded and stored with the ordering policy's
+//          barriers, as the functors' is (Note6 of control_board_gpio_reg23.h).
+//          relaxed_ordering, the default, suits the handle's own shadow;
+//          point a handle at a real register with device_ordering.
+
+#ifndef BOARD_HANDLE_H
+#define BOARD_HANDLE_H
+
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint32_t
+
+#include "control_board_gpio_reg23.h"
+#include "field_instrumentation.h"
+#include "register_arena.h"
+#include "register_ordering.h"
+#include "solenoid_rate_limit.h"
+
+// a board's register #23 access counts, over all of its fields
+struct board_stats
+{
+    std::uint32_t reads         {0};
+    std::uint32_t writes        {0};
+    std::uint32_t elided_writes {0};
+    std::uint32_t range_errors  {0};
+    std::uint32_t rate_limited  {0};    // toggles refused by the rate limiting policy
+};
+
+template< typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit,
+          typename ordering = relaxed_ordering >    // Note3
+class alignas(CACHE_LINE_SIZE) board_handle
+{
+public:
+    // a handle driving its own shadow
+    board_handle() : board_handle(nullptr) {}
+
+    // a handle driving the given register. Like the functors, the handle
+    // closes the valves and kills the lamp on startup
+    explicit board_handle(gpio_reg23_ptr_t preg_)
+        : preg(preg_ != nullptr ? preg_ : &reg23),
+          solenoid2_bucket(rate_limit::bucket_for(preg, SOLENOID2_FIELD_ID)),
+          solenoid3_bucket(rate_limit::bucket_for(preg, SOLENOID3_FIELD_ID))
+    {
+        std::uint16_t word = reg23_load<ordering>(preg);
+        word = SOLENOID2_FIELD.insert(word, 0);
+        word = SOLENOID3_FIELD.insert(word, 0);
+        word = LAMP_PWR_FIELD.insert(word, LIGHTS_OUT);
+        reg23_store<ordering>(preg, word);
+    }
+
+    // the accessors may point into the handle, so a handle stays where it was built
+    board_handle(const board_handle&)            = delete;
+    board_handle& operator=(const board_handle&) = delete;
+
+    // vac_solenoid2 accessors. The setter returns the solenoid's previous state
+    vacuum vac_solenoid2(vacuum val)
+    {
+        const std::uint16_t old_bit =
+            reg23_write_field<instrumentation>(counted_access{ preg, stats }, SOLENOID2_FIELD, (val == vacuum::OFF ? 0 : 1),
+                                               [this]() { return rate_limit::admit(solenoid2_bucket); });
+
+        return (old_bit == 0 ? vacuum::OFF : vacuum::ON);
+    }
+
+    vacuum vac_solenoid2()
+    {
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        const std::uint16_t bit = SOLENOID2_FIELD.extract(reg23_load<ordering>(preg));
+
+        ++stats.reads;
+        instrumentation::read(GPIO_REG23_ID, SOLENOID2_FIELD_ID, t0, bit);
+
+        return (bit == 0 ? vacuum::OFF : vacuum::ON);
+    }
+
+    // vac_solenoid3 accessors. The setter returns the solenoid's previous state
+    vacuum vac_solenoid3(vacuum val)
+    {
+        const std::uint16_t old_bit =
+            reg23_write_field<instrumentation>(counted_access{ preg, stats }, SOLENOID3_FIELD, (val == vacuum::OFF ? 0 : 1),
+                                               [this]() { return rate_limit::admit(solenoid3_bucket); });
+
+        return (old_bit == 0 ? vacuum::OFF : vacuum::ON);
+    }
+
+    vacuum vac_solenoid3()
+    {
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        const std::uint16_t bit = SOLENOID3_FIELD.extract(reg23_load<ordering>(preg));
+
+        ++stats.reads;
+        instrumentation::read(GPIO_REG23_ID, SOLENOID3_FIELD_ID, t0, bit);
+
+        return (bit == 0 ? vacuum::OFF : vacuum::ON);
+    }
+
+    // lamp accessors. The setter returns the lamp's previous power setting
+    std::uint16_t lamp42(lamp_t val)
+    {
+        return reg23_write_field<instrumentation>(counted_access{ preg, stats }, LAMP_PWR_FIELD, val);
+    }
+
+    std::uint16_t lamp42()
+    {
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        const std::uint16_t retval = LAMP_PWR_FIELD.extract(reg23_load<ordering>(preg));
+
+        ++stats.reads;
+        instrumentation::read(GPIO_REG23_ID, LAMP_PWR_FIELD_ID, t0, retval);
+
+        return retval;
+    }
+
+    // the register the accessors drive: the shadow, or a real register
+    gpio_reg23_ptr_t reg() const { return preg; }
+
+    genpurpIO_register23    reg23 {};     // the shadow
+    board_stats             stats {};     // Note1
+
+private:
+    // the setters' access to the register (see reg23_write_field()), which
+    // counts their outcomes in the handle's stats. Note3
+    struct counted_access : reg23_access<ordering>
+    {
+        board_stats& stats;
+
+        counted_access(gpio_reg23_ptr_t preg_, board_stats& stats_) : reg23_access<ordering>{ preg_ }, stats(stats_) {}
+
+        void tally(field_write_outcome outcome) const
+        {
+            switch (outcome)
+            {
+                case field_write_outcome::WRITTEN:      ++stats.writes;        break;
+                case field_write_outcome::ELIDED:       ++stats.elided_writes; break;
+                case field_write_outcome::RATE_LIMITED: ++stats.rate_limited;  break;
+                case field_write_outcome::RANGE_ERROR:  ++stats.range_errors;  break;
+            }
+        }
+    };
+
+    gpio_reg23_ptr_t                preg;
+
+    typename rate_limit::bucket_ref solenoid2_bucket;        // Note2
+    typename rate_limit::bucket_ref solenoid3_bucket;
+};
+
+static_assert(sizeof(board_handle<>) == CACHE_LINE_SIZE, "a board handle fills exactly one cache line");
+static_assert(sizeof(board_handle< no_instrumentation, coil_rate_limit >) == CACHE_LINE_SIZE,
+              "a rate limited board handle fills exactly one cache line");
+static_assert(sizeof(board_handle< no_instrumentation, no_rate_limit, device_ordering >) == CACHE_LINE_SIZE,
+              "the ordering policy takes no space in a board handle");
+
+
+// board_handle_array -- a fixed number of handles, each driving its own shadow
+template< typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit,
+          typename ordering = relaxed_ordering >
+class board_handle_array
+{
+public:
+    typedef board_handle< instrumentation, rate_limit, ordering > handle_t;
+
+    explicit board_handle_array(std::size_t boards)
+        : boards_(boards),
+          handles_(make_register_array<handle_t>(boards))
+    {
+    }
+
+    std::size_t size() const { return boards_; }
+
+    handle_t&       operator[](std::size_t i)       { return handles_[i]; }
+    const handle_t& operator[](std::size_t i) const { return handles_[i]; }
+
+    handle_t* begin() { return handles_.get(); }
+    handle_t* end()   { return handles_.get() + boards_; }
+
+private:
+    std::size_t                     boards_;
+    register_array<handle_t>        handles_;
+};
+
+#endif // BOARD_HANDLE_H
@@ -0,0 +1,87 @@
+// codegen_control_board_gpio_reg23.cpp
+//
+// Not a unit test. This file is only compiled to assembly (-O2 -S) so that
+// the Makefile's codegen check can inspect the code generated for the
+// functors:
+//
+//      codegen_uninstrumented_*()  must not contain any trace of an
+//                                  instrumentation policy (no counter
+//                                  reads, no thread-local counters)
+//
+//      codegen_counted_*()         must contain the instrumentation.
+//                                  This proves the check is capable of
+//                                  spotting the instrumentation at all.
+//
+//      codegen_typestate_*()       must not contain any test, compare or
+//                                  conditional branch
+//
+//      codegen_*_ordered_*()       must not contain a full fence (mfence,
+//                                  a locked instruction, dmb sy / ish)
+
+#include <utility>      //  std::move
+
+#include "control_board_gpio_reg23.h"
+#include "mcp23017.h"
+#include "solenoid_typestate.h"
+
+static_assert(sizeof(gpio_register_23< solenoid2_t >) == sizeof(gpio_reg23_ptr_t),
+              "the uninstrumented functor must be nothing more than the register's address");
+
+extern "C" vacuum codegen_uninstrumented_solenoid2(gpio_reg23_ptr_t preg)
+{
+    gpio_register_23< solenoid2_t > vac_solenoid2{ preg };
+
+    vac_solenoid2(vacuum::ON);
+    return vac_solenoid2();
+}
+
+extern "C" std::uint16_t codegen_uninstrumented_lamp(gpio_reg23_ptr_t preg)
+{
+    gpio_register_23< lamp_t > lamp42{ preg };
+
+    lamp42(MOOD_LIGHTING);
+    return lamp42();
+}
+
+extern "C" vacuum codegen_counted_solenoid2(gpio_reg23_ptr_t preg)
+{
+    gpio_register_23< solenoid2_t, counting_instrumentation > vac_solenoid2{ preg };
+
+    vac_solenoid2(vacuum::ON);
+    return vac_solenoid2();
+}
+
+// an IC's field functors must be as lean as register #23's. See ic_register_driver.h
+extern "C" std::uint16_t codegen_uninstrumented_ic_pin(volatile ic_reg_t* base)
+{
+    ic_field_functor< mcp23017_output< mcp23017_port::A, 3 > > gpa3{ mmio_window{ base } };
+
+    gpa3(1);
+    return gpa3();
+}
+
+// acquire/release and device ordering must not cost a full fence. See register_ordering.h
+extern "C" vacuum codegen_acq_rel_ordered_solenoid2(gpio_reg23_ptr_t preg)
+{
+    gpio_register_23< solenoid2_t, no_instrumentation, no_rate_limit, acq_rel_ordering > vac_solenoid2{ preg };
+
+    vac_solenoid2(vacuum::ON);
+    return vac_solenoid2();
+}
+
+extern "C" vacuum codegen_device_ordered_solenoid2(gpio_reg23_ptr_t preg)
+{
+    gpio_register_23< solenoid2_t, no_instrumentation, no_rate_limit, device_ordering > vac_solenoid2{ preg };
+
+    vac_solenoid2(vacuum::ON);
+    return vac_solenoid2();
+}
+
+// the typestate knows the solenoid's state, so a cycle through it must not
+// test or compare anything. See solenoid_typestate.h
+extern "C" void codegen_typestate_solenoid2(gpio_reg23_ptr_t preg)
+{
+    solenoid_off< solenoid2_t > off = solenoid_startup< solenoid2_t >(preg);
+
+    off = std::move(off).energize().deenergize();
+}
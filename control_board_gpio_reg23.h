@@ -1,8 +1,17 @@
 // control_board_gpio_reg23.h
 
+#ifndef CONTROL_BOARD_GPIO_REG23_H
+#define CONTROL_BOARD_GPIO_REG23_H
+
 #include <cstdint>      //  std::uint16_t
-#include <exception>    //  std::range_error
-#include <sstream>      //  std::stringstream
+#include <cstring>      //  std::memcpy
+
+#include "field_instrumentation.h"
+#include "register_descriptor.h"
+#include "register_error.h"
+#include "register_interlock.h"
+#include "register_ordering.h"
+#include "solenoid_rate_limit.h"
 
 
 // in real life there we can expect multiple GPIO registers. In this toy
@@ -19,6 +28,92 @@ struct genpurpIO_register23
 
 typedef struct genpurpIO_register23* gpio_reg23_ptr_t;
 
+// ids identifying register #23 and its named fields to
+// the instrumentation policies. See field_instrumentation.h
+const std::uint8_t      GPIO_REG23_ID      = 23;
+const std::uint8_t      SOLENOID2_FIELD_ID = 0;
+const std::uint8_t      SOLENOID3_FIELD_ID = 1;
+const std::uint8_t      LAMP_PWR_FIELD_ID  = 2;
+
+static_assert(sizeof(genpurpIO_register23) == sizeof(std::uint16_t), "register #23 is a 16 bit register");
+
+// where g++ places the named fields within register #23's raw word.
+// See register_descriptor.h
+constexpr field_descriptor SOLENOID2_FIELD { GPIO_REG23_ID, SOLENOID2_FIELD_ID, 0, 1 };
+constexpr field_descriptor SOLENOID3_FIELD { GPIO_REG23_ID, SOLENOID3_FIELD_ID, 1, 1 };
+constexpr field_descriptor LAMP_PWR_FIELD  { GPIO_REG23_ID, LAMP_PWR_FIELD_ID,  2, 3 };
+
+// whether the instrumentation can account for each of the register's
+// fields. Everything instrumenting them static_asserts it, rather than
+// leave an untracked field to its hooks. See field_instrumentation.h
+template< typename instrumentation >
+constexpr bool reg23_tracked_by()
+{
+    return instrumentation::tracks(GPIO_REG23_ID, SOLENOID2_FIELD_ID) &&
+           instrumentation::tracks(GPIO_REG23_ID, SOLENOID3_FIELD_ID) &&
+           instrumentation::tracks(GPIO_REG23_ID, LAMP_PWR_FIELD_ID);
+}
+
+// the register's raw word, and vice versa
+inline std::uint16_t reg23_to_word(const genpurpIO_register23& reg)
+{
+    std::uint16_t word;
+    std::memcpy(&word, &reg, sizeof(word));
+    return word;
+}
+
+inline genpurpIO_register23 word_to_reg23(std::uint16_t word)
+{
+    genpurpIO_register23 reg;
+    std::memcpy(&reg, &word, sizeof(reg));
+    return reg;
+}
+
+// the register's raw word, in place
+inline volatile std::uint16_t* reg23_word(gpio_reg23_ptr_t preg)
+{
+    return reinterpret_cast<volatile std::uint16_t*>(preg);
+}
+
+// the register's raw word, loaded and stored with the ordering the
+// policy requires. See register_ordering.h
+template< typename ordering >
+constexpr std::uint16_t reg23_load(gpio_reg23_ptr_t preg)
+{
+    return ordering::template load<std::uint16_t>(preg);
+}
+
+template< typename ordering >
+constexpr void reg23_store(gpio_reg23_ptr_t preg, std::uint16_t word)
+{
+    ordering::template store<std::uint16_t>(preg, word);
+}
+
+// reg23_constexpr_ordering -- relaxed_ordering's plain accesses, made
+//      through the register's named fields instead of std::memcpy, so that
+//      the functors can run in a constant expression against a constexpr
+//      register image. The register's unused bits read as 0. See Note8
+struct reg23_constexpr_ordering
+{
+    template< typename word_t >
+    static constexpr word_t load(const genpurpIO_register23* reg)
+    {
+        word_t word = 0;
+        word = SOLENOID2_FIELD.insert(word, reg->energize_vac_solenoid2);
+        word = SOLENOID3_FIELD.insert(word, reg->energize_vac_solenoid3);
+        word = LAMP_PWR_FIELD.insert(word, reg->lamp_pwr);
+        return word;
+    }
+
+    template< typename word_t >
+    static constexpr void store(genpurpIO_register23* reg, word_t word)
+    {
+        reg->energize_vac_solenoid2 = SOLENOID2_FIELD.extract(word);
+        reg->energize_vac_solenoid3 = SOLENOID3_FIELD.extract(word);
+        reg->lamp_pwr               = LAMP_PWR_FIELD.extract(word);
+    }
+};
+
 enum class vacuum: unsigned int
 {
     OFF,  // de-energizing the vacuum solenoid closes the valve, removing the vacuum
@@ -53,52 +148,218 @@ typedef std::uint16_t      lamp_t;
 
 //-------- end of partial specialization typedefs ----------
 
+// register #23's safety interlocks. Enforced on transactional writes.
+// See register_interlock.h
+constexpr interlock_rule REG23_INTERLOCK_RULES[] {
+    { "solenoid2 and solenoid3 must never both be energized",
+      { SOLENOID2_FIELD, interlock_cmp::EQ, 1 }, { SOLENOID3_FIELD, interlock_cmp::EQ, 1 } },
+    { "lamp must be at most MOOD_LIGHTING while solenoid2 applies vacuum",
+      { LAMP_PWR_FIELD,  interlock_cmp::GT, MOOD_LIGHTING }, { SOLENOID2_FIELD, interlock_cmp::EQ, 1 } },
+    { "lamp must be at most MOOD_LIGHTING while solenoid3 applies vacuum",
+      { LAMP_PWR_FIELD,  interlock_cmp::GT, MOOD_LIGHTING }, { SOLENOID3_FIELD, interlock_cmp::EQ, 1 } }
+};
+
+constexpr interlock_table REG23_INTERLOCKS { REG23_INTERLOCK_RULES };
+
 // Note2:   no need to define gpio_register_23 b/c the
 //          primary template is never instantiated.
 
+// Note3:   instrumentation is a compile-time policy. By default it is
+//          no_instrumentation, which compiles out entirely.
+//          See field_instrumentation.h
+//
+// Note4:   a setter that finds the field already holding the requested
+//          value skips the store, sparing the bus a pointless write.
+//
+// Note5:   rate_limit is a compile-time policy deciding whether a solenoid
+//          may toggle. By default it is no_rate_limit, which compiles out
+//          entirely. See solenoid_rate_limit.h. A solenoid's toggle
+//          budget is kept once per register field, and shared by all of
+//          its accessors: the functor looks its field's bucket up when
+//          constructed, and keeps the reference as a base, so that
+//          no_rate_limit's empty reference takes no space.
+//
+// Note6:   ordering is a compile-time policy deciding which barriers the
+//          register's loads and stores pay for. By default it is
+//          relaxed_ordering, right for shadows; use acq_rel_ordering for a
+//          mirror shared with other threads, and device_ordering for a
+//          real register. See register_ordering.h. A setter loads the
+//          register's word once, and stores the updated word back.
+//
+// Note7:   a functor constructed with REG23_ATTACH attaches to a register
+//          that is already in its startup state, and leaves it as it is.
+//          E.g., an image in a frame buffer. See register_frame.h
+//
+// Note8:   with reg23_constexpr_ordering, no_instrumentation and
+//          no_rate_limit, the functors are usable in constant expressions.
+//          The default relaxed_ordering is not: it copies the word with
+//          std::memcpy. Against a constexpr register image they run at
+//          compile time, so their deterministic behavior (startup values,
+//          setters, getters, range checking) is verified by static_asserts.
+//          See ut_control_board_gpio_reg23.cpp. An out of range lamp
+//          setting is not a constant expression, so it fails the build.
+
+// throw_lamp_range_error() -- kept out of line, so that the lamp's setter
+//                             stays small, and stays constexpr. Note8
+[[noreturn]] __attribute__((noinline, cold))
+inline void throw_lamp_range_error(lamp_t val)
+{
+    throw register_range_error( "Incorrect attempt to set lamp #42 pwr value to (%u). "
+                                "Valid pwr settings range for lamp #42 is 0:7. ", unsigned{val} );
+}
+
+// throw_reg23_range_error() -- as throw_lamp_range_error(), for any of the
+//                              register's fields
+[[noreturn]] __attribute__((noinline, cold))
+inline void throw_reg23_range_error(const field_descriptor& f, std::uint16_t val)
+{
+    if (f.field_id == LAMP_PWR_FIELD_ID)
+    {
+        throw_lamp_range_error(val);
+    }
+    throw register_range_error( "Incorrect attempt to set field %u of register #23 to (%u). Valid range is 0:%u. ",
+                                unsigned{f.field_id}, unsigned{val}, unsigned{f.max_value()} );
+}
+
+// what became of a setter call, for the accessors that count them (see board_handle.h)
+enum class field_write_outcome
+{
+    WRITTEN,
+    ELIDED,             // Note4
+    RATE_LIMITED,       // Note5
+    RANGE_ERROR
+};
+
+// reg23_access -- reaches the register's word for reg23_write_field(): the
+//                 register itself, loaded and stored with the ordering
+//                 policy's barriers (Note6). Counts nothing
+template< typename ordering >
+struct reg23_access
+{
+    gpio_reg23_ptr_t preg;
+
+    constexpr std::uint16_t load() const                     { return reg23_load<ordering>(preg); }
+    constexpr void          store(std::uint16_t word) const  { reg23_store<ordering>(preg, word); }
+    constexpr void          tally(field_write_outcome) const {}
+};
+
+// reg23_write_field() -- a setter's read-modify-write of field f, shared by
+//      the functors, board_handle's accessors and the cached functors
+//      (see tick_read_cache.h), which differ only in how they reach the
+//      register's word: access provides load(), store(word) and
+//      tally(outcome). Rejects a val the field can't hold, skips the store
+//      when the field already holds val (Note4) or when admit() refuses
+//      the change (Note5), and reports each outcome to the
+//      instrumentation. Loads the word once (Note6). Returns the field's
+//      previous value
+template< typename instrumentation, typename access_t, typename admit_t >
+constexpr std::uint16_t reg23_write_field(access_t access, const field_descriptor& f, std::uint16_t val, admit_t admit)
+{
+    static_assert(reg23_tracked_by<instrumentation>(), "the instrumentation can't account for register #23's fields");
+
+    if (val > f.max_value())
+    {
+        access.tally(field_write_outcome::RANGE_ERROR);
+        instrumentation::range_error(f.reg_id, f.field_id, val);
+        throw_reg23_range_error(f, val);
+    }
+
+    typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+    const std::uint16_t word    = access.load();
+    const std::uint16_t old_val = f.extract(word);
+
+    if (val == old_val)
+    {
+        access.tally(field_write_outcome::ELIDED);
+        instrumentation::elided_write(f.reg_id, f.field_id, t0, val);
+    }
+    else if (!admit())
+    {
+        access.tally(field_write_outcome::RATE_LIMITED);
+        instrumentation::rate_limited(f.reg_id, f.field_id, t0, val);
+    }
+    else
+    {
+        access.store(f.insert(word, val));
+
+        access.tally(field_write_outcome::WRITTEN);
+        instrumentation::write(f.reg_id, f.field_id, t0, old_val, val);
+    }
+
+    return old_val;
+}
+
+// for fields with no rate limiting policy
+template< typename instrumentation, typename access_t >
+constexpr std::uint16_t reg23_write_field(access_t access, const field_descriptor& f, std::uint16_t val)
+{
+    return reg23_write_field<instrumentation>(access, f, val, []() { return true; });
+}
+
+// tag selecting the functors' attaching constructor. Note7
+struct reg23_attach_t {};
+constexpr reg23_attach_t REG23_ATTACH {};
+
 // primary template
-template< typename field>
+template< typename field, typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit,
+          typename ordering = relaxed_ordering >    // Note3, Note5, Note6
 class gpio_register_23;    // Note2
 
 // class template partial specialization
 // for the vac_solenoid2 control functor
-template<>
-class gpio_register_23< solenoid2_t  >
+template< typename instrumentation, typename rate_limit, typename ordering >
+class gpio_register_23< solenoid2_t, instrumentation, rate_limit, ordering > : private rate_limit::bucket_ref    // Note5
 {
+    static_assert(reg23_tracked_by<instrumentation>(), "the instrumentation can't account for register #23's fields");
+
 public:
-    gpio_register_23(gpio_reg23_ptr_t preg_)  : preg(preg_)
+    constexpr gpio_register_23(gpio_reg23_ptr_t preg_)
+        : rate_limit::bucket_ref(rate_limit::bucket_for(preg_, SOLENOID2_FIELD_ID)), preg(preg_)
+    {
+        // close the valve on startup
+        reg23_store<ordering>(preg, SOLENOID2_FIELD.insert(reg23_load<ordering>(preg), 0));
+    }
+
+    constexpr gpio_register_23(gpio_reg23_ptr_t preg_, reg23_attach_t)     // Note7
+        : rate_limit::bucket_ref(rate_limit::bucket_for(preg_, SOLENOID2_FIELD_ID)), preg(preg_)
     {
-        preg->energize_vac_solenoid2 = 0;  // close the valve on startup
     }
 
     // functor for controlling the vacuum solenoid
     // returns the solenoid's previous state.
-    vacuum operator() (vacuum val)
+    constexpr vacuum operator() (vacuum val)
     {
-        // store the solenoid's current state
-        vacuum retval = get_current_state();
-
-        // set solenoid to new state
-        preg->energize_vac_solenoid2 = (val == vacuum::OFF ? 0 : 1);
+        // set the solenoid to the new state, unless it is already in it or
+        // toggling it now would overheat its coil. Note4, Note5
+        const std::uint16_t old_bit =
+            reg23_write_field<instrumentation>(reg23_access<ordering>{ preg }, SOLENOID2_FIELD, (val == vacuum::OFF ? 0 : 1),
+                                               [this]() { return rate_limit::admit(*this); });
 
         // return the solenoid's 'prior to call' state
-        return retval;
+        return (old_bit == 0 ? vacuum::OFF : vacuum::ON);
     }
 
     // functor for returning the vacuum solenoid's current state
-    vacuum operator() ()
+    constexpr vacuum operator() ()
     {
-        return get_current_state();
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        vacuum retval = get_current_state(reg23_load<ordering>(preg));
+
+        instrumentation::read(GPIO_REG23_ID, SOLENOID2_FIELD_ID, t0, (retval == vacuum::OFF ? 0 : 1));
+
+        return retval;
     }
 
 private:
-    vacuum get_current_state()
+    static constexpr vacuum get_current_state(std::uint16_t word)
     {
         // init to vacuum solenoid being de-energized
         vacuum retval = vacuum::OFF;
 
         // if power is currently applied to the vacuum solenoid
-        if (preg->energize_vac_solenoid2 == 1)
+        if (SOLENOID2_FIELD.extract(word) == 1)
         {
             retval = vacuum::ON;
         }
@@ -106,50 +367,65 @@ private:
         return retval;
     }
 
-    volatile gpio_reg23_ptr_t preg;
+    gpio_reg23_ptr_t preg;
 };
 
 
 
 // class template partial specialization
 // for the vac_solenoid3 control functor
-template<>
-class gpio_register_23< solenoid3_t >
+template< typename instrumentation, typename rate_limit, typename ordering >
+class gpio_register_23< solenoid3_t, instrumentation, rate_limit, ordering > : private rate_limit::bucket_ref    // Note5
 {
+    static_assert(reg23_tracked_by<instrumentation>(), "the instrumentation can't account for register #23's fields");
+
 public:
-    gpio_register_23(gpio_reg23_ptr_t preg_)  : preg(preg_)
+    constexpr gpio_register_23(gpio_reg23_ptr_t preg_)
+        : rate_limit::bucket_ref(rate_limit::bucket_for(preg_, SOLENOID3_FIELD_ID)), preg(preg_)
+    {
+        // close the valve on startup
+        reg23_store<ordering>(preg, SOLENOID3_FIELD.insert(reg23_load<ordering>(preg), 0));
+    }
+
+    constexpr gpio_register_23(gpio_reg23_ptr_t preg_, reg23_attach_t)     // Note7
+        : rate_limit::bucket_ref(rate_limit::bucket_for(preg_, SOLENOID3_FIELD_ID)), preg(preg_)
     {
-        preg->energize_vac_solenoid3 = 0;  // close the valve on startup
     }
 
     // functor for controlling the vacuum solenoid
     // returns the solenoid's previous state.
-    vacuum operator() (vacuum val)
+    constexpr vacuum operator() (vacuum val)
     {
-        // store the solenoid's current state
-        vacuum retval = get_current_state();
-
-        // set solenoid to new state
-        preg->energize_vac_solenoid3 = (val == vacuum::OFF ? 0 : 1);
+        // set the solenoid to the new state, unless it is already in it or
+        // toggling it now would overheat its coil. Note4, Note5
+        const std::uint16_t old_bit =
+            reg23_write_field<instrumentation>(reg23_access<ordering>{ preg }, SOLENOID3_FIELD, (val == vacuum::OFF ? 0 : 1),
+                                               [this]() { return rate_limit::admit(*this); });
 
         // return the solenoid's 'prior to call' state
-        return retval;
+        return (old_bit == 0 ? vacuum::OFF : vacuum::ON);
     }
 
     // functor for returning the vacuum solenoid's current state
-    vacuum operator() ()
+    constexpr vacuum operator() ()
     {
-        return get_current_state();
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        vacuum retval = get_current_state(reg23_load<ordering>(preg));
+
+        instrumentation::read(GPIO_REG23_ID, SOLENOID3_FIELD_ID, t0, (retval == vacuum::OFF ? 0 : 1));
+
+        return retval;
     }
 
 private:
-    vacuum get_current_state()
+    static constexpr vacuum get_current_state(std::uint16_t word)
     {
         // init to vacuum solenoid being de-energized
         vacuum retval = vacuum::OFF;
 
         // if power is currently applied to the vacuum solenoid
-        if (preg->energize_vac_solenoid3 == 1)
+        if (SOLENOID3_FIELD.extract(word) == 1)
         {
             retval = vacuum::ON;
         }
@@ -157,56 +433,54 @@ private:
         return retval;
     }
 
-    volatile gpio_reg23_ptr_t preg;
+    gpio_reg23_ptr_t preg;
 };
 
 // class template partial specialization
 // for the lamp control functor
-template<>
-class gpio_register_23< lamp_t >
+template< typename instrumentation, typename ordering >
+class gpio_register_23< lamp_t, instrumentation, no_rate_limit, ordering >    // the lamp has no coil to protect
 {
+    static_assert(reg23_tracked_by<instrumentation>(), "the instrumentation can't account for register #23's fields");
+
 public:
-    gpio_register_23(gpio_reg23_ptr_t preg_)  : preg(preg_)
+    constexpr gpio_register_23(gpio_reg23_ptr_t preg_)  : preg(preg_)
     {
-        preg->lamp_pwr = LIGHTS_OUT;  // kill the lamp on startup
+        // kill the lamp on startup
+        reg23_store<ordering>(preg, LAMP_PWR_FIELD.insert(reg23_load<ordering>(preg), LIGHTS_OUT));
     }
 
+    constexpr gpio_register_23(gpio_reg23_ptr_t preg_, reg23_attach_t)  : preg(preg_) {}    // Note7
+
     // functor for controlling the lamp's power setting
-    std::uint16_t operator() (lamp_t val)
+    constexpr std::uint16_t operator() (lamp_t val)
     {
-        // if the caller specified a power setting that is out of range
-        if (val >= LAMP_OOR)
-        {
-            std::stringstream msg{};
-            msg << "Incorrect attempt to set lamp #42 pwr value to (" << val << "). "
-                << "Valid pwr settings range for lamp #42 is 0:7. ";
-            throw std::range_error( msg.str() );
-        }
-
-        // store the lamp's current power setting
-        std::uint16_t retval = get_current_state();
-
-        preg->lamp_pwr = {val};     // update lamp power setting
-
+        // update the lamp's power setting, unless it is out of range
+        // (LAMP_OOR and up) or the lamp is already at it. Note4
         // return the lamp's 'prior to call' power setting
-        return retval;
+        return reg23_write_field<instrumentation>(reg23_access<ordering>{ preg }, LAMP_PWR_FIELD, val);
     }
 
     // functor for returning the lamp's current power setting
-    std::uint16_t operator() ()
+    constexpr std::uint16_t operator() ()
     {
-        return get_current_state();
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        std::uint16_t retval = get_current_state();
+
+        instrumentation::read(GPIO_REG23_ID, LAMP_PWR_FIELD_ID, t0, retval);
+
+        return retval;
     }
 
 
 private:
-    std::uint16_t get_current_state()
+    constexpr std::uint16_t get_current_state()
     {
-        return preg->lamp_pwr;
+        return LAMP_PWR_FIELD.extract(reg23_load<ordering>(preg));
     }
 
-    volatile gpio_reg23_ptr_t preg;
+    gpio_reg23_ptr_t preg;
 };
 
-
-
+#endif // CONTROL_BOARD_GPIO_REG23_H
@@ -0,0 +1,63 @@
+// cycle_counter.h
+//
+// read_cycle_counter() -- returns a free running, monotonic tick count
+//
+//      Used for timing register accesses. Reading the counter is a
+//      single instruction on the CPUs we care about, no syscall.
+//
+//      x86:      the TSC (rdtsc)
+//      aarch64:  the generic timer's virtual count (cntvct_el0)
+//      others:   std::chrono::steady_clock, in nanoseconds
+//
+//  Note1:  The ticks are not necessarily CPU cycles, nor nanoseconds.
+//          Use cycle_counter_hz() when ticks need converting into
+//          seconds.
+
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include <chrono>       //  std::chrono::steady_clock
+#include <cstdint>      //  std::uint64_t
+#include <thread>       //  std::this_thread::sleep_for
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>  //  __rdtsc
+#endif
+
+inline std::uint64_t read_cycle_counter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// cycle_counter_hz() -- ticks per second of read_cycle_counter(). See Note1
+//
+//      Calibrated once, on first use, against steady_clock
+inline double cycle_counter_hz()
+{
+    static const double hz = []()
+    {
+        const auto          t0     = std::chrono::steady_clock::now();
+        const std::uint64_t ticks0 = read_cycle_counter();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        const std::uint64_t ticks1 = read_cycle_counter();
+        const auto          t1     = std::chrono::steady_clock::now();
+
+        const double secs = std::chrono::duration<double>(t1 - t0).count();
+        return static_cast<double>(ticks1 - ticks0) / secs;
+    }();
+
+    return hz;
+}
+
+#endif // CYCLE_COUNTER_H
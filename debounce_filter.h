@@ -0,0 +1,235 @@
+// debounce_filter.h
+//
+// debounce_filter -- filters glitches out of a readback register's bits
+//
+//      Each sample() takes a raw register word. The filter keeps the last
+//      few samples, and filters all 16 bits of the word at once with
+//      bitwise operations: no per-bit loop, and no data dependent branch.
+//      The rule it applies is a template parameter:
+//
+//          majority_vote<N>  -- a bit is 1 while most of its last N
+//                               samples were 1 (N odd)
+//          stable_for<K>     -- a bit changes only once its last K
+//                               samples agree; otherwise it holds
+//
+//      Before its first sample the filtered word is all zeros, as is the
+//      history the rules look back on.
+//
+//      debounced_gpio_register_23 getter functors read the filtered state
+//      of register #23's fields, just as gpio_register_23's getters read
+//      the raw state.
+//
+//  Note1:  majority_vote keeps, for every bit, the count of 1s among its
+//          last N samples as a bit-sliced ("vertical") counter: plane b
+//          holds bit b of all 16 counts. A sample entering the window is
+//          added to all 16 counts with one ripple of AND/XOR over the
+//          planes, and the sample leaving it is subtracted the same way
+//          (first, so that no count ever exceeds N).
+//
+//  Note2:  the counts are compared against the threshold plane by plane from the
+//          top. The threshold's bits are compile-time constants, so the
+//          comparison's branches are resolved by the compiler.
+//
+//  Note3:  multi-bit fields (e.g., lamp_pwr) are filtered bit by bit, so
+//          while a field is changing its filtered value may briefly be a
+//          mix of its old and new bits.
+
+#ifndef DEBOUNCE_FILTER_H
+#define DEBOUNCE_FILTER_H
+
+#include <array>        //  std::array
+#include <cstdint>      //  std::uint16_t
+
+#include "control_board_gpio_reg23.h"
+#include "register_descriptor.h"
+
+// bits needed to count from 0 to n
+constexpr unsigned counter_bits(unsigned n)
+{
+    return n == 0 ? 0 : 1 + counter_bits(n >> 1);
+}
+
+// majority_vote -- each bit is the majority of its last N samples
+template< unsigned N >
+class majority_vote
+{
+    static_assert(N % 2 == 1 && N <= 31, "majority_vote needs an odd number of samples, 31 at most");
+
+public:
+    static const unsigned SAMPLES { N };
+
+    std::uint16_t update(std::uint16_t word, std::uint16_t /*filtered*/)
+    {
+        const std::uint16_t leaving = window_[oldest_];
+        window_[oldest_] = word;
+        oldest_ = (oldest_ + 1) % N;
+
+        subtract(leaving);                                                  // Note1
+        add(word);
+
+        return at_least(N / 2 + 1);
+    }
+
+private:
+    static const unsigned PLANES { counter_bits(N) };
+
+    void add(std::uint16_t bits)
+    {
+        std::uint16_t carry = bits;
+        for (unsigned b = 0; b < PLANES; ++b)
+        {
+            const std::uint16_t next_carry = planes_[b] & carry;
+            planes_[b] ^= carry;
+            carry = next_carry;
+        }
+    }
+
+    void subtract(std::uint16_t bits)
+    {
+        std::uint16_t borrow = bits;
+        for (unsigned b = 0; b < PLANES; ++b)
+        {
+            const std::uint16_t next_borrow = static_cast<std::uint16_t>(~planes_[b] & borrow);
+            planes_[b] ^= borrow;
+            borrow = next_borrow;
+        }
+    }
+
+    // the bits whose count is at least threshold. Note2
+    std::uint16_t at_least(unsigned threshold) const
+    {
+        std::uint16_t greater = 0;
+        std::uint16_t equal   = 0xFFFF;
+
+        for (unsigned b = PLANES; b-- > 0; )
+        {
+            if ((threshold >> b) & 1u)
+            {
+                equal &= planes_[b];
+            }
+            else
+            {
+                greater |= equal & planes_[b];
+                equal   &= static_cast<std::uint16_t>(~planes_[b]);
+            }
+        }
+
+        return greater | equal;
+    }
+
+    std::array<std::uint16_t, N>        window_ {};
+    std::array<std::uint16_t, PLANES>   planes_ {};
+    unsigned                            oldest_ {0};
+};
+
+// stable_for -- each bit takes its new value once its last K samples agree
+template< unsigned K >
+class stable_for
+{
+    static_assert(K >= 1 && K <= 32, "stable_for needs 1 to 32 samples");
+
+public:
+    static const unsigned SAMPLES { K };
+
+    std::uint16_t update(std::uint16_t word, std::uint16_t filtered)
+    {
+        window_[newest_] = word;
+        newest_ = (newest_ + 1) % K;
+
+        std::uint16_t all_ones  = 0xFFFF;
+        std::uint16_t all_zeros = 0xFFFF;
+        for (std::uint16_t w : window_)
+        {
+            all_ones  &= w;
+            all_zeros &= static_cast<std::uint16_t>(~w);
+        }
+
+        return static_cast<std::uint16_t>((filtered & ~all_zeros) | all_ones);
+    }
+
+private:
+    std::array<std::uint16_t, K>    window_ {};
+    unsigned                        newest_ {0};
+};
+
+
+template< typename rule >
+class debounce_filter
+{
+public:
+    // sample() -- filters in the next raw word. Returns the filtered word
+    std::uint16_t sample(std::uint16_t word)
+    {
+        filtered_ = rule_.update(word, filtered_);
+        return filtered_;
+    }
+
+    std::uint16_t sample(const volatile std::uint16_t* reg) { return sample(*reg); }
+
+    std::uint16_t filtered() const { return filtered_; }
+
+    std::uint16_t filtered(const field_descriptor& field) const { return field.extract(filtered_); }
+
+private:
+    rule            rule_     {};
+    std::uint16_t   filtered_ {0};
+};
+
+
+// debounced_gpio_register_23 -- getters for the filtered state of
+//                               register #23's fields
+//
+//      Like gpio_register_23 there is a partial specialization per field.
+//      Unlike it, there are no setters: the filtered state is read only.
+template< typename field, typename rule >
+class debounced_gpio_register_23;    // Note2 of control_board_gpio_reg23.h
+
+template< typename rule >
+class debounced_gpio_register_23< solenoid2_t, rule >
+{
+public:
+    explicit debounced_gpio_register_23(const debounce_filter<rule>& filter_) : filter(filter_) {}
+
+    // the solenoid's filtered state
+    vacuum operator() () const
+    {
+        return filter.filtered(SOLENOID2_FIELD) == 1 ? vacuum::ON : vacuum::OFF;
+    }
+
+private:
+    const debounce_filter<rule>& filter;
+};
+
+template< typename rule >
+class debounced_gpio_register_23< solenoid3_t, rule >
+{
+public:
+    explicit debounced_gpio_register_23(const debounce_filter<rule>& filter_) : filter(filter_) {}
+
+    // the solenoid's filtered state
+    vacuum operator() () const
+    {
+        return filter.filtered(SOLENOID3_FIELD) == 1 ? vacuum::ON : vacuum::OFF;
+    }
+
+private:
+    const debounce_filter<rule>& filter;
+};
+
+template< typename rule >
+class debounced_gpio_register_23< lamp_t, rule >
+{
+public:
+    explicit debounced_gpio_register_23(const debounce_filter<rule>& filter_) : filter(filter_) {}
+
+    // the lamp's filtered power setting. See Note3
+    std::uint16_t operator() () const
+    {
+        return filter.filtered(LAMP_PWR_FIELD);
+    }
+
+private:
+    const debounce_filter<rule>& filter;
+};
+
+#endif // DEBOUNCE_FILTER_H
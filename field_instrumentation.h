@@ -0,0 +1,293 @@
+// field_instrumentation.h
+//
+// Compile-time instrumentation policies for the field functors
+// (e.g., gpio_register_23).
+//
+// A field functor takes its instrumentation policy as a template
+// parameter and calls the policy's static hooks at each access:
+//
+//      begin()          -- called on entry to a getter or setter. Returns
+//                          a stamp handed back to the hook below
+//      read()           -- a getter returned the field's value
+//      write()          -- a setter stored a new value into the field
+//      elided_write()   -- a setter found the field already held the
+//                          requested value, so it skipped the store
+//      range_error()    -- a setter rejected an out of range value
+//      rate_limited()   -- a setter's rate limiting policy refused a
+//                          toggle, so it skipped the store (see
+//                          solenoid_rate_limit.h)
+//
+// Fields are identified by a (register key, field id) pair, where the
+// register key is the register's id qualified by its register space (see
+// register_descriptor.h). A board register's key is its register id.
+//
+// Every policy also says, through tracks(), which fields it can account
+// for. The functors static_assert it of their fields, and the hooks are
+// noexcept: they run after a setter's store has landed, so a hook that
+// threw would report a failed write that in fact happened.
+//
+// no_instrumentation is the default policy. All of its hooks are empty
+// inline functions, so it compiles out entirely. See Note1
+//
+// counting_instrumentation counts the accesses to each field, along with
+// the ticks spent in them (see cycle_counter.h).
+
+#ifndef FIELD_INSTRUMENTATION_H
+#define FIELD_INSTRUMENTATION_H
+
+#include <atomic>       //  std::atomic
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint8_t, std::uint16_t, std::uint64_t
+#include <type_traits>  //  std::is_empty
+
+#include "cycle_counter.h"
+#include "per_thread_registry.h"
+#include "register_descriptor.h"
+#include "register_error.h"
+
+const std::size_t CACHE_LINE_SIZE { 64 };
+
+// Note1:   codegen_control_board_gpio_reg23.cpp verifies that functors
+//          using no_instrumentation carry no trace of the policy.
+struct no_instrumentation
+{
+    typedef std::uint8_t stamp_t;
+
+    static constexpr bool tracks(register_key_t, std::uint8_t) { return true; }
+
+    // constexpr, so that uninstrumented functors can run in constant expressions
+    static constexpr stamp_t begin() noexcept { return 0; }
+
+    static constexpr void read        (register_key_t, std::uint8_t, stamp_t, std::uint16_t /*val*/) noexcept {}
+    static constexpr void write       (register_key_t, std::uint8_t, stamp_t, std::uint16_t /*old_val*/, std::uint16_t /*new_val*/) noexcept {}
+    static constexpr void elided_write(register_key_t, std::uint8_t, stamp_t, std::uint16_t /*val*/) noexcept {}
+    static constexpr void range_error (register_key_t, std::uint8_t, std::uint16_t /*val*/) noexcept {}
+    static constexpr void rate_limited(register_key_t, std::uint8_t, stamp_t, std::uint16_t /*val*/) noexcept {}
+};
+
+static_assert(std::is_empty<no_instrumentation>::value, "no_instrumentation must not carry state");
+
+
+// snapshot of the access counts for one field
+struct field_stats
+{
+    std::uint64_t reads         {0};
+    std::uint64_t writes        {0};
+    std::uint64_t elided_writes {0};
+    std::uint64_t range_errors  {0};
+    std::uint64_t rate_limited  {0};
+    std::uint64_t ticks         {0};   // ticks spent in the field's getters and setters
+};
+
+
+// counting_instrumentation
+//
+//      Each thread gets its own table of counters, with each field's
+//      counters padded out to a cache line. Consequently the hooks never
+//      contend with another thread, nor share a cache line with another
+//      field's counters.
+//
+//      A thread's counters are readable from other threads, so that
+//      all_threads() can total them up. See Note2
+//
+//      The counters of a thread that has exited are folded into a
+//      running total, so its counts are not lost.
+//
+//      A field outside the table -- a register space, register id or
+//      field id beyond MAX_SPACES, MAX_REGISTERS or MAX_FIELDS -- is
+//      not tracked. A functor instrumented with it fails to compile, and
+//      this_thread() or all_threads() reject it with std::range_error.
+//      See Note3
+struct counting_instrumentation
+{
+    typedef std::uint64_t stamp_t;
+
+    static const std::size_t MAX_SPACES    {  4 };  // register spaces range 0:3: the board's, and up to three ICs'
+    static const std::size_t MAX_REGISTERS { 32 };  // register ids range 0:31 within each space
+    static const std::size_t MAX_FIELDS    {  8 };  // field ids range 0:7
+    static const std::size_t MAX_KEYS      { MAX_SPACES * MAX_REGISTERS };
+
+    // tracks() -- whether a [MAX_KEYS][MAX_FIELDS] table holds the given field. Note3
+    static constexpr bool tracks(register_key_t key, std::uint8_t field_id)
+    {
+        return key_space(key) < MAX_SPACES && key_reg_id(key) < MAX_REGISTERS && field_id < MAX_FIELDS;
+    }
+
+    // table_row() -- the row of a [MAX_KEYS][MAX_FIELDS] table holding the
+    //                given field. Throws std::range_error for a field the
+    //                table can't hold
+    static std::size_t table_row(register_key_t key, std::uint8_t field_id)
+    {
+        if (!tracks(key, field_id))
+        {
+            throw_untracked_field(key, field_id);
+        }
+        return tracked_row(key);
+    }
+
+    // the row of a field known to be tracked
+    static constexpr std::size_t tracked_row(register_key_t key)
+    {
+        return key_space(key) * MAX_REGISTERS + key_reg_id(key);
+    }
+
+    static stamp_t begin() noexcept { return read_cycle_counter(); }
+
+    static void read(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t) noexcept
+    {
+        if (counters* c = this_threads_counters(key, field_id))
+        {
+            bump(c->reads, 1);
+            bump(c->ticks, read_cycle_counter() - t0);
+        }
+    }
+
+    static void write(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t, std::uint16_t) noexcept
+    {
+        if (counters* c = this_threads_counters(key, field_id))
+        {
+            bump(c->writes, 1);
+            bump(c->ticks, read_cycle_counter() - t0);
+        }
+    }
+
+    static void elided_write(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t) noexcept
+    {
+        if (counters* c = this_threads_counters(key, field_id))
+        {
+            bump(c->elided_writes, 1);
+            bump(c->ticks, read_cycle_counter() - t0);
+        }
+    }
+
+    static void range_error(register_key_t key, std::uint8_t field_id, std::uint16_t) noexcept
+    {
+        if (counters* c = this_threads_counters(key, field_id))
+        {
+            bump(c->range_errors, 1);
+        }
+    }
+
+    static void rate_limited(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t) noexcept
+    {
+        if (counters* c = this_threads_counters(key, field_id))
+        {
+            bump(c->rate_limited, 1);
+            bump(c->ticks, read_cycle_counter() - t0);
+        }
+    }
+
+    // returns the calling thread's counts for the given field
+    static field_stats this_thread(register_key_t key, std::uint8_t field_id)
+    {
+        field_stats stats {};
+        accumulate(stats, this_threads_table().fields[table_row(key, field_id)][field_id]);
+        return stats;
+    }
+
+    // returns the given field's counts totalled over every thread,
+    // including the threads which have since exited
+    static field_stats all_threads(register_key_t key, std::uint8_t field_id)
+    {
+        const std::size_t row = table_row(key, field_id);
+
+        field_stats stats {};
+        registry::visit( [&](const retired_table& retired) { accumulate(stats, retired.fields[row][field_id]); },
+                         [&](const table& t)               { accumulate(stats, t.fields[row][field_id]); } );
+        return stats;
+    }
+
+private:
+    // Note3:   an IC's register addresses run up to 255, so not every
+    //          field fits the tables. The functors static_assert tracks()
+    //          of their fields, so an untracked field is caught when it
+    //          is compiled. The hooks still check the ids rather than
+    //          trust them to index the tables, but they skip an untracked
+    //          field rather than throw, since they run after the store.
+    //          Kept out of line, so that the query functions stay small.
+    [[noreturn]] __attribute__((noinline, cold))
+    static void throw_untracked_field(register_key_t key, std::uint8_t field_id)
+    {
+        throw register_range_error( "Field %u of register %u in register space %u is not instrumentable. "
+                                    "The instrumentation tracks register spaces 0:%u, registers 0:%u, fields 0:%u. ",
+                                    unsigned{field_id}, unsigned{key_reg_id(key)}, unsigned{key_space(key)},
+                                    unsigned(MAX_SPACES - 1), unsigned(MAX_REGISTERS - 1), unsigned(MAX_FIELDS - 1) );
+    }
+
+    struct alignas(CACHE_LINE_SIZE) counters
+    {
+        std::atomic<std::uint64_t> reads         {0};
+        std::atomic<std::uint64_t> writes        {0};
+        std::atomic<std::uint64_t> elided_writes {0};
+        std::atomic<std::uint64_t> range_errors  {0};
+        std::atomic<std::uint64_t> rate_limited  {0};
+        std::atomic<std::uint64_t> ticks         {0};
+    };
+
+    struct retired_table
+    {
+        field_stats fields[MAX_KEYS][MAX_FIELDS];
+    };
+
+    // one per thread. Folds its counts into the retired totals when the
+    // thread exits
+    struct table
+    {
+        counters fields[MAX_KEYS][MAX_FIELDS];
+
+        void retire(retired_table& retired) const
+        {
+            for (std::size_t row = 0; row < MAX_KEYS; ++row)
+            {
+                for (std::size_t fld = 0; fld < MAX_FIELDS; ++fld)
+                {
+                    accumulate(retired.fields[row][fld], fields[row][fld]);
+                }
+            }
+        }
+    };
+
+    typedef per_thread_registry<table, retired_table> registry;
+
+    // Note2:   only the owning thread ever writes to its counters, so
+    //          a relaxed load and store suffices; no locked read-modify-write
+    //          instruction is needed.
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static void accumulate(field_stats& stats, const counters& c)
+    {
+        stats.reads         += c.reads.load(std::memory_order_relaxed);
+        stats.writes        += c.writes.load(std::memory_order_relaxed);
+        stats.elided_writes += c.elided_writes.load(std::memory_order_relaxed);
+        stats.range_errors  += c.range_errors.load(std::memory_order_relaxed);
+        stats.rate_limited  += c.rate_limited.load(std::memory_order_relaxed);
+        stats.ticks         += c.ticks.load(std::memory_order_relaxed);
+    }
+
+    static void accumulate(field_stats& total, const field_stats& stats)
+    {
+        total.reads         += stats.reads;
+        total.writes        += stats.writes;
+        total.elided_writes += stats.elided_writes;
+        total.range_errors  += stats.range_errors;
+        total.rate_limited  += stats.rate_limited;
+        total.ticks         += stats.ticks;
+    }
+
+    static table& this_threads_table()
+    {
+        return registry::local();
+    }
+
+    // the calling thread's counters for the given field, or nullptr for
+    // a field the tables can't hold. Note3
+    static counters* this_threads_counters(register_key_t key, std::uint8_t field_id) noexcept
+    {
+        return tracks(key, field_id) ? &this_threads_table().fields[tracked_row(key)][field_id] : nullptr;
+    }
+};
+
+#endif // FIELD_INSTRUMENTATION_H
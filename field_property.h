@@ -0,0 +1,334 @@
+// field_property.h
+//
+// Property tests of field isolation: setting a field through its accessor
+// puts the value set in that field's bits, and changes no other bit of the
+// register file -- not a neighbouring field's, not a filler's, not another
+// register's. A field's getter returns what was set, and a range checked
+// accessor throws std::range_error on a value too wide for the field,
+// leaving the register file untouched.
+//
+//      check_fields_exhaustively() -- for small registers (16 bits or less).
+//          For every field, every value of the field's register word, and
+//          every value the field can hold, sets the field and checks the
+//          property. Each range checked field is also tried, for every
+//          register word, with a random value too wide for it.
+//
+//      check_fields_randomly() -- for register files too large to enumerate.
+//          Each iteration randomizes the whole register file, then sets a
+//          random field to a random value (one in FIELD_PROPERTY_OOR_ODDS
+//          of them too wide for a range checked field), and checks the
+//          property.
+//
+// Either returns the number of field writes checked, and the first
+// counterexample found, if any. See Note1
+//
+//      std::vector< field_under_test<std::uint16_t> > fields { ... };
+//      field_property_result r = check_fields_exhaustively(fields, 1, field_property_seed(0x23));
+//      if (!r.passed) { std::cout << r.counterexample; }
+//
+//  Note1:  the randomness (the other registers' background in the
+//          exhaustive check; everything in the random one) comes from a
+//          splitmix64 generator seeded by the caller, so a run is replayed
+//          by reusing its seed. field_property_seed() lets the UT_SEED
+//          environment variable override a test's default seed, and every
+//          counterexample says how to replay it:
+//
+//              UT_SEED=0x1234 ./ut_field_property.exe ut03
+//
+//  Note2:  a field's mask must come from an oracle independent of the
+//          accessor under test: e.g., the compiler's own layout of a
+//          bitfield struct, or the datasheet's bit numbers. A mask derived
+//          from the same descriptor as the accessor would agree with any
+//          bug in that descriptor.
+//
+//  Note3:  the checks run in the caller's thread, over plain function
+//          pointers and a register file on the stack, so that they go at
+//          millions of field writes per second. A field's set and get
+//          functions adapt its accessor to the register file.
+
+#ifndef FIELD_PROPERTY_H
+#define FIELD_PROPERTY_H
+
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <cstdlib>      //  std::getenv, std::strtoull
+#include <sstream>      //  std::stringstream
+#include <stdexcept>    //  std::range_error, std::length_error
+#include <string>       //  std::string
+#include <vector>       //  std::vector
+
+// the largest register file the checks take, in registers
+const std::size_t   FIELD_PROPERTY_MAX_REGS  { 64 };
+
+// the random check sets one in this many range checked writes out of range
+const std::uint64_t FIELD_PROPERTY_OOR_ODDS  { 64 };
+
+// field_property_rng -- splitmix64: small, fast, and good enough to draw
+//                       register images from. Note1
+class field_property_rng
+{
+public:
+    explicit field_property_rng(std::uint64_t seed) : state(seed) {}
+
+    std::uint64_t next()
+    {
+        std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // a value in [0, bound)
+    std::uint64_t below(std::uint64_t bound) { return next() % bound; }
+
+private:
+    std::uint64_t state;
+};
+
+// the test's seed: UT_SEED from the environment if set, else fallback. Note1
+inline std::uint64_t field_property_seed(std::uint64_t fallback)
+{
+    const char* env = std::getenv("UT_SEED");
+    return (env != nullptr ? std::strtoull(env, nullptr, 0) : fallback);
+}
+
+// a field, and how to set and get it through the accessor under test
+template< typename word_t >
+struct field_under_test
+{
+    std::string     name;
+    std::size_t     reg;                                        // the field's register, within the register file
+    word_t          mask;                                       // the field's bits, from an oracle. Note2
+    void          (*set)(word_t* regs, std::uint16_t val);      // Note3
+    std::uint16_t (*get)(word_t* regs);
+    bool            range_checked;                              // a value wider than the field throws std::range_error
+};
+
+struct field_property_result
+{
+    std::uint64_t   checks {0};         // field writes checked
+    bool            passed {true};
+    std::string     counterexample {};  // the first failure found
+};
+
+namespace field_property_detail
+{
+    inline void check_reg_count(std::size_t reg_count)
+    {
+        if (reg_count == 0 || reg_count > FIELD_PROPERTY_MAX_REGS)
+        {
+            std::stringstream msg{};
+            msg << "A register file of " << reg_count << " registers. "
+                << "The field property checks take 1:" << FIELD_PROPERTY_MAX_REGS << ". ";
+            throw std::length_error( msg.str() );
+        }
+    }
+
+    inline unsigned lowest_bit(std::uint64_t mask)
+    {
+        unsigned shift = 0;
+        while (mask != 0 && (mask & 1u) == 0)
+        {
+            mask >>= 1;
+            ++shift;
+        }
+        return shift;
+    }
+
+    // the largest value the field holds
+    template< typename word_t >
+    std::uint16_t max_value(const field_under_test<word_t>& f)
+    {
+        return static_cast<std::uint16_t>(std::uint64_t{f.mask} >> lowest_bit(f.mask));
+    }
+
+    template< typename word_t >
+    void fail(field_property_result& result, const field_under_test<word_t>& f, std::uint16_t val,
+              word_t before, word_t after, word_t expected, const std::string& what,
+              std::uint64_t seed, std::uint64_t iteration)
+    {
+        std::stringstream msg{};
+        msg << "field " << f.name << " (register " << f.reg << ", mask 0x" << std::hex << std::uint64_t{f.mask}
+            << "): set(" << std::dec << val << ") on 0x" << std::hex << std::uint64_t{before}
+            << " gave 0x" << std::uint64_t{after} << ", expected 0x" << std::uint64_t{expected};
+        if (((after ^ expected) & ~f.mask) != 0)
+        {
+            msg << ", disturbing bits 0x" << std::uint64_t{static_cast<word_t>((after ^ expected) & ~f.mask)}
+                << " outside the field";
+        }
+        msg << std::dec << ". " << what << std::endl
+            << "seed 0x" << std::hex << seed << std::dec << ", iteration " << iteration
+            << "; replay with UT_SEED=0x" << std::hex << seed << std::dec << std::endl;
+
+        result.passed         = false;
+        result.counterexample = msg.str();
+    }
+
+    // sets f to val on regs, and checks the property. Returns whether it held
+    template< typename word_t >
+    bool check_one(field_property_result& result, const field_under_test<word_t>& f, word_t* regs,
+                   std::size_t reg_count, std::uint16_t val, std::uint64_t seed, std::uint64_t iteration)
+    {
+        word_t before[FIELD_PROPERTY_MAX_REGS];
+        for (std::size_t r = 0; r < reg_count; ++r)
+        {
+            before[r] = regs[r];
+        }
+
+        const bool     in_range = val <= max_value(f);
+        const word_t   expected = (in_range
+                                    ? static_cast<word_t>((before[f.reg] & ~f.mask) | ((std::uint64_t{val} << lowest_bit(f.mask)) & f.mask))
+                                    : before[f.reg]);
+        const char*    threw    = nullptr;
+
+        ++result.checks;
+        try
+        {
+            f.set(regs, val);
+        }
+        catch (std::range_error&)
+        {
+            threw = "std::range_error";
+        }
+
+        std::string what {};
+        if (in_range && threw != nullptr)
+        {
+            what = std::string{"An in range value threw "} + threw + ".";
+        }
+        else if (!in_range && f.range_checked && threw == nullptr)
+        {
+            what = "An out of range value did not throw.";
+        }
+        else if (regs[f.reg] != expected)
+        {
+            what = "The field's register is wrong.";
+        }
+        else
+        {
+            for (std::size_t r = 0; r < reg_count && what.empty(); ++r)
+            {
+                if (r != f.reg && regs[r] != before[r])
+                {
+                    std::stringstream msg{};
+                    msg << "Register " << r << " changed from 0x" << std::hex << std::uint64_t{before[r]}
+                        << " to 0x" << std::uint64_t{regs[r]} << ".";
+                    what = msg.str();
+                }
+            }
+        }
+        if (what.empty() && in_range && f.get(regs) != val)
+        {
+            std::stringstream msg{};
+            msg << "The getter returned " << f.get(regs) << ".";
+            what = msg.str();
+        }
+
+        if (!what.empty())
+        {
+            fail(result, f, val, before[f.reg], regs[f.reg], expected, what, seed, iteration);
+        }
+        return what.empty();
+    }
+}
+
+// check_fields_exhaustively() -- checks every field, from every value of its
+//                                register word, with every value the field
+//                                holds. word_t is at most 16 bits
+template< typename word_t >
+field_property_result check_fields_exhaustively(const std::vector< field_under_test<word_t> >& fields,
+                                                std::size_t reg_count, std::uint64_t seed)
+{
+    static_assert(sizeof(word_t) <= sizeof(std::uint16_t), "a register too wide to enumerate; use check_fields_randomly()");
+
+    field_property_detail::check_reg_count(reg_count);
+
+    field_property_result result {};
+    field_property_rng    rng { seed };
+    std::uint64_t         iteration = 0;
+
+    for (const field_under_test<word_t>& f : fields)
+    {
+        word_t background[FIELD_PROPERTY_MAX_REGS];
+        for (std::size_t r = 0; r < reg_count; ++r)
+        {
+            background[r] = static_cast<word_t>(rng.next());
+        }
+
+        const std::uint16_t max = field_property_detail::max_value(f);
+        for (std::uint64_t word = 0; word <= word_t(~word_t{0}); ++word)
+        {
+            word_t regs[FIELD_PROPERTY_MAX_REGS];
+            for (std::uint32_t val = 0; val <= max; ++val, ++iteration)
+            {
+                for (std::size_t r = 0; r < reg_count; ++r)
+                {
+                    regs[r] = background[r];
+                }
+                regs[f.reg] = static_cast<word_t>(word);
+
+                if (!field_property_detail::check_one(result, f, regs, reg_count, static_cast<std::uint16_t>(val), seed, iteration))
+                {
+                    return result;
+                }
+            }
+
+            if (f.range_checked && max < 0xFFFF)
+            {
+                const std::uint16_t oor = static_cast<std::uint16_t>(max + 1 + rng.below(0xFFFFu - max));
+                for (std::size_t r = 0; r < reg_count; ++r)
+                {
+                    regs[r] = background[r];
+                }
+                regs[f.reg] = static_cast<word_t>(word);
+
+                if (!field_property_detail::check_one(result, f, regs, reg_count, oor, seed, iteration++))
+                {
+                    return result;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+// check_fields_randomly() -- checks iterations random writes of random
+//                            fields, each on a random register file
+template< typename word_t >
+field_property_result check_fields_randomly(const std::vector< field_under_test<word_t> >& fields,
+                                            std::size_t reg_count, std::uint64_t iterations, std::uint64_t seed)
+{
+    field_property_detail::check_reg_count(reg_count);
+
+    field_property_result result {};
+    field_property_rng    rng { seed };
+
+    for (std::uint64_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        word_t regs[FIELD_PROPERTY_MAX_REGS];
+        for (std::size_t r = 0; r < reg_count; ++r)
+        {
+            regs[r] = static_cast<word_t>(rng.next());
+        }
+
+        const field_under_test<word_t>& f   = fields[rng.below(fields.size())];
+        const std::uint16_t             max = field_property_detail::max_value(f);
+        const std::uint64_t             draw = rng.next();
+
+        std::uint16_t val = static_cast<std::uint16_t>((draw >> 8) % (std::uint64_t{max} + 1));
+        if (f.range_checked && max < 0xFFFF && draw % FIELD_PROPERTY_OOR_ODDS == 0)
+        {
+            val = static_cast<std::uint16_t>(max + 1 + (draw >> 8) % (0xFFFFu - max));
+        }
+
+        if (!field_property_detail::check_one(result, f, regs, reg_count, val, seed, iteration))
+        {
+            return result;
+        }
+    }
+
+    return result;
+}
+
+#endif // FIELD_PROPERTY_H
@@ -0,0 +1,310 @@
+// field_subscription.h
+//
+// Change notifications for register fields.
+//
+// field_subscription -- subscribes to changes of one field, e.g., "lamp_pwr
+//      changed" or "solenoid3 de-energized". Each change is delivered as a
+//      field_notification into the subscription's lock-free queue, and the
+//      subscription's eventfd becomes readable, so an HMI or logger thread
+//      can sleep in epoll (or poll, or select) until there is something to
+//      look at, rather than busy-poll the getters.
+//
+//          field_subscription lamp_changes{ GPIO_REG23_ID, LAMP_PWR_FIELD_ID };
+//          ...add lamp_changes.fd() to an epoll set, and when it's readable:
+//          lamp_changes.drain(notifications);
+//
+// notifying_instrumentation -- the instrumentation policy (see
+//      field_instrumentation.h) which delivers the notifications. Only
+//      changes made through functors using it are noticed.
+//
+//  Note1:  a write to a field nobody subscribes to costs one relaxed load.
+//
+//  Note2:  subscribers are published as an immutable list, replaced
+//          wholesale on each subscribe or unsubscribe. A write notifies
+//          the list it loaded, which keeps its subscribers' queues alive
+//          until it is done with them, even if they unsubscribe meanwhile.
+//
+//  Note3:  the eventfd is only written when the subscriber has read it
+//          since it was last written, so a burst of changes costs one
+//          system call, not one per change. The producer's exchange and
+//          the consumer's fence pair up: either the producer sees the
+//          flag cleared and writes the eventfd, or the consumer's drain
+//          sees the producer's notification.
+//
+//  Note4:  when a subscriber's queue is full the notification is not
+//          delivered; it is counted as dropped instead.
+
+#ifndef FIELD_SUBSCRIPTION_H
+#define FIELD_SUBSCRIPTION_H
+
+#include <atomic>       //  std::atomic, std::atomic_load, std::atomic_store
+#include <cerrno>       //  errno
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint8_t, std::uint16_t, std::uint64_t
+#include <memory>       //  std::shared_ptr, std::allocate_shared
+#include <mutex>        //  std::mutex, std::lock_guard
+#include <system_error> //  std::system_error
+#include <vector>       //  std::vector
+
+#include <poll.h>       //  poll
+#include <sys/eventfd.h>//  eventfd
+#include <unistd.h>     //  read, write, close
+
+#include "cycle_counter.h"
+#include "field_instrumentation.h"
+#include "mpsc_ring.h"
+#include "register_arena.h"
+
+struct field_notification
+{
+    std::uint64_t   tsc;        // read_cycle_counter() when the change was noticed
+    register_key_t  reg_key;    // the register's id, qualified by its space (see register_descriptor.h)
+    std::uint8_t    field_id;
+    std::uint16_t   old_val;
+    std::uint16_t   new_val;
+};
+
+// which changes a subscription is interested in
+enum class notify_when
+{
+    ANY_CHANGE,     // every change of the field's value
+    BECOMES,        // the field changes to the given value
+    LEAVES          // the field changes from the given value
+};
+
+const std::size_t SUBSCRIPTION_QUEUE_CAPACITY { 1024 };     // notifications per subscription
+
+
+class field_subscription
+{
+public:
+    // throws std::system_error if an eventfd can't be created, and
+    // std::range_error for a field the registry can't hold
+    field_subscription(register_key_t key, std::uint8_t field_id,
+                       notify_when when = notify_when::ANY_CHANGE, std::uint16_t value = 0)
+        : state_(std::allocate_shared<state>(register_allocator<state>{},
+                                             counting_instrumentation::table_row(key, field_id), key, field_id, when, value))
+    {
+        subscribe(state_);
+    }
+
+    ~field_subscription()
+    {
+        unsubscribe(state_);
+    }
+
+    field_subscription(const field_subscription&)            = delete;
+    field_subscription& operator=(const field_subscription&) = delete;
+
+    // readable whenever undrained notifications may be waiting
+    int fd() const { return state_->efd; }
+
+    // drain() -- appends the waiting notifications, oldest first.
+    //            Returns the number appended. Never blocks
+    std::size_t drain(std::vector<field_notification>& notifications)
+    {
+        std::uint64_t signals;
+        if (::read(state_->efd, &signals, sizeof(signals)) < 0 && errno != EAGAIN)
+        {
+            throw std::system_error(errno, std::generic_category(), "field_subscription: reading eventfd");
+        }
+
+        state_->signalled.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst);                // Note3
+
+        std::size_t drained = 0;
+        field_notification n;
+        while (state_->queue.pop(n))
+        {
+            notifications.push_back(n);
+            ++drained;
+        }
+        return drained;
+    }
+
+    // wait() -- sleeps until a notification may be waiting, or until
+    //           timeout_ms have passed (-1 waits forever). Returns false
+    //           on timeout
+    bool wait(int timeout_ms) const
+    {
+        pollfd pfd { state_->efd, POLLIN, 0 };
+        const int ready = ::poll(&pfd, 1, timeout_ms);
+        if (ready < 0 && errno != EINTR)
+        {
+            throw std::system_error(errno, std::generic_category(), "field_subscription: polling eventfd");
+        }
+        return ready > 0;
+    }
+
+    // the number of notifications lost to a full queue. See Note4
+    std::uint64_t dropped() const { return state_->dropped.load(std::memory_order_relaxed); }
+
+    // notify() -- delivers a change of (key, field_id) to its subscribers.
+    //             Called by notifying_instrumentation
+    //             Nobody can subscribe to a field the registry can't
+    //             hold, so such a change is skipped
+    static void notify(register_key_t key, std::uint8_t field_id, std::uint16_t old_val, std::uint16_t new_val) noexcept
+    {
+        if (!counting_instrumentation::tracks(key, field_id))
+        {
+            return;
+        }
+        const std::size_t row = counting_instrumentation::tracked_row(key);
+
+        if (the_registry().subscribed[row][field_id].load(std::memory_order_relaxed) == 0)      // Note1
+        {
+            return;
+        }
+
+        const std::shared_ptr<const subscriber_list> subscribers =
+            std::atomic_load(&the_registry().lists[row][field_id]);         // Note2
+        if (!subscribers)
+        {
+            return;
+        }
+
+        const field_notification n { read_cycle_counter(), key, field_id, old_val, new_val };
+
+        for (const std::shared_ptr<state>& s : *subscribers)
+        {
+            if (s->wants(old_val, new_val))
+            {
+                s->deliver(n);
+            }
+        }
+    }
+
+private:
+    static const std::size_t MAX_KEYS      { counting_instrumentation::MAX_KEYS };
+    static const std::size_t MAX_FIELDS    { counting_instrumentation::MAX_FIELDS };
+
+    struct state
+    {
+        state(std::size_t row_, register_key_t key_, std::uint8_t field_id_, notify_when when_, std::uint16_t value_)
+            : row(row_), key(key_), field_id(field_id_), when(when_), value(value_),
+              efd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+        {
+            if (efd < 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "field_subscription: creating eventfd");
+            }
+        }
+
+        ~state() { ::close(efd); }
+
+        bool wants(std::uint16_t old_val, std::uint16_t new_val) const
+        {
+            switch (when)
+            {
+                case notify_when::BECOMES: return new_val == value;
+                case notify_when::LEAVES:  return old_val == value;
+                default:                   return true;
+            }
+        }
+
+        void deliver(const field_notification& n)
+        {
+            if (!queue.push(n))
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);            // Note4
+                return;
+            }
+
+            if (!signalled.exchange(true))                                  // Note3
+            {
+                const std::uint64_t one = 1;
+                (void)!::write(efd, &one, sizeof(one));
+            }
+        }
+
+        const std::size_t       row;        // of the registry's tables
+        const register_key_t    key;
+        const std::uint8_t      field_id;
+        const notify_when       when;
+        const std::uint16_t     value;
+        const int               efd;
+
+        mpsc_ring<field_notification, SUBSCRIPTION_QUEUE_CAPACITY> queue;
+        std::atomic<bool>                                          signalled {false};
+        std::atomic<std::uint64_t>                                 dropped   {0};
+    };
+
+    typedef register_vector< std::shared_ptr<state> > subscriber_list;
+
+    struct registry
+    {
+        std::mutex                                  mtx;        // serializes subscribe and unsubscribe
+        std::shared_ptr<const subscriber_list>      lists[MAX_KEYS][MAX_FIELDS];
+        std::atomic<std::uint32_t>                  subscribed[MAX_KEYS][MAX_FIELDS] {};
+    };
+
+    static registry& the_registry()
+    {
+        static registry r;
+        return r;
+    }
+
+    static void subscribe(const std::shared_ptr<state>& s)
+    {
+        registry& r = the_registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+
+        std::shared_ptr<const subscriber_list>& list = r.lists[s->row][s->field_id];
+
+        auto replacement = std::allocate_shared<subscriber_list>(register_allocator<subscriber_list>{}, list ? *list : subscriber_list{});
+        replacement->push_back(s);
+
+        std::atomic_store(&list, std::shared_ptr<const subscriber_list>(replacement));
+        r.subscribed[s->row][s->field_id].store(static_cast<std::uint32_t>(replacement->size()), std::memory_order_relaxed);
+    }
+
+    static void unsubscribe(const std::shared_ptr<state>& s)
+    {
+        registry& r = the_registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+
+        std::shared_ptr<const subscriber_list>& list = r.lists[s->row][s->field_id];
+
+        auto replacement = std::allocate_shared<subscriber_list>(register_allocator<subscriber_list>{});
+        for (const std::shared_ptr<state>& other : *list)
+        {
+            if (other != s)
+            {
+                replacement->push_back(other);
+            }
+        }
+
+        r.subscribed[s->row][s->field_id].store(static_cast<std::uint32_t>(replacement->size()), std::memory_order_relaxed);
+        std::atomic_store(&list, std::shared_ptr<const subscriber_list>(replacement));
+    }
+
+    std::shared_ptr<state> state_;
+};
+
+
+// notifying_instrumentation -- notifies each change made through a functor
+struct notifying_instrumentation
+{
+    typedef std::uint8_t stamp_t;
+
+    static constexpr bool tracks(register_key_t key, std::uint8_t field_id)
+    {
+        return counting_instrumentation::tracks(key, field_id);
+    }
+
+    static stamp_t begin() noexcept { return 0; }
+
+    static void read(register_key_t, std::uint8_t, stamp_t, std::uint16_t) noexcept {}
+
+    static void write(register_key_t key, std::uint8_t field_id, stamp_t, std::uint16_t old_val, std::uint16_t new_val) noexcept
+    {
+        field_subscription::notify(key, field_id, old_val, new_val);
+    }
+
+    // an elided write changes nothing, and a rejected or refused one never happened
+    static void elided_write(register_key_t, std::uint8_t, stamp_t, std::uint16_t) noexcept {}
+    static void range_error (register_key_t, std::uint8_t, std::uint16_t) noexcept {}
+    static void rate_limited(register_key_t, std::uint8_t, stamp_t, std::uint16_t) noexcept {}
+};
+
+#endif // FIELD_SUBSCRIPTION_H
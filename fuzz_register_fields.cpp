@@ -0,0 +1,938 @@
+// fuzz_register_fields.cpp
+//
+// Coverage guided fuzz target for the register field APIs.
+//
+// LLVMFuzzerTestOneInput() interprets its input as a sequence of steps on
+// mock registers: field writes and reads through register #23's functors,
+// a board_handle, the tick read cache and register_transaction; frames
+// composed and committed through a reg23_frame_buffer; and an MCP23017's
+// fields written, fetched and flushed through a bus_batch on a
+// simulated_bus, with snapshots of the device read back through ic_device.
+// After every step the registers, the return values and the write/elided
+// write counts are cross-checked against a reference model. The optimized
+// paths -- write elision, the tick cache, the bus batch's coalesced and
+// bridged bursts, the all-or-nothing commits -- must be indistinguishable
+// from the model. See Note1
+//
+//      make fuzz           -- builds with clang's -fsanitize=fuzzer (plus
+//                             address and undefined), and fuzzes for
+//                             FUZZ_SECONDS, keeping its corpus in ./fuzz_corpus
+//      make fuzz_check     -- builds with g++ and a stand-in driver, and
+//                             runs random inputs. See Note4
+//
+//  Note1:  the model is deliberately simple: a plain word per register,
+//          fields as the datasheet's bit numbers, and the documented
+//          behavior spelled out step by step. It shares no code with the
+//          APIs under test.
+//
+//  Note2:  the model follows the APIs' documented contracts rather than
+//          avoiding them: the tick cache's getters don't see writes made
+//          by others within a tick (Note1 of tick_read_cache.h), though
+//          its setters read afresh. A transaction commits only the fields
+//          it staged, merged into the register's word as it is at the
+//          commit, so writes made by others since it began are kept, and
+//          the interlock is checked against the merged word (Note3 of
+//          register_interlock.h). The expander, on the other hand, has one
+//          writer, its bus_batch, as register_bus.h assumes; the
+//          "hardware" only changes its input registers.
+//
+//  Note3:  a mismatch prints the step, and aborts. libFuzzer reports the
+//          abort as a crash and saves the input, which replays with
+//
+//              ./fuzz_register_fields.exe crash-<sha1>
+//
+//  Note4:  without clang, FUZZ_STANDALONE builds a main() that runs the
+//          inputs named on its command line, then -runs=N random inputs
+//          (of up to -max_len=N bytes, from -seed=N). It is not coverage
+//          guided, but exercises the same checks. A failing input is saved
+//          to ./crash-standalone.
+
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint8_t, std::uint16_t, std::uint64_t
+#include <cstdio>       //  std::fprintf, std::fopen, std::fwrite
+#include <cstdlib>      //  std::abort
+#include <optional>     //  std::optional
+#include <stdexcept>    //  std::range_error
+#include <vector>       //  std::vector
+
+#include "board_handle.h"
+#include "control_board_gpio_reg23.h"
+#include "ic_register_driver.h"
+#include "mcp23017.h"
+#include "register_bus.h"
+#include "register_frame.h"
+#include "register_interlock.h"
+#include "tick_read_cache.h"
+
+// counts the functors' instrumentation hooks, for the model to check elision against
+struct fuzz_instrumentation
+{
+    typedef std::uint8_t stamp_t;
+
+    static constexpr bool tracks(register_key_t, std::uint8_t) { return true; }
+
+    static stamp_t begin() noexcept { return 0; }
+
+    static void read        (register_key_t, std::uint8_t, stamp_t, std::uint16_t)                noexcept { ++reads; }
+    static void write       (register_key_t, std::uint8_t, stamp_t, std::uint16_t, std::uint16_t) noexcept { ++writes; }
+    static void elided_write(register_key_t, std::uint8_t, stamp_t, std::uint16_t)                noexcept { ++elided_writes; }
+    static void range_error (register_key_t, std::uint8_t, std::uint16_t)                         noexcept { ++range_errors; }
+    static void rate_limited(register_key_t, std::uint8_t, stamp_t, std::uint16_t)                noexcept {}
+
+    static inline std::uint64_t reads         {0};
+    static inline std::uint64_t writes        {0};
+    static inline std::uint64_t elided_writes {0};
+    static inline std::uint64_t range_errors  {0};
+};
+
+// the input, one byte at a time. An exhausted input reads as zeros
+class fuzz_input
+{
+public:
+    fuzz_input(const std::uint8_t* data_, std::size_t size_) : data(data_), size(size_) {}
+
+    bool          more() const { return pos < size; }
+    std::uint8_t  byte()       { return (pos < size ? data[pos++] : 0); }
+    std::uint16_t word()       { const std::uint16_t lo = byte(); return static_cast<std::uint16_t>(lo | (byte() << 8)); }
+
+private:
+    const std::uint8_t* data;
+    std::size_t         size;
+    std::size_t         pos {0};
+};
+
+enum fuzz_op : std::uint8_t
+{
+    REG23_SET, REG23_GET,                   // gpio_register_23, attached
+    HANDLE_SET, HANDLE_GET,                 // board_handle
+    CACHED_SET, CACHED_GET, TICK_END,       // tick_read_cache.h
+    TXN_BEGIN, TXN_SET, TXN_COMMIT,         // register_transaction
+    REG23_POKE,                             // someone else writes register #23
+    FRAME_SET, FRAME_GET, FRAME_COMMIT,     // register_frame.h
+    FRAME_POKE, FRAME_SNAPSHOT,
+    BATCH_SET, BATCH_GET, BATCH_FETCH,      // register_bus.h
+    BATCH_FLUSH, BATCH_STAGE_FLUSH,
+    EXPANDER_INPUT, EXPANDER_SNAPSHOT,      // the pins change; ic_device::read_all()
+    FUZZ_OP_COUNT
+};
+
+const char* const FUZZ_OP_NAMES[FUZZ_OP_COUNT] {
+    "REG23_SET", "REG23_GET", "HANDLE_SET", "HANDLE_GET", "CACHED_SET", "CACHED_GET", "TICK_END",
+    "TXN_BEGIN", "TXN_SET", "TXN_COMMIT", "REG23_POKE", "FRAME_SET", "FRAME_GET", "FRAME_COMMIT",
+    "FRAME_POKE", "FRAME_SNAPSHOT", "BATCH_SET", "BATCH_GET", "BATCH_FETCH", "BATCH_FLUSH",
+    "BATCH_STAGE_FLUSH", "EXPANDER_INPUT", "EXPANDER_SNAPSHOT"
+};
+
+// the input being run by the stand-alone driver, saved on failure. Note4
+const std::vector<std::uint8_t>* fuzz_standalone_input = nullptr;
+
+// reports a mismatch with the model, and aborts. Note3
+[[noreturn]] void fuzz_fail(std::size_t step, fuzz_op op, const char* what)
+{
+    std::fprintf(stderr, "fuzz_register_fields: step %zu (%s): %s\n", step, FUZZ_OP_NAMES[op], what);
+
+    if (fuzz_standalone_input != nullptr)
+    {
+        if (std::FILE* f = std::fopen("crash-standalone", "wb"))
+        {
+            std::fwrite(fuzz_standalone_input->data(), 1, fuzz_standalone_input->size(), f);
+            std::fclose(f);
+            std::fprintf(stderr, "fuzz_register_fields: input saved to ./crash-standalone\n");
+        }
+    }
+    std::abort();
+}
+
+//-------------------- the reference model. Note1 --------------------
+
+struct model_field
+{
+    unsigned    shift;
+    unsigned    width;
+
+    unsigned mask()                    const { return ((1u << width) - 1u) << shift; }
+    unsigned max()                     const { return (1u << width) - 1u; }
+    unsigned get(unsigned word)        const { return (word & mask()) >> shift; }
+    unsigned set(unsigned word, unsigned val) const { return (word & ~mask()) | (val << shift); }
+};
+
+// register #23: solenoid2 is bit 0, solenoid3 bit 1, the lamp bits 2..4
+const model_field MODEL_REG23_FIELDS[3] { { 0, 1 }, { 1, 1 }, { 2, 3 } };
+
+const model_field& MODEL_SOLENOID2 = MODEL_REG23_FIELDS[0];
+const model_field& MODEL_SOLENOID3 = MODEL_REG23_FIELDS[1];
+const model_field& MODEL_LAMP      = MODEL_REG23_FIELDS[2];
+
+// the three interlock rules, spelled out
+bool model_forbidden(unsigned word)
+{
+    const bool solenoid2 = MODEL_SOLENOID2.get(word) == 1;
+    const bool solenoid3 = MODEL_SOLENOID3.get(word) == 1;
+    const bool bright    = MODEL_LAMP.get(word) > MOOD_LIGHTING;
+
+    return (solenoid2 && solenoid3) || (bright && solenoid2) || (bright && solenoid3);
+}
+
+//-------------------- the subjects --------------------
+
+const std::size_t   FRAME_BOARDS    { 3 };
+const std::uint8_t  EXPANDER_ADDR   { 0x20 };
+const std::size_t   EXPANDER_REGS   { mcp23017_map::REGISTER_COUNT };
+
+typedef batch_window< mcp23017_map > fuzz_batch_window;
+
+// an expander field the steps drive, with its datasheet placement for the model
+struct expander_field
+{
+    std::uint8_t    addr;
+    model_field     bits;
+    std::uint16_t (*batch_set)(fuzz_batch_window, std::uint16_t);     // nullptr for a read-only field
+    std::uint16_t (*batch_get)(fuzz_batch_window);
+    std::uint16_t (*bus_get)(bus_window);
+};
+
+template< typename field >
+std::uint16_t expander_batch_set(fuzz_batch_window window, std::uint16_t val)
+{
+    return ic_field_functor< field, fuzz_batch_window, fuzz_instrumentation >{ window }(val);
+}
+
+template< typename field >
+std::uint16_t expander_batch_get(fuzz_batch_window window)
+{
+    return ic_field_functor< field, fuzz_batch_window, fuzz_instrumentation >{ window }();
+}
+
+template< typename field >
+std::uint16_t expander_bus_get(bus_window window)
+{
+    return ic_field_functor< field, bus_window >{ window }();
+}
+
+template< typename field >
+constexpr expander_field writable_field(std::uint8_t addr, unsigned shift, unsigned width)
+{
+    return expander_field{ addr, { shift, width }, expander_batch_set<field>, expander_batch_get<field>, expander_bus_get<field> };
+}
+
+template< typename field >
+constexpr expander_field read_only_field(std::uint8_t addr, unsigned shift, unsigned width)
+{
+    return expander_field{ addr, { shift, width }, nullptr, expander_batch_get<field>, expander_bus_get<field> };
+}
+
+const expander_field EXPANDER_FIELDS[] {
+    writable_field< mcp23017_output< mcp23017_port::A, 0 > >(0x14, 0, 1),
+    writable_field< mcp23017_output< mcp23017_port::A, 7 > >(0x14, 7, 1),
+    writable_field< mcp23017_output< mcp23017_port::B, 3 > >(0x15, 3, 1),
+    writable_field< mcp23017_port_output< mcp23017_port::B > >(0x15, 0, 8),
+    writable_field< mcp23017_direction< mcp23017_port::A, 5 > >(0x00, 5, 1),
+    writable_field< mcp23017_port_direction< mcp23017_port::B > >(0x01, 0, 8),
+    writable_field< mcp23017_polarity< mcp23017_port::A, 1 > >(0x02, 1, 1),
+    writable_field< mcp23017_pullup< mcp23017_port::B, 6 > >(0x0D, 6, 1),
+    writable_field< mcp23017_iocon_mirror_t >(0x0A, 6, 1),
+    writable_field< mcp23017_iocon_intpol_t >(0x0A, 1, 1),
+    read_only_field< mcp23017_input< mcp23017_port::A, 2 > >(0x12, 2, 1),
+    read_only_field< mcp23017_port_input< mcp23017_port::B > >(0x13, 0, 8),
+    read_only_field< mcp23017_interrupt_flags< mcp23017_port::A > >(0x0E, 0, 8),
+};
+
+const std::size_t EXPANDER_FIELD_COUNT { sizeof(EXPANDER_FIELDS) / sizeof(EXPANDER_FIELDS[0]) };
+
+// the expander's input registers, which only the "hardware" changes
+const std::uint8_t EXPANDER_INPUTS[] { MCP23017_INTFA, MCP23017_INTFB, MCP23017_INTCAPA, MCP23017_INTCAPB,
+                                       MCP23017_GPIOA, MCP23017_GPIOB };
+
+// everything one input runs against, and the model of it
+class fuzz_world
+{
+public:
+    explicit fuzz_world(fuzz_input& in_)
+        : in(in_),
+          hw(word_to_reg23(in_.word())),
+          handle(&hw),                          // closes the valves, kills the lamp
+          cache(&hw),
+          frame_regs(FRAME_BOARDS, word_to_reg23(0)),
+          frames(frame_registers(frame_regs)),
+          device(bus.attach(EXPANDER_ADDR)),
+          batch(bus, EXPANDER_ADDR),
+          expander(bus_window{ bus, EXPANDER_ADDR })
+    {
+        m_hw = reg23_to_word(hw);
+        for (std::size_t b = 0; b < FRAME_BOARDS; ++b)
+        {
+            m_frame_regs[b] = m_front[b] = m_back[b] = 0;
+        }
+        // the expander powers up with its reset values; the batch has fetched nothing
+        for (std::size_t r = 0; r < EXPANDER_REGS; ++r)
+        {
+            m_device[r] = device[r] = mcp23017_map::REGISTERS[r].reset_value;
+            m_shadow[r] = 0;
+        }
+    }
+
+    void step(std::size_t step_, fuzz_op op_)
+    {
+        step_no = step_;
+        op      = op_;
+
+        switch (op)
+        {
+            case REG23_SET:          reg23_set();          break;
+            case REG23_GET:          reg23_get();          break;
+            case HANDLE_SET:         handle_set();         break;
+            case HANDLE_GET:         handle_get();         break;
+            case CACHED_SET:         cached_set();         break;
+            case CACHED_GET:         cached_get();         break;
+            case TICK_END:           cache.invalidate(); m_cache_valid = false; break;
+            case TXN_BEGIN:          txn_begin();          break;
+            case TXN_SET:            txn_set();            break;
+            case TXN_COMMIT:         txn_commit();         break;
+            case REG23_POKE:         m_hw = in.word(); hw = word_to_reg23(static_cast<std::uint16_t>(m_hw)); break;
+            case FRAME_SET:          frame_set();          break;
+            case FRAME_GET:          frame_get();          break;
+            case FRAME_COMMIT:       frame_commit();       break;
+            case FRAME_POKE:         frame_poke();         break;
+            case FRAME_SNAPSHOT:     frame_snapshot();     break;
+            case BATCH_SET:          batch_set();          break;
+            case BATCH_GET:          batch_get();          break;
+            case BATCH_FETCH:        batch_fetch();        break;
+            case BATCH_FLUSH:        batch_flush(false);   break;
+            case BATCH_STAGE_FLUSH:  batch_flush(true);    break;
+            case EXPANDER_INPUT:     expander_input();     break;
+            case EXPANDER_SNAPSHOT:  expander_snapshot();  break;
+            default:                                       break;
+        }
+
+        check_state();
+    }
+
+private:
+    static std::vector<gpio_reg23_ptr_t> frame_registers(std::vector<genpurpIO_register23>& regs)
+    {
+        std::vector<gpio_reg23_ptr_t> addrs;
+        for (genpurpIO_register23& reg : regs)
+        {
+            addrs.push_back(&reg);
+        }
+        return addrs;
+    }
+
+    void expect(bool ok, const char* what) const
+    {
+        if (!ok)
+        {
+            fuzz_fail(step_no, op, what);
+        }
+    }
+
+    // a field of register #23, and a value for it: a solenoid takes 0:1;
+    // the lamp 0:9, of which 8 and 9 are out of range
+    unsigned reg23_field()        { return in.byte() % 3; }
+    unsigned reg23_value(unsigned f) { return (f == 2 ? in.byte() % 10 : in.byte() % 2); }
+
+    static vacuum to_vacuum(unsigned bit) { return (bit == 0 ? vacuum::OFF : vacuum::ON); }
+    static unsigned from_vacuum(vacuum v) { return (v == vacuum::OFF ? 0 : 1); }
+
+    // the model's side of a field write of register #23 through a write
+    // eliding functor or accessor, given the word it was made against.
+    // Returns the word the model expects the register to hold afterwards
+    unsigned model_reg23_write(unsigned f, unsigned val, unsigned word)
+    {
+        const model_field& field = MODEL_REG23_FIELDS[f];
+        if (field.get(word) == val)
+        {
+            ++m_elided_writes;
+            return word;
+        }
+        ++m_writes;
+        return field.set(word, val);
+    }
+
+    void reg23_set()
+    {
+        const unsigned f      = reg23_field();
+        const unsigned val    = reg23_value(f);
+        const unsigned before = MODEL_REG23_FIELDS[f].get(m_hw);
+        unsigned       retval = 0;
+
+        if (f == 2 && val > MODEL_LAMP.max())
+        {
+            ++m_range_errors;
+            expect(lamp_throws([this, val]() { gpio_register_23< lamp_t, fuzz_instrumentation >{ &hw, REG23_ATTACH }(val); }),
+                   "an out of range lamp setting did not throw");
+            return;
+        }
+
+        switch (f)
+        {
+            case 0:  retval = from_vacuum(gpio_register_23< solenoid2_t, fuzz_instrumentation >{ &hw, REG23_ATTACH }(to_vacuum(val))); break;
+            case 1:  retval = from_vacuum(gpio_register_23< solenoid3_t, fuzz_instrumentation >{ &hw, REG23_ATTACH }(to_vacuum(val))); break;
+            default: retval = gpio_register_23< lamp_t, fuzz_instrumentation >{ &hw, REG23_ATTACH }(static_cast<lamp_t>(val));          break;
+        }
+
+        m_hw = model_reg23_write(f, val, m_hw);
+        expect(retval == before, "a functor's setter returned the wrong previous value");
+    }
+
+    void reg23_get()
+    {
+        const unsigned f      = reg23_field();
+        unsigned       retval = 0;
+
+        switch (f)
+        {
+            case 0:  retval = from_vacuum(gpio_register_23< solenoid2_t, fuzz_instrumentation >{ &hw, REG23_ATTACH }()); break;
+            case 1:  retval = from_vacuum(gpio_register_23< solenoid3_t, fuzz_instrumentation >{ &hw, REG23_ATTACH }()); break;
+            default: retval = gpio_register_23< lamp_t, fuzz_instrumentation >{ &hw, REG23_ATTACH }();                    break;
+        }
+
+        ++m_reads;
+        expect(retval == MODEL_REG23_FIELDS[f].get(m_hw), "a functor's getter disagrees with the model");
+    }
+
+    void handle_set()
+    {
+        const unsigned f      = reg23_field();
+        const unsigned val    = reg23_value(f);
+        const unsigned before = MODEL_REG23_FIELDS[f].get(m_hw);
+        unsigned       retval = 0;
+
+        if (f == 2 && val > MODEL_LAMP.max())
+        {
+            ++m_range_errors;
+            expect(lamp_throws([this, val]() { handle.lamp42(static_cast<lamp_t>(val)); }),
+                   "an out of range lamp setting did not throw");
+            return;
+        }
+
+        switch (f)
+        {
+            case 0:  retval = from_vacuum(handle.vac_solenoid2(to_vacuum(val))); break;
+            case 1:  retval = from_vacuum(handle.vac_solenoid3(to_vacuum(val))); break;
+            default: retval = handle.lamp42(static_cast<lamp_t>(val));           break;
+        }
+
+        m_hw = model_reg23_write(f, val, m_hw);
+        expect(retval == before, "a handle's setter returned the wrong previous value");
+    }
+
+    void handle_get()
+    {
+        const unsigned f      = reg23_field();
+        unsigned       retval = 0;
+
+        switch (f)
+        {
+            case 0:  retval = from_vacuum(handle.vac_solenoid2()); break;
+            case 1:  retval = from_vacuum(handle.vac_solenoid3()); break;
+            default: retval = handle.lamp42();                     break;
+        }
+
+        ++m_reads;
+        expect(retval == MODEL_REG23_FIELDS[f].get(m_hw), "a handle's getter disagrees with the model");
+    }
+
+    // the tick's word: the register, read at most once per tick. Note2
+    unsigned model_cached_word()
+    {
+        if (!m_cache_valid)
+        {
+            m_cached      = m_hw;
+            m_cache_valid = true;
+            ++m_cache_loads;
+        }
+        return m_cached;
+    }
+
+    void cached_set()
+    {
+        const unsigned f   = reg23_field();
+        const unsigned val = reg23_value(f);
+
+        if (f == 2 && val > MODEL_LAMP.max())
+        {
+            ++m_range_errors;
+            expect(lamp_throws([this, val]() { cached_gpio_register_23< lamp_t, fuzz_instrumentation >{ cache }(static_cast<lamp_t>(val)); }),
+                   "an out of range lamp setting did not throw");
+            return;
+        }
+
+        unsigned retval = 0;
+        switch (f)
+        {
+            case 0:  retval = from_vacuum(cached_gpio_register_23< solenoid2_t, fuzz_instrumentation >{ cache }(to_vacuum(val))); break;
+            case 1:  retval = from_vacuum(cached_gpio_register_23< solenoid3_t, fuzz_instrumentation >{ cache }(to_vacuum(val))); break;
+            default: retval = cached_gpio_register_23< lamp_t, fuzz_instrumentation >{ cache }(static_cast<lamp_t>(val));          break;
+        }
+
+        // a setter reads the register afresh, and writes the whole word
+        // through to it; the cache keeps the word read, then the word written
+        const unsigned word  = m_hw;
+        m_cached      = word;
+        m_cache_valid = true;
+        ++m_cache_loads;
+
+        const unsigned after = model_reg23_write(f, val, word);
+        if (after != word)
+        {
+            m_hw = m_cached = after;
+        }
+        expect(retval == MODEL_REG23_FIELDS[f].get(word), "a cached setter returned the wrong previous value");
+    }
+
+    void cached_get()
+    {
+        const unsigned f      = reg23_field();
+        unsigned       retval = 0;
+
+        switch (f)
+        {
+            case 0:  retval = from_vacuum(cached_gpio_register_23< solenoid2_t, fuzz_instrumentation >{ cache }()); break;
+            case 1:  retval = from_vacuum(cached_gpio_register_23< solenoid3_t, fuzz_instrumentation >{ cache }()); break;
+            default: retval = cached_gpio_register_23< lamp_t, fuzz_instrumentation >{ cache }();                    break;
+        }
+
+        ++m_reads;
+        expect(retval == MODEL_REG23_FIELDS[f].get(model_cached_word()), "a cached getter disagrees with the model");
+    }
+
+    // the staged fields, merged into the register's word as it is now
+    unsigned model_staged_word() const
+    {
+        return (m_hw & ~m_staged_mask) | m_staged_bits;
+    }
+
+    void txn_begin()
+    {
+        txn.emplace(reg23_word(&hw), REG23_INTERLOCKS);
+        m_staged_mask = 0;
+        m_staged_bits = 0;
+    }
+
+    // a staged value may be out of range for a solenoid too: 0:2, and the lamp 0:9
+    void txn_set()
+    {
+        const unsigned f   = reg23_field();
+        const unsigned val = (f == 2 ? in.byte() % 10 : in.byte() % 3);
+        if (!txn)
+        {
+            return;
+        }
+
+        const field_descriptor& field = (f == 0 ? SOLENOID2_FIELD : f == 1 ? SOLENOID3_FIELD : LAMP_PWR_FIELD);
+        bool threw = false;
+        try
+        {
+            txn->set(field, static_cast<std::uint16_t>(val));
+        }
+        catch (std::range_error&)
+        {
+            threw = true;
+        }
+
+        const bool in_range = val <= MODEL_REG23_FIELDS[f].max();
+        expect(threw != in_range, "a staged value's range check disagrees with the model");
+        if (in_range)
+        {
+            m_staged_mask |= MODEL_REG23_FIELDS[f].mask();
+            m_staged_bits  = MODEL_REG23_FIELDS[f].set(m_staged_bits, val);
+        }
+        expect(txn->word() == model_staged_word(), "the staged word disagrees with the model");
+    }
+
+    void txn_commit()
+    {
+        if (!txn)
+        {
+            return;
+        }
+
+        bool threw = false;
+        try
+        {
+            txn->commit();
+        }
+        catch (interlock_violation&)
+        {
+            threw = true;
+        }
+
+        const unsigned merged = model_staged_word();
+        expect(threw == model_forbidden(merged), "a transaction's interlock check disagrees with the model");
+        if (!threw)
+        {
+            m_hw = merged;
+        }
+    }
+
+    void frame_set()
+    {
+        const std::size_t b   = in.byte() % FRAME_BOARDS;
+        const unsigned    f   = reg23_field();
+        const unsigned    val = reg23_value(f);
+
+        if (f == 2 && val > MODEL_LAMP.max())
+        {
+            expect(lamp_throws([this, b, val]() { gpio_register_23< lamp_t >{ frames.back(b), REG23_ATTACH }(static_cast<lamp_t>(val)); }),
+                   "an out of range lamp setting did not throw");
+            return;
+        }
+
+        switch (f)
+        {
+            case 0:  gpio_register_23< solenoid2_t >{ frames.back(b), REG23_ATTACH }(to_vacuum(val)); break;
+            case 1:  gpio_register_23< solenoid3_t >{ frames.back(b), REG23_ATTACH }(to_vacuum(val)); break;
+            default: gpio_register_23< lamp_t >{ frames.back(b), REG23_ATTACH }(static_cast<lamp_t>(val)); break;
+        }
+
+        m_back[b] = MODEL_REG23_FIELDS[f].set(m_back[b], val);
+    }
+
+    void frame_get()
+    {
+        const std::size_t b      = in.byte() % FRAME_BOARDS;
+        const unsigned    f      = reg23_field();
+        unsigned          retval = 0;
+
+        switch (f)
+        {
+            case 0:  retval = from_vacuum(gpio_register_23< solenoid2_t >{ frames.back(b), REG23_ATTACH }()); break;
+            case 1:  retval = from_vacuum(gpio_register_23< solenoid3_t >{ frames.back(b), REG23_ATTACH }()); break;
+            default: retval = gpio_register_23< lamp_t >{ frames.back(b), REG23_ATTACH }();                    break;
+        }
+
+        expect(retval == MODEL_REG23_FIELDS[f].get(m_back[b]), "a back image's getter disagrees with the model");
+    }
+
+    // a frame commits whole, or not at all
+    void frame_commit()
+    {
+        bool forbidden = false;
+        for (std::size_t b = 0; b < FRAME_BOARDS; ++b)
+        {
+            forbidden = forbidden || model_forbidden(m_back[b]);
+        }
+
+        bool threw = false;
+        try
+        {
+            frames.commit();
+        }
+        catch (interlock_violation&)
+        {
+            threw = true;
+        }
+
+        expect(threw == forbidden, "a frame's interlock check disagrees with the model");
+        if (!threw)
+        {
+            for (std::size_t b = 0; b < FRAME_BOARDS; ++b)
+            {
+                m_front[b] = m_frame_regs[b] = m_back[b];
+            }
+            ++m_commits;
+        }
+    }
+
+    void frame_poke()
+    {
+        const std::size_t b = in.byte() % FRAME_BOARDS;
+        m_frame_regs[b]     = in.word();
+        frame_regs[b]       = word_to_reg23(static_cast<std::uint16_t>(m_frame_regs[b]));
+    }
+
+    void frame_snapshot()
+    {
+        for (std::size_t b = 0; b < FRAME_BOARDS; ++b)
+        {
+            expect(reg23_to_word(frames.front(b)) == m_front[b], "the front frame disagrees with the model");
+        }
+        expect(frames.commits() == m_commits, "the commit count disagrees with the model");
+    }
+
+    const expander_field& pick_expander_field() { return EXPANDER_FIELDS[in.byte() % EXPANDER_FIELD_COUNT]; }
+
+    // a one bit field takes 0:2, of which 2 is out of range; a port wide field 0:255
+    void batch_set()
+    {
+        const expander_field& f   = pick_expander_field();
+        const unsigned        val = (f.bits.width == 1 ? in.byte() % 3 : in.byte());
+        if (f.batch_set == nullptr)
+        {
+            return;
+        }
+
+        if (val > f.bits.max())
+        {
+            bool threw = false;
+            try
+            {
+                f.batch_set(batch.window(), static_cast<std::uint16_t>(val));
+            }
+            catch (std::range_error&)
+            {
+                threw = true;
+            }
+            ++m_range_errors;
+            expect(threw, "an out of range field value did not throw");
+            return;
+        }
+
+        const unsigned before = f.bits.get(m_shadow[f.addr]);
+        const unsigned retval = f.batch_set(batch.window(), static_cast<std::uint16_t>(val));
+
+        if (before == val)
+        {
+            ++m_elided_writes;
+        }
+        else
+        {
+            ++m_writes;
+            m_shadow[f.addr] = static_cast<std::uint8_t>(f.bits.set(m_shadow[f.addr], val));
+            m_dirty |= std::uint64_t{1} << f.addr;
+        }
+        expect(retval == before, "a batched setter returned the wrong previous value");
+    }
+
+    void batch_get()
+    {
+        const expander_field& f = pick_expander_field();
+
+        ++m_reads;
+        expect(f.batch_get(batch.window()) == f.bits.get(m_shadow[f.addr]), "a batched getter disagrees with the model");
+    }
+
+    // registers with unflushed changes keep them
+    void batch_fetch()
+    {
+        const std::size_t first = in.byte() % EXPANDER_REGS;
+        const std::size_t count = 1 + in.byte() % (EXPANDER_REGS - first);
+
+        batch.fetch(static_cast<std::uint8_t>(first), count);
+
+        for (std::size_t r = first; r < first + count; ++r)
+        {
+            if (!((m_dirty >> r) & 1u))
+            {
+                m_shadow[r] = m_device[r];
+            }
+        }
+    }
+
+    // the changed registers reach the device, in one round trip if there are any
+    void batch_flush(bool staged)
+    {
+        const std::uint64_t round_trips = bus.round_trips();
+
+        if (staged)
+        {
+            std::vector<bus_transfer> transfers;
+            batch.stage_flush(transfers);
+            if (!transfers.empty())
+            {
+                bus.execute(transfers);
+            }
+        }
+        else
+        {
+            batch.flush();
+        }
+
+        expect(bus.round_trips() - round_trips == (m_dirty != 0 ? 1u : 0u), "a flush took the wrong number of round trips");
+
+        for (std::size_t r = 0; r < EXPANDER_REGS; ++r)
+        {
+            if ((m_dirty >> r) & 1u)
+            {
+                m_device[r] = m_shadow[r];
+            }
+        }
+        m_dirty = 0;
+    }
+
+    void expander_input()
+    {
+        const std::uint8_t addr = EXPANDER_INPUTS[in.byte() % sizeof(EXPANDER_INPUTS)];
+        m_device[addr] = device[addr] = in.byte();
+    }
+
+    void expander_snapshot()
+    {
+        const ic_device< mcp23017_map, bus_window >::image_t image = expander.read_all();
+        for (std::size_t r = 0; r < EXPANDER_REGS; ++r)
+        {
+            expect(image[r] == m_device[r], "a snapshot of the expander disagrees with the model");
+        }
+
+        const expander_field& f = pick_expander_field();
+        expect(f.bus_get(bus_window{ bus, EXPANDER_ADDR }) == f.bits.get(m_device[f.addr]),
+               "a field read over the bus disagrees with the model");
+    }
+
+    template< typename set_t >
+    static bool lamp_throws(set_t set)
+    {
+        try
+        {
+            set();
+        }
+        catch (std::range_error&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    // the whole of every register, fillers included, and the hooks' counts
+    void check_state() const
+    {
+        expect(reg23_to_word(hw) == m_hw, "register #23 disagrees with the model");
+
+        expect(fuzz_instrumentation::writes        == m_writes,        "the write count disagrees with the model");
+        expect(fuzz_instrumentation::elided_writes == m_elided_writes, "the elided write count disagrees with the model");
+        expect(fuzz_instrumentation::reads         == m_reads,         "the read count disagrees with the model");
+        expect(fuzz_instrumentation::range_errors  == m_range_errors,  "the range error count disagrees with the model");
+        expect(cache.loads() == m_cache_loads, "the tick cache read the register the wrong number of times");
+
+        for (std::size_t b = 0; b < FRAME_BOARDS; ++b)
+        {
+            expect(reg23_to_word(frame_regs[b]) == m_frame_regs[b], "a board's register disagrees with the model");
+        }
+
+        for (std::size_t r = 0; r < EXPANDER_REGS; ++r)
+        {
+            expect(device[r] == m_device[r], "the expander's registers disagree with the model");
+        }
+        expect(batch.pending() == (m_dirty != 0), "the batch's pending changes disagree with the model");
+    }
+
+    fuzz_input&                             in;
+    std::size_t                             step_no {0};
+    fuzz_op                                 op      {REG23_SET};
+
+    // the subjects
+    genpurpIO_register23                    hw;
+    board_handle< fuzz_instrumentation >    handle;
+    reg23_read_cache<>                      cache;
+    std::optional< register_transaction<> > txn;
+
+    std::vector<genpurpIO_register23>       frame_regs;
+    reg23_frame_buffer< relaxed_ordering >  frames;
+
+    simulated_bus                           bus;
+    ic_reg_t*                               device;
+    bus_batch< mcp23017_map >               batch;
+    ic_device< mcp23017_map, bus_window >   expander;
+
+    // the model
+    unsigned        m_hw            {0};
+    unsigned        m_cached        {0};
+    bool            m_cache_valid   {false};
+    std::uint64_t   m_cache_loads   {0};
+    unsigned        m_staged_mask   {0};
+    unsigned        m_staged_bits   {0};
+
+    unsigned        m_frame_regs[FRAME_BOARDS];
+    unsigned        m_front[FRAME_BOARDS];
+    unsigned        m_back[FRAME_BOARDS];
+    std::uint64_t   m_commits       {0};
+
+    std::uint8_t    m_device[EXPANDER_REGS];
+    std::uint8_t    m_shadow[EXPANDER_REGS];
+    std::uint64_t   m_dirty         {0};
+
+    std::uint64_t   m_reads         {0};
+    std::uint64_t   m_writes        {0};
+    std::uint64_t   m_elided_writes {0};
+    std::uint64_t   m_range_errors  {0};
+};
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+    fuzz_instrumentation::reads         = 0;
+    fuzz_instrumentation::writes        = 0;
+    fuzz_instrumentation::elided_writes = 0;
+    fuzz_instrumentation::range_errors  = 0;
+
+    fuzz_input in{ data, size };
+    fuzz_world world{ in };
+
+    for (std::size_t step = 0; in.more(); ++step)
+    {
+        world.step(step, static_cast<fuzz_op>(in.byte() % FUZZ_OP_COUNT));
+    }
+
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+
+#include <cstring>      //  std::strncmp
+#include <fstream>      //  std::ifstream
+#include <iostream>     //  std::cout, std::cerr
+#include <iterator>     //  std::istreambuf_iterator
+
+#include "field_property.h"
+
+// runs the inputs named on the command line, then random ones. Note4
+int main(int argc, char* argv[])
+{
+    std::uint64_t runs    = 0;
+    std::uint64_t seed    = 0x5EED;
+    std::size_t   max_len = 256;
+    std::size_t   files   = 0;
+
+    for (int a = 1; a < argc; ++a)
+    {
+        if (std::strncmp(argv[a], "-runs=", 6) == 0)
+        {
+            runs = std::strtoull(argv[a] + 6, nullptr, 0);
+        }
+        else if (std::strncmp(argv[a], "-seed=", 6) == 0)
+        {
+            seed = std::strtoull(argv[a] + 6, nullptr, 0);
+        }
+        else if (std::strncmp(argv[a], "-max_len=", 9) == 0)
+        {
+            max_len = std::strtoull(argv[a] + 9, nullptr, 0);
+        }
+        else
+        {
+            std::ifstream file{ argv[a], std::ios::binary };
+            if (!file)
+            {
+                std::cerr << "fuzz_register_fields: cannot read " << argv[a] << std::endl;
+                return 1;
+            }
+
+            const std::vector<std::uint8_t> input{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+            fuzz_standalone_input = &input;
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+            ++files;
+        }
+    }
+
+    field_property_rng rng{ seed };
+    for (std::uint64_t run = 0; run < runs; ++run)
+    {
+        std::vector<std::uint8_t> input(rng.below(max_len + 1));
+        for (std::uint8_t& byte : input)
+        {
+            byte = static_cast<std::uint8_t>(rng.next());
+        }
+
+        fuzz_standalone_input = &input;
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+
+    std::cout << "fuzz check: ";
+    if (files != 0)
+    {
+        std::cout << files << " inputs, ";
+    }
+    std::cout << runs << " random inputs (seed 0x" << std::hex << seed << std::dec << ") ok" << std::endl;
+    return 0;
+}
+
+#endif // FUZZ_STANDALONE
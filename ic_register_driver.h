@@ -0,0 +1,291 @@
+// ic_register_driver.h
+//
+// Reusable drivers for off-the-shelf ICs whose register map is fixed
+// (the README's NEED_IC_ID scenario), e.g., GPIO expanders.
+//
+// Unlike register #23, whose layout is whatever the board's designer
+// chose, a mass-manufactured IC's registers are the same on every board,
+// so its register map is written once, as constexpr data, and reused.
+// A device header (e.g., mcp23017.h) provides:
+//
+//      - the register map: a constexpr array of ic_register_info, one per
+//        register address, giving each register's name, reset value, and
+//        whether it is writable
+//      - field tags: ic_map_field typedefs naming the bits within the
+//        registers
+//
+// ic_field_functor -- the field functors, with the same ergonomics as
+//      gpio_register_23's: a setter that returns the previous value and
+//      skips the store when nothing changes (Note4 of
+//      control_board_gpio_reg23.h), a getter, a range check, and a
+//      compile-time instrumentation policy (see field_instrumentation.h).
+//      The instrumentation identifies a field by its register's address,
+//      keyed by the IC's register space (see register_descriptor.h), and
+//      its field id. Each IC on a board needs its own space, so that their
+//      fields are told apart from each other's and from the board's:
+//      SPACE is IC_REGISTER_SPACE unless given.
+//
+//          ic_field_functor< mcp23017_output< mcp23017_port::A, 3 > > relay{ window };
+//          relay(1);
+//
+// ic_device -- whole-device operations, made with burst transfers: reset,
+//      reading all registers in one go, and writing a run of registers.
+//
+// Both take an access handle, through which they reach the IC's registers.
+// mmio_window is the handle for registers mapped into memory (an FPGA
+// bridge, or a memory-mapped image of the device). An access handle is
+// copied into each functor, so it should be no bigger than a pointer, and
+// provides:
+//
+//      std::uint8_t read(std::uint8_t addr)
+//      void         write(std::uint8_t addr, std::uint8_t val)
+//      void         read_burst(std::uint8_t first, std::uint8_t* out, std::size_t count)
+//      void         write_burst(std::uint8_t first, const std::uint8_t* in, std::size_t count)
+//
+//  Note1:  a field tag's register must be writable for its functor's
+//          setter to compile. Reading a read-only register is fine.
+//          ic_map_field takes a tag's writability from the register map,
+//          so a tag can't make a read-only register writable. A tag may
+//          still be read-only in a writable register, e.g., a pin's level
+//          in the MCP23017's GPIO, whose writes go to the output latch.
+//
+//  Note2:  registers are 8 bits wide, as they are on nearly all I2C and SPI
+//          peripherals. Fields reuse field_descriptor (see
+//          register_descriptor.h), with the register's address as reg_id.
+//          An address is not a board register id: IC register 0x17 is not
+//          register #23. Hence the register space.
+//
+//  Note3:  the Makefile's codegen check verifies that an uninstrumented
+//          field functor inlines into a plain read-modify-write.
+//
+//  Note4:  a functor's instrumentation must be able to account for its
+//          field (see field_instrumentation.h), or the functor does not
+//          compile. E.g., counting_instrumentation tracks registers 0:31
+//          of each space, so an IC register above 0x1F can only be counted
+//          by an instrumentation that tracks it, or left uninstrumented.
+
+#ifndef IC_REGISTER_DRIVER_H
+#define IC_REGISTER_DRIVER_H
+
+#include <array>        //  std::array
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint8_t, std::uint16_t
+#include <stdexcept>    //  std::range_error
+
+#include "field_instrumentation.h"
+#include "register_descriptor.h"
+#include "register_error.h"
+
+typedef std::uint8_t ic_reg_t;     // Note2
+
+// one entry of a device's register map
+struct ic_register_info
+{
+    std::uint8_t    addr;
+    ic_reg_t        reset_value;
+    bool            writable;
+    const char*     name;
+};
+
+// ic_field -- a field tag: the bits [SHIFT, SHIFT + WIDTH) of register ADDR
+template< std::uint8_t ADDR, std::uint8_t SHIFT, std::uint8_t WIDTH, bool WRITABLE_ = true, std::uint8_t FIELD_ID = SHIFT >
+struct ic_field
+{
+    static_assert(WIDTH >= 1 && SHIFT + WIDTH <= 8, "an IC field must fit within its 8 bit register");
+
+    static constexpr field_descriptor FIELD { ADDR, FIELD_ID, SHIFT, WIDTH };
+    static constexpr bool             WRITABLE { WRITABLE_ };
+};
+
+// ic_map_field -- a field tag of a register in register_map (listed by
+//                 address, see ic_register_map_is_dense()), writable only
+//                 if the map's register is and READ_ONLY isn't asked for. Note1
+template< typename register_map, std::uint8_t ADDR, std::uint8_t SHIFT, std::uint8_t WIDTH, bool READ_ONLY = false >
+using ic_map_field = ic_field< ADDR, SHIFT, WIDTH, register_map::REGISTERS[ADDR].writable && !READ_ONLY >;
+
+
+// mmio_window -- access handle for an IC's registers mapped into memory
+class mmio_window
+{
+public:
+    explicit mmio_window(volatile ic_reg_t* base_) : base(base_) {}
+
+    ic_reg_t read(std::uint8_t addr) const            { return base[addr]; }
+    void     write(std::uint8_t addr, ic_reg_t val)   { base[addr] = val; }
+
+    void read_burst(std::uint8_t first, ic_reg_t* out, std::size_t count) const
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out[i] = base[first + i];
+        }
+    }
+
+    void write_burst(std::uint8_t first, const ic_reg_t* in, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            base[first + i] = in[i];
+        }
+    }
+
+private:
+    volatile ic_reg_t* base;
+};
+
+
+// throw_ic_range_error() -- kept out of line, so that the setters it is
+//                           called from stay small enough to inline. Note3
+[[noreturn]] __attribute__((noinline, cold))
+inline void throw_ic_range_error(const field_descriptor& f, std::uint16_t val)
+{
+    throw register_range_error( "Incorrect attempt to set field %u of IC register 0x%x to (%u). Valid range is 0:%u. ",
+                                unsigned{f.field_id}, unsigned{f.reg_id}, unsigned{val}, unsigned{f.max_value()} );
+}
+
+
+template< typename field, typename access = mmio_window, typename instrumentation = no_instrumentation,
+          register_space_t SPACE = IC_REGISTER_SPACE >
+class ic_field_functor
+{
+    static_assert(SPACE != BOARD_REGISTER_SPACE, "an IC's registers are not the board's. Note2");
+
+    // the key the instrumentation knows the field's register by
+    static constexpr register_key_t KEY { register_key(SPACE, field::FIELD.reg_id) };
+
+    static_assert(instrumentation::tracks(KEY, field::FIELD.field_id),
+                  "the instrumentation can't account for this field. Note4");
+
+public:
+    explicit ic_field_functor(access window_) : window(window_) {}
+
+    // sets the field, returning its previous value.
+    // Throws std::range_error if val does not fit the field
+    std::uint16_t operator() (std::uint16_t val)
+    {
+        static_assert(field::WRITABLE, "the field's register is read-only");     // Note1
+
+        constexpr field_descriptor f = field::FIELD;
+
+        if (val > f.max_value())
+        {
+            instrumentation::range_error(KEY, f.field_id, val);
+            throw_ic_range_error(f, val);
+        }
+
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        const ic_reg_t      reg    = window.read(f.reg_id);
+        const std::uint16_t retval = f.extract(reg);
+
+        if (val == retval)
+        {
+            instrumentation::elided_write(KEY, f.field_id, t0, val);
+        }
+        else
+        {
+            window.write(f.reg_id, static_cast<ic_reg_t>(f.insert(reg, val)));
+
+            instrumentation::write(KEY, f.field_id, t0, retval, val);
+        }
+
+        return retval;
+    }
+
+    // returns the field's current value
+    std::uint16_t operator() ()
+    {
+        constexpr field_descriptor f = field::FIELD;
+
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        const std::uint16_t retval = f.extract(window.read(f.reg_id));
+
+        instrumentation::read(KEY, f.field_id, t0, retval);
+
+        return retval;
+    }
+
+private:
+    access window;
+};
+
+
+// ic_device -- whole-device operations on an IC described by register_map
+//
+//      register_map provides REGISTER_COUNT, and REGISTERS: one
+//      ic_register_info per address, from address 0 up
+template< typename register_map, typename access = mmio_window >
+class ic_device
+{
+public:
+    static const std::size_t REGISTER_COUNT { register_map::REGISTER_COUNT };
+
+    typedef std::array<ic_reg_t, REGISTER_COUNT> image_t;
+
+    explicit ic_device(access window_) : window(window_) {}
+
+    // reset() -- writes each writable register's reset value, one burst
+    //            per run of consecutive writable registers
+    void reset()
+    {
+        std::size_t first = 0;
+        while (first < REGISTER_COUNT)
+        {
+            if (!register_map::REGISTERS[first].writable)
+            {
+                ++first;
+                continue;
+            }
+
+            std::size_t end = first;
+            ic_reg_t    values[REGISTER_COUNT];
+            while (end < REGISTER_COUNT && register_map::REGISTERS[end].writable)
+            {
+                values[end - first] = register_map::REGISTERS[end].reset_value;
+                ++end;
+            }
+
+            window.write_burst(static_cast<std::uint8_t>(first), values, end - first);
+            first = end;
+        }
+    }
+
+    // every register, read in a single burst
+    image_t read_all()
+    {
+        image_t image {};
+        window.read_burst(0, image.data(), REGISTER_COUNT);
+        return image;
+    }
+
+    void read_registers(std::uint8_t first, ic_reg_t* out, std::size_t count)        { window.read_burst(first, out, count); }
+    void write_registers(std::uint8_t first, const ic_reg_t* in, std::size_t count)  { window.write_burst(first, in, count); }
+
+    // a field's value within an image returned by read_all()
+    template< typename field >
+    static std::uint16_t field_of(const image_t& image)
+    {
+        return field::FIELD.extract(image[field::FIELD.reg_id]);
+    }
+
+private:
+    access window;
+};
+
+// verifies, at compile time, that a register map lists its registers in
+// address order from 0, as ic_device expects
+template< std::size_t N >
+constexpr bool ic_register_map_is_dense(const ic_register_info (&registers)[N])
+{
+    for (std::size_t i = 0; i < N; ++i)
+    {
+        if (registers[i].addr != i)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // IC_REGISTER_DRIVER_H
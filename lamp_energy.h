@@ -0,0 +1,240 @@
+// lamp_energy.h
+//
+// Lamp energy accounting, driven by the lamp's writes rather than by
+// sampling.
+//
+// A lamp's illumination is exactly proportional to its power setting (see
+// Note1 of control_board_gpio_reg23.h), so its energy is the integral of
+// lamp_pwr over time. Between two changes the setting is constant, so the
+// integral only needs updating when the setting changes:
+//
+//      level_ticks += old setting * ticks since the previous change
+//
+// lamp_energy_meter -- one lamp's integral, in level-ticks (read_cycle_counter()
+//      ticks; see cycle_counter.h). level_seconds() converts to
+//      level-seconds: 1 second at FULL_ILLUMINATION is 7 level-seconds.
+//      A meter is updated by one thread and may be read by any. Note1
+//
+// lamp_energy_ledger -- the meters of a set of lamps. Reports each lamp's
+//      total and the total over all lamps, including lamps that have
+//      since been retired.
+//
+// metered_lamp -- a lamp functor whose setter feeds the lamp's meter. It
+//      behaves exactly as gpio_register_23< lamp_t > does (see
+//      control_board_gpio_reg23.h); a setter call that changes the setting
+//      costs one counter read more, and one that doesn't costs nothing more.
+//
+//          lamp_energy_ledger ledger;
+//          metered_lamp<> lamp42{ REGISTER_ADDRESS_GPIO23, 42, ledger };
+//          lamp42(MOOD_LIGHTING);
+//          ...
+//          double total = ledger.total_level_seconds();
+//
+//  Note1:  a meter's three words are published with a sequence lock: the
+//          writer bumps the sequence to odd, updates, then bumps it to
+//          even; a reader retries until it sees the same even sequence
+//          before and after its reads. The writer never waits.
+//
+//  Note2:  only changes made through the metered_lamp are seen. A lamp
+//          driven through another functor as well is under-counted.
+
+#ifndef LAMP_ENERGY_H
+#define LAMP_ENERGY_H
+
+#include <algorithm>    //  std::find
+#include <atomic>       //  std::atomic, std::atomic_thread_fence
+#include <cstdint>      //  std::uint16_t, std::uint32_t, std::uint64_t
+#include <mutex>        //  std::mutex, std::lock_guard
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "cycle_counter.h"
+#include "field_instrumentation.h"
+#include "register_arena.h"
+
+class lamp_energy_meter
+{
+public:
+    // a meter for a lamp whose setting is level as of now
+    explicit lamp_energy_meter(std::uint32_t lamp_id_, std::uint16_t level = LIGHTS_OUT,
+                               std::uint64_t now = read_cycle_counter())
+        : lamp_id(lamp_id_), level_(level), since_(now)
+    {
+    }
+
+    lamp_energy_meter(const lamp_energy_meter&)            = delete;
+    lamp_energy_meter& operator=(const lamp_energy_meter&) = delete;
+
+    // change() -- the lamp's setting changed to level at now. Only the
+    //             meter's owning thread may call this. Note1
+    void change(std::uint16_t level, std::uint64_t now)
+    {
+        const std::uint32_t seq   = seq_.load(std::memory_order_relaxed);
+        const std::uint64_t since = since_.load(std::memory_order_relaxed);
+        const std::uint64_t total = level_ticks_.load(std::memory_order_relaxed)
+                                    + level_.load(std::memory_order_relaxed) * (now > since ? now - since : 0);
+
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        level_ticks_.store(total, std::memory_order_relaxed);
+        level_.store(level, std::memory_order_relaxed);
+        since_.store(now, std::memory_order_relaxed);
+
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // the lamp's energy up to now, in level-ticks. Any thread may call this
+    std::uint64_t level_ticks(std::uint64_t now = read_cycle_counter()) const
+    {
+        for (;;)
+        {
+            const std::uint32_t seq = seq_.load(std::memory_order_acquire);
+            if (seq & 1u)
+            {
+                continue;       // a change is being published
+            }
+
+            const std::uint64_t total = level_ticks_.load(std::memory_order_relaxed);
+            const std::uint64_t level = level_.load(std::memory_order_relaxed);
+            const std::uint64_t since = since_.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == seq)
+            {
+                return total + level * (now > since ? now - since : 0);
+            }
+        }
+    }
+
+    double level_seconds(std::uint64_t now = read_cycle_counter(), double ticks_per_second = cycle_counter_hz()) const
+    {
+        return static_cast<double>(level_ticks(now)) / ticks_per_second;
+    }
+
+    const std::uint32_t             lamp_id;
+
+private:
+    std::atomic<std::uint32_t>      seq_         {0};
+    std::atomic<std::uint16_t>      level_;
+    std::atomic<std::uint64_t>      since_;
+    std::atomic<std::uint64_t>      level_ticks_ {0};
+};
+
+
+// one lamp's energy, as reported by a ledger
+struct lamp_energy_reading
+{
+    std::uint32_t   lamp_id;
+    std::uint64_t   level_ticks;
+};
+
+class lamp_energy_ledger
+{
+public:
+    void attach(const lamp_energy_meter& meter)
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        meters_.push_back(&meter);
+    }
+
+    // detach() -- the meter's lamp is retired; its energy up to now is
+    //             kept in the ledger's total
+    void detach(const lamp_energy_meter& meter, std::uint64_t now = read_cycle_counter())
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        auto it = std::find(meters_.begin(), meters_.end(), &meter);
+        if (it != meters_.end())
+        {
+            retired_level_ticks_ += meter.level_ticks(now);
+            meters_.erase(it);
+        }
+    }
+
+    // each attached lamp's energy up to now
+    std::vector<lamp_energy_reading> readings(std::uint64_t now = read_cycle_counter()) const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        std::vector<lamp_energy_reading> result;
+        result.reserve(meters_.size());
+        for (const lamp_energy_meter* m : meters_)
+        {
+            result.push_back(lamp_energy_reading{ m->lamp_id, m->level_ticks(now) });
+        }
+        return result;
+    }
+
+    // all lamps' energy up to now, the retired lamps' included
+    std::uint64_t total_level_ticks(std::uint64_t now = read_cycle_counter()) const
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+
+        std::uint64_t total = retired_level_ticks_;
+        for (const lamp_energy_meter* m : meters_)
+        {
+            total += m->level_ticks(now);
+        }
+        return total;
+    }
+
+    double total_level_seconds(std::uint64_t now = read_cycle_counter(), double ticks_per_second = cycle_counter_hz()) const
+    {
+        return static_cast<double>(total_level_ticks(now)) / ticks_per_second;
+    }
+
+private:
+    mutable std::mutex                          mtx_;
+    register_vector<const lamp_energy_meter*>   meters_;
+    std::uint64_t                               retired_level_ticks_ {0};
+};
+
+
+// metered_lamp -- a lamp functor feeding the lamp's energy meter. Note2
+template< typename instrumentation = no_instrumentation >
+class metered_lamp
+{
+public:
+    metered_lamp(gpio_reg23_ptr_t preg, std::uint32_t lamp_id, lamp_energy_ledger& ledger_)
+        : lamp(preg),                       // kills the lamp, so the meter starts at LIGHTS_OUT
+          meter(lamp_id),
+          ledger(ledger_)
+    {
+        ledger.attach(meter);
+    }
+
+    ~metered_lamp()
+    {
+        ledger.detach(meter);
+    }
+
+    // the ledger holds the meter's address
+    metered_lamp(const metered_lamp&)            = delete;
+    metered_lamp& operator=(const metered_lamp&) = delete;
+
+    // sets the lamp's power setting, returning the previous one.
+    // Throws std::range_error, as gpio_register_23< lamp_t > does
+    std::uint16_t operator() (lamp_t val)
+    {
+        const std::uint16_t retval = lamp(val);
+
+        if (retval != val)
+        {
+            meter.change(val, read_cycle_counter());
+        }
+
+        return retval;
+    }
+
+    std::uint16_t operator() () { return lamp(); }
+
+    const lamp_energy_meter& energy() const { return meter; }
+
+private:
+    gpio_register_23< lamp_t, instrumentation >     lamp;
+    lamp_energy_meter                               meter;
+    lamp_energy_ledger&                             ledger;
+};
+
+#endif // LAMP_ENERGY_H
@@ -0,0 +1,385 @@
+// latency_histogram.h
+//
+// latency_histogram -- an HDR-style histogram of latencies, in ticks
+//                      (see cycle_counter.h)
+//
+//      Buckets are log-linear: latencies below 64 ticks each get their
+//      own bucket; above that each power of two is split into 32 equal
+//      buckets. Consequently any latency is reported to within ~3% of
+//      its value, across the full 64 bit range, with 1920 counters.
+//
+//      Recording a latency is a bucket index computation (one count
+//      leading zeros) and one counter bump. No locks, no allocation.
+//
+//      Histograms merge by adding their counters, so per-thread
+//      histograms can be combined into one for reporting.
+//
+// latency_instrumentation -- an instrumentation policy (see
+//      field_instrumentation.h) which records the latency of each getter
+//      and setter call into per-thread histograms, one per field and kind
+//      of call. dump_latency() reports their percentiles.
+//
+//  Note1:  only the owning thread ever records into its histograms, so a
+//          relaxed load and store suffices. Other threads may read them
+//          while they are being recorded into.
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>        //  std::array
+#include <atomic>       //  std::atomic
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint8_t, std::uint64_t
+#include <iomanip>      //  std::setw
+#include <new>          //  std::bad_alloc
+#include <ostream>      //  std::ostream
+#include <string>       //  std::string, std::to_string
+
+#include "cycle_counter.h"
+#include "field_instrumentation.h"
+#include "per_thread_registry.h"
+#include "register_arena.h"
+
+class latency_histogram
+{
+public:
+    static const unsigned    SUB_BUCKET_BITS { 5 };                               // 32 buckets per power of two
+    static const std::size_t LINEAR_LIMIT    { std::size_t{2} << SUB_BUCKET_BITS }; // below 64 ticks each tick gets a bucket
+    static const std::size_t BUCKETS         { (64 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS };
+
+    latency_histogram() = default;
+
+    latency_histogram(const latency_histogram& other) { merge(other); }
+
+    latency_histogram& operator=(const latency_histogram& other)
+    {
+        reset();
+        merge(other);
+        return *this;
+    }
+
+    // bucket_index() -- the bucket a latency is counted in
+    static std::size_t bucket_index(std::uint64_t ticks)
+    {
+        if (ticks < LINEAR_LIMIT)
+        {
+            return static_cast<std::size_t>(ticks);
+        }
+
+        const unsigned msb      = 63 - __builtin_clzll(ticks);
+        const unsigned exponent = msb - SUB_BUCKET_BITS;                    // >= 1
+        const std::uint64_t mantissa = ticks >> exponent;                   // [32, 63]
+
+        return (static_cast<std::size_t>(exponent) << SUB_BUCKET_BITS) + static_cast<std::size_t>(mantissa);
+    }
+
+    // bucket_lowest() -- the smallest latency counted in the given bucket
+    static std::uint64_t bucket_lowest(std::size_t index)
+    {
+        if (index < LINEAR_LIMIT)
+        {
+            return index;
+        }
+
+        const unsigned      exponent = static_cast<unsigned>(index >> SUB_BUCKET_BITS) - 1;
+        const std::uint64_t mantissa = (index & ((std::size_t{1} << SUB_BUCKET_BITS) - 1)) | (std::size_t{1} << SUB_BUCKET_BITS);
+
+        return mantissa << exponent;
+    }
+
+    // bucket_highest() -- the largest latency counted in the given bucket
+    static std::uint64_t bucket_highest(std::size_t index)
+    {
+        return (index + 1 < BUCKETS) ? bucket_lowest(index + 1) - 1 : ~std::uint64_t{0};
+    }
+
+    void record(std::uint64_t ticks)                                        // Note1
+    {
+        bump(counts_[bucket_index(ticks)], 1);
+        bump(total_, 1);
+
+        if (ticks > max_.load(std::memory_order_relaxed))
+        {
+            max_.store(ticks, std::memory_order_relaxed);
+        }
+    }
+
+    void merge(const latency_histogram& other)
+    {
+        for (std::size_t i = 0; i < BUCKETS; ++i)
+        {
+            const std::uint64_t n = other.counts_[i].load(std::memory_order_relaxed);
+            if (n != 0)
+            {
+                bump(counts_[i], n);
+            }
+        }
+
+        bump(total_, other.count());
+
+        if (other.max() > max())
+        {
+            max_.store(other.max(), std::memory_order_relaxed);
+        }
+    }
+
+    void reset()
+    {
+        for (auto& n : counts_)
+        {
+            n.store(0, std::memory_order_relaxed);
+        }
+        total_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    std::uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+    std::uint64_t max()   const { return max_.load(std::memory_order_relaxed); }
+
+    // percentile() -- the latency which the given percentage (e.g., 99.9)
+    //                 of the recorded latencies do not exceed.
+    //                 Reported as the highest latency of its bucket, but
+    //                 never beyond the largest latency recorded
+    std::uint64_t percentile(double percent) const
+    {
+        const std::uint64_t total = count();
+        if (total == 0)
+        {
+            return 0;
+        }
+
+        std::uint64_t wanted = static_cast<std::uint64_t>(percent / 100.0 * total + 0.5);
+        if (wanted == 0)
+        {
+            wanted = 1;
+        }
+
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKETS; ++i)
+        {
+            seen += counts_[i].load(std::memory_order_relaxed);
+            if (seen >= wanted)
+            {
+                const std::uint64_t highest = bucket_highest(i);
+                return highest < max() ? highest : max();
+            }
+        }
+
+        return max();
+    }
+
+private:
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, BUCKETS> counts_ {};
+    std::atomic<std::uint64_t>                      total_  {0};
+    std::atomic<std::uint64_t>                      max_    {0};
+};
+
+
+// the kinds of call latency_instrumentation keeps apart
+const std::uint8_t  LATENCY_GETTER = 0;
+const std::uint8_t  LATENCY_SETTER = 1;     // includes elided writes
+
+// latency_instrumentation -- records getter and setter latencies
+//
+//      Each thread's histograms are created on the thread's first call
+//      to the given field, so only the fields actually used cost memory.
+struct latency_instrumentation
+{
+    typedef std::uint64_t stamp_t;
+
+    static const std::size_t MAX_SPACES    { counting_instrumentation::MAX_SPACES };
+    static const std::size_t MAX_REGISTERS { counting_instrumentation::MAX_REGISTERS };
+    static const std::size_t MAX_FIELDS    { counting_instrumentation::MAX_FIELDS };
+    static const std::size_t MAX_KEYS      { counting_instrumentation::MAX_KEYS };
+
+    static constexpr bool tracks(register_key_t key, std::uint8_t field_id)
+    {
+        return counting_instrumentation::tracks(key, field_id);
+    }
+
+    static stamp_t begin() noexcept { return read_cycle_counter(); }
+
+    static void read(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t) noexcept
+    {
+        record(key, field_id, LATENCY_GETTER, t0);
+    }
+
+    static void write(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t, std::uint16_t) noexcept
+    {
+        record(key, field_id, LATENCY_SETTER, t0);
+    }
+
+    static void elided_write(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t) noexcept
+    {
+        record(key, field_id, LATENCY_SETTER, t0);
+    }
+
+    // a rejected setting or refused toggle is not an actuation, so its latency is not recorded
+    static void range_error(register_key_t, std::uint8_t, std::uint16_t) noexcept {}
+    static void rate_limited(register_key_t, std::uint8_t, stamp_t, std::uint16_t) noexcept {}
+
+    // merged() -- the given field's histogram, merged over every thread,
+    //             including the threads which have since exited
+    //             Throws std::range_error for a field the tables can't hold
+    static latency_histogram merged(register_key_t key, std::uint8_t field_id, std::uint8_t kind)
+    {
+        const std::size_t row = counting_instrumentation::table_row(key, field_id);
+
+        latency_histogram merged_hist {};
+        registry::visit( [&](const retired_table& retired)
+                         {
+                             if (retired.hists[row][field_id][kind])
+                             {
+                                 merged_hist.merge(*retired.hists[row][field_id][kind]);
+                             }
+                         },
+                         [&](const table& t)
+                         {
+                             const latency_histogram* h = t.hists[row][field_id][kind].load(std::memory_order_acquire);
+                             if (h != nullptr)
+                             {
+                                 merged_hist.merge(*h);
+                             }
+                         } );
+
+        return merged_hist;
+    }
+
+private:
+    struct retired_table
+    {
+        register_ptr<latency_histogram> hists[MAX_KEYS][MAX_FIELDS][2];
+    };
+
+    // one per thread. Folds its histograms into the retired ones when the
+    // thread exits
+    struct table
+    {
+        std::atomic<latency_histogram*> hists[MAX_KEYS][MAX_FIELDS][2] {};
+
+        void retire(retired_table& retired)
+        {
+            for (std::size_t row = 0; row < MAX_KEYS; ++row)
+            {
+                for (std::size_t fld = 0; fld < MAX_FIELDS; ++fld)
+                {
+                    for (std::size_t kind = 0; kind < 2; ++kind)
+                    {
+                        register_ptr<latency_histogram> h { hists[row][fld][kind].load(std::memory_order_relaxed) };
+                        if (!h)
+                        {
+                            continue;
+                        }
+
+                        if (retired.hists[row][fld][kind])
+                        {
+                            retired.hists[row][fld][kind]->merge(*h);
+                        }
+                        else
+                        {
+                            retired.hists[row][fld][kind] = std::move(h);
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    typedef per_thread_registry<table, retired_table> registry;
+
+    // Note2:   the hooks run after a setter's store, so they must not
+    //          throw. A field the tables can't hold is skipped (the
+    //          functors static_assert tracks() of their fields), as is a
+    //          sample whose histogram the arena has no room for.
+    static void record(register_key_t key, std::uint8_t field_id, std::uint8_t kind, stamp_t t0) noexcept
+    {
+        const std::uint64_t t1 = read_cycle_counter();
+        if (latency_histogram* h = this_threads(key, field_id, kind))
+        {
+            h->record(t1 - t0);
+        }
+    }
+
+    // the calling thread's histogram for the given field, or nullptr. Note2
+    static latency_histogram* this_threads(register_key_t key, std::uint8_t field_id, std::uint8_t kind) noexcept
+    {
+        if (!tracks(key, field_id))
+        {
+            return nullptr;
+        }
+
+        std::atomic<latency_histogram*>& slot =
+            this_threads_table().hists[counting_instrumentation::tracked_row(key)][field_id][kind];
+
+        latency_histogram* h = slot.load(std::memory_order_relaxed);
+        if (h == nullptr)       // first call to this field on this thread
+        {
+            try
+            {
+                h = make_register<latency_histogram>().release();
+            }
+            catch (const std::bad_alloc&)
+            {
+                return nullptr;
+            }
+            slot.store(h, std::memory_order_release);
+        }
+
+        return h;
+    }
+
+    static table& this_threads_table()
+    {
+        return registry::local();
+    }
+};
+
+
+// dump_latency() -- reports the percentiles of every field's getter and
+//                   setter latencies, in nanoseconds. An IC's registers
+//                   are listed as space:reg
+inline void dump_latency(std::ostream& os)
+{
+    const double ns_per_tick = 1e9 / cycle_counter_hz();
+
+    os << "reg  field  call      count       p50(ns)     p90(ns)     p99(ns)   p99.9(ns)     max(ns)\n";
+
+    for (std::size_t row = 0; row < latency_instrumentation::MAX_KEYS; ++row)
+    {
+        const std::size_t       space = row / latency_instrumentation::MAX_REGISTERS;
+        const std::size_t       reg   = row % latency_instrumentation::MAX_REGISTERS;
+        const register_key_t    key   = register_key(static_cast<register_space_t>(space), static_cast<std::uint8_t>(reg));
+
+        for (std::size_t fld = 0; fld < latency_instrumentation::MAX_FIELDS; ++fld)
+        {
+            for (std::uint8_t kind : { LATENCY_GETTER, LATENCY_SETTER })
+            {
+                const latency_histogram h = latency_instrumentation::merged(key, static_cast<std::uint8_t>(fld), kind);
+                if (h.count() == 0)
+                {
+                    continue;
+                }
+
+                os << std::setw(3) << (space == BOARD_REGISTER_SPACE ? std::to_string(reg)
+                                                                     : std::to_string(space) + ':' + std::to_string(reg))
+                   << std::setw(7) << fld
+                   << (kind == LATENCY_GETTER ? "  getter" : "  setter")
+                   << std::setw(11) << h.count();
+
+                for (double pct : { 50.0, 90.0, 99.0, 99.9 })
+                {
+                    os << std::setw(12) << static_cast<std::uint64_t>(h.percentile(pct) * ns_per_tick);
+                }
+
+                os << std::setw(12) << static_cast<std::uint64_t>(h.max() * ns_per_tick) << '\n';
+            }
+        }
+    }
+}
+
+#endif // LATENCY_HISTOGRAM_H
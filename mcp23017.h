@@ -0,0 +1,154 @@
+// mcp23017.h
+//
+// Register map and field tags of the MCP23017, a 16 bit I2C GPIO expander
+// (two 8 bit ports, A and B). See ic_register_driver.h
+//
+//      ic_device< mcp23017_map > expander{ window };
+//      expander.reset();
+//
+//      ic_field_functor< mcp23017_direction< mcp23017_port::A, 3 > > gpa3_dir{ window };
+//      ic_field_functor< mcp23017_output< mcp23017_port::A, 3 > >    gpa3{ window };
+//      gpa3_dir(MCP23017_OUTPUT);
+//      gpa3(1);
+//
+//  Note1:  the addresses are those of IOCON.BANK = 0 (the power-on default),
+//          in which each port A register is followed by its port B twin.
+//
+//  Note2:  writing GPIO writes OLAT. Drive outputs through the mcp23017_output
+//          fields (OLAT), and read pins through the mcp23017_input fields
+//          (GPIO), which are the pins' actual levels, and so are read-only.
+//
+//  Note3:  the field tags take their writability from mcp23017_map (see
+//          ic_map_field in ic_register_driver.h). IOCON.BANK is read-only:
+//          setting it would move every register to the addresses of
+//          IOCON.BANK = 1, which the map doesn't describe (Note1).
+
+#ifndef MCP23017_H
+#define MCP23017_H
+
+#include <cstdint>      //  std::uint8_t
+
+#include "ic_register_driver.h"
+
+// register addresses. Note1
+const std::uint8_t  MCP23017_IODIRA   = 0x00;
+const std::uint8_t  MCP23017_IODIRB   = 0x01;
+const std::uint8_t  MCP23017_IPOLA    = 0x02;
+const std::uint8_t  MCP23017_IPOLB    = 0x03;
+const std::uint8_t  MCP23017_GPINTENA = 0x04;
+const std::uint8_t  MCP23017_GPINTENB = 0x05;
+const std::uint8_t  MCP23017_DEFVALA  = 0x06;
+const std::uint8_t  MCP23017_DEFVALB  = 0x07;
+const std::uint8_t  MCP23017_INTCONA  = 0x08;
+const std::uint8_t  MCP23017_INTCONB  = 0x09;
+const std::uint8_t  MCP23017_IOCON    = 0x0A;     // also at 0x0B
+const std::uint8_t  MCP23017_GPPUA    = 0x0C;
+const std::uint8_t  MCP23017_GPPUB    = 0x0D;
+const std::uint8_t  MCP23017_INTFA    = 0x0E;
+const std::uint8_t  MCP23017_INTFB    = 0x0F;
+const std::uint8_t  MCP23017_INTCAPA  = 0x10;
+const std::uint8_t  MCP23017_INTCAPB  = 0x11;
+const std::uint8_t  MCP23017_GPIOA    = 0x12;
+const std::uint8_t  MCP23017_GPIOB    = 0x13;
+const std::uint8_t  MCP23017_OLATA    = 0x14;
+const std::uint8_t  MCP23017_OLATB    = 0x15;
+
+// IODIR values
+const std::uint16_t MCP23017_OUTPUT   = 0;
+const std::uint16_t MCP23017_INPUT    = 1;     // the power-on default
+
+struct mcp23017_map
+{
+    static const std::size_t REGISTER_COUNT { 0x16 };
+
+    static constexpr ic_register_info REGISTERS[REGISTER_COUNT] {
+        { MCP23017_IODIRA,   0xFF, true,  "IODIRA"   },
+        { MCP23017_IODIRB,   0xFF, true,  "IODIRB"   },
+        { MCP23017_IPOLA,    0x00, true,  "IPOLA"    },
+        { MCP23017_IPOLB,    0x00, true,  "IPOLB"    },
+        { MCP23017_GPINTENA, 0x00, true,  "GPINTENA" },
+        { MCP23017_GPINTENB, 0x00, true,  "GPINTENB" },
+        { MCP23017_DEFVALA,  0x00, true,  "DEFVALA"  },
+        { MCP23017_DEFVALB,  0x00, true,  "DEFVALB"  },
+        { MCP23017_INTCONA,  0x00, true,  "INTCONA"  },
+        { MCP23017_INTCONB,  0x00, true,  "INTCONB"  },
+        { MCP23017_IOCON,    0x00, true,  "IOCON"    },
+        { 0x0B,              0x00, true,  "IOCON"    },
+        { MCP23017_GPPUA,    0x00, true,  "GPPUA"    },
+        { MCP23017_GPPUB,    0x00, true,  "GPPUB"    },
+        { MCP23017_INTFA,    0x00, false, "INTFA"    },
+        { MCP23017_INTFB,    0x00, false, "INTFB"    },
+        { MCP23017_INTCAPA,  0x00, false, "INTCAPA"  },
+        { MCP23017_INTCAPB,  0x00, false, "INTCAPB"  },
+        { MCP23017_GPIOA,    0x00, true,  "GPIOA"    },
+        { MCP23017_GPIOB,    0x00, true,  "GPIOB"    },
+        { MCP23017_OLATA,    0x00, true,  "OLATA"    },
+        { MCP23017_OLATB,    0x00, true,  "OLATB"    }
+    };
+};
+
+static_assert(ic_register_map_is_dense(mcp23017_map::REGISTERS), "the MCP23017's map must list every address from 0");
+
+enum class mcp23017_port : std::uint8_t
+{
+    A = 0,
+    B = 1
+};
+
+// a port's register, given the port A register's address. Note1
+constexpr std::uint8_t mcp23017_reg(std::uint8_t port_a_addr, mcp23017_port port)
+{
+    return static_cast<std::uint8_t>(port_a_addr + static_cast<std::uint8_t>(port));
+}
+
+//-------- field tags ----------
+
+// a field of one of the MCP23017's registers. Note3
+template< std::uint8_t ADDR, std::uint8_t SHIFT, std::uint8_t WIDTH, bool READ_ONLY = false >
+using mcp23017_map_field = ic_map_field< mcp23017_map, ADDR, SHIFT, WIDTH, READ_ONLY >;
+
+// one pin's direction: MCP23017_OUTPUT or MCP23017_INPUT
+template< mcp23017_port PORT, std::uint8_t PIN >
+using mcp23017_direction = mcp23017_map_field< mcp23017_reg(MCP23017_IODIRA, PORT), PIN, 1 >;
+
+// one pin's 100k pull-up: 1 == enabled
+template< mcp23017_port PORT, std::uint8_t PIN >
+using mcp23017_pullup = mcp23017_map_field< mcp23017_reg(MCP23017_GPPUA, PORT), PIN, 1 >;
+
+// one pin's input polarity: 1 == inverted
+template< mcp23017_port PORT, std::uint8_t PIN >
+using mcp23017_polarity = mcp23017_map_field< mcp23017_reg(MCP23017_IPOLA, PORT), PIN, 1 >;
+
+// one pin's output latch. Note2
+template< mcp23017_port PORT, std::uint8_t PIN >
+using mcp23017_output = mcp23017_map_field< mcp23017_reg(MCP23017_OLATA, PORT), PIN, 1 >;
+
+// one pin's level. Read-only, Note2
+template< mcp23017_port PORT, std::uint8_t PIN >
+using mcp23017_input = mcp23017_map_field< mcp23017_reg(MCP23017_GPIOA, PORT), PIN, 1, true >;
+
+// a whole port at once
+template< mcp23017_port PORT >
+using mcp23017_port_direction = mcp23017_map_field< mcp23017_reg(MCP23017_IODIRA, PORT), 0, 8 >;
+
+template< mcp23017_port PORT >
+using mcp23017_port_output = mcp23017_map_field< mcp23017_reg(MCP23017_OLATA, PORT), 0, 8 >;
+
+template< mcp23017_port PORT >
+using mcp23017_port_input = mcp23017_map_field< mcp23017_reg(MCP23017_GPIOA, PORT), 0, 8, true >;   // read-only, Note2
+
+// the pins which caused the last interrupt. Read-only, as INTF is
+template< mcp23017_port PORT >
+using mcp23017_interrupt_flags = mcp23017_map_field< mcp23017_reg(MCP23017_INTFA, PORT), 0, 8 >;
+
+// IOCON's bits. BANK is read-only, Note3
+typedef mcp23017_map_field< MCP23017_IOCON, 7, 1, true > mcp23017_iocon_bank_t;      // 1 == registers grouped by port
+typedef mcp23017_map_field< MCP23017_IOCON, 6, 1 >       mcp23017_iocon_mirror_t;    // 1 == INTA and INTB are wired together
+typedef mcp23017_map_field< MCP23017_IOCON, 5, 1 >       mcp23017_iocon_seqop_t;     // 1 == no address auto-increment
+typedef mcp23017_map_field< MCP23017_IOCON, 4, 1 >       mcp23017_iocon_disslw_t;    // 1 == SDA slew rate control disabled
+typedef mcp23017_map_field< MCP23017_IOCON, 2, 1 >       mcp23017_iocon_odr_t;       // 1 == INT pins are open drain
+typedef mcp23017_map_field< MCP23017_IOCON, 1, 1 >       mcp23017_iocon_intpol_t;    // 1 == INT pins are active high
+
+//-------- end of field tags ----------
+
+#endif // MCP23017_H
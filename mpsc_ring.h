@@ -0,0 +1,107 @@
+// mpsc_ring.h
+//
+// mpsc_ring -- a bounded, lock-free, multiple producer/single consumer ring
+//
+//      Any number of threads may push(); exactly one thread may pop().
+//      Neither ever blocks nor takes a lock: push() fails when the
+//      ring is full and pop() fails when the ring is empty.
+//
+//      capacity must be a power of two.
+//
+//  Note1:  each slot carries a sequence number telling producers and the
+//          consumer whose turn it is. A slot at position pos is free for
+//          the producer which claims pos when its sequence is pos, and
+//          holds an item for the consumer when its sequence is pos + 1.
+//          Producers claim positions by compare-exchanging head, so two
+//          producers never fill the same slot. (D. Vyukov's bounded queue.)
+
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>       //  std::atomic
+#include <cstddef>      //  std::size_t, std::ptrdiff_t
+
+#include "field_instrumentation.h"  //  CACHE_LINE_SIZE
+#include "register_arena.h"
+
+template< typename T, std::size_t capacity >
+class mpsc_ring
+{
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    mpsc_ring() : slots_(make_register_array<slot>(capacity))
+    {
+        for (std::size_t i = 0; i < capacity; ++i)
+        {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // producer side. returns false, leaving the ring untouched, if the ring is full
+    bool push(const T& item)
+    {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+
+        for (;;)                                        // Note1
+        {
+            slot& s = slots_[pos & (capacity - 1)];
+
+            const std::ptrdiff_t turn = static_cast<std::ptrdiff_t>(s.seq.load(std::memory_order_acquire) - pos);
+            if (turn == 0)
+            {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    s.item = item;
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (turn < 0)          // the consumer hasn't drained this slot yet
+            {
+                return false;
+            }
+            else                        // another producer claimed pos first
+            {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // consumer side. returns false, leaving item untouched, if the ring is empty
+    bool pop(T& item)
+    {
+        const std::size_t pos = tail_.load(std::memory_order_relaxed);
+        slot& s = slots_[pos & (capacity - 1)];
+
+        if (s.seq.load(std::memory_order_acquire) != pos + 1)
+        {
+            return false;
+        }
+
+        item = s.item;
+        s.seq.store(pos + capacity, std::memory_order_release);
+        tail_.store(pos + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    // number of items in the ring. Only a hint while either side is active
+    std::size_t size() const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    struct slot
+    {
+        std::atomic<std::size_t>    seq {0};
+        T                           item {};
+    };
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_ {0};    // next position to claim. Producers share
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_ {0};    // next position to drain. Consumer owned
+    register_array<slot>                              slots_;
+};
+
+#endif // MPSC_RING_H
@@ -0,0 +1,111 @@
+// per_thread_registry.h
+//
+// per_thread_registry -- gives each thread its own T, and keeps track of
+//                        every live thread's T, so that another thread can
+//                        total them up
+//
+//      The instrumentation policies keep their per thread state this way
+//      (counters, histograms, trace rings), so that their hooks never
+//      contend with another thread:
+//
+//          local()     -- the calling thread's T, built on its first call
+//          visit()     -- under the registry's lock, hands the retired
+//                         state, then each live thread's T, to the caller
+//
+//      When a thread exits, its T is handed the registry's retired_t
+//      state, through T::retire(retired_t&), under the registry's lock,
+//      so that whatever it gathered outlives the thread. Then it is
+//      deregistered.
+//
+//  Note1:  the T's are linked into the registry through their own nodes,
+//          so registering a thread's T allocates nothing.
+//
+//  Note2:  the registry is constructed before the first thread's node is,
+//          so it outlives every thread's node.
+
+#ifndef PER_THREAD_REGISTRY_H
+#define PER_THREAD_REGISTRY_H
+
+#include <mutex>        //  std::mutex, std::lock_guard
+
+template< typename T, typename retired_t >
+class per_thread_registry
+{
+public:
+    static T& local()
+    {
+        thread_local node n;
+        return n.value;
+    }
+
+    // on_retired(retired_t&), then on_live(T&) for each live thread's T
+    template< typename retired_fn_t, typename live_fn_t >
+    static void visit(retired_fn_t on_retired, live_fn_t on_live)
+    {
+        registry& r = the_registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+
+        on_retired(r.retired);
+        for (node* n = r.head; n != nullptr; n = n->next)
+        {
+            on_live(n->value);
+        }
+    }
+
+private:
+    struct node;
+
+    struct registry
+    {
+        std::mutex  mtx;
+        node*       head {nullptr};     // Note1
+        retired_t   retired {};
+    };
+
+    // one per thread. Registers itself on construction; retires its T
+    // when the thread exits
+    struct node
+    {
+        T       value {};
+        node*   prev  {nullptr};
+        node*   next  {nullptr};
+
+        node()
+        {
+            registry& r = the_registry();                                   // Note2
+            std::lock_guard<std::mutex> lock(r.mtx);
+
+            next = r.head;
+            if (next != nullptr)
+            {
+                next->prev = this;
+            }
+            r.head = this;
+        }
+
+        ~node()
+        {
+            registry& r = the_registry();
+            std::lock_guard<std::mutex> lock(r.mtx);
+
+            value.retire(r.retired);
+
+            (prev != nullptr ? prev->next : r.head) = next;
+            if (next != nullptr)
+            {
+                next->prev = prev;
+            }
+        }
+
+        node(const node&)            = delete;
+        node& operator=(const node&) = delete;
+    };
+
+    static registry& the_registry()
+    {
+        static registry r;
+        return r;
+    }
+};
+
+#endif // PER_THREAD_REGISTRY_H
@@ -0,0 +1,239 @@
+// register_arena.h
+//
+// The allocation-free build mode. Built with REGISTER_STATIC_ARENAS
+// defined, every runtime structure of the library -- frame images, board
+// handle arrays, rings, subscription lists, instrumentation and trace
+// registries, latency histograms, fleet image arrays -- draws its memory
+// from register_arena, a fixed-capacity block of static storage sized at
+// compile time, and never from the heap. Built without it, they use the
+// heap, as they always have. See Note1
+//
+//      g++ -std=c++17 -DREGISTER_STATIC_ARENAS -DREGISTER_ARENA_BYTES=262144 ...
+//
+// register_arena -- a bump allocator over REGISTER_ARENA_BYTES of static
+//      storage (1 MiB by default). Allocating is a compare-exchange of the
+//      arena's top; freeing is a no-op. Throws std::bad_alloc once the
+//      arena is exhausted.
+//
+// The library's structures hold their memory through these, which pick the
+// arena or the heap according to the build mode:
+//
+//      register_allocator<T>       -- arena_allocator<T>, or std::allocator<T>
+//      register_vector<T>          -- a std::vector using register_allocator<T>
+//      register_ptr<T>             -- a std::unique_ptr, made by make_register<T>(args...)
+//      register_array<T>           -- a std::unique_ptr<T[]>, made by make_register_array<T>(n)
+//
+// Errors don't allocate in either mode: the library's exceptions carry
+// their message in a fixed buffer. See register_error.h
+//
+//  Note1:  arena memory is never returned. The mode is for programs which
+//          build their structures once, at startup, and then run their
+//          real-time loop: reserve vectors to size, subscribe and register
+//          before the loop starts. A structure freed and rebuilt, or a
+//          vector regrown, leaks its old block into the arena, so
+//          REGISTER_ARENA_BYTES must cover the startup high water mark;
+//          register_arena::used() reports it.
+//
+//  Note2:  some memory is outside the library's control, and is not drawn
+//          from the arena: std::thread's start state (board_controller, at
+//          startup), a register_poller callback's std::function captures
+//          (small lambdas are stored inline), the vectors the query
+//          functions return (e.g., lamp_energy_meter::readings(),
+//          fleet_field_histogram()), and the register_trace file I/O. The
+//          library's steady state paths -- the field accessors,
+//          transactions, frames, bus batches, notifications, tracing and
+//          instrumentation -- don't allocate at all. ut_heap_guard.h checks
+//          so, in ut_register_arena.cpp.
+
+#ifndef REGISTER_ARENA_H
+#define REGISTER_ARENA_H
+
+#include <atomic>       //  std::atomic
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uintptr_t
+#include <memory>       //  std::unique_ptr, std::allocator
+#include <new>          //  std::bad_alloc, placement new
+#include <utility>      //  std::forward
+#include <vector>       //  std::vector
+
+#ifndef REGISTER_ARENA_BYTES
+#define REGISTER_ARENA_BYTES (1u << 20)
+#endif
+
+class register_arena
+{
+public:
+    static constexpr std::size_t capacity() { return REGISTER_ARENA_BYTES; }
+
+    // bytes aligned to align, a power of two. Throws std::bad_alloc if the arena can't hold them
+    static void* allocate(std::size_t bytes, std::size_t align)
+    {
+        const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(storage());
+        std::size_t          top  = top_().load(std::memory_order_relaxed);
+
+        bytes = (bytes != 0 ? bytes : 1);       // distinct allocations get distinct addresses
+
+        for (;;)
+        {
+            const std::size_t begin = ((base + top + align - 1) & ~std::uintptr_t(align - 1)) - base;
+            if (begin > capacity() || bytes > capacity() - begin)
+            {
+                throw std::bad_alloc();
+            }
+
+            if (top_().compare_exchange_weak(top, begin + bytes, std::memory_order_relaxed))
+            {
+                return storage() + begin;
+            }
+        }
+    }
+
+    // arena memory is never returned. Note1
+    static void deallocate(void*, std::size_t) noexcept {}
+
+    // the bytes handed out so far, including alignment padding
+    static std::size_t used() { return top_().load(std::memory_order_relaxed); }
+
+private:
+    static unsigned char* storage()
+    {
+        alignas(CACHE_LINE_ALIGN) static unsigned char block[REGISTER_ARENA_BYTES];
+        return block;
+    }
+
+    static std::atomic<std::size_t>& top_()
+    {
+        static std::atomic<std::size_t> top {0};
+        return top;
+    }
+
+    static const std::size_t CACHE_LINE_ALIGN { 64 };
+};
+
+// arena_allocator -- an allocator drawing from register_arena
+template< typename T >
+struct arena_allocator
+{
+    typedef T value_type;
+
+    arena_allocator() noexcept = default;
+
+    template< typename U >
+    arena_allocator(const arena_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        if (n > std::size_t(-1) / sizeof(T))
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(register_arena::allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept { register_arena::deallocate(p, n * sizeof(T)); }
+};
+
+template< typename T, typename U >
+bool operator==(const arena_allocator<T>&, const arena_allocator<U>&) { return true; }
+
+template< typename T, typename U >
+bool operator!=(const arena_allocator<T>&, const arena_allocator<U>&) { return false; }
+
+
+#ifdef REGISTER_STATIC_ARENAS
+
+template< typename T >
+using register_allocator = arena_allocator<T>;
+
+// destroys a register_ptr's object, handing its memory back to the arena
+template< typename T >
+struct register_deleter
+{
+    void operator()(T* p) const
+    {
+        p->~T();
+        register_arena::deallocate(p, sizeof(T));
+    }
+};
+
+template< typename T >
+using register_ptr = std::unique_ptr< T, register_deleter<T> >;
+
+template< typename T, typename... args_t >
+register_ptr<T> make_register(args_t&&... args)
+{
+    void* p = register_arena::allocate(sizeof(T), alignof(T));
+    return register_ptr<T>( new (p) T(std::forward<args_t>(args)...) );
+}
+
+// destroys a register_array's elements, handing their memory back to the arena
+template< typename T >
+struct register_array_deleter
+{
+    std::size_t count {0};
+
+    void operator()(T* p) const
+    {
+        for (std::size_t i = count; i-- > 0;)
+        {
+            p[i].~T();
+        }
+        register_arena::deallocate(p, count * sizeof(T));
+    }
+};
+
+template< typename T >
+using register_array = std::unique_ptr< T[], register_array_deleter<T> >;
+
+// n default initialized elements, as new T[n] makes them
+template< typename T >
+register_array<T> make_register_array(std::size_t n)
+{
+    T* p = arena_allocator<T>{}.allocate(n);
+
+    std::size_t built = 0;
+    try
+    {
+        for (; built < n; ++built)
+        {
+            new (p + built) T;
+        }
+    }
+    catch (...)
+    {
+        register_array_deleter<T>{ built }(p);
+        throw;
+    }
+
+    return register_array<T>( p, register_array_deleter<T>{ n } );
+}
+
+#else
+
+template< typename T >
+using register_allocator = std::allocator<T>;
+
+template< typename T >
+using register_ptr = std::unique_ptr<T>;
+
+template< typename T, typename... args_t >
+register_ptr<T> make_register(args_t&&... args)
+{
+    return register_ptr<T>( new T(std::forward<args_t>(args)...) );
+}
+
+template< typename T >
+using register_array = std::unique_ptr<T[]>;
+
+template< typename T >
+register_array<T> make_register_array(std::size_t n)
+{
+    return register_array<T>( new T[n] );
+}
+
+#endif // REGISTER_STATIC_ARENAS
+
+template< typename T >
+using register_vector = std::vector< T, register_allocator<T> >;
+
+#endif // REGISTER_ARENA_H
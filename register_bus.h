@@ -0,0 +1,383 @@
+// register_bus.h
+//
+// Transport for IC registers behind a serial bus (I2C, SPI).
+//
+// Through a mmio_window (see ic_register_driver.h) a field functor's
+// read-modify-write costs a couple of memory accesses. Behind a bus each
+// of those accesses is a bus transaction, whose round trip dwarfs
+// everything else. This header cuts the number of round trips:
+//
+// bus_transport -- the bus. execute() carries out a list of transfers
+//      (each a burst read or burst write of consecutive registers of one
+//      device) back to back, as a single pipelined round trip, and returns
+//      once they have all completed. A real transport maps this onto its
+//      driver's batched call, e.g. Linux i2c-dev's I2C_RDWR ioctl, or a
+//      queued SPI message.
+//
+// simulated_bus -- an in-process bus with devices made of plain register
+//      files, and a configurable latency (bus_latency), for testing and
+//      benchmarking without hardware.
+//
+// bus_window -- access handle making one transfer per access. Every field
+//      functor call is at least one round trip.
+//
+// bus_batch -- coalesces a device's field updates. fetch() burst reads
+//      registers into a shadow; functors using the batch's window then
+//      read and write the shadow; flush() writes the registers they
+//      changed back as the fewest bursts, pipelined into one round trip:
+//
+//          bus_batch< mcp23017_map > batch{ bus, 0x20 };
+//          batch.fetch_all();
+//          ic_field_functor< mcp23017_output< mcp23017_port::A, 3 >, batch_window< mcp23017_map > > gpa3{ batch.window() };
+//          ic_field_functor< mcp23017_output< mcp23017_port::B, 0 >, batch_window< mcp23017_map > > gpb0{ batch.window() };
+//          gpa3(1);
+//          gpb0(1);
+//          batch.flush();     // one burst: OLATA, OLATB
+//
+//      stage_flush() appends the transfers to a list instead, so that the
+//      flushes of several devices share one round trip.
+//
+//  Note1:  runs of changed registers separated by at most BRIDGE_GAP
+//          unchanged ones are written as one burst, the unchanged
+//          registers rewritten with the values they already hold. That
+//          only happens when those registers are writable and were
+//          fetched, so the values written are the device's own.
+//
+//  Note2:  the shadow is only as fresh as the last fetch(). Fetch inputs
+//          (e.g., GPIO) before reading them through the batch.
+
+#ifndef REGISTER_BUS_H
+#define REGISTER_BUS_H
+
+#include <array>        //  std::array
+#include <chrono>       //  std::chrono::steady_clock, std::chrono::nanoseconds
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint8_t, std::uint64_t
+#include <cstring>      //  std::memcpy
+#include <stdexcept>    //  std::runtime_error, std::range_error
+#include <vector>       //  std::vector
+
+#include "ic_register_driver.h"
+#include "register_arena.h"
+#include "register_error.h"
+
+// one burst transfer. For a read, data receives count registers; for a
+// write, data holds them
+struct bus_transfer
+{
+    std::uint8_t    device;     // the device's bus address
+    std::uint8_t    first;      // its first register
+    bool            is_read;
+    std::size_t     count;
+    ic_reg_t*       data;
+};
+
+// the error thrown when a device does not answer
+class bus_error : public fixed_message_error<std::runtime_error>
+{
+public:
+    using fixed_message_error<std::runtime_error>::fixed_message_error;
+};
+
+
+class bus_transport
+{
+public:
+    virtual ~bus_transport() = default;
+
+    // execute() -- carries out the transfers in order, pipelined into a
+    //              single round trip. Throws bus_error
+    virtual void execute(bus_transfer* transfers, std::size_t count) = 0;
+
+    void execute(std::vector<bus_transfer>& transfers) { execute(transfers.data(), transfers.size()); }
+};
+
+
+// the simulated bus's timing. A call to execute() takes
+//      round_trip + per_transfer * transfers + per_byte * registers moved
+struct bus_latency
+{
+    std::chrono::nanoseconds    round_trip   {0};
+    std::chrono::nanoseconds    per_transfer {0};   // e.g., I2C's start condition and address bytes
+    std::chrono::nanoseconds    per_byte     {0};
+};
+
+class simulated_bus : public bus_transport
+{
+public:
+    static const std::size_t DEVICE_REGISTERS { 256 };
+    static const std::size_t BUS_ADDRESSES    { 128 };      // 7 bit bus addresses
+
+    explicit simulated_bus(bus_latency latency_ = bus_latency{}) : latency(latency_) {}
+
+    using bus_transport::execute;
+
+    // attach() -- puts a device on the bus at addr. Returns its registers,
+    //             all 0, which the test may inspect and poke
+    ic_reg_t* attach(std::uint8_t addr)
+    {
+        if (addr >= BUS_ADDRESSES)
+        {
+            throw std::range_error("simulated_bus: bus addresses are 7 bits");
+        }
+
+        devices[addr] = make_register< std::array<ic_reg_t, DEVICE_REGISTERS> >();
+        return devices[addr]->data();
+    }
+
+    void execute(bus_transfer* transfers, std::size_t count) override
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const bus_transfer& t = transfers[i];
+
+            if (t.device >= BUS_ADDRESSES || !devices[t.device])
+            {
+                throw bus_error( "No device answered at bus address 0x%x. ", unsigned{t.device} );
+            }
+            if (t.first + t.count > DEVICE_REGISTERS)
+            {
+                throw std::range_error("simulated_bus: transfer runs off the end of the device's registers");
+            }
+
+            ic_reg_t* regs = devices[t.device]->data() + t.first;
+            if (t.is_read)
+            {
+                std::memcpy(t.data, regs, t.count);
+            }
+            else
+            {
+                std::memcpy(regs, t.data, t.count);
+            }
+            bytes += t.count;
+        }
+
+        ++round_trips_;
+        transfers_ += count;
+        bytes_     += bytes;
+
+        // the bus is busy until the last transfer has completed
+        const auto busy = latency.round_trip + latency.per_transfer * count + latency.per_byte * bytes;
+        while (std::chrono::steady_clock::now() - start < busy)
+        {
+            // spin
+        }
+    }
+
+    std::uint64_t round_trips() const { return round_trips_; }
+    std::uint64_t transfers()   const { return transfers_; }
+    std::uint64_t bytes()       const { return bytes_; }
+
+private:
+    const bus_latency                                               latency;
+    register_ptr< std::array<ic_reg_t, DEVICE_REGISTERS> >          devices[BUS_ADDRESSES];
+
+    std::uint64_t   round_trips_ {0};
+    std::uint64_t   transfers_   {0};
+    std::uint64_t   bytes_       {0};
+};
+
+
+// bus_window -- access handle making one transfer per access
+class bus_window
+{
+public:
+    bus_window(bus_transport& bus_, std::uint8_t device_) : bus(&bus_), device(device_) {}
+
+    ic_reg_t read(std::uint8_t addr) const
+    {
+        ic_reg_t val = 0;
+        read_burst(addr, &val, 1);
+        return val;
+    }
+
+    void write(std::uint8_t addr, ic_reg_t val) { write_burst(addr, &val, 1); }
+
+    void read_burst(std::uint8_t first, ic_reg_t* out, std::size_t count) const
+    {
+        bus_transfer t { device, first, true, count, out };
+        bus->execute(&t, 1);
+    }
+
+    void write_burst(std::uint8_t first, const ic_reg_t* in, std::size_t count)
+    {
+        bus_transfer t { device, first, false, count, const_cast<ic_reg_t*>(in) };
+        bus->execute(&t, 1);
+    }
+
+private:
+    bus_transport*  bus;
+    std::uint8_t    device;
+};
+
+
+template< typename register_map >
+class bus_batch;
+
+// batch_window -- access handle onto a bus_batch's shadow
+template< typename register_map >
+class batch_window
+{
+public:
+    explicit batch_window(bus_batch< register_map >& batch_) : batch(&batch_) {}
+
+    ic_reg_t read(std::uint8_t addr) const                                      { return batch->shadow[addr]; }
+    void     write(std::uint8_t addr, ic_reg_t val)                             { batch->stage(addr, &val, 1); }
+    void     read_burst(std::uint8_t first, ic_reg_t* out, std::size_t count) const
+    {
+        std::memcpy(out, &batch->shadow[first], count);
+    }
+    void     write_burst(std::uint8_t first, const ic_reg_t* in, std::size_t count) { batch->stage(first, in, count); }
+
+private:
+    bus_batch< register_map >* batch;
+};
+
+
+template< typename register_map >
+class bus_batch
+{
+public:
+    static const std::size_t REGISTER_COUNT { register_map::REGISTER_COUNT };
+    static const std::size_t BRIDGE_GAP     { 2 };     // Note1
+
+    static_assert(REGISTER_COUNT <= 64, "a bus_batch tracks its registers in a 64 bit mask");
+
+    bus_batch(bus_transport& bus_, std::uint8_t device_) : bus(bus_), device(device_) {}
+
+    // the batch is referred to by its windows
+    bus_batch(const bus_batch&)            = delete;
+    bus_batch& operator=(const bus_batch&) = delete;
+
+    batch_window< register_map > window() { return batch_window< register_map >{ *this }; }
+
+    // fetch() -- burst reads registers [first, first + count) into the shadow.
+    //            Registers with unflushed changes keep their changed values.
+    //            Throws std::range_error, reading nothing, if the run goes
+    //            past the device's last register
+    void fetch(std::uint8_t first, std::size_t count)
+    {
+        if (first > REGISTER_COUNT || count > REGISTER_COUNT - first)
+        {
+            throw register_range_error( "bus_batch: fetching %zu registers from 0x%x runs past the device's %zu registers. ",
+                                        count, unsigned{first}, REGISTER_COUNT );
+        }
+
+        ic_reg_t fetched[REGISTER_COUNT];
+        bus_transfer t { device, first, true, count, fetched };
+        bus.execute(&t, 1);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!((dirty >> (first + i)) & 1u))
+            {
+                shadow[first + i] = fetched[i];
+            }
+        }
+        valid |= run_mask(first, count);
+    }
+
+    void fetch_all() { fetch(0, REGISTER_COUNT); }
+
+    // stage_flush() -- appends the transfers writing back the changed
+    //                  registers to transfers, and considers them written.
+    //                  The transfers point into the shadow, so execute
+    //                  them before changing anything through the batch again
+    void stage_flush(std::vector<bus_transfer>& transfers)
+    {
+        stage([&transfers](const bus_transfer& t) { transfers.push_back(t); });
+    }
+
+    // flush() -- writes back the changed registers in one round trip.
+    //            The transfers are staged on the stack: no allocation
+    void flush()
+    {
+        std::array<bus_transfer, REGISTER_COUNT> transfers;
+        std::size_t                              count = 0;
+
+        stage([&transfers, &count](const bus_transfer& t) { transfers[count++] = t; });
+        if (count != 0)
+        {
+            bus.execute(transfers.data(), count);
+        }
+    }
+
+    bool pending() const { return dirty != 0; }
+
+private:
+    friend class batch_window< register_map >;
+
+    // hands emit() the transfers writing back the changed registers, and
+    // considers them written. Runs are separated by unchanged registers,
+    // so there are fewer than REGISTER_COUNT of them
+    template< typename emit_t >
+    void stage(emit_t emit)
+    {
+        std::uint64_t pending = dirty;
+        while (pending != 0)
+        {
+            const unsigned first = static_cast<unsigned>(__builtin_ctzll(pending));
+            unsigned       end   = first;
+
+            // extend the run over changed registers, and over short gaps. Note1
+            for (;;)
+            {
+                while (end < REGISTER_COUNT && ((dirty >> end) & 1u))
+                {
+                    ++end;
+                }
+
+                unsigned next = end;
+                while (next < REGISTER_COUNT && next - end < BRIDGE_GAP && !((dirty >> next) & 1u) && bridgeable(next))
+                {
+                    ++next;
+                }
+
+                if (next < REGISTER_COUNT && next > end && ((dirty >> next) & 1u))
+                {
+                    end = next;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            emit(bus_transfer{ device, static_cast<std::uint8_t>(first), false, end - first, &shadow[first] });
+            pending &= ~run_mask(first, end - first);
+        }
+
+        dirty = 0;
+    }
+
+    static std::uint64_t run_mask(std::size_t first, std::size_t count)
+    {
+        return (count >= 64 ? ~std::uint64_t{0} : ((std::uint64_t{1} << count) - 1)) << first;
+    }
+
+    bool bridgeable(unsigned addr) const
+    {
+        return register_map::REGISTERS[addr].writable && ((valid >> addr) & 1u);
+    }
+
+    void stage(std::uint8_t first, const ic_reg_t* in, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            shadow[first + i] = in[i];
+        }
+        dirty |= run_mask(first, count);
+        valid |= run_mask(first, count);
+    }
+
+    bus_transport&                          bus;
+    const std::uint8_t                      device;
+    std::array<ic_reg_t, REGISTER_COUNT>    shadow {};
+    std::uint64_t                           dirty  {0};     // changed since the last flush
+    std::uint64_t                           valid  {0};     // fetched or written
+};
+
+#endif // REGISTER_BUS_H
@@ -0,0 +1,71 @@
+// register_descriptor.h
+//
+// field_descriptor -- describes where a named field lives within a
+//                     register's raw 16 bit word
+//
+//      The functors twiddle bits through bit-fields. Code which works on
+//      raw register words instead (e.g., SIMD kernels over thousands of
+//      register images) uses field descriptors to find the same bits.
+//
+//  Note1:  The layout of the fields within a bit-field is implementation
+//          dependent (see README.md). Each register header states the
+//          layout its compiler gives its bit-field, and its UT verifies
+//          that the descriptors agree with the bit-field.
+//
+//  Note2:  register ids are only unique within a register space: IC
+//          register 0x17 is not board register #23. Anything keyed by
+//          register, e.g., the instrumentation (see field_instrumentation.h),
+//          keys it by register_key(space, reg_id).
+
+#ifndef REGISTER_DESCRIPTOR_H
+#define REGISTER_DESCRIPTOR_H
+
+#include <cstdint>      //  std::uint8_t, std::uint16_t
+
+// the spaces register ids are drawn from. Note2
+typedef std::uint8_t    register_space_t;
+typedef std::uint16_t   register_key_t;     // a register id, qualified by its space
+
+const register_space_t  BOARD_REGISTER_SPACE { 0 };     // the board's own registers, e.g., register #23
+const register_space_t  IC_REGISTER_SPACE    { 1 };     // the first IC's registers, by address (see ic_register_driver.h)
+
+// a board register's key is its register id
+constexpr register_key_t register_key(register_space_t space, std::uint8_t reg_id)
+{
+    return static_cast<register_key_t>((space << 8) | reg_id);
+}
+
+constexpr register_space_t key_space(register_key_t key)  { return static_cast<register_space_t>(key >> 8); }
+constexpr std::uint8_t     key_reg_id(register_key_t key) { return static_cast<std::uint8_t>(key & 0xFF); }
+
+struct field_descriptor
+{
+    std::uint8_t    reg_id;
+    std::uint8_t    field_id;
+    std::uint8_t    shift;      // bit position of the field's LSB
+    std::uint8_t    width;      // in bits
+
+    // the field's bits, in place within the register word
+    constexpr std::uint16_t mask() const
+    {
+        return static_cast<std::uint16_t>(((1u << width) - 1u) << shift);
+    }
+
+    // the largest value the field can hold
+    constexpr std::uint16_t max_value() const
+    {
+        return static_cast<std::uint16_t>((1u << width) - 1u);
+    }
+
+    constexpr std::uint16_t extract(std::uint16_t word) const
+    {
+        return static_cast<std::uint16_t>((word & mask()) >> shift);
+    }
+
+    constexpr std::uint16_t insert(std::uint16_t word, std::uint16_t val) const
+    {
+        return static_cast<std::uint16_t>((word & ~mask()) | ((val << shift) & mask()));
+    }
+};
+
+#endif // REGISTER_DESCRIPTOR_H
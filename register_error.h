@@ -0,0 +1,50 @@
+// register_error.h
+//
+// fixed_message_error -- an exception of type base (e.g., std::range_error)
+//                        which carries its message in a fixed buffer
+//
+//      The library throws these from its accessors, so that rejecting a
+//      bad value never touches the heap: the message is formatted, with
+//      std::snprintf, into a buffer inside the exception object, and base
+//      is given an empty message, which doesn't allocate. Catch them as
+//      their base:
+//
+//          throw register_range_error( "Valid range is 0:%u. ", max );
+//          ...
+//          catch (std::range_error& e) { std::cout << e.what(); }
+//
+//      Messages longer than REGISTER_ERROR_MESSAGE_BYTES - 1 are truncated.
+//
+//  Note1:  the exception object itself comes from the C++ runtime's
+//          exception allocator (__cxa_allocate_exception), not operator
+//          new, with an emergency pool for when malloc fails.
+
+#ifndef REGISTER_ERROR_H
+#define REGISTER_ERROR_H
+
+#include <cstddef>      //  std::size_t
+#include <cstdio>       //  std::snprintf
+#include <stdexcept>    //  std::range_error
+
+const std::size_t REGISTER_ERROR_MESSAGE_BYTES { 256 };
+
+template< typename base >
+class fixed_message_error : public base
+{
+public:
+    // format and args as std::snprintf takes them
+    template< typename... args_t >
+    explicit fixed_message_error(const char* format, args_t... args) : base("")
+    {
+        std::snprintf(message, sizeof(message), format, args...);
+    }
+
+    const char* what() const noexcept override { return message; }
+
+private:
+    char message[REGISTER_ERROR_MESSAGE_BYTES];
+};
+
+typedef fixed_message_error<std::range_error>   register_range_error;
+
+#endif // REGISTER_ERROR_H
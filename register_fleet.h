@@ -0,0 +1,340 @@
+// register_fleet.h
+//
+// Register images for a fleet of simulated control boards, stored as a
+// structure of arrays: for each register id, one contiguous array holding
+// that register's raw word for every board.
+//
+// Rather than run one functor per board, field updates are applied to
+// every board at once by SIMD kernels (see simd_dispatch.h):
+//
+//      fleet_write_field()  -- writes a value into a field of the selected
+//                              boards' images
+//      fleet_clamp_field()  -- clamps a field of every board's image to a
+//                              maximum value
+//
+// Boards are selected by a bitmap, one bit per board: bit (i % 64) of
+// select[i / 64] selects board i. A null bitmap selects every board.
+//
+// Functors may still be pointed at a single board's image (see
+// register_image_array::board()) for spot checks and interop.
+
+#ifndef REGISTER_FLEET_H
+#define REGISTER_FLEET_H
+
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <cstdlib>      //  std::aligned_alloc, std::free
+#include <memory>       //  std::unique_ptr
+#include <new>          //  std::bad_alloc
+
+#include "control_board_gpio_reg23.h"
+#include "register_arena.h"
+#include "register_descriptor.h"
+#include "register_error.h"
+#include "simd_dispatch.h"
+
+const std::size_t FLEET_ALIGNMENT { 32 };                                   // one AVX2 vector
+const std::size_t FLEET_LANES     { FLEET_ALIGNMENT / sizeof(std::uint16_t) };
+
+// register_image_array -- one register's raw word for each board
+//
+//  Note1:  the array is padded out to a whole number of AVX2 vectors and
+//          aligned to one, so the kernels never straddle a vector.
+class register_image_array
+{
+public:
+    register_image_array(std::size_t boards, std::uint16_t reset_word)
+        : boards_(boards),
+          words_(allocate(boards))
+    {
+        for (std::size_t i = 0; i < padded(boards); ++i)
+        {
+            words_[i] = (i < boards ? reset_word : 0);
+        }
+    }
+
+    std::size_t           size() const { return boards_; }
+    std::uint16_t*        data()       { return words_.get(); }
+    const std::uint16_t*  data() const { return words_.get(); }
+
+    std::uint16_t& operator[](std::size_t i)       { return words_[i]; }
+    std::uint16_t  operator[](std::size_t i) const { return words_[i]; }
+
+    // the address of board i's image, suitable for handing to a functor
+    gpio_reg23_ptr_t board(std::size_t i)
+    {
+        return reinterpret_cast<gpio_reg23_ptr_t>(&words_[i]);
+    }
+
+private:
+    struct free_deleter
+    {
+#ifdef REGISTER_STATIC_ARENAS
+        void operator()(std::uint16_t* p) const { register_arena::deallocate(p, 0); }
+#else
+        void operator()(std::uint16_t* p) const { std::free(p); }
+#endif
+    };
+
+    static std::size_t padded(std::size_t boards)                           // Note1
+    {
+        return (boards + FLEET_LANES - 1) / FLEET_LANES * FLEET_LANES;
+    }
+
+    static std::uint16_t* allocate(std::size_t boards)
+    {
+        const std::size_t bytes = (padded(boards) ? padded(boards) : FLEET_LANES) * sizeof(std::uint16_t);
+
+#ifdef REGISTER_STATIC_ARENAS
+        return static_cast<std::uint16_t*>(register_arena::allocate(bytes, FLEET_ALIGNMENT));
+#else
+        void* p = std::aligned_alloc(FLEET_ALIGNMENT, bytes);
+        if (p == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<std::uint16_t*>(p);
+#endif
+    }
+
+    std::size_t                                   boards_;
+    std::unique_ptr<std::uint16_t[], free_deleter> words_;
+};
+
+
+// register_fleet -- the register image arrays of a fleet of boards,
+//                   created on first use of each register id
+class register_fleet
+{
+public:
+    static const std::size_t MAX_REGISTERS { 32 };  // register ids range 0:31
+
+    explicit register_fleet(std::size_t boards) : boards_(boards) {}
+
+    std::size_t boards() const { return boards_; }
+
+    // the image array for the given board register. Images start out zeroed.
+    // Throws std::range_error for a register id beyond MAX_REGISTERS
+    register_image_array& images(std::uint8_t reg_id)
+    {
+        if (reg_id >= MAX_REGISTERS)
+        {
+            throw register_range_error( "register_fleet: register id %u is out of range. Valid register ids range 0:%u. ",
+                                        unsigned{reg_id}, unsigned(MAX_REGISTERS - 1) );
+        }
+
+        if (!arrays_[reg_id])
+        {
+            arrays_[reg_id] = make_register<register_image_array>(boards_, 0);
+        }
+        return *arrays_[reg_id];
+    }
+
+private:
+    std::size_t                             boards_;
+    register_ptr<register_image_array>      arrays_[MAX_REGISTERS];
+};
+
+
+//==================================================================
+//
+//  Kernels
+//
+//==================================================================
+
+// is board i selected? See the select bitmap, above
+inline bool fleet_selected(const std::uint64_t* select, std::size_t i)
+{
+    return select == nullptr || ((select[i / 64] >> (i % 64)) & 1u);
+}
+
+// the selection bits for boards [i, i + lanes). i must be a multiple of lanes
+inline unsigned fleet_select_bits(const std::uint64_t* select, std::size_t i, unsigned lanes)
+{
+    if (select == nullptr)
+    {
+        return (1u << lanes) - 1u;
+    }
+    return static_cast<unsigned>(select[i / 64] >> (i % 64)) & ((1u << lanes) - 1u);
+}
+
+inline void fleet_write_field_scalar(std::uint16_t* words, std::size_t begin, std::size_t n,
+                                     field_descriptor field, std::uint16_t value, const std::uint64_t* select)
+{
+    for (std::size_t i = begin; i < n; ++i)
+    {
+        if (fleet_selected(select, i))
+        {
+            words[i] = field.insert(words[i], value);
+        }
+    }
+}
+
+inline void fleet_clamp_field_scalar(std::uint16_t* words, std::size_t begin, std::size_t n,
+                                     field_descriptor field, std::uint16_t max_value)
+{
+    for (std::size_t i = begin; i < n; ++i)
+    {
+        if (field.extract(words[i]) > max_value)
+        {
+            words[i] = field.insert(words[i], max_value);
+        }
+    }
+}
+
+#ifdef REGISTER_SIMD_X86
+
+// Note2:   a lane's selection bit is spread into a whole lane by and'ing
+//          the broadcast selection bits with each lane's own bit, then
+//          comparing the result with that bit.
+
+SIMD_TARGET_SSE2 inline void fleet_write_field_sse2(std::uint16_t* words, std::size_t n,
+                                                    field_descriptor field, std::uint16_t value, const std::uint64_t* select)
+{
+    const __m128i lane_bits = _mm_setr_epi16(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+    const __m128i fmask     = _mm_set1_epi16(static_cast<short>(field.mask()));
+    const __m128i fvalue    = _mm_set1_epi16(static_cast<short>((value << field.shift) & field.mask()));
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128i bits = _mm_and_si128(_mm_set1_epi16(static_cast<short>(fleet_select_bits(select, i, 8))), lane_bits);
+        const __m128i sel  = _mm_cmpeq_epi16(bits, lane_bits);                                  // Note2
+
+        __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(words + i));
+        w = _mm_or_si128(_mm_andnot_si128(_mm_and_si128(fmask, sel), w), _mm_and_si128(fvalue, sel));
+        _mm_store_si128(reinterpret_cast<__m128i*>(words + i), w);
+    }
+
+    fleet_write_field_scalar(words, i, n, field, value, select);
+}
+
+SIMD_TARGET_AVX2 inline void fleet_write_field_avx2(std::uint16_t* words, std::size_t n,
+                                                    field_descriptor field, std::uint16_t value, const std::uint64_t* select)
+{
+    const __m256i lane_bits = _mm256_setr_epi16(0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+                                                0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, static_cast<short>(0x8000));
+    const __m256i fmask     = _mm256_set1_epi16(static_cast<short>(field.mask()));
+    const __m256i fvalue    = _mm256_set1_epi16(static_cast<short>((value << field.shift) & field.mask()));
+
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m256i bits = _mm256_and_si256(_mm256_set1_epi16(static_cast<short>(fleet_select_bits(select, i, 16))), lane_bits);
+        const __m256i sel  = _mm256_cmpeq_epi16(bits, lane_bits);                               // Note2
+
+        __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(words + i));
+        w = _mm256_or_si256(_mm256_andnot_si256(_mm256_and_si256(fmask, sel), w), _mm256_and_si256(fvalue, sel));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(words + i), w);
+    }
+
+    fleet_write_field_scalar(words, i, n, field, value, select);
+}
+
+// Note3:   SSE2 has no unsigned 16 bit min. min(a, b) == a - saturating(a - b)
+
+SIMD_TARGET_SSE2 inline void fleet_clamp_field_sse2(std::uint16_t* words, std::size_t n,
+                                                    field_descriptor field, std::uint16_t max_value)
+{
+    const __m128i fmask = _mm_set1_epi16(static_cast<short>(field.mask()));
+    const __m128i limit = _mm_set1_epi16(static_cast<short>(max_value << field.shift));
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(words + i));
+        const __m128i f = _mm_and_si128(w, fmask);
+        const __m128i c = _mm_sub_epi16(f, _mm_subs_epu16(f, limit));                            // Note3
+        w = _mm_or_si128(_mm_andnot_si128(fmask, w), c);
+        _mm_store_si128(reinterpret_cast<__m128i*>(words + i), w);
+    }
+
+    fleet_clamp_field_scalar(words, i, n, field, max_value);
+}
+
+SIMD_TARGET_AVX2 inline void fleet_clamp_field_avx2(std::uint16_t* words, std::size_t n,
+                                                    field_descriptor field, std::uint16_t max_value)
+{
+    const __m256i fmask = _mm256_set1_epi16(static_cast<short>(field.mask()));
+    const __m256i limit = _mm256_set1_epi16(static_cast<short>(max_value << field.shift));
+
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(words + i));
+        const __m256i c = _mm256_min_epu16(_mm256_and_si256(w, fmask), limit);
+        w = _mm256_or_si256(_mm256_andnot_si256(fmask, w), c);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(words + i), w);
+    }
+
+    fleet_clamp_field_scalar(words, i, n, field, max_value);
+}
+
+#endif // REGISTER_SIMD_X86
+
+
+// throw_fleet_range_error() -- kept out of line, as the functors' range
+//                              errors are
+[[noreturn]] __attribute__((noinline, cold))
+inline void throw_fleet_range_error(const field_descriptor& f, std::uint16_t val)
+{
+    throw register_range_error( "Incorrect fleet access to field %u of register %u with value (%u). Valid range is 0:%u. ",
+                                unsigned{f.field_id}, unsigned{f.reg_id}, unsigned{val}, unsigned{f.max_value()} );
+}
+
+// fleet_write_field() -- writes value into field of each selected board's image.
+//                        Throws std::range_error, writing nothing, if value
+//                        does not fit the field
+//
+//  words must be a register_image_array's data(), or be similarly aligned
+inline void fleet_write_field(std::uint16_t* words, std::size_t n, field_descriptor field, std::uint16_t value,
+                              const std::uint64_t* select = nullptr, simd_level level = best_simd_level())
+{
+    if (value > field.max_value())
+    {
+        throw_fleet_range_error(field, value);
+    }
+
+    switch (usable_simd_level(level))
+    {
+#ifdef REGISTER_SIMD_X86
+        case simd_level::AVX2: fleet_write_field_avx2(words, n, field, value, select); break;
+        case simd_level::SSE2: fleet_write_field_sse2(words, n, field, value, select); break;
+#endif
+        default:               fleet_write_field_scalar(words, 0, n, field, value, select); break;
+    }
+}
+
+inline void fleet_write_field(register_image_array& images, field_descriptor field, std::uint16_t value,
+                              const std::uint64_t* select = nullptr, simd_level level = best_simd_level())
+{
+    fleet_write_field(images.data(), images.size(), field, value, select, level);
+}
+
+// fleet_clamp_field() -- clamps field of every board's image to max_value
+inline void fleet_clamp_field(std::uint16_t* words, std::size_t n, field_descriptor field, std::uint16_t max_value,
+                              simd_level level = best_simd_level())
+{
+    // if no value the field can hold exceeds max_value
+    if (max_value >= field.max_value())
+    {
+        return;
+    }
+
+    switch (usable_simd_level(level))
+    {
+#ifdef REGISTER_SIMD_X86
+        case simd_level::AVX2: fleet_clamp_field_avx2(words, n, field, max_value); break;
+        case simd_level::SSE2: fleet_clamp_field_sse2(words, n, field, max_value); break;
+#endif
+        default:               fleet_clamp_field_scalar(words, 0, n, field, max_value); break;
+    }
+}
+
+inline void fleet_clamp_field(register_image_array& images, field_descriptor field, std::uint16_t max_value,
+                              simd_level level = best_simd_level())
+{
+    fleet_clamp_field(images.data(), images.size(), field, max_value, level);
+}
+
+#endif // REGISTER_FLEET_H
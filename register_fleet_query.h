@@ -0,0 +1,429 @@
+// register_fleet_query.h
+//
+// SIMD query kernels over arrays of register images (see register_fleet.h)
+//
+//      fleet_count_field()      -- counts the boards whose field holds a value
+//                                  (e.g., boards with solenoid2 energized)
+//      fleet_field_histogram()  -- counts the boards holding each of a
+//                                  field's values (e.g., lamp_pwr levels)
+//      fleet_find_field_differs() -- lists the boards whose field differs
+//                                  from a target value
+//
+// Like the update kernels, each query has AVX2, SSE2 and scalar versions,
+// selected at run time (see simd_dispatch.h), except where a SIMD version
+// would be no faster than the scalar one. See Note4, Note5. 'make bench'
+// times each level.
+//
+//  Note1:  each lane of a compare result is 0xFFFF or 0x0000, so a lane
+//          contributes two bits to movemask's result. Halving the
+//          population count of the mask gives the number of matching lanes.
+//
+//  Note2:  the histogram, and the SSE2 count, accumulate matches into 16
+//          bit lane counters by subtracting each compare result (-1 per
+//          match), and sum the lanes only when the counters are drained
+//          into the 64 bit totals, before they can overflow.
+
+#ifndef REGISTER_FLEET_QUERY_H
+#define REGISTER_FLEET_QUERY_H
+
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint32_t, std::uint64_t
+#include <utility>      //  std::index_sequence, std::make_index_sequence
+#include <vector>       //  std::vector
+
+#include "register_descriptor.h"
+#include "register_fleet.h"
+#include "simd_dispatch.h"
+
+// Note5:   the SIMD histogram kernels keep a lane counter per value, in
+//          registers (Note6), for at most FLEET_HISTOGRAM_MAX_BINS values.
+//          A wider field's histogram is taken by the scalar kernel,
+//          whatever the level asked for. SSE2's 16 registers hold at most
+//          FLEET_HISTOGRAM_SSE2_MAX_BINS counters along with the compare;
+//          past that its counters spill to the stack and it is no faster
+//          than the scalar kernel, so AVX2 takes a 4 bit field's histogram
+//          or no SIMD level does.
+const std::size_t FLEET_HISTOGRAM_MAX_BINS      { 16 };     // fields up to 4 bits wide
+const std::size_t FLEET_HISTOGRAM_SSE2_MAX_BINS {  8 };     // fields up to 3 bits wide
+
+inline std::size_t fleet_count_field_scalar(const std::uint16_t* words, std::size_t begin, std::size_t n,
+                                            field_descriptor field, std::uint16_t value)
+{
+    std::size_t count = 0;
+    for (std::size_t i = begin; i < n; ++i)
+    {
+        count += (field.extract(words[i]) == value);
+    }
+    return count;
+}
+
+inline void fleet_field_histogram_scalar(const std::uint16_t* words, std::size_t begin, std::size_t n,
+                                         field_descriptor field, std::uint64_t* bins)
+{
+    for (std::size_t i = begin; i < n; ++i)
+    {
+        ++bins[field.extract(words[i])];
+    }
+}
+
+// Note3:   the differing boards' indices are compacted into out without a
+//          branch per board: every index is stored, but out only advances
+//          past the ones which differ. out must have room for n - begin
+//          indices. Returns the number stored.
+inline std::size_t fleet_find_field_differs_scalar(const std::uint16_t* words, std::size_t begin, std::size_t n,
+                                                   field_descriptor field, std::uint16_t target, std::uint32_t* out)
+{
+    std::size_t found = 0;
+    for (std::size_t i = begin; i < n; ++i)
+    {
+        out[found] = static_cast<std::uint32_t>(i);                                  // Note3
+        found += (field.extract(words[i]) != target);
+    }
+    return found;
+}
+
+#ifdef REGISTER_SIMD_X86
+
+// the sum of a vector's 16 bit lane counters. Note2
+SIMD_TARGET_SSE2 inline std::uint64_t fleet_sum_lanes_sse2(__m128i lanes)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i sum = _mm_add_epi32(_mm_unpacklo_epi16(lanes, zero), _mm_unpackhi_epi16(lanes, zero));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return static_cast<std::uint32_t>(_mm_cvtsi128_si32(sum));
+}
+
+SIMD_TARGET_AVX2 inline std::uint64_t fleet_sum_lanes_avx2(__m256i lanes)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i sum = _mm256_add_epi32(_mm256_unpacklo_epi16(lanes, zero), _mm256_unpackhi_epi16(lanes, zero));
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return static_cast<std::uint32_t>(_mm_cvtsi128_si32(half));
+}
+
+SIMD_TARGET_SSE2 inline std::size_t fleet_count_field_sse2(const std::uint16_t* words, std::size_t n,
+                                                           field_descriptor field, std::uint16_t value)
+{
+    const __m128i fmask  = _mm_set1_epi16(static_cast<short>(field.mask()));
+    const __m128i fvalue = _mm_set1_epi16(static_cast<short>((value << field.shift) & field.mask()));
+
+    std::size_t count       = 0;
+    __m128i     lane_counts = _mm_setzero_si128();
+    std::size_t i           = 0;
+    unsigned    pending     = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128i w  = _mm_load_si128(reinterpret_cast<const __m128i*>(words + i));
+        const __m128i eq = _mm_cmpeq_epi16(_mm_and_si128(w, fmask), fvalue);
+        lane_counts = _mm_sub_epi16(lane_counts, eq);                                    // Note2
+
+        if (++pending == 0xFFFF)
+        {
+            count      += fleet_sum_lanes_sse2(lane_counts);
+            lane_counts = _mm_setzero_si128();
+            pending     = 0;
+        }
+    }
+    count += fleet_sum_lanes_sse2(lane_counts);
+
+    return count + fleet_count_field_scalar(words, i, n, field, value);
+}
+
+SIMD_TARGET_AVX2 inline std::size_t fleet_count_field_avx2(const std::uint16_t* words, std::size_t n,
+                                                           field_descriptor field, std::uint16_t value)
+{
+    const __m256i fmask  = _mm256_set1_epi16(static_cast<short>(field.mask()));
+    const __m256i fvalue = _mm256_set1_epi16(static_cast<short>((value << field.shift) & field.mask()));
+
+    std::size_t count = 0;
+    std::size_t i     = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m256i w  = _mm256_load_si256(reinterpret_cast<const __m256i*>(words + i));
+        const __m256i eq = _mm256_cmpeq_epi16(_mm256_and_si256(w, fmask), fvalue);
+        count += _mm_popcnt_u32(static_cast<unsigned>(_mm256_movemask_epi8(eq))) / 2;     // Note1
+    }
+
+    return count + fleet_count_field_scalar(words, i, n, field, value);
+}
+
+// Note6:   the histograms' lane counters are indexed by constants only,
+//          unrolled over the field's values, so that they are kept in
+//          registers rather than loaded and stored on every vector.
+
+template< std::size_t... V >
+SIMD_TARGET_SSE2 inline void fleet_tally_lanes_sse2(__m128i f, __m128i (&lane_counts)[sizeof...(V)],
+                                                    const __m128i (&targets)[sizeof...(V)], std::index_sequence<V...>)
+{
+    ((lane_counts[V] = _mm_sub_epi16(lane_counts[V], _mm_cmpeq_epi16(f, targets[V]))), ...);
+}
+
+// drains the 16 bit lane counters into the 64 bit totals, and zeroes them. Note2
+template< std::size_t... V >
+SIMD_TARGET_SSE2 __attribute__((always_inline)) inline void fleet_drain_lane_counts_sse2(__m128i (&lane_counts)[sizeof...(V)], std::uint64_t* bins,
+                                                          std::index_sequence<V...>)
+{
+    ((bins[V] += fleet_sum_lanes_sse2(lane_counts[V]), lane_counts[V] = _mm_setzero_si128()), ...);
+}
+
+template< unsigned VALUES >
+SIMD_TARGET_SSE2 inline void fleet_field_histogram_sse2(const std::uint16_t* words, std::size_t n,
+                                                        field_descriptor field, std::uint64_t* bins)
+{
+    const __m128i fmask = _mm_set1_epi16(static_cast<short>(field.mask()));
+
+    __m128i lane_counts[VALUES];
+    __m128i targets[VALUES];
+    for (unsigned v = 0; v < VALUES; ++v)
+    {
+        lane_counts[v] = _mm_setzero_si128();
+        targets[v]     = _mm_set1_epi16(static_cast<short>(v << field.shift));
+    }
+
+    std::size_t i       = 0;
+    unsigned    pending = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128i f = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(words + i)), fmask);
+        fleet_tally_lanes_sse2(f, lane_counts, targets, std::make_index_sequence<VALUES>{});          // Note6
+
+        if (++pending == 0xFFFF)
+        {
+            fleet_drain_lane_counts_sse2(lane_counts, bins, std::make_index_sequence<VALUES>{});
+            pending = 0;
+        }
+    }
+    fleet_drain_lane_counts_sse2(lane_counts, bins, std::make_index_sequence<VALUES>{});
+
+    fleet_field_histogram_scalar(words, i, n, field, bins);
+}
+
+template< std::size_t... V >
+SIMD_TARGET_AVX2 inline void fleet_tally_lanes_avx2(__m256i f, __m256i (&lane_counts)[sizeof...(V)],
+                                                    const __m256i (&targets)[sizeof...(V)], std::index_sequence<V...>)
+{
+    ((lane_counts[V] = _mm256_sub_epi16(lane_counts[V], _mm256_cmpeq_epi16(f, targets[V]))), ...);
+}
+
+template< std::size_t... V >
+SIMD_TARGET_AVX2 __attribute__((always_inline)) inline void fleet_drain_lane_counts_avx2(__m256i (&lane_counts)[sizeof...(V)], std::uint64_t* bins,
+                                                          std::index_sequence<V...>)
+{
+    ((bins[V] += fleet_sum_lanes_avx2(lane_counts[V]), lane_counts[V] = _mm256_setzero_si256()), ...);
+}
+
+template< unsigned VALUES >
+SIMD_TARGET_AVX2 inline void fleet_field_histogram_avx2(const std::uint16_t* words, std::size_t n,
+                                                        field_descriptor field, std::uint64_t* bins)
+{
+    const __m256i fmask = _mm256_set1_epi16(static_cast<short>(field.mask()));
+
+    __m256i lane_counts[VALUES];
+    __m256i targets[VALUES];
+    for (unsigned v = 0; v < VALUES; ++v)
+    {
+        lane_counts[v] = _mm256_setzero_si256();
+        targets[v]     = _mm256_set1_epi16(static_cast<short>(v << field.shift));
+    }
+
+    std::size_t i       = 0;
+    unsigned    pending = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m256i f = _mm256_and_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(words + i)), fmask);
+        fleet_tally_lanes_avx2(f, lane_counts, targets, std::make_index_sequence<VALUES>{});          // Note6
+
+        if (++pending == 0xFFFF)
+        {
+            fleet_drain_lane_counts_avx2(lane_counts, bins, std::make_index_sequence<VALUES>{});
+            pending = 0;
+        }
+    }
+    fleet_drain_lane_counts_avx2(lane_counts, bins, std::make_index_sequence<VALUES>{});
+
+    fleet_field_histogram_scalar(words, i, n, field, bins);
+}
+
+// Note4:   the AVX2 kernel compares 8 boards at a time, packs the compare
+//          results down to one movemask bit per board, and looks up where
+//          the differing boards' lanes are. It stores all 8 lane indices,
+//          differing boards first, with one unaligned store, and out only
+//          advances past the differing ones (Note3). Vectors in which no
+//          board differs are skipped outright.
+//
+//          There is no SSE2 kernel: SSE2 has no variable shuffle to
+//          compact the lanes with, and compacting them one at a time is
+//          no faster than the scalar kernel.
+
+// fleet_left_pack -- for each 8 bit mask of differing lanes, the numbers
+//                    of the differing lanes, lowest first, a nibble each
+struct fleet_left_pack_table
+{
+    std::uint32_t lanes[256];
+
+    constexpr fleet_left_pack_table() : lanes{}
+    {
+        for (unsigned mask = 0; mask < 256; ++mask)
+        {
+            unsigned packed = 0;
+            for (unsigned lane = 0; lane < 8; ++lane)
+            {
+                if (mask & (1u << lane))
+                {
+                    lanes[mask] |= lane << (4 * packed++);
+                }
+            }
+        }
+    }
+};
+
+constexpr fleet_left_pack_table FLEET_LEFT_PACK {};
+
+SIMD_TARGET_AVX2 inline std::size_t fleet_find_field_differs_avx2(const std::uint16_t* words, std::size_t n,
+                                                                  field_descriptor field, std::uint16_t target, std::uint32_t* out)
+{
+    const __m128i fmask   = _mm_set1_epi16(static_cast<short>(field.mask()));
+    const __m128i ftarget = _mm_set1_epi16(static_cast<short>((target << field.shift) & field.mask()));
+    const __m256i nibbles = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+
+    std::size_t found = 0;
+    std::size_t i     = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128i w  = _mm_load_si128(reinterpret_cast<const __m128i*>(words + i));
+        const __m128i eq = _mm_cmpeq_epi16(_mm_and_si128(w, fmask), ftarget);
+
+        const unsigned differs = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_packs_epi16(eq, eq))) & 0xFFu;     // Note4
+        if (differs == 0)
+        {
+            continue;
+        }
+
+        const __m256i packed = _mm256_set1_epi32(static_cast<int>(FLEET_LEFT_PACK.lanes[differs]));
+        const __m256i lanes  = _mm256_and_si256(_mm256_srlv_epi32(packed, nibbles), _mm256_set1_epi32(0xF));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + found),
+                            _mm256_add_epi32(lanes, _mm256_set1_epi32(static_cast<int>(i))));         // Note3
+        found += _mm_popcnt_u32(differs);
+    }
+
+    return found + fleet_find_field_differs_scalar(words, i, n, field, target, out + found);
+}
+
+#endif // REGISTER_SIMD_X86
+
+
+// fleet_count_field() -- the number of boards whose field holds value.
+//                        Throws std::range_error if value does not fit the field
+inline std::size_t fleet_count_field(const register_image_array& images, field_descriptor field, std::uint16_t value,
+                                     simd_level level = best_simd_level())
+{
+    if (value > field.max_value())
+    {
+        throw_fleet_range_error(field, value);
+    }
+
+    switch (usable_simd_level(level))
+    {
+#ifdef REGISTER_SIMD_X86
+        case simd_level::AVX2: return fleet_count_field_avx2(images.data(), images.size(), field, value);
+        case simd_level::SSE2: return fleet_count_field_sse2(images.data(), images.size(), field, value);
+#endif
+        default:               return fleet_count_field_scalar(images.data(), 0, images.size(), field, value);
+    }
+}
+
+// fleet_field_histogram() -- bins[v] is the number of boards whose field holds v.
+//                            Fields over 4 bits wide take the scalar kernel,
+//                            as do 4 bit fields at the SSE2 level. Note5
+inline std::vector<std::uint64_t> fleet_field_histogram(const register_image_array& images, field_descriptor field,
+                                                        simd_level level = best_simd_level())
+{
+    std::vector<std::uint64_t> bins(field.max_value() + 1u, 0);
+
+    level = usable_simd_level(level);
+    if (bins.size() > FLEET_HISTOGRAM_MAX_BINS || (level == simd_level::SSE2 && bins.size() > FLEET_HISTOGRAM_SSE2_MAX_BINS))
+    {
+        level = simd_level::SCALAR;
+    }
+
+    switch (level)
+    {
+#ifdef REGISTER_SIMD_X86
+        case simd_level::AVX2:
+            switch (bins.size())
+            {
+                case 2:  fleet_field_histogram_avx2<2>(images.data(), images.size(), field, bins.data());  break;
+                case 4:  fleet_field_histogram_avx2<4>(images.data(), images.size(), field, bins.data());  break;
+                case 8:  fleet_field_histogram_avx2<8>(images.data(), images.size(), field, bins.data());  break;
+                default: fleet_field_histogram_avx2<16>(images.data(), images.size(), field, bins.data()); break;
+            }
+            break;
+        case simd_level::SSE2:
+            switch (bins.size())
+            {
+                case 2:  fleet_field_histogram_sse2<2>(images.data(), images.size(), field, bins.data());  break;
+                case 4:  fleet_field_histogram_sse2<4>(images.data(), images.size(), field, bins.data());  break;
+                default: fleet_field_histogram_sse2<8>(images.data(), images.size(), field, bins.data());  break;
+            }
+            break;
+#endif
+        default:               fleet_field_histogram_scalar(images.data(), 0, images.size(), field, bins.data()); break;
+    }
+
+    return bins;
+}
+
+// fleet_find_field_differs() -- stores, in ascending order, the index of
+//                               each board whose field does not hold target
+//                               into out, which must have room for an index
+//                               per board. Returns the number stored.
+//                               Throws std::range_error if target does not
+//                               fit the field. The SSE2 level takes the
+//                               scalar kernel. Note4
+inline std::size_t fleet_find_field_differs(const register_image_array& images, field_descriptor field, std::uint16_t target,
+                                            std::uint32_t* out, simd_level level = best_simd_level())
+{
+    if (target > field.max_value())
+    {
+        throw_fleet_range_error(field, target);
+    }
+
+    switch (usable_simd_level(level))
+    {
+#ifdef REGISTER_SIMD_X86
+        case simd_level::AVX2: return fleet_find_field_differs_avx2(images.data(), images.size(), field, target, out);
+#endif
+        default:               return fleet_find_field_differs_scalar(images.data(), 0, images.size(), field, target, out);
+    }
+}
+
+// fleet_find_field_differs() -- as above, appending the indices to indices.
+//                               Makes room for an index per board, which
+//                               costs zero filling that room on each call;
+//                               a dashboard scanning over and over should
+//                               keep a buffer of its own, and use the above
+inline void fleet_find_field_differs(const register_image_array& images, field_descriptor field, std::uint16_t target,
+                                     std::vector<std::uint32_t>& indices, simd_level level = best_simd_level())
+{
+    if (target > field.max_value())
+    {
+        throw_fleet_range_error(field, target);
+    }
+
+    const std::size_t already = indices.size();
+    indices.resize(already + images.size());        // room for every board. Note3
+
+    const std::size_t found = fleet_find_field_differs(images, field, target, indices.data() + already, level);
+
+    indices.resize(already + found);
+}
+
+#endif // REGISTER_FLEET_QUERY_H
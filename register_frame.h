@@ -0,0 +1,137 @@
+// register_frame.h
+//
+// Frames: all-at-once updates of many boards' register #23.
+//
+// A coordinated move across many boards needs their registers to change
+// together, not one functor call at a time as the application gets to
+// them. A reg23_frame_buffer holds two frames of register images, one
+// image per board:
+//
+//      back  -- the frame being composed. The application drives its
+//               images with the usual functors, attached with REG23_ATTACH
+//               (Note7 of control_board_gpio_reg23.h)
+//      front -- the last committed frame, which is what the boards' registers hold
+//
+// commit() checks every image of the back frame against register #23's
+// interlocks, swaps the two frames (a pointer swap), then streams the new
+// front frame to the boards' registers in register order, one store per
+// register. Nothing reaches the registers between commits. A frame that
+// breaks an interlock is rejected whole: commit() throws
+// interlock_violation, and neither the registers nor the frames change.
+//
+//      reg23_frame_buffer<> frames{ registers };
+//
+//      for (std::size_t b = 0; b < frames.size(); ++b)
+//      {
+//          gpio_register_23< lamp_t > lamp42{ frames.back(b), REG23_ATTACH };
+//          lamp42(MOOD_LIGHTING);
+//      }
+//      frames.commit();        // every lamp changes in the same pass
+//
+//  Note1:  after the swap, the new back frame is seeded from the new
+//          front, so the next frame starts from what the registers hold
+//          and need only make its changes.
+//
+//  Note2:  the swap moves the back frame, so a functor attached to a back
+//          image is good until the next commit(). Attach functors within
+//          the frame's code; attaching costs nothing, unless rate limited
+//          (a bucket lookup, see solenoid_rate_limit.h). A rate limited
+//          solenoid functor shares the toggle bucket of the image it is
+//          attached to, not the board register's, and a board's two images
+//          take turns at the back, so keep toggles of rate limited
+//          solenoids out of frames.
+//
+//  Note3:  every register is stored on every commit, changed or not, so a
+//          commit takes the same time whatever the frame changed.
+//
+//  Note4:  ordering (device_ordering by default) orders the stores to the
+//          boards' registers. See register_ordering.h. The frames are
+//          plain memory, owned by the thread composing them.
+
+#ifndef REGISTER_FRAME_H
+#define REGISTER_FRAME_H
+
+#include <algorithm>    //  std::copy
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <utility>      //  std::swap
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "register_arena.h"
+#include "register_interlock.h"
+#include "register_ordering.h"
+
+template< typename ordering = device_ordering >    // Note4
+class reg23_frame_buffer
+{
+public:
+    // one image per register. Like the functors, the frame buffer closes
+    // the valves and kills the lamps on startup
+    template< typename allocator_t >
+    explicit reg23_frame_buffer(const std::vector<gpio_reg23_ptr_t, allocator_t>& registers_)
+        : registers(registers_.begin(), registers_.end()),
+          images(2 * registers.size(), word_to_reg23(0)),
+          front_(images.data()),
+          back_(images.data() + registers.size())
+    {
+        stream();
+    }
+
+    // the frames are referred to by pointer
+    reg23_frame_buffer(const reg23_frame_buffer&)            = delete;
+    reg23_frame_buffer& operator=(const reg23_frame_buffer&) = delete;
+
+    std::size_t size() const { return registers.size(); }
+
+    // the back frame's image of register i, for attached functors. Note2
+    gpio_reg23_ptr_t back(std::size_t i) { return &back_[i]; }
+
+    // the front frame's image of register i: what the register holds
+    const genpurpIO_register23& front(std::size_t i) const { return front_[i]; }
+
+    // commit() -- makes the back frame the front one, and streams it to the
+    //             registers. Throws interlock_violation, changing nothing,
+    //             if any image breaks an interlock rule
+    void commit()
+    {
+        for (std::size_t i = 0; i < registers.size(); ++i)
+        {
+            const std::uint16_t word = reg23_to_word(back_[i]);
+            if (REG23_INTERLOCKS.forbidden(word))
+            {
+                const interlock_rule* rule = REG23_INTERLOCKS.broken_rule(word);
+
+                throw interlock_violation( word, "Frame rejected: image %zu would break interlock rule '%s'. ",
+                                           i, (rule != nullptr ? rule->name : "?") );
+            }
+        }
+
+        std::swap(front_, back_);
+        stream();
+        std::copy(front_, front_ + registers.size(), back_);     // Note1
+
+        ++commits_;
+    }
+
+    // the number of frames committed since startup
+    std::uint64_t commits() const { return commits_; }
+
+private:
+    // stores the front frame to the registers, in register order. Note3
+    void stream()
+    {
+        for (std::size_t i = 0; i < registers.size(); ++i)
+        {
+            reg23_store<ordering>(registers[i], reg23_to_word(front_[i]));
+        }
+    }
+
+    const register_vector<gpio_reg23_ptr_t>     registers;
+    register_vector<genpurpIO_register23>       images;     // both frames
+    genpurpIO_register23*                       front_;
+    genpurpIO_register23*                       back_;
+    std::uint64_t                               commits_ {0};
+};
+
+#endif // REGISTER_FRAME_H
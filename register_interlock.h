@@ -0,0 +1,261 @@
+// register_interlock.h
+//
+// Safety interlocks for a register's fields, checked without branches.
+//
+// interlock_rule -- a forbidden combination of field values, e.g.,
+//      "solenoid2 energized AND solenoid3 energized". A rule is one or two
+//      field_conditions, all of which must hold for the rule to be broken.
+//
+// interlock_table -- a register's rules, compiled (at compile time, when
+//      declared constexpr) into a bitmap with one bit per combination of
+//      the bits the rules look at. Checking a register word is a shift, a
+//      mask and a bit test, however many rules there are. See Note1
+//
+// register_transaction -- stages a batch of field writes, then commits them
+//      with a single store. commit() re-reads the register, merges the
+//      staged fields into it, and publishes the merged word with a
+//      compare-exchange through the ordering policy, so another writer's
+//      update to the other fields is kept, not lost. If the merged word
+//      breaks a rule, commit() throws interlock_violation and the register
+//      is left untouched: the whole batch is rejected, never part of it.
+//
+//          register_transaction txn{ reg23_word(preg), REG23_INTERLOCKS };
+//          txn.set(SOLENOID2_FIELD, 1).set(LAMP_PWR_FIELD, MOOD_LIGHTING);
+//          txn.commit();
+//
+//  Note1:  the bitmap spans from the lowest to the highest bit any rule
+//          looks at, which must be at most MAX_SPAN_BITS bits apart. Bits
+//          outside the span cannot affect any rule.
+//
+//  Note2:  only the final word is checked, so a batch may pass through a
+//          forbidden combination on its way to an allowed one (e.g.,
+//          swapping which solenoid is energized).
+//
+//  Note3:  the interlock is checked against the word actually published.
+//          If the register changes between the load and the
+//          compare-exchange, the batch is merged into the new word and
+//          checked again.
+
+#ifndef REGISTER_INTERLOCK_H
+#define REGISTER_INTERLOCK_H
+
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <stdexcept>    //  std::runtime_error, std::range_error
+#include <string>       //  std::string
+
+#include "register_descriptor.h"
+#include "register_error.h"
+#include "register_ordering.h"
+
+enum class interlock_cmp
+{
+    ALWAYS,     // the condition always holds (an unused second condition)
+    EQ, NE, LT, LE, GT, GE
+};
+
+struct field_condition
+{
+    field_descriptor    field;
+    interlock_cmp       cmp;
+    std::uint16_t       value;
+
+    constexpr bool holds(std::uint16_t word) const
+    {
+        const std::uint16_t v = field.extract(word);
+        switch (cmp)
+        {
+            case interlock_cmp::EQ: return v == value;
+            case interlock_cmp::NE: return v != value;
+            case interlock_cmp::LT: return v <  value;
+            case interlock_cmp::LE: return v <= value;
+            case interlock_cmp::GT: return v >  value;
+            case interlock_cmp::GE: return v >= value;
+            default:                return true;
+        }
+    }
+
+    constexpr std::uint16_t mask() const
+    {
+        return cmp == interlock_cmp::ALWAYS ? 0 : field.mask();
+    }
+};
+
+constexpr field_condition ALWAYS_HOLDS { field_descriptor{ 0, 0, 0, 0 }, interlock_cmp::ALWAYS, 0 };
+
+struct interlock_rule
+{
+    const char*         name;       // reported when the rule is broken
+    field_condition     first;
+    field_condition     second;
+
+    constexpr bool broken_by(std::uint16_t word) const
+    {
+        return first.holds(word) && second.holds(word);
+    }
+};
+
+
+class interlock_table
+{
+public:
+    static const unsigned MAX_SPAN_BITS { 10 };     // Note1
+
+    template< std::size_t N >
+    constexpr explicit interlock_table(const interlock_rule (&rules)[N])
+        : rules_(rules), count_(N), low_(0), span_mask_(0), forbidden_{}
+    {
+        std::uint16_t looked_at = 0;
+        for (std::size_t r = 0; r < N; ++r)
+        {
+            looked_at |= rules[r].first.mask() | rules[r].second.mask();
+        }
+
+        unsigned high = 0;
+        for (unsigned b = 0; b < 16; ++b)
+        {
+            if ((looked_at >> b) & 1u)
+            {
+                high = b;
+            }
+        }
+        for (unsigned b = 16; b-- > 0; )
+        {
+            if ((looked_at >> b) & 1u)
+            {
+                low_ = b;
+            }
+        }
+
+        if (looked_at != 0 && high - low_ + 1 > MAX_SPAN_BITS)
+        {
+            throw std::range_error("interlock_table: the rules' fields span too many bits");
+        }
+
+        span_mask_ = looked_at == 0 ? 0 : static_cast<std::uint16_t>((1u << (high - low_ + 1)) - 1u);
+
+        for (unsigned state = 0; state <= span_mask_; ++state)
+        {
+            const std::uint16_t word = static_cast<std::uint16_t>(state << low_);
+            for (std::size_t r = 0; r < N; ++r)
+            {
+                if (rules[r].broken_by(word))
+                {
+                    forbidden_[state / 64] |= std::uint64_t{1} << (state % 64);
+                }
+            }
+        }
+    }
+
+    // forbidden() -- does word break any rule?
+    constexpr bool forbidden(std::uint16_t word) const
+    {
+        const unsigned state = (word >> low_) & span_mask_;
+        return (forbidden_[state / 64] >> (state % 64)) & 1u;
+    }
+
+    // the first rule word breaks, or nullptr. Only needed once a word is known to be forbidden
+    const interlock_rule* broken_rule(std::uint16_t word) const
+    {
+        for (std::size_t r = 0; r < count_; ++r)
+        {
+            if (rules_[r].broken_by(word))
+            {
+                return &rules_[r];
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    const interlock_rule*   rules_;
+    std::size_t             count_;
+    unsigned                low_;
+    std::uint16_t           span_mask_;
+    std::uint64_t           forbidden_[(1u << MAX_SPAN_BITS) / 64];
+};
+
+
+// the error thrown when a transaction would break an interlock rule
+class interlock_violation : public fixed_message_error<std::runtime_error>
+{
+public:
+    interlock_violation(const std::string& what_arg, std::uint16_t word_)
+        : fixed_message_error<std::runtime_error>("%s", what_arg.c_str()), word(word_) {}
+
+    // the message formatted as std::snprintf does, without allocating. See register_error.h
+    template< typename... args_t >
+    interlock_violation(std::uint16_t word_, const char* format, args_t... args)
+        : fixed_message_error<std::runtime_error>(format, args...), word(word_) {}
+
+    const std::uint16_t word;     // the rejected register word
+};
+
+
+template< typename ordering = relaxed_ordering >
+class register_transaction
+{
+public:
+    // stages nothing, and reads nothing, until set() and commit()
+    register_transaction(volatile std::uint16_t* reg_, const interlock_table& interlocks_)
+        : reg(const_cast<std::uint16_t*>(reg_)), interlocks(interlocks_)
+    {
+    }
+
+    // set() -- stages a write of val into field.
+    //          Throws std::range_error if val does not fit the field
+    register_transaction& set(const field_descriptor& field, std::uint16_t val)
+    {
+        if (val > field.max_value())
+        {
+            throw register_range_error( "Incorrect attempt to stage value (%u) into field %u of register #%u. Valid range is 0:%u. ",
+                                        unsigned{val}, unsigned{field.field_id}, unsigned{field.reg_id}, unsigned{field.max_value()} );
+        }
+
+        staged_mask |= field.mask();
+        staged_bits  = field.insert(staged_bits, val);
+        return *this;
+    }
+
+    // the register's word as it would be if committed now
+    std::uint16_t word() const { return merge(ordering::template load<std::uint16_t>(reg)); }
+
+    // commit() -- merges the staged fields into the register's current word
+    //             and publishes it with a single store, unless it breaks a
+    //             rule, in which case it throws interlock_violation and
+    //             leaves the register untouched. See Note2 and Note3
+    void commit()
+    {
+        std::uint16_t current = ordering::template load<std::uint16_t>(reg);
+        for (;;)
+        {
+            const std::uint16_t merged = merge(current);
+
+            if (interlocks.forbidden(merged))
+            {
+                const interlock_rule* rule = interlocks.broken_rule(merged);
+
+                throw interlock_violation( merged, "Transaction rejected: it would break interlock rule '%s'. ",
+                                           (rule != nullptr ? rule->name : "?") );
+            }
+
+            if (ordering::compare_exchange(reg, current, merged))     // reloads current on failure
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    std::uint16_t merge(std::uint16_t current) const
+    {
+        return static_cast<std::uint16_t>((current & ~staged_mask) | staged_bits);
+    }
+
+    std::uint16_t*              reg;
+    const interlock_table&      interlocks;
+    std::uint16_t               staged_mask {0};    // the fields set() has staged
+    std::uint16_t               staged_bits {0};    // their staged values
+};
+
+#endif // REGISTER_INTERLOCK_H
@@ -0,0 +1,154 @@
+// register_ordering.h
+//
+// Memory ordering policies for register accesses.
+//
+// A functor's register may be plain memory that only its own thread
+// touches (a shadow), memory shared with other threads or processes (a
+// mirror), or a device's registers (MMIO). Each needs a different
+// ordering, and barriers are not free: an aarch64 dmb stalls the core
+// until its outstanding accesses complete. The functors (see
+// control_board_gpio_reg23.h) and board_handle take an ordering policy,
+// so each register pays only for the ordering it needs:
+//
+// relaxed_ordering -- plain loads and stores, for shadows. The compiler
+//      may merge or drop accesses nobody else can observe. The default.
+//
+// acq_rel_ordering -- loads acquire, stores release, for mirrors read by
+//      other threads: a reader that sees a store also sees everything the
+//      writer did before it. A plain mov on x86, ldarh / stlrh on aarch64;
+//      no fence on either.
+//
+// device_ordering -- volatile accesses, fenced as Linux's readw() and
+//      writew() fence them: a read is followed by a fence keeping it
+//      ahead of later reads, and a write is preceded by a fence keeping
+//      earlier writes ahead of it.
+//          aarch64:  dmb oshld after a read, dmb oshst before a write.
+//                    Outer shareable and one direction each, instead of
+//                    a full dmb sy around every access
+//          x86:      a compiler barrier. MMIO is mapped uncached, and the
+//                    CPU keeps uncached accesses in program order
+//          others:   a full fence
+//
+//  Note1:  a setter's read-modify-write is a load followed by a store, not
+//          an atomic read-modify-write. A register has one writer (as a
+//          board does in board_controller.h) and any number of readers.
+//
+//  Note2:  the policies access a register as a whole word_t. relaxed
+//          copies it with std::memcpy, so reading a register struct as a
+//          word is well defined.
+//
+//  Note3:  compare_exchange() stores desired only if the register still
+//          holds expected; otherwise it loads the register into expected
+//          and returns false, as __atomic_compare_exchange_n does. It is
+//          how register_transaction (see register_interlock.h) publishes a
+//          batch without losing another writer's update. device_ordering
+//          cannot lock device memory, so its compare_exchange() is a load,
+//          a compare and a store: it relies on Note1's one writer.
+
+#ifndef REGISTER_ORDERING_H
+#define REGISTER_ORDERING_H
+
+#include <cstring>      //  std::memcpy
+
+struct relaxed_ordering
+{
+    template< typename word_t >
+    static word_t load(const void* addr)
+    {
+        word_t word;
+        std::memcpy(&word, addr, sizeof(word));     // Note2
+        return word;
+    }
+
+    template< typename word_t >
+    static void store(void* addr, word_t word)
+    {
+        std::memcpy(addr, &word, sizeof(word));
+    }
+
+    template< typename word_t >
+    static bool compare_exchange(void* addr, word_t& expected, word_t desired)     // Note3
+    {
+        return __atomic_compare_exchange_n(static_cast<word_t*>(addr), &expected, desired, false,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+};
+
+struct acq_rel_ordering
+{
+    template< typename word_t >
+    static word_t load(const void* addr)
+    {
+        return __atomic_load_n(static_cast<const word_t*>(addr), __ATOMIC_ACQUIRE);
+    }
+
+    template< typename word_t >
+    static void store(void* addr, word_t word)
+    {
+        __atomic_store_n(static_cast<word_t*>(addr), word, __ATOMIC_RELEASE);
+    }
+
+    template< typename word_t >
+    static bool compare_exchange(void* addr, word_t& expected, word_t desired)     // Note3
+    {
+        return __atomic_compare_exchange_n(static_cast<word_t*>(addr), &expected, desired, false,
+                                           __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+};
+
+// keeps a device read ahead of later reads
+inline void device_read_fence()
+{
+#if defined(__aarch64__)
+    asm volatile("dmb oshld" ::: "memory");
+#elif defined(__x86_64__) || defined(__i386__)
+    asm volatile("" ::: "memory");
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+// keeps earlier writes ahead of a device write
+inline void device_write_fence()
+{
+#if defined(__aarch64__)
+    asm volatile("dmb oshst" ::: "memory");
+#elif defined(__x86_64__) || defined(__i386__)
+    asm volatile("" ::: "memory");
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+struct device_ordering
+{
+    template< typename word_t >
+    static word_t load(const void* addr)
+    {
+        const word_t word = *static_cast<const volatile word_t*>(addr);
+        device_read_fence();
+        return word;
+    }
+
+    template< typename word_t >
+    static void store(void* addr, word_t word)
+    {
+        device_write_fence();
+        *static_cast<volatile word_t*>(addr) = word;
+    }
+
+    template< typename word_t >
+    static bool compare_exchange(void* addr, word_t& expected, word_t desired)     // Note3
+    {
+        const word_t current = load<word_t>(addr);
+        if (current != expected)
+        {
+            expected = current;
+            return false;
+        }
+        store<word_t>(addr, desired);
+        return true;
+    }
+};
+
+#endif // REGISTER_ORDERING_H
@@ -0,0 +1,230 @@
+// register_poller.h
+//
+// register_poller -- polls readback registers on a schedule which adapts
+//                    to how often they change
+//
+//      Each watched register is read as a raw word and diffed against the
+//      word read last time with a single XOR. A quiet register costs one
+//      bus read and one compare. When bits did change, only the callbacks
+//      of the fields (see register_descriptor.h) holding changed bits are
+//      called, with the field's old and new value.
+//
+//      Each register keeps its own polling interval, between a minimum
+//      and a maximum:
+//
+//          - a change snaps the interval back to the minimum (activity
+//            tends to come in bursts)
+//          - after QUIET_POLLS_BEFORE_BACKOFF quiet polls in a row the
+//            interval doubles, up to the maximum
+//
+//      So a register nothing is happening to is read at the slow rate,
+//      and one in the middle of a burst at the fast rate.
+//
+//      poll_due() polls whichever registers are due at the given time,
+//      and is what a caller with its own loop (or the UT) calls. run()
+//      is a loop of its own, sleeping until the next register is due.
+//
+//  Note1:  the word is read through a pointer to volatile, so every poll
+//          is a real read of the register.
+//
+//  Note2:  a callback may call watch(), e.g., to start watching another
+//          field once this one changes. The registers and their watches
+//          are kept in deques, which never move their elements as they
+//          grow, and are walked by index up to the count they had when the
+//          walk began. So a watch added by a callback is not called for
+//          the change that added it, and a register added by a callback
+//          is first polled by the next poll_due().
+
+#ifndef REGISTER_POLLER_H
+#define REGISTER_POLLER_H
+
+#include <algorithm>    //  std::min
+#include <atomic>       //  std::atomic
+#include <chrono>       //  std::chrono::steady_clock
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <deque>        //  std::deque
+#include <functional>   //  std::function
+#include <stdexcept>    //  std::invalid_argument
+#include <thread>       //  std::this_thread::sleep_until
+
+#include "register_arena.h"
+#include "register_descriptor.h"
+
+class register_poller
+{
+public:
+    typedef std::chrono::steady_clock               clock_t;
+    typedef clock_t::time_point                     time_point_t;
+    typedef std::chrono::nanoseconds                interval_t;
+
+    // called with the changed field's descriptor, its previous and its current value
+    typedef std::function< void(const field_descriptor& field, std::uint16_t old_val, std::uint16_t new_val) > callback_t;
+
+    static const unsigned QUIET_POLLS_BEFORE_BACKOFF { 4 };
+
+    register_poller(interval_t min_interval, interval_t max_interval)
+        : min_interval_(min_interval),
+          max_interval_(max_interval)
+    {
+        if (min_interval <= interval_t::zero() || max_interval < min_interval)
+        {
+            throw std::invalid_argument("register_poller: need 0 < min_interval <= max_interval");
+        }
+    }
+
+    // watch() -- calls callback whenever field's bits in the register word
+    //            at reg change. The register's first poll is due at now;
+    //            its first read only sets the baseline. May be called from
+    //            a callback. Note2
+    void watch(const volatile std::uint16_t* reg, const field_descriptor& field, callback_t callback,
+               time_point_t now = clock_t::now())
+    {
+        polled_register& r = find_or_add(reg, now);
+        r.watched_bits |= field.mask();
+        r.watches.push_back(watch_t{ field, std::move(callback) });
+    }
+
+    // poll_due() -- polls the registers whose turn has come by now.
+    //               Returns the number of registers polled
+    std::size_t poll_due(time_point_t now)
+    {
+        std::size_t polled = 0;
+
+        const std::size_t count = registers_.size();                        // Note2
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (registers_[i].next_due <= now)
+            {
+                poll(registers_[i], now);
+                ++polled;
+            }
+        }
+        return polled;
+    }
+
+    // when the next register is due to be polled
+    time_point_t next_due() const
+    {
+        time_point_t earliest = time_point_t::max();
+        for (const polled_register& r : registers_)
+        {
+            earliest = std::min(earliest, r.next_due);
+        }
+        return earliest;
+    }
+
+    // run() -- polls the registers as they fall due, until stop is set
+    void run(const std::atomic<bool>& stop)
+    {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            std::this_thread::sleep_until(std::min(next_due(), clock_t::now() + max_interval_));
+            poll_due(clock_t::now());
+        }
+    }
+
+    // the given register's current polling interval
+    interval_t interval(const volatile std::uint16_t* reg) const
+    {
+        for (const polled_register& r : registers_)
+        {
+            if (r.reg == reg)
+            {
+                return r.interval;
+            }
+        }
+        return interval_t::zero();
+    }
+
+    std::uint64_t polls()        const { return polls_; }
+    std::uint64_t quiet_polls()  const { return quiet_polls_; }     // polls which found no watched bit changed
+    std::uint64_t callbacks()    const { return callbacks_; }
+
+private:
+    struct watch_t
+    {
+        field_descriptor    field;
+        callback_t          callback;
+    };
+
+    template< typename T >
+    using register_deque = std::deque< T, register_allocator<T> >;         // Note2
+
+    struct polled_register
+    {
+        const volatile std::uint16_t*   reg;                // Note1
+        std::uint16_t                   watched_bits;
+        std::uint16_t                   last;
+        bool                            baselined;
+        unsigned                        quiet_in_a_row;
+        interval_t                      interval;
+        time_point_t                    next_due;
+        register_deque<watch_t>         watches;
+    };
+
+    polled_register& find_or_add(const volatile std::uint16_t* reg, time_point_t now)
+    {
+        for (polled_register& r : registers_)
+        {
+            if (r.reg == reg)
+            {
+                return r;
+            }
+        }
+
+        registers_.push_back(polled_register{ reg, 0, 0, false, 0, min_interval_, now, {} });
+        return registers_.back();
+    }
+
+    void poll(polled_register& r, time_point_t now)
+    {
+        const std::uint16_t word    = *r.reg;
+        const std::uint16_t changed = static_cast<std::uint16_t>((word ^ r.last) & r.watched_bits);
+        const std::uint16_t last    = r.last;
+
+        r.last = word;
+        ++polls_;
+
+        if (!r.baselined)
+        {
+            r.baselined = true;
+        }
+        else if (changed != 0)
+        {
+            r.quiet_in_a_row = 0;
+            r.interval       = min_interval_;       // tighten on activity
+            r.next_due       = now + r.interval;
+
+            const std::size_t count = r.watches.size();                     // Note2
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const watch_t& w = r.watches[i];
+                if (changed & w.field.mask())
+                {
+                    ++callbacks_;
+                    w.callback(w.field, w.field.extract(last), w.field.extract(word));
+                }
+            }
+            return;
+        }
+
+        ++quiet_polls_;
+        if (++r.quiet_in_a_row >= QUIET_POLLS_BEFORE_BACKOFF)
+        {
+            r.quiet_in_a_row = 0;
+            r.interval       = std::min(r.interval * 2, max_interval_);    // back off when quiet
+        }
+        r.next_due = now + r.interval;
+    }
+
+    const interval_t                    min_interval_;
+    const interval_t                    max_interval_;
+    register_deque<polled_register>     registers_;
+
+    std::uint64_t                   polls_       {0};
+    std::uint64_t                   quiet_polls_ {0};
+    std::uint64_t                   callbacks_   {0};
+};
+
+#endif // REGISTER_POLLER_H
@@ -0,0 +1,395 @@
+// register_trace.h
+//
+// Binary trace of the register accesses made through the field functors.
+//
+// tracing_instrumentation is an instrumentation policy (see
+// field_instrumentation.h). Each access made through a functor using it
+// is recorded as a 16 byte trace_record into the calling thread's
+// lock-free ring. Recording an access costs a counter read and a handful
+// of stores; there is no formatting, no locking and no system call.
+//
+// flush_trace() drains every thread's ring, appending the records to a
+// memory-mapped trace file. trace_decode.exe turns a trace file into text.
+//
+//  Note1:  When a thread's ring is full the access is not recorded; it is
+//          counted as dropped instead. Flush often enough that the rings
+//          do not fill up.
+
+#ifndef REGISTER_TRACE_H
+#define REGISTER_TRACE_H
+
+#include <atomic>       //  std::atomic
+#include <cerrno>       //  errno
+#include <cstdint>      //  std::uint8_t, std::uint16_t, std::uint64_t
+#include <cstring>      //  std::memcpy, std::memcmp
+#include <iomanip>      //  std::setw
+#include <ostream>      //  std::ostream
+#include <stdexcept>    //  std::runtime_error
+#include <string>       //  std::string
+#include <system_error> //  std::system_error
+#include <vector>       //  std::vector
+
+#include <fcntl.h>      //  open
+#include <sys/mman.h>   //  mmap, munmap, msync
+#include <sys/stat.h>   //  fstat
+#include <unistd.h>     //  close, ftruncate, pread
+
+#include "cycle_counter.h"
+#include "per_thread_registry.h"
+#include "register_arena.h"
+#include "register_descriptor.h"
+#include "spsc_ring.h"
+
+// the kinds of access recorded in a trace
+const std::uint8_t  TRACE_READ         = 0;
+const std::uint8_t  TRACE_WRITE        = 1;
+const std::uint8_t  TRACE_ELIDED_WRITE = 2;
+const std::uint8_t  TRACE_RANGE_ERROR  = 3;
+const std::uint8_t  TRACE_RATE_LIMITED = 4;
+
+struct trace_record
+{
+    std::uint64_t   tsc;        // read_cycle_counter() at the start of the access
+    std::uint8_t    reg_id;     // within the register's space
+    std::uint8_t    field_id;
+    std::uint16_t   old_val;    // field's value before the access
+    std::uint16_t   new_val;    // field's value after the access (the rejected value for TRACE_RANGE_ERROR, TRACE_RATE_LIMITED)
+    std::uint8_t    kind;       // TRACE_READ, TRACE_WRITE, etc.
+    std::uint8_t    space;      // the register's space (see register_descriptor.h). Once reserved, and 0
+};
+
+static_assert(sizeof(trace_record) == 16, "trace_record is a file format. Keep it compact and fixed");
+
+const std::size_t TRACE_RING_CAPACITY { 16384 };    // records per thread
+
+
+// tracing_instrumentation -- records every access. See Note1
+struct tracing_instrumentation
+{
+    typedef std::uint64_t stamp_t;
+
+    // a trace record holds any register key and field id
+    static constexpr bool tracks(register_key_t, std::uint8_t) { return true; }
+
+    static stamp_t begin() noexcept { return read_cycle_counter(); }
+
+    // a read records the value it returned as both the old and new value
+    static void read(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t val) noexcept
+    {
+        record(trace_record{ t0, key_reg_id(key), field_id, val, val, TRACE_READ, key_space(key) });
+    }
+
+    static void write(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t old_val, std::uint16_t new_val) noexcept
+    {
+        record(trace_record{ t0, key_reg_id(key), field_id, old_val, new_val, TRACE_WRITE, key_space(key) });
+    }
+
+    static void elided_write(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t val) noexcept
+    {
+        record(trace_record{ t0, key_reg_id(key), field_id, val, val, TRACE_ELIDED_WRITE, key_space(key) });
+    }
+
+    static void range_error(register_key_t key, std::uint8_t field_id, std::uint16_t val) noexcept
+    {
+        record(trace_record{ read_cycle_counter(), key_reg_id(key), field_id, 0, val, TRACE_RANGE_ERROR, key_space(key) });
+    }
+
+    static void rate_limited(register_key_t key, std::uint8_t field_id, stamp_t t0, std::uint16_t val) noexcept
+    {
+        record(trace_record{ t0, key_reg_id(key), field_id, 0, val, TRACE_RATE_LIMITED, key_space(key) });
+    }
+
+    // drain() -- moves every thread's recorded accesses into records.
+    //            Each thread's records stay in the order they were made.
+    static void drain(std::vector<trace_record>& records)
+    {
+        registry::visit( [&](retired_records& retired)     // one consumer at a time
+                         {
+                             records.insert(records.end(), retired.begin(), retired.end());
+                             retired.clear();
+                         },
+                         [&](thread_ring& t) { drain_ring(t.ring, records); } );
+    }
+
+    // number of accesses that were not recorded because a ring was full. See Note1
+    static std::uint64_t dropped()
+    {
+        return dropped_count().load(std::memory_order_relaxed);
+    }
+
+private:
+    typedef spsc_ring<trace_record, TRACE_RING_CAPACITY> ring_t;
+
+    typedef register_vector<trace_record> retired_records;     // records left behind by exited threads
+
+    // one per thread. Hands its undrained records over to the retired
+    // ones when the thread exits
+    struct thread_ring
+    {
+        ring_t ring;
+
+        void retire(retired_records& retired)
+        {
+            drain_ring(ring, retired);
+        }
+    };
+
+    typedef per_thread_registry<thread_ring, retired_records> registry;
+
+    static void record(const trace_record& rec) noexcept
+    {
+        if (!this_threads_ring().ring.push(rec))
+        {
+            dropped_count().fetch_add(1, std::memory_order_relaxed);    // Note1
+        }
+    }
+
+    template< typename records_t >
+    static void drain_ring(ring_t& ring, records_t& records)
+    {
+        trace_record rec;
+        while (ring.pop(rec))
+        {
+            records.push_back(rec);
+        }
+    }
+
+    static std::atomic<std::uint64_t>& dropped_count()
+    {
+        static std::atomic<std::uint64_t> dropped {0};
+        return dropped;
+    }
+
+    static thread_ring& this_threads_ring()
+    {
+        return registry::local();
+    }
+};
+
+
+//==================================================================
+//
+//  Trace file format
+//
+//      trace_file_header
+//      trace_record[ header.count ]
+//
+//  The records are in the host's byte order.
+//
+//==================================================================
+
+const char           TRACE_FILE_MAGIC[8] = { 'R', 'E', 'G', 'T', 'R', 'A', 'C', 'E' };
+const std::uint32_t  TRACE_FILE_VERSION  = 1;
+
+struct trace_file_header
+{
+    char            magic[8];
+    std::uint32_t   version;
+    std::uint32_t   record_size;
+    std::uint64_t   count;              // number of records following the header
+    double          ticks_per_second;   // see cycle_counter_hz()
+};
+
+static_assert(sizeof(trace_file_header) == 32, "trace_file_header is a file format");
+
+// closes a file descriptor on scope exit
+struct trace_fd
+{
+    int fd;
+    explicit trace_fd(int fd_) : fd(fd_) {}
+    ~trace_fd() { if (fd >= 0) ::close(fd); }
+};
+
+// maps [0,len) of a file, unmapping it on scope exit
+struct trace_mapping
+{
+    void*       addr;
+    std::size_t len;
+
+    trace_mapping(int fd, std::size_t len_, int prot) : len(len_)
+    {
+        addr = ::mmap(nullptr, len, prot, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::generic_category(), "mmap trace file");
+        }
+    }
+
+    ~trace_mapping() { ::munmap(addr, len); }
+};
+
+inline void validate_trace_header(const trace_file_header& hdr, const std::string& path)
+{
+    if (std::memcmp(hdr.magic, TRACE_FILE_MAGIC, sizeof(hdr.magic)) != 0
+        || hdr.version     != TRACE_FILE_VERSION
+        || hdr.record_size != sizeof(trace_record))
+    {
+        throw std::runtime_error("'" + path + "' is not a trace file this build can read.");
+    }
+}
+
+// trace_count_fits() -- whether a file of file_size bytes holds the header
+//                       and the header's count of records. Divides rather
+//                       than multiplies, so that a corrupt count can't
+//                       overflow its way past the check
+inline bool trace_count_fits(const trace_file_header& hdr, std::size_t file_size)
+{
+    return file_size >= sizeof(hdr) && hdr.count <= (file_size - sizeof(hdr)) / sizeof(trace_record);
+}
+
+// append_trace() -- appends records to the trace file at path, creating it if need be
+inline void append_trace(const std::string& path, const std::vector<trace_record>& records)
+{
+    trace_fd file{ ::open(path.c_str(), O_RDWR | O_CREAT, 0644) };
+    if (file.fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "open '" + path + "'");
+    }
+
+    struct stat st;
+    if (::fstat(file.fd, &st) != 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "fstat '" + path + "'");
+    }
+
+    trace_file_header hdr {};
+
+    // if this is a brand new trace file
+    if (st.st_size == 0)
+    {
+        std::memcpy(hdr.magic, TRACE_FILE_MAGIC, sizeof(hdr.magic));
+        hdr.version          = TRACE_FILE_VERSION;
+        hdr.record_size      = sizeof(trace_record);
+        hdr.count            = 0;
+        hdr.ticks_per_second = cycle_counter_hz();
+    }
+    else if (::pread(file.fd, &hdr, sizeof(hdr), 0) != static_cast<ssize_t>(sizeof(hdr)))
+    {
+        throw std::runtime_error("'" + path + "' is too short to be a trace file.");
+    }
+
+    validate_trace_header(hdr, path);
+
+    if (st.st_size != 0 && !trace_count_fits(hdr, static_cast<std::size_t>(st.st_size)))
+    {
+        throw std::runtime_error("'" + path + "' is truncated.");
+    }
+
+    const std::size_t offset = sizeof(hdr) + hdr.count * sizeof(trace_record);
+    const std::size_t size   = offset + records.size() * sizeof(trace_record);
+
+    if (::ftruncate(file.fd, size) != 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "ftruncate '" + path + "'");
+    }
+
+    trace_mapping map{ file.fd, size, PROT_READ | PROT_WRITE };
+    char* base = static_cast<char*>(map.addr);
+
+    if (!records.empty())
+    {
+        std::memcpy(base + offset, records.data(), records.size() * sizeof(trace_record));
+    }
+
+    hdr.count += records.size();
+    std::memcpy(base, &hdr, sizeof(hdr));
+
+    ::msync(map.addr, size, MS_SYNC);
+}
+
+// flush_trace() -- drains every thread's ring into the trace file at path.
+//                  Returns the number of records flushed
+inline std::size_t flush_trace(const std::string& path)
+{
+    std::vector<trace_record> records;
+    tracing_instrumentation::drain(records);
+
+    append_trace(path, records);
+
+    return records.size();
+}
+
+// read_trace() -- reads the trace file at path. Returns its records
+inline std::vector<trace_record> read_trace(const std::string& path, trace_file_header& hdr)
+{
+    trace_fd file{ ::open(path.c_str(), O_RDONLY) };
+    if (file.fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "open '" + path + "'");
+    }
+
+    struct stat st;
+    if (::fstat(file.fd, &st) != 0)
+    {
+        throw std::system_error(errno, std::generic_category(), "fstat '" + path + "'");
+    }
+
+    if (static_cast<std::size_t>(st.st_size) < sizeof(hdr))
+    {
+        throw std::runtime_error("'" + path + "' is too short to be a trace file.");
+    }
+
+    trace_mapping map{ file.fd, static_cast<std::size_t>(st.st_size), PROT_READ };
+    const char* base = static_cast<const char*>(map.addr);
+
+    std::memcpy(&hdr, base, sizeof(hdr));
+    validate_trace_header(hdr, path);
+
+    if (!trace_count_fits(hdr, static_cast<std::size_t>(st.st_size)))
+    {
+        throw std::runtime_error("'" + path + "' is truncated.");
+    }
+
+    std::vector<trace_record> records(hdr.count);
+    if (hdr.count != 0)
+    {
+        std::memcpy(records.data(), base + sizeof(hdr), hdr.count * sizeof(trace_record));
+    }
+
+    return records;
+}
+
+inline const char* trace_kind_name(std::uint8_t kind)
+{
+    switch (kind)
+    {
+        case TRACE_READ:         return "read";
+        case TRACE_WRITE:        return "write";
+        case TRACE_ELIDED_WRITE: return "elided";
+        case TRACE_RANGE_ERROR:  return "range_error";
+        case TRACE_RATE_LIMITED: return "rate_limited";
+        default:                 return "unknown";
+    }
+}
+
+// format_trace_record() -- emits one record as a line of text.
+//                          ticks are shown relative to t0, and a
+//                          register outside the board's space is
+//                          shown with its space
+inline void format_trace_record(std::ostream& os, const trace_record& rec, std::uint64_t t0)
+{
+    os << std::setw(12) << (rec.tsc - t0);
+
+    if (rec.space != BOARD_REGISTER_SPACE)      // an IC's register
+    {
+        os << "  space" << static_cast<unsigned>(rec.space);
+    }
+
+    os << "  reg" << static_cast<unsigned>(rec.reg_id)
+       << "  field" << static_cast<unsigned>(rec.field_id)
+       << "  " << std::setw(11) << std::left << trace_kind_name(rec.kind) << std::right;
+
+    switch (rec.kind)
+    {
+        case TRACE_WRITE:        os << "  " << rec.old_val << " -> " << rec.new_val; break;
+        case TRACE_READ:         os << "  " << rec.new_val;                          break;
+        case TRACE_ELIDED_WRITE: os << "  " << rec.new_val;                          break;
+        case TRACE_RANGE_ERROR:  os << "  rejected " << rec.new_val;                 break;
+        case TRACE_RATE_LIMITED: os << "  refused " << rec.new_val;                  break;
+        default:                                                                     break;
+    }
+
+    os << '\n';
+}
+
+#endif // REGISTER_TRACE_H
@@ -0,0 +1,75 @@
+// simd_dispatch.h
+//
+// Runtime selection of SIMD kernels.
+//
+// Kernels over arrays of register images come in a scalar flavour and,
+// on x86, SSE2 and AVX2 flavours. Each kernel's dispatcher takes a
+// simd_level, defaulting to the best level the CPU running the code
+// supports. Asking for a level the CPU does not support quietly gets
+// the best one it does, so a UT may ask for every level on any CPU.
+//
+//  Note1:  The SSE2 and AVX2 kernels are compiled with target attributes
+//          rather than -mavx2, so that a single binary runs on any x86 CPU
+//          and only calls the AVX2 kernels where AVX2 exists.
+
+#ifndef SIMD_DISPATCH_H
+#define SIMD_DISPATCH_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#define REGISTER_SIMD_X86 1
+#include <immintrin.h>  //  SSE2, AVX2 intrinsics
+#endif
+
+#define SIMD_TARGET_SSE2 __attribute__((target("sse2")))            // Note1
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,popcnt")))     // Note1
+
+enum class simd_level
+{
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+inline const char* simd_level_name(simd_level level)
+{
+    switch (level)
+    {
+        case simd_level::SSE2: return "sse2";
+        case simd_level::AVX2: return "avx2";
+        default:               return "scalar";
+    }
+}
+
+// best_simd_level() -- the best level the running CPU supports
+inline simd_level best_simd_level()
+{
+#ifdef REGISTER_SIMD_X86
+    static const simd_level best = []()
+    {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+        {
+            return simd_level::AVX2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return simd_level::SSE2;
+        }
+        return simd_level::SCALAR;
+    }();
+
+    return best;
+#else
+    return simd_level::SCALAR;
+#endif
+}
+
+// usable_simd_level() -- the requested level, or the best the CPU
+//                        supports if that is lower
+inline simd_level usable_simd_level(simd_level requested)
+{
+    const simd_level best = best_simd_level();
+    return (static_cast<int>(requested) > static_cast<int>(best)) ? best : requested;
+}
+
+#endif // SIMD_DISPATCH_H
@@ -0,0 +1,204 @@
+// solenoid_rate_limit.h
+//
+// Compile-time rate limiting policies for the solenoid functors
+// (gpio_register_23< solenoid2_t >, < solenoid3_t >, and their cached
+// counterparts), for board_handle's solenoid accessors and for the
+// solenoid typestates.
+//
+// Toggling a solenoid too often overheats its coil. A rate limiting policy
+// decides whether a toggle (a write that changes the solenoid's state) may
+// go ahead. A toggle it refuses is rejected: the solenoid keeps its state,
+// the setter returns it as usual, and the instrumentation policy's
+// rate_limited() hook is called (see field_instrumentation.h), so that
+// counting_instrumentation counts it and tracing_instrumentation records it.
+// Writes that change nothing are elided before the policy is consulted, so
+// they never use up a toggle.
+//
+// no_rate_limit is the default policy. It admits every toggle and compiles
+// out entirely.
+//
+// coil_rate_limit enforces the limits set by coil_rate_limit::configure():
+//
+//      min_dwell       -- a solenoid must stay in a state at least this long
+//      max_toggles     -- at most this many toggles within any window
+//
+// Each field's limits are tracked in a toggle_bucket, 16 bytes, one per
+// register field, kept in toggle_bucket_table. Every accessor of a
+// solenoid -- a functor, board_handle's accessors, a cached functor (see
+// tick_read_cache.h), a typestate -- looks its bucket up once, when
+// constructed, and keeps a bucket_ref to it, so however many accessors
+// drive a solenoid, they share its one toggle budget. The clock is read_cycle_counter() (see
+// cycle_counter.h), so a check costs a counter read and a few compares;
+// no syscall, no lookup.
+//
+//  Note1:  toggle_bucket is a token bucket kept in the 'virtual scheduling'
+//          form of the generic cell rate algorithm: rather than a token
+//          count and a refill time, it keeps the single time at which the
+//          bucket will be full again (tat). A toggle is admitted while tat
+//          lies no more than a burst ahead of now, and pushes tat one
+//          interval further on. No refill loop, no division.
+//
+//  Note2:  the limits are shared by every coil of the process, and are
+//          read, not locked, by the hot path. Configure them before the
+//          accessors are used. Until configured, every toggle is admitted.
+//
+//  Note3:  a bucket is keyed by its register's address and its field's id,
+//          and lives as long as the process does: a coil's history
+//          outlives the accessors that drove it. The table is locked only
+//          to look a bucket up; a bucket itself is updated unlocked, by
+//          its register's one writer (Note1 of register_ordering.h).
+
+#ifndef SOLENOID_RATE_LIMIT_H
+#define SOLENOID_RATE_LIMIT_H
+
+#include <chrono>       //  std::chrono::nanoseconds
+#include <cstdint>      //  std::uint8_t, std::uint64_t
+#include <deque>        //  std::deque
+#include <mutex>        //  std::mutex, std::lock_guard
+#include <stdexcept>    //  std::invalid_argument
+#include <type_traits>  //  std::is_empty
+
+#include "cycle_counter.h"
+#include "register_arena.h"
+
+// a coil's limits, in read_cycle_counter() ticks
+struct toggle_limits
+{
+    std::uint64_t   min_dwell {0};      // the least time between toggles
+    std::uint64_t   interval  {0};      // the window divided by max_toggles
+    std::uint64_t   burst     {0};      // how far ahead of now tat may run. Note1
+};
+
+// to_toggle_limits() -- converts limits in time into limits in ticks.
+//                       Throws std::invalid_argument for max_toggles == 0
+inline toggle_limits to_toggle_limits(std::chrono::nanoseconds min_dwell, unsigned max_toggles,
+                                      std::chrono::nanoseconds window, double ticks_per_second = cycle_counter_hz())
+{
+    if (max_toggles == 0)
+    {
+        throw std::invalid_argument("to_toggle_limits: a coil must be allowed at least one toggle per window");
+    }
+
+    const double ticks_per_ns = ticks_per_second / 1e9;
+
+    toggle_limits limits {};
+    limits.min_dwell = static_cast<std::uint64_t>(min_dwell.count() * ticks_per_ns);
+    limits.interval  = static_cast<std::uint64_t>(window.count() * ticks_per_ns) / max_toggles;
+    limits.burst     = limits.interval * (max_toggles - 1);
+    return limits;
+}
+
+// one field's toggle history. Note1
+class toggle_bucket
+{
+public:
+    // admit() -- may the field toggle at now? If so, the toggle is accounted for
+    bool admit(const toggle_limits& limits, std::uint64_t now)
+    {
+        const std::uint64_t tat = (tat_ > now ? tat_ : now);
+
+        if (now < dwell_until_ || tat - now > limits.burst)
+        {
+            return false;
+        }
+
+        tat_         = tat + limits.interval;
+        dwell_until_ = now + limits.min_dwell;
+        return true;
+    }
+
+private:
+    std::uint64_t   tat_         {0};
+    std::uint64_t   dwell_until_ {0};      // the earliest the field may toggle again
+};
+
+static_assert(sizeof(toggle_bucket) == 16, "a toggle_bucket must stay small");
+
+// toggle_bucket_table -- every register field's toggle_bucket. Note3
+class toggle_bucket_table
+{
+public:
+    // bucket_for() -- the field's bucket, added on its first lookup
+    static toggle_bucket& bucket_for(const void* reg, std::uint8_t field_id)
+    {
+        table& t = the_table();
+        std::lock_guard<std::mutex> lock(t.mtx);
+
+        for (entry& e : t.entries)
+        {
+            if (e.reg == reg && e.field_id == field_id)
+            {
+                return e.bucket;
+            }
+        }
+
+        t.entries.push_back(entry{ reg, field_id, toggle_bucket{} });     // a deque never moves its entries
+        return t.entries.back().bucket;
+    }
+
+private:
+    struct entry
+    {
+        const void*     reg;
+        std::uint8_t    field_id;
+        toggle_bucket   bucket;
+    };
+
+    struct table
+    {
+        std::mutex                                      mtx;
+        std::deque< entry, register_allocator<entry> >  entries;
+    };
+
+    static table& the_table()
+    {
+        static table t;
+        return t;
+    }
+};
+
+
+// no_rate_limit -- admits every toggle
+struct no_rate_limit
+{
+    struct bucket_ref {};
+
+    static constexpr bucket_ref bucket_for(const void*, std::uint8_t) { return bucket_ref{}; }
+
+    static constexpr bool admit(const bucket_ref&) { return true; }
+};
+
+static_assert(std::is_empty<no_rate_limit::bucket_ref>::value, "no_rate_limit must not carry state");
+
+
+// coil_rate_limit -- enforces the coils' dwell time and toggle rate
+struct coil_rate_limit
+{
+    struct bucket_ref
+    {
+        toggle_bucket*  bucket;
+    };
+
+    // bucket_for() -- the reference an accessor keeps to its field's bucket. Note3
+    static bucket_ref bucket_for(const void* reg, std::uint8_t field_id)
+    {
+        return bucket_ref{ &toggle_bucket_table::bucket_for(reg, field_id) };
+    }
+
+    // Note2
+    static void configure(const toggle_limits& limits) { limits_ = limits; }
+
+    static void configure(std::chrono::nanoseconds min_dwell, unsigned max_toggles, std::chrono::nanoseconds window)
+    {
+        configure(to_toggle_limits(min_dwell, max_toggles, window));
+    }
+
+    static const toggle_limits& limits() { return limits_; }
+
+    static bool admit(const bucket_ref& r) { return r.bucket->admit(limits_, read_cycle_counter()); }
+
+private:
+    static inline toggle_limits limits_ {};
+};
+
+#endif // SOLENOID_RATE_LIMIT_H
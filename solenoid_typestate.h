@@ -0,0 +1,306 @@
+// solenoid_typestate.h
+//
+// Solenoid sequencing, checked by the compiler.
+//
+// A solenoid's state is encoded in the type of the object through which
+// it is driven: a solenoid_off can only be energized, yielding a
+// solenoid_on, which can only be de-energized, yielding a solenoid_off.
+// De-energizing an idle solenoid, or energizing it twice, doesn't compile.
+//
+//      auto off = solenoid_startup< solenoid2_t >(preg);   // closes the valve
+//      auto on  = std::move(off).energize();
+//      off      = std::move(on).deenergize();
+//
+// Since the type already says what the solenoid's state is, a transition
+// neither reads the solenoid back nor compares anything: it is a store,
+// plus the instrumentation policy's write() hook (see
+// field_instrumentation.h). The Makefile's codegen check verifies this.
+//
+// The vacuum_pair_* states do the same for both of register #23's
+// solenoids together, encoding the interlock "solenoid2 and solenoid3
+// must never both be energized" (see control_board_gpio_reg23.h): the
+// state with one solenoid energized offers no way to energize the other.
+//
+// typestate_misuse.cpp holds sequences which must not compile; the
+// Makefile's typestate_check verifies that they don't.
+//
+//  Note1:  states can't be copied, and transitions consume the state they
+//          are called on (they are rvalue qualified, hence the std::move).
+//          A moved-from state must not be used again; the compiler won't
+//          stop that, but static analysis (e.g., clang-tidy's
+//          bugprone-use-after-move) will.
+//
+//  Note2:  the typestate API owns the solenoid's state. Driving the same
+//          solenoid through a gpio_register_23 functor as well would make
+//          the types lie.
+//
+//  Note3:  rate_limit, no_rate_limit by default, is the functors' rate
+//          limiting policy (see solenoid_rate_limit.h), and a state shares
+//          its solenoid's toggle bucket with every other accessor of the
+//          field. A transition the policy refuses can't leave the solenoid
+//          as it was and still return the new state, so it throws
+//          toggle_refused instead, before storing anything. The state it
+//          was called on is left as it was: the caller still holds the
+//          solenoid's true state, and may retry later.
+
+#ifndef SOLENOID_TYPESTATE_H
+#define SOLENOID_TYPESTATE_H
+
+#include <cstdint>      //  std::uint8_t, std::uint16_t
+#include <stdexcept>    //  std::runtime_error
+#include <type_traits>  //  std::is_empty
+
+#include "control_board_gpio_reg23.h"
+#include "field_instrumentation.h"
+#include "register_error.h"
+#include "solenoid_rate_limit.h"
+
+// where each solenoid lives within register #23
+template< typename field >
+struct solenoid_field;
+
+template<>
+struct solenoid_field< solenoid2_t >
+{
+    static const std::uint8_t FIELD_ID { SOLENOID2_FIELD_ID };
+
+    static void store(gpio_reg23_ptr_t preg, std::uint16_t bit) { preg->energize_vac_solenoid2 = bit; }
+};
+
+template<>
+struct solenoid_field< solenoid3_t >
+{
+    static const std::uint8_t FIELD_ID { SOLENOID3_FIELD_ID };
+
+    static void store(gpio_reg23_ptr_t preg, std::uint16_t bit) { preg->energize_vac_solenoid3 = bit; }
+};
+
+// the error thrown when the rate limiting policy refuses a transition. Note3
+class toggle_refused : public fixed_message_error<std::runtime_error>
+{
+public:
+    explicit toggle_refused(std::uint8_t field_id_)
+        : fixed_message_error<std::runtime_error>( "Toggle of field %u of register #23 refused: its coil needs to rest. ",
+                                                   unsigned{field_id_} ),
+          field_id(field_id_) {}
+
+    const std::uint8_t field_id;    // the solenoid's field
+};
+
+[[noreturn]] __attribute__((noinline, cold))
+inline void throw_toggle_refused(std::uint8_t field_id)
+{
+    throw toggle_refused(field_id);
+}
+
+// solenoid_bucket -- a state's reference to its solenoid's toggle bucket,
+//                    a base of the state, so that no_rate_limit's empty
+//                    reference takes no space. Note3
+template< typename field, typename rate_limit, bool = std::is_empty< typename rate_limit::bucket_ref >::value >
+class solenoid_bucket
+{
+public:
+    explicit solenoid_bucket(gpio_reg23_ptr_t preg)
+        : ref(rate_limit::bucket_for(preg, solenoid_field< field >::FIELD_ID)) {}
+
+    const typename rate_limit::bucket_ref& bucket() const { return ref; }
+
+private:
+    typename rate_limit::bucket_ref ref;
+};
+
+template< typename field, typename rate_limit >
+class solenoid_bucket< field, rate_limit, true >
+{
+public:
+    explicit solenoid_bucket(gpio_reg23_ptr_t) {}
+
+    typename rate_limit::bucket_ref bucket() const { return typename rate_limit::bucket_ref{}; }
+};
+
+// transition() -- drives a solenoid whose current state is known
+template< typename field, typename instrumentation, typename rate_limit >
+inline void transition(gpio_reg23_ptr_t preg, const solenoid_bucket< field, rate_limit >& bucket,
+                       std::uint16_t from_bit, std::uint16_t to_bit)
+{
+    static_assert(reg23_tracked_by<instrumentation>(), "the instrumentation can't account for register #23's fields");
+
+    typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+    if (!rate_limit::admit(bucket.bucket()))        // Note3
+    {
+        instrumentation::rate_limited(GPIO_REG23_ID, solenoid_field< field >::FIELD_ID, t0, to_bit);
+        throw_toggle_refused(solenoid_field< field >::FIELD_ID);
+    }
+
+    solenoid_field< field >::store(preg, to_bit);
+
+    instrumentation::write(GPIO_REG23_ID, solenoid_field< field >::FIELD_ID, t0, from_bit, to_bit);
+}
+
+
+template< typename field, typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit >
+class solenoid_on;
+
+template< typename field, typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit >
+class solenoid_off : private solenoid_bucket< field, rate_limit >
+{
+public:
+    solenoid_off(solenoid_off&&)            = default;
+    solenoid_off& operator=(solenoid_off&&) = default;
+
+    // Note1, Note3
+    solenoid_on< field, instrumentation, rate_limit > energize() &&
+    {
+        transition< field, instrumentation, rate_limit >(preg, *this, 0, 1);
+        return solenoid_on< field, instrumentation, rate_limit >{ preg, *this };
+    }
+
+private:
+    template< typename, typename, typename > friend class solenoid_on;
+    template< typename f, typename i, typename r > friend solenoid_off< f, i, r > solenoid_startup(gpio_reg23_ptr_t);
+
+    solenoid_off(gpio_reg23_ptr_t preg_, const solenoid_bucket< field, rate_limit >& bucket_)
+        : solenoid_bucket< field, rate_limit >(bucket_), preg(preg_) {}
+
+    gpio_reg23_ptr_t preg;
+};
+
+template< typename field, typename instrumentation, typename rate_limit >
+class solenoid_on : private solenoid_bucket< field, rate_limit >
+{
+public:
+    solenoid_on(solenoid_on&&)            = default;
+    solenoid_on& operator=(solenoid_on&&) = default;
+
+    // Note1, Note3
+    solenoid_off< field, instrumentation, rate_limit > deenergize() &&
+    {
+        transition< field, instrumentation, rate_limit >(preg, *this, 1, 0);
+        return solenoid_off< field, instrumentation, rate_limit >{ preg, *this };
+    }
+
+private:
+    template< typename, typename, typename > friend class solenoid_off;
+
+    solenoid_on(gpio_reg23_ptr_t preg_, const solenoid_bucket< field, rate_limit >& bucket_)
+        : solenoid_bucket< field, rate_limit >(bucket_), preg(preg_) {}
+
+    gpio_reg23_ptr_t preg;
+};
+
+// solenoid_startup() -- takes charge of a solenoid (Note2), closing its
+//                       valve just as the functor's constructor does
+template< typename field, typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit >
+solenoid_off< field, instrumentation, rate_limit > solenoid_startup(gpio_reg23_ptr_t preg)
+{
+    solenoid_field< field >::store(preg, 0);
+    return solenoid_off< field, instrumentation, rate_limit >{ preg, solenoid_bucket< field, rate_limit >{ preg } };
+}
+
+
+//-------- both solenoids --------
+
+template< typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit > class vacuum_pair_solenoid2_on;
+template< typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit > class vacuum_pair_solenoid3_on;
+
+// vacuum_pair_buckets -- a pair state's references to both solenoids' toggle buckets. Note3
+template< typename rate_limit >
+class vacuum_pair_buckets : private solenoid_bucket< solenoid2_t, rate_limit >,
+                            private solenoid_bucket< solenoid3_t, rate_limit >
+{
+public:
+    explicit vacuum_pair_buckets(gpio_reg23_ptr_t preg)
+        : solenoid_bucket< solenoid2_t, rate_limit >(preg), solenoid_bucket< solenoid3_t, rate_limit >(preg) {}
+
+    const solenoid_bucket< solenoid2_t, rate_limit >& solenoid2() const { return *this; }
+    const solenoid_bucket< solenoid3_t, rate_limit >& solenoid3() const { return *this; }
+};
+
+// neither solenoid energized
+template< typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit >
+class vacuum_pair_off : private vacuum_pair_buckets< rate_limit >
+{
+public:
+    vacuum_pair_off(vacuum_pair_off&&)            = default;
+    vacuum_pair_off& operator=(vacuum_pair_off&&) = default;
+
+    vacuum_pair_solenoid2_on< instrumentation, rate_limit > energize_solenoid2() &&
+    {
+        transition< solenoid2_t, instrumentation, rate_limit >(preg, this->solenoid2(), 0, 1);
+        return vacuum_pair_solenoid2_on< instrumentation, rate_limit >{ preg, *this };
+    }
+
+    vacuum_pair_solenoid3_on< instrumentation, rate_limit > energize_solenoid3() &&
+    {
+        transition< solenoid3_t, instrumentation, rate_limit >(preg, this->solenoid3(), 0, 1);
+        return vacuum_pair_solenoid3_on< instrumentation, rate_limit >{ preg, *this };
+    }
+
+private:
+    template< typename, typename > friend class vacuum_pair_solenoid2_on;
+    template< typename, typename > friend class vacuum_pair_solenoid3_on;
+    template< typename i, typename r > friend vacuum_pair_off< i, r > vacuum_pair_startup(gpio_reg23_ptr_t);
+
+    vacuum_pair_off(gpio_reg23_ptr_t preg_, const vacuum_pair_buckets< rate_limit >& buckets_)
+        : vacuum_pair_buckets< rate_limit >(buckets_), preg(preg_) {}
+
+    gpio_reg23_ptr_t preg;
+};
+
+// solenoid2 energized, so solenoid3 can't be
+template< typename instrumentation, typename rate_limit >
+class vacuum_pair_solenoid2_on : private vacuum_pair_buckets< rate_limit >
+{
+public:
+    vacuum_pair_solenoid2_on(vacuum_pair_solenoid2_on&&)            = default;
+    vacuum_pair_solenoid2_on& operator=(vacuum_pair_solenoid2_on&&) = default;
+
+    vacuum_pair_off< instrumentation, rate_limit > deenergize_solenoid2() &&
+    {
+        transition< solenoid2_t, instrumentation, rate_limit >(preg, this->solenoid2(), 1, 0);
+        return vacuum_pair_off< instrumentation, rate_limit >{ preg, *this };
+    }
+
+private:
+    template< typename, typename > friend class vacuum_pair_off;
+
+    vacuum_pair_solenoid2_on(gpio_reg23_ptr_t preg_, const vacuum_pair_buckets< rate_limit >& buckets_)
+        : vacuum_pair_buckets< rate_limit >(buckets_), preg(preg_) {}
+
+    gpio_reg23_ptr_t preg;
+};
+
+// solenoid3 energized, so solenoid2 can't be
+template< typename instrumentation, typename rate_limit >
+class vacuum_pair_solenoid3_on : private vacuum_pair_buckets< rate_limit >
+{
+public:
+    vacuum_pair_solenoid3_on(vacuum_pair_solenoid3_on&&)            = default;
+    vacuum_pair_solenoid3_on& operator=(vacuum_pair_solenoid3_on&&) = default;
+
+    vacuum_pair_off< instrumentation, rate_limit > deenergize_solenoid3() &&
+    {
+        transition< solenoid3_t, instrumentation, rate_limit >(preg, this->solenoid3(), 1, 0);
+        return vacuum_pair_off< instrumentation, rate_limit >{ preg, *this };
+    }
+
+private:
+    template< typename, typename > friend class vacuum_pair_off;
+
+    vacuum_pair_solenoid3_on(gpio_reg23_ptr_t preg_, const vacuum_pair_buckets< rate_limit >& buckets_)
+        : vacuum_pair_buckets< rate_limit >(buckets_), preg(preg_) {}
+
+    gpio_reg23_ptr_t preg;
+};
+
+// vacuum_pair_startup() -- takes charge of both solenoids, closing both valves
+template< typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit >
+vacuum_pair_off< instrumentation, rate_limit > vacuum_pair_startup(gpio_reg23_ptr_t preg)
+{
+    solenoid_field< solenoid2_t >::store(preg, 0);
+    solenoid_field< solenoid3_t >::store(preg, 0);
+    return vacuum_pair_off< instrumentation, rate_limit >{ preg, vacuum_pair_buckets< rate_limit >{ preg } };
+}
+
+#endif // SOLENOID_TYPESTATE_H
@@ -0,0 +1,86 @@
+// spsc_ring.h
+//
+// spsc_ring -- a bounded, lock-free, single producer/single consumer ring
+//
+//      Exactly one thread may push() and exactly one thread may pop().
+//      Neither ever blocks nor takes a lock: push() fails when the
+//      ring is full and pop() fails when the ring is empty.
+//
+//      capacity must be a power of two.
+//
+//  Note1:  head and tail live on their own cache lines, so the producer
+//          and the consumer do not bounce a shared line between them.
+//          Each side also keeps a private copy of the other side's index,
+//          only re-reading the shared one when the copy says the ring
+//          is full (or empty).
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <array>        //  std::array
+#include <atomic>       //  std::atomic
+#include <cstddef>      //  std::size_t
+
+#include "field_instrumentation.h"  //  CACHE_LINE_SIZE
+
+template< typename T, std::size_t capacity >
+class spsc_ring
+{
+    static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // producer side. returns false, leaving the ring untouched, if the ring is full
+    bool push(const T& item)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+
+        if (head - tail_cache_ == capacity)             // Note1
+        {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head - tail_cache_ == capacity)
+            {
+                return false;
+            }
+        }
+
+        slots_[head & (capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // consumer side. returns false, leaving item untouched, if the ring is empty
+    bool pop(T& item)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+        if (tail == head_cache_)                        // Note1
+        {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail == head_cache_)
+            {
+                return false;
+            }
+        }
+
+        item = slots_[tail & (capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // number of items in the ring. Only a hint while either side is active
+    std::size_t size() const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_       {0};  // next slot to fill. Producer owned
+                             std::size_t              tail_cache_ {0};  // producer's copy of tail_
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_       {0};  // next slot to drain. Consumer owned
+                             std::size_t              head_cache_ {0};  // consumer's copy of head_
+    alignas(CACHE_LINE_SIZE) std::array<T, capacity>  slots_      {};
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,242 @@
+// tick_read_cache.h
+//
+// Coalesces the reads of register #23 made within one control tick.
+//
+// A control tick typically calls vac_solenoid2(), vac_solenoid3() and
+// lamp42() back to back, and each gpio_register_23 getter reads the
+// register afresh. reg23_read_cache reads the register's word once, on
+// the first getter call of the tick, and serves the tick's later getter
+// calls from that word. At the end of the tick the word is invalidated,
+// either explicitly (invalidate()) or by a tick_scope going out of scope,
+// so the next tick reads the register afresh:
+//
+//      reg23_read_cache cache{ preg };
+//      cached_gpio_register_23< solenoid2_t > vac_solenoid2{ cache };
+//      cached_gpio_register_23< lamp_t >      lamp42{ cache };
+//
+//      for (;;)                                  // the control loop
+//      {
+//          tick_scope tick{ cache };
+//          if (vac_solenoid2() == vacuum::ON)   // reads the register
+//          {
+//              lamp42(MOOD_LIGHTING);           // no read: the tick's word is used
+//          }
+//      }                                        // the word is invalidated
+//
+// cached_gpio_register_23 -- functors with the same getters and setters
+//      as gpio_register_23 (see control_board_gpio_reg23.h), and the same
+//      instrumentation, rate limiting and ordering policies, working
+//      through the cache. The setters share the functors'
+//      reg23_write_field(). A setter writes through: it reads the register
+//      afresh, stores the updated word to the register with a single
+//      store, and keeps the cached word in step, so later getters in the
+//      tick see the new value without reading the register again.
+//
+//  Note1:  within a tick, a change made to the register by anything
+//          other than the cache's functors (another thread, another
+//          functor, the hardware) is not seen by the getters until the
+//          next tick, or the next setter call. That is the point of the
+//          cache; keep ticks short.
+//
+//  Note2:  only the getters are served from the cached word. A setter
+//          reads the register afresh (Note6 of control_board_gpio_reg23.h)
+//          and merges its field into that, so it never stores a stale
+//          word over another writer's change to the other fields. The word
+//          it read, then the word it stored, become the tick's word.
+
+#ifndef TICK_READ_CACHE_H
+#define TICK_READ_CACHE_H
+
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+
+#include "control_board_gpio_reg23.h"
+#include "field_instrumentation.h"
+#include "register_descriptor.h"
+#include "register_ordering.h"
+#include "solenoid_rate_limit.h"
+
+template< typename ordering = relaxed_ordering >
+class reg23_read_cache
+{
+public:
+    explicit reg23_read_cache(gpio_reg23_ptr_t preg_) : preg(preg_) {}
+
+    // the register's word, read from the register at most once per tick
+    std::uint16_t word()
+    {
+        if (!valid)
+        {
+            load();
+        }
+        return cached;
+    }
+
+    // load() -- reads the register afresh, and keeps its word as the tick's word. Note2
+    std::uint16_t load()
+    {
+        cached = reg23_load<ordering>(preg);
+        valid  = true;
+        ++loads_;
+        return cached;
+    }
+
+    // store() -- writes word to the register, and keeps it as the tick's word. Note2
+    void store(std::uint16_t word_)
+    {
+        reg23_store<ordering>(preg, word_);
+        cached = word_;
+        valid  = true;
+    }
+
+    // ends the tick: the next getter reads the register afresh
+    void invalidate() { valid = false; }
+
+    // the register the cache reads
+    gpio_reg23_ptr_t reg() const { return preg; }
+
+    // the number of times the register was actually read
+    std::uint64_t loads() const { return loads_; }
+
+private:
+    gpio_reg23_ptr_t            preg;
+    std::uint16_t               cached {0};
+    bool                        valid  {false};
+    std::uint64_t               loads_ {0};
+};
+
+// cache_access -- reaches the register's word for the cached functors'
+//                 setters (see reg23_write_field() in
+//                 control_board_gpio_reg23.h): loads afresh, and keeps the
+//                 cache in step. Note2. Counts nothing
+template< typename ordering >
+struct cache_access
+{
+    reg23_read_cache< ordering >& cache;
+
+    std::uint16_t load() const                     { return cache.load(); }
+    void          store(std::uint16_t word) const  { cache.store(word); }
+    void          tally(field_write_outcome) const {}
+};
+
+// tick_scope -- invalidates the cache's word when the tick ends
+template< typename ordering = relaxed_ordering >
+class tick_scope
+{
+public:
+    explicit tick_scope(reg23_read_cache< ordering >& cache_) : cache(cache_) {}
+    ~tick_scope() { cache.invalidate(); }
+
+    tick_scope(const tick_scope&)            = delete;
+    tick_scope& operator=(const tick_scope&) = delete;
+
+private:
+    reg23_read_cache< ordering >& cache;
+};
+
+
+// cached_gpio_register_23 -- register #23's functors, working through a
+//                            reg23_read_cache
+//
+//      Like gpio_register_23 there is a partial specialization per field,
+//      and the policies are gpio_register_23's (Note3, Note5 and Note6 of
+//      control_board_gpio_reg23.h). The ordering is the cache's. Unlike
+//      them, construction does not touch the register: the functors are
+//      views of a register whose functors already put it in its startup
+//      state.
+template< typename field, typename instrumentation = no_instrumentation, typename rate_limit = no_rate_limit,
+          typename ordering = relaxed_ordering >
+class cached_gpio_register_23;    // Note2 of control_board_gpio_reg23.h
+
+// cached_solenoid -- what the two solenoids' specializations share. Shares
+//                    the solenoid's toggle bucket with every other accessor
+//                    of the field (see solenoid_rate_limit.h)
+template< typename instrumentation, typename rate_limit, typename ordering >
+class cached_solenoid : private rate_limit::bucket_ref
+{
+protected:
+    cached_solenoid(reg23_read_cache< ordering >& cache_, const field_descriptor& field_)
+        : rate_limit::bucket_ref(rate_limit::bucket_for(cache_.reg(), field_.field_id)), cache(cache_), field(field_)
+    {
+    }
+
+    vacuum set(vacuum val)
+    {
+        const std::uint16_t old_bit =
+            reg23_write_field<instrumentation>(cache_access< ordering >{ cache }, field, (val == vacuum::OFF ? 0 : 1),
+                                               [this]() { return rate_limit::admit(*this); });
+
+        return (old_bit == 0 ? vacuum::OFF : vacuum::ON);
+    }
+
+    vacuum get()
+    {
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        const std::uint16_t bit = field.extract(cache.word());
+
+        instrumentation::read(GPIO_REG23_ID, field.field_id, t0, bit);
+
+        return (bit == 0 ? vacuum::OFF : vacuum::ON);
+    }
+
+private:
+    reg23_read_cache< ordering >&   cache;
+    const field_descriptor          field;
+};
+
+template< typename instrumentation, typename rate_limit, typename ordering >
+class cached_gpio_register_23< solenoid2_t, instrumentation, rate_limit, ordering >
+    : private cached_solenoid< instrumentation, rate_limit, ordering >
+{
+public:
+    explicit cached_gpio_register_23(reg23_read_cache< ordering >& cache_)
+        : cached_solenoid< instrumentation, rate_limit, ordering >(cache_, SOLENOID2_FIELD) {}
+
+    // returns the solenoid's previous state
+    vacuum operator() (vacuum val) { return this->set(val); }
+
+    vacuum operator() ()           { return this->get(); }
+};
+
+template< typename instrumentation, typename rate_limit, typename ordering >
+class cached_gpio_register_23< solenoid3_t, instrumentation, rate_limit, ordering >
+    : private cached_solenoid< instrumentation, rate_limit, ordering >
+{
+public:
+    explicit cached_gpio_register_23(reg23_read_cache< ordering >& cache_)
+        : cached_solenoid< instrumentation, rate_limit, ordering >(cache_, SOLENOID3_FIELD) {}
+
+    // returns the solenoid's previous state
+    vacuum operator() (vacuum val) { return this->set(val); }
+
+    vacuum operator() ()           { return this->get(); }
+};
+
+template< typename instrumentation, typename rate_limit, typename ordering >
+class cached_gpio_register_23< lamp_t, instrumentation, rate_limit, ordering >
+{
+public:
+    explicit cached_gpio_register_23(reg23_read_cache< ordering >& cache_) : cache(cache_) {}
+
+    // returns the lamp's previous power setting. Throws std::range_error
+    std::uint16_t operator() (lamp_t val)
+    {
+        return reg23_write_field<instrumentation>(cache_access< ordering >{ cache }, LAMP_PWR_FIELD, val);
+    }
+
+    std::uint16_t operator() ()
+    {
+        typename instrumentation::stamp_t t0 = instrumentation::begin();
+
+        const std::uint16_t retval = LAMP_PWR_FIELD.extract(cache.word());
+
+        instrumentation::read(GPIO_REG23_ID, LAMP_PWR_FIELD_ID, t0, retval);
+
+        return retval;
+    }
+
+private:
+    reg23_read_cache< ordering >& cache;
+};
+
+#endif // TICK_READ_CACHE_H
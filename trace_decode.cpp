@@ -0,0 +1,51 @@
+// trace_decode.cpp
+//
+// Offline decoder for the trace files written by flush_trace().
+// See register_trace.h
+//
+// usage: trace_decode.exe <trace file>
+//
+// Emits one line of text per recorded access, ordered by time stamp.
+// Time stamps are shown in ticks relative to the earliest record.
+
+#include <algorithm>    //  std::stable_sort
+#include <cstdlib>      //  EXIT_SUCCESS, EXIT_FAILURE
+#include <iostream>     //  std::cout, std::cerr
+#include <vector>       //  std::vector
+
+#include "register_trace.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <trace file>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        trace_file_header hdr {};
+        std::vector<trace_record> records = read_trace(argv[1], hdr);
+
+        // each thread's records are already in order, but the
+        // threads' records were flushed one thread after another
+        std::stable_sort(records.begin(), records.end(),
+                         [](const trace_record& a, const trace_record& b) { return a.tsc < b.tsc; });
+
+        std::cout << "# " << hdr.count << " records, " << hdr.ticks_per_second << " ticks/second" << std::endl;
+
+        const std::uint64_t t0 = records.empty() ? 0 : records.front().tsc;
+        for (const trace_record& rec : records)
+        {
+            format_trace_record(std::cout, rec, t0);
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << argv[0] << ": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+// trace_replay.cpp
+//
+// Replays a trace file of register #23 accesses against a mock register.
+// See trace_replay.h
+//
+// usage: trace_replay.exe [--original-timing] <trace file>
+//
+// Exits with a non-zero status if the replay did not reproduce the trace.
+
+#include <algorithm>    //  std::stable_sort
+#include <chrono>       //  std::chrono::steady_clock
+#include <cstdlib>      //  EXIT_SUCCESS, EXIT_FAILURE
+#include <cstring>      //  std::strcmp
+#include <iostream>     //  std::cout, std::cerr
+#include <vector>       //  std::vector
+
+#include "trace_replay.h"
+
+int main(int argc, char* argv[])
+{
+    replay_timing timing = replay_timing::AS_FAST_AS_POSSIBLE;
+    const char*   path   = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--original-timing") == 0)
+        {
+            timing = replay_timing::ORIGINAL;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+
+    if (path == nullptr)
+    {
+        std::cerr << "usage: " << argv[0] << " [--original-timing] <trace file>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        trace_file_header hdr {};
+        std::vector<trace_record> records = read_trace(path, hdr);
+
+        std::stable_sort(records.begin(), records.end(),
+                         [](const trace_record& a, const trace_record& b) { return a.tsc < b.tsc; });
+
+        static struct genpurpIO_register23 mock_reg23;   // This is masquerading as GPIO register #23
+
+        cycle_counter_hz();     // calibrate the counter before the clock starts
+
+        const auto t0 = std::chrono::steady_clock::now();
+        replay_result result = replay_reg23(records, &mock_reg23, timing, hdr.ticks_per_second);
+        const auto t1 = std::chrono::steady_clock::now();
+
+        const double traced_secs   = records.empty() ? 0.0 : (records.back().tsc - records.front().tsc) / hdr.ticks_per_second;
+        const double replayed_secs = std::chrono::duration<double>(t1 - t0).count();
+
+        std::cout << "replayed " << result.replayed << " records ("
+                  << result.skipped << " skipped) in " << replayed_secs << "s; "
+                  << "the trace spans " << traced_secs << "s" << std::endl;
+
+        for (const replay_mismatch& m : result.first_mismatches)
+        {
+            std::cout << "mismatch at record " << m.index << ": field" << static_cast<unsigned>(m.field_id)
+                      << " expected(" << m.expected << ") encountered(" << m.encountered << ")" << std::endl;
+        }
+
+        if (!result.passed())
+        {
+            std::cout << result.mismatches << " mismatches. REPLAY FAILED!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "replay passed" << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << argv[0] << ": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
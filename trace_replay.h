@@ -0,0 +1,186 @@
+// trace_replay.h
+//
+// Replays a trace of register #23 accesses (see register_trace.h) through
+// the gpio_register_23 functors, checking at each step that the register
+// behaves as it did when the trace was captured.
+//
+// The functors drive whatever register they are handed: a mock register,
+// or a register image within a memory-mapped file.
+//
+// For each recorded access the replay checks:
+//
+//      write, elided write  -- the setter's 'prior to call' value matches
+//                              the recorded old value
+//      read                 -- the getter returns the recorded value
+//      range error          -- the setter still rejects the value
+//
+// and, after the last record, that each field holds the last value the
+// trace wrote to it.
+//
+// Replay runs either as fast as possible, or paced to the trace's original
+// timing. See Note1
+//
+// The records are expected in time stamp order. trace_decode.cpp shows
+// how to sort a trace flushed from several threads.
+
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <stdexcept>    //  std::range_error
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "cycle_counter.h"
+#include "register_trace.h"
+
+enum class replay_timing
+{
+    AS_FAST_AS_POSSIBLE,
+    ORIGINAL
+};
+
+// a recorded access the register did not reproduce
+struct replay_mismatch
+{
+    std::size_t     index;          // index of the record. The trace's size for the final state check
+    std::uint8_t    field_id;
+    std::uint16_t   expected;
+    std::uint16_t   encountered;
+};
+
+struct replay_result
+{
+    std::size_t                  replayed   {0};  // records replayed
+    std::size_t                  skipped    {0};  // records of registers other than #23
+    std::size_t                  mismatches {0};  // total mismatches, including those not kept below
+    std::vector<replay_mismatch> first_mismatches;
+
+    bool passed() const { return mismatches == 0; }
+};
+
+const std::size_t REPLAY_MISMATCHES_KEPT { 16 };
+
+// replay_reg23() -- replays records through functors driving preg.
+//
+//  ticks_per_second is the rate of the clock which stamped the records
+//  (see trace_file_header). It is only used to pace ORIGINAL timing.
+//
+//  Note1:  ORIGINAL timing spins on read_cycle_counter() until each
+//          record's moment comes around. The replay never sleeps, so
+//          it does not overshoot by a scheduler quantum.
+//
+//  Note2:  the functors are constructed before the first record is
+//          replayed, so the replay starts from the state the functors'
+//          ctors leave the register in, as the capture did.
+template< typename instrumentation = no_instrumentation >
+replay_result replay_reg23(
+                              const std::vector<trace_record>&  records,
+                              gpio_reg23_ptr_t                  preg,
+                              replay_timing                     timing           = replay_timing::AS_FAST_AS_POSSIBLE,
+                              double                            ticks_per_second = cycle_counter_hz()
+                          )
+{
+    gpio_register_23< solenoid2_t, instrumentation > vac_solenoid2{ preg };    // Note2
+    gpio_register_23< solenoid3_t, instrumentation > vac_solenoid3{ preg };
+    gpio_register_23< lamp_t,      instrumentation > lamp42{ preg };
+
+    // the value each field should finish with
+    std::uint16_t final_state[3] = { 0, 0, LIGHTS_OUT };
+
+    replay_result result {};
+
+    auto check = [&result](std::size_t index, std::uint8_t field_id, std::uint16_t expected, std::uint16_t encountered)
+    {
+        if (expected != encountered)
+        {
+            if (result.first_mismatches.size() < REPLAY_MISMATCHES_KEPT)
+            {
+                result.first_mismatches.push_back(replay_mismatch{ index, field_id, expected, encountered });
+            }
+            ++result.mismatches;
+        }
+    };
+
+    const double        tick_scale   = cycle_counter_hz() / ticks_per_second;
+    const std::uint64_t replay_start = read_cycle_counter();
+    const std::uint64_t trace_start  = records.empty() ? 0 : records.front().tsc;
+
+    for (std::size_t i = 0; i < records.size(); ++i)
+    {
+        const trace_record& rec = records[i];
+
+        if (rec.space != BOARD_REGISTER_SPACE || rec.reg_id != GPIO_REG23_ID || rec.field_id > LAMP_PWR_FIELD_ID)
+        {
+            ++result.skipped;
+            continue;
+        }
+
+        if (timing == replay_timing::ORIGINAL)      // Note1
+        {
+            const std::uint64_t offset = (rec.tsc > trace_start ? rec.tsc - trace_start : 0);
+            const std::uint64_t due    = replay_start + static_cast<std::uint64_t>(offset * tick_scale);
+            while (read_cycle_counter() < due)
+            {
+                // spin
+            }
+        }
+
+        std::uint16_t encountered = 0;
+
+        switch (rec.kind)
+        {
+            case TRACE_READ:
+                switch (rec.field_id)
+                {
+                    case SOLENOID2_FIELD_ID: encountered = (vac_solenoid2() == vacuum::ON); break;
+                    case SOLENOID3_FIELD_ID: encountered = (vac_solenoid3() == vacuum::ON); break;
+                    default:                 encountered = lamp42();                        break;
+                }
+                check(i, rec.field_id, rec.new_val, encountered);
+                break;
+
+            case TRACE_WRITE:
+            case TRACE_ELIDED_WRITE:
+                switch (rec.field_id)
+                {
+                    case SOLENOID2_FIELD_ID: encountered = (vac_solenoid2(rec.new_val ? vacuum::ON : vacuum::OFF) == vacuum::ON); break;
+                    case SOLENOID3_FIELD_ID: encountered = (vac_solenoid3(rec.new_val ? vacuum::ON : vacuum::OFF) == vacuum::ON); break;
+                    default:                 encountered = lamp42(rec.new_val);                                                    break;
+                }
+                check(i, rec.field_id, rec.old_val, encountered);
+                final_state[rec.field_id] = rec.new_val;
+                break;
+
+            case TRACE_RANGE_ERROR:
+            {
+                std::uint16_t rejected = 0;     // init to 'was not rejected'
+                try
+                {
+                    lamp42(rec.new_val);
+                }
+                catch (std::range_error &)
+                {
+                    rejected = 1;
+                }
+                check(i, rec.field_id, 1, rejected);
+                break;
+            }
+
+            default:
+                ++result.skipped;
+                continue;
+        }
+
+        ++result.replayed;
+    }
+
+    check(records.size(), SOLENOID2_FIELD_ID, final_state[SOLENOID2_FIELD_ID], preg->energize_vac_solenoid2);
+    check(records.size(), SOLENOID3_FIELD_ID, final_state[SOLENOID3_FIELD_ID], preg->energize_vac_solenoid3);
+    check(records.size(), LAMP_PWR_FIELD_ID,  final_state[LAMP_PWR_FIELD_ID],  preg->lamp_pwr);
+
+    return result;
+}
+
+#endif // TRACE_REPLAY_H
@@ -0,0 +1,43 @@
+// typestate_misuse.cpp
+//
+// Not a unit test. The Makefile's typestate_check compiles this file once
+// per MISUSE value (-fsyntax-only): MISUSE=0 is a legal sequence and must
+// compile, every other value is an illegal sequence and must not.
+// See solenoid_typestate.h
+
+#include <utility>      //  std::move
+
+#include "solenoid_typestate.h"
+
+#ifndef MISUSE
+#define MISUSE 0
+#endif
+
+void sequence(gpio_reg23_ptr_t preg)
+{
+    auto off  = solenoid_startup< solenoid2_t >(preg);
+    auto idle = vacuum_pair_startup(preg);
+
+#if MISUSE == 0         // legal: on, off, on, off
+    auto on  = std::move(off).energize();
+    off      = std::move(on).deenergize();
+    off      = std::move(off).energize().deenergize();
+
+    auto two = std::move(idle).energize_solenoid2();
+    idle     = std::move(two).deenergize_solenoid2().energize_solenoid3().deenergize_solenoid3();
+#elif MISUSE == 1       // de-energizing a solenoid which is already off
+    std::move(off).deenergize();
+#elif MISUSE == 2       // energizing a solenoid twice
+    std::move(off).energize().energize();
+#elif MISUSE == 3       // duplicating a state
+    auto copy = off;
+#elif MISUSE == 4       // a transition which doesn't consume its state
+    off.energize();
+#elif MISUSE == 5       // conjuring a state without taking charge of the solenoid
+    solenoid_on< solenoid2_t > on{ preg };
+#elif MISUSE == 6       // energizing solenoid3 while solenoid2 is energized
+    std::move(idle).energize_solenoid2().energize_solenoid3();
+#elif MISUSE == 7       // de-energizing the solenoid which isn't energized
+    std::move(idle).energize_solenoid3().deenergize_solenoid2();
+#endif
+}
@@ -0,0 +1,206 @@
+// ut_board_controller.cpp
+
+#include <atomic>       //  std::atomic
+#include <chrono>       //  std::chrono::milliseconds
+#include <cstdint>      //  std::uint16_t, std::uintptr_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <new>          //  std::bad_alloc
+#include <stdexcept>    //  std::runtime_error
+#include <string>       //  std::string
+#include <thread>       //  std::this_thread::sleep_for
+#include <vector>       //  std::vector
+
+#include "board_controller.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+// an odd number of boards, so the last worker's range is a short one
+const std::size_t UT_BOARDS  { 250 + 3 };
+const std::size_t UT_WORKERS { 4 };
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that each tick works on every board exactly once, through the
+// board's own functors
+int ut00()
+{
+    int something_failed = 0;
+
+    board_controller<> controller{ UT_BOARDS, UT_WORKERS };
+
+    std::vector<std::atomic<int>> visits(UT_BOARDS);
+
+    for (std::uint16_t t = 0; t < 10; ++t)
+    {
+        controller.tick( [&](control_board<>& board, std::size_t i)
+                         {
+                             ++visits[i];
+                             board.lamp42(static_cast<lamp_t>((i + t) % LAMP_OOR));
+                             board.vac_solenoid2((i & 1) ? vacuum::ON : vacuum::OFF);
+                         } );
+    }
+
+    bool all_visited_ten_times = true;
+    bool all_boards_set        = true;
+    for (std::size_t i = 0; i < UT_BOARDS; ++i)
+    {
+        all_visited_ten_times = all_visited_ten_times && visits[i] == 10;
+        all_boards_set        = all_boards_set
+                                && controller.board(i).reg23.lamp_pwr == (i + 9) % LAMP_OOR
+                                && controller.board(i).reg23.energize_vac_solenoid2 == (i & 1);
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that every board was worked on once per tick" },
+                                   all_visited_ten_times );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that each board's functors wrote its own register shadow" },
+                                   all_boards_set );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the number of ticks run" },
+                                   controller.ticks(),
+                                   std::uint64_t { 10 } );
+
+    return something_failed;
+}
+
+// verify that boards sit on cache lines of their own
+int ut01()
+{
+    int something_failed = 0;
+
+    board_controller<> controller{ UT_BOARDS, UT_WORKERS };
+
+    bool aligned = true;
+    for (std::size_t i = 0; i < UT_BOARDS; ++i)
+    {
+        aligned = aligned && reinterpret_cast<std::uintptr_t>(&controller.board(i)) % CACHE_LINE_SIZE == 0;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that every board is cache line aligned" },
+                                   aligned );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a board fits a single cache line" },
+                                   sizeof(control_board<>),
+                                   CACHE_LINE_SIZE );
+
+    return something_failed;
+}
+
+// verify that idle workers steal the chunks of a worker held up by slow boards
+int ut02()
+{
+    int something_failed = 0;
+
+    board_controller<> controller{ UT_BOARDS, UT_WORKERS };
+
+    std::atomic<std::size_t> worked {0};
+
+    // the first worker's boards each take a millisecond
+    controller.tick( [&](control_board<>& board, std::size_t i)
+                     {
+                         if (i < UT_BOARDS / UT_WORKERS)
+                         {
+                             std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                         }
+                         board.lamp42(BRIGHT_LIGHTS);
+                         ++worked;
+                     } );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the slow worker's chunks were stolen" },
+                                   controller.stolen() > 0 );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every board was still worked on exactly once" },
+                                   worked.load(),
+                                   UT_BOARDS );
+
+    return something_failed;
+}
+
+// verify that an exception thrown by a board's work is rethrown by tick(),
+// once every other board has been worked on, and that the controller
+// carries on ticking afterwards
+int ut03()
+{
+    int something_failed = 0;
+
+    board_controller<> controller{ UT_BOARDS, UT_WORKERS };
+
+    std::vector<unsigned char> visited(UT_BOARDS, 0);      // each board's entry is written by one worker only
+
+    bool rethrown = false;
+    try
+    {
+        controller.tick( [&](control_board<>& board, std::size_t i)
+                         {
+                             board.lamp42(i == 42 ? LAMP_OOR : MOOD_LIGHTING);
+                             visited[i] = 1;
+                         } );
+    }
+    catch (std::range_error &)
+    {
+        rethrown = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that board 42's range error was rethrown by tick()" },
+                                   rethrown );
+
+    std::size_t others_visited = 0;
+    for (std::size_t i = 0; i < UT_BOARDS; ++i)
+    {
+        others_visited += (i != 42 && visited[i]);
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every other board was still worked on" },
+                                   others_visited,
+                                   UT_BOARDS - 1 );
+
+    std::atomic<std::size_t> worked {0};
+    controller.tick( [&](control_board<>&, std::size_t) { ++worked; } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the next tick worked on every board" },
+                                   worked.load(),
+                                   UT_BOARDS );
+
+    return something_failed;
+}
+
+// verify that a controller whose workers can't build their boards throws
+// their failure from its constructor, rather than hang or terminate
+int ut04()
+{
+    std::string ut_intent { "verifing that the workers' std::bad_alloc is rethrown by the constructor" };
+
+    bool rethrown = false;
+    try
+    {
+        board_controller<> controller{ std::size_t { 1 } << 60, UT_WORKERS, false };
+    }
+    catch (std::bad_alloc &)
+    {
+        rethrown = true;
+    }
+
+    return ut_report( std::string { __func__ }, ut_intent, rethrown );
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // every board, every tick
+        { "ut01", ut01 },     // cache line alignment
+        { "ut02", ut02 },     // work stealing
+        { "ut03", ut03 },     // exceptions
+        { "ut04", ut04 },     // boards that can't be built
+    } );
+}
@@ -0,0 +1,152 @@
+// ut_board_handle.cpp
+
+#include <cstdint>      //  std::uint16_t, std::uint32_t, std::uintptr_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+
+#include "board_handle.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that a handle's shadow, pointer and counts share a single cache line
+int ut00()
+{
+    int something_failed = 0;
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a board handle is one cache line long" },
+                                   sizeof(board_handle<>),
+                                   CACHE_LINE_SIZE );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a board handle is cache line aligned" },
+                                   alignof(board_handle<>),
+                                   CACHE_LINE_SIZE );
+
+    board_handle_array<> boards{ 100 };
+
+    bool one_line_each = true;
+    for (std::size_t i = 0; i < boards.size(); ++i)
+    {
+        const std::uintptr_t line = reinterpret_cast<std::uintptr_t>(&boards[i]) / CACHE_LINE_SIZE;
+
+        one_line_each = one_line_each
+                        && reinterpret_cast<std::uintptr_t>(&boards[i]) % CACHE_LINE_SIZE == 0
+                        && reinterpret_cast<std::uintptr_t>(&boards[i].reg23) / CACHE_LINE_SIZE == line
+                        && reinterpret_cast<std::uintptr_t>(&boards[i].stats) / CACHE_LINE_SIZE == line;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that each board's shadow and counts lie on the board's own line" },
+                                   one_line_each );
+
+    return something_failed;
+}
+
+// verify that the accessors behave as the functors do, and count accesses
+int ut01()
+{
+    int something_failed = 0;
+
+    board_handle<> board;
+
+    board.lamp42(BRIGHT_LIGHTS);
+    board.lamp42(BRIGHT_LIGHTS);        // elided
+    board.vac_solenoid2(vacuum::ON);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the lamp setter returns the lamp's previous setting" },
+                                   board.lamp42(MOOD_LIGHTING),
+                                   BRIGHT_LIGHTS );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the solenoid3 setter returns the solenoid's previous state" },
+                                   board.vac_solenoid3(vacuum::ON) == vacuum::OFF );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the accessors drove the handle's shadow" },
+                                   board.reg23.lamp_pwr == MOOD_LIGHTING
+                                   && board.reg23.energize_vac_solenoid2 == 1
+                                   && board.reg23.energize_vac_solenoid3 == 1 );
+
+    bool threw = false;
+    try
+    {
+        board.lamp42(LAMP_OOR);
+    }
+    catch (std::range_error &)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that an out of range lamp setting is rejected" },
+                                   threw && board.lamp42() == MOOD_LIGHTING );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the board's count of writes" },
+                                   board.stats.writes,
+                                   std::uint32_t { 4 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the board's count of elided writes" },
+                                   board.stats.elided_writes,
+                                   std::uint32_t { 1 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the board's count of reads" },
+                                   board.stats.reads,
+                                   std::uint32_t { 1 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the board's count of range errors" },
+                                   board.stats.range_errors,
+                                   std::uint32_t { 1 } );
+
+    return something_failed;
+}
+
+// verify that a handle pointed at a register drives that register, and
+// shares it with the functors
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    board_handle<> board{ &mock_reg23 };
+    gpio_register_23< lamp_t > lamp42{ &mock_reg23 };
+
+    board.lamp42(FULL_ILLUMINATION);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the lamp functor sees the handle's write" },
+                                   lamp42(),
+                                   FULL_ILLUMINATION );
+
+    lamp42(VERY_DIM_LIGHTS);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the handle sees the lamp functor's write" },
+                                   board.lamp42(),
+                                   VERY_DIM_LIGHTS );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the handle drives the register, not its shadow" },
+                                   board.reg() == &mock_reg23 && board.reg23.lamp_pwr == LIGHTS_OUT );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // layout
+        { "ut01", ut01 },     // accessors and counts
+        { "ut02", ut02 },     // driving a real register
+    } );
+}
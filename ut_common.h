@@ -0,0 +1,147 @@
+// ut_common.h
+//
+// UT boilerplate shared by the ut_*.cpp unit tests. Every unit test
+// sends its chatter to stdout. ut_harness.h runs the tests, and reports
+// a failed test's chatter; 'make golden_check' compares the chatter
+// against the 'known good' output kept in ./ut_ref_output.
+
+#ifndef UT_COMMON_H
+#define UT_COMMON_H
+
+#include <algorithm>    //  std::find_if
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint32_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <sstream>      //  std::stringstream, std::string
+
+const std::size_t OK_COL_POS   { 95 };  // column position for "ok" text   See note1
+
+// rtrim() -- toss trailing dots from end of a string
+//
+// credits: https://stackoverflow.com/a/217605
+static inline void rtrim(std::string &s)
+{
+    s.erase(std::find_if(s.rbegin(), s.rend(), [](int ch)
+            {
+                return ch != '.';
+            }
+        ).base(), s.end()
+    );
+}
+
+
+// note1:   for readablity I favor formatting UT chatter
+//          in text columns. Generally the first column is
+//          a description of what the given UT is testing and
+//          the second column shows that the test passed (e.g., "ok").
+//
+//          The text emitted when a UT fails is formatted differently
+//          WRT chatter from a successful UT. Put another way,
+//          a UT failure emits text that visually clashes with
+//          the text generated by successful UTs.
+//
+//          The human eyes is a mismatch detector.  This formatting
+//          scheme intends to make a stream of successful UTs
+//          "blend together" and any UT failures to visually clash
+//          with the chatter from sucessful UTs. The visual clash will
+//          cause any UT failure to be instantly noticed.
+//
+//  note4:  As per note1, we are inserting the "ok" text in a
+//          second 'column' on the line.  We're using insert() to
+//          create a "tab stop" effect where the second 'column' is
+//          located.
+//
+//          This column's location follows the chatter about what the
+//          given UT is testing. This "tab stop" is located beyond the
+//          end of the chatter about what a given UT is testing.
+//
+//          string.insert(pos, text) will throw out_of_range if
+//          pos > string length.
+//
+//          Consequently, we are padding the end of the first column's
+//          chatter with dots so as to prevent string.insert()
+//          from throwing "out_of_range" when we insert "ok" at
+//          the second column's "tab stop".
+//
+//          I am padding with dots instead of whitespace because
+//          the row of dots guide the viewer's eyes from the
+//          text to the corresponding "ok"|"FAILED!" indication.
+//
+//
+//
+//==================================================================
+
+
+// ut_report() -- emits the columnized "ok"|"FAILED!" line for a UT.
+//                See note1
+//
+// returns 0 if the UT passed, 1 if it failed
+static inline int ut_report(
+                                const std::string& utid,        // ut17, ut18, etc.
+                                const std::string& intent,      // what UT is attempting to verify
+                                bool passed
+                           )
+{
+    std::string tmp { intent + "......" };                  // note4
+    if (tmp.size() < OK_COL_POS)
+    {
+        tmp.resize(OK_COL_POS, '.');                        // note4
+    }
+    tmp.insert( OK_COL_POS, (passed ? "ok" : "FAILED!") );  // columnize "ok" text   See note1
+    rtrim(tmp);                                              // toss trailing dots
+    std::cout << utid << ": " << tmp << std::endl;
+
+    return (passed ? 0 : 1);
+}
+
+
+// ut_verify() general purpose UT boilerplate for comparing the
+// value a UT obtained with the value it expected.
+//
+// keeping it DRY
+template< typename T >
+int ut_verify(
+                const std::string& utid,        // ut17, ut18, etc.
+                const std::string& intent,      // what UT is attempting to verify
+                const T& actual,                // value the UT obtained
+                const T& expected               // value the UT expected
+             )
+{
+    int something_failed = ut_report(utid, intent, actual == expected);
+
+    if (something_failed)
+    {
+        std::cout << "expected("    << expected << ")" << std::endl;
+        std::cout << "encountered(" << actual   << ")" << std::endl;
+    }
+
+    return something_failed;
+}
+
+
+// ut_random() -- xorshift32: cheap, deterministic pseudo random numbers
+//                for the UTs, so that their chatter matches the golden
+//                output run after run
+static inline std::uint32_t ut_random()
+{
+    static std::uint32_t state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+
+// randomize() -- fills every 16 bit word of images (e.g., a fleet's
+//                register images) with random bits
+template< typename images_t >
+void randomize(images_t& images)
+{
+    for (std::size_t i = 0; i < images.size(); ++i)
+    {
+        images[i] = static_cast<std::uint16_t>(ut_random());
+    }
+}
+
+
+#endif // UT_COMMON_H
@@ -2,11 +2,13 @@
 
 #include <algorithm>    //  std::find_if
 #include <cassert>      //  assert
-#include <cstdlib>      //  exit(), EXIT_FAILURE
 #include <iostream>     //  for sending text to stdout, stderr
 #include <sstream>      //  std::stringstream, std::string
+#include <type_traits>  //  std::integral_constant, std::true_type, std::false_type, std::void_t
 
 #include "control_board_gpio_reg23.h"
+#include "ut_common.h"
+#include "ut_harness.h"
 
 // ============ helper debug functions ================================
 void print_vac_state( std::uint16_t val)
@@ -68,60 +70,6 @@ int deliberately_throw_exception()
 
 // ============ end of helper debug functions ================================
 
-const std::size_t OK_COL_POS   { 95 };  // column position for "ok" text   See note1
-
-// rtrim() -- toss trailing dots from end of a string
-//
-// credits: https://stackoverflow.com/a/217605
-static inline void rtrim(std::string &s)
-{
-    s.erase(std::find_if(s.rbegin(), s.rend(), [](int ch)
-            {
-                return ch != '.';
-            }
-        ).base(), s.end()
-    );
-}
-
-
-// note1:   for readablity I favor formatting UT chatter
-//          in text columns. Generally the first column is
-//          a description of what the given UT is testing and
-//          the second column shows that the test passed (e.g., "ok").
-//
-//          The text emitted when a UT fails is formatted differently
-//          WRT chatter from a successful UT. Put another way,
-//          a UT failure emits text that visually clashes with
-//          the text generated by successful UTs.
-//
-//          The human eyes is a mismatch detector.  This formatting
-//          scheme intends to make a stream of successful UTs
-//          "blend together" and any UT failures to visually clash
-//          with the chatter from sucessful UTs. The visual clash will
-//          cause any UT failure to be instantly noticed.
-//
-//  note4:  As per note1, we are inserting the "ok" text in a
-//          second 'column' on the line.  We're using insert() to
-//          create a "tab stop" effect where the second 'column' is
-//          located.
-//
-//          This column's location follows the chatter about what the
-//          given UT is testing. This "tab stop" is located beyond the
-//          end of the chatter about what a given UT is testing.
-//
-//          string.insert(pos, text) will throw out_of_range if
-//          pos > string length.
-//
-//          Consequently, we are padding the end of the first column's
-//          chatter with dots so as to prevent string.insert()
-//          from throwing "out_of_range" when we insert "ok" at
-//          the second column's "tab stop".
-//
-//          I am padding with dots instead of whitespace because
-//          the row of dots guide the viewer's eyes from the
-//          text to the corresponding "ok"|"FAILED!" indication.
-//
-//
 //==================================================================
 //
 //  Commentary about this "GPIO register #23":
@@ -241,6 +189,90 @@ int ut_verify_lamp_state(
     return something_failed;
 }
 
+//======================= Compile-time Unit Tests ===============================
+//
+// The functors run at compile time against a constexpr register image (see
+// Note8 of control_board_gpio_reg23.h), so their deterministic behavior is
+// verified by the static_asserts below: a failure breaks the build before
+// any test runs. The runtime UTs further down drive the same functors
+// through a register in memory.
+
+template< typename field >
+using ct_functor = gpio_register_23< field, no_instrumentation, no_rate_limit, reg23_constexpr_ordering >;
+
+// the register image's raw word
+constexpr std::uint16_t ct_word(const genpurpIO_register23& reg)
+{
+    return reg23_constexpr_ordering::load<std::uint16_t>(&reg);
+}
+
+// ut00..ut02: the ctors put a register holding all ones in its startup state
+constexpr genpurpIO_register23 ct_after_startup()
+{
+    genpurpIO_register23 reg {};
+    reg23_constexpr_ordering::store<std::uint16_t>(&reg, 0xFFFF);
+
+    ct_functor< solenoid2_t > vac_solenoid2{ &reg };
+    ct_functor< solenoid3_t > vac_solenoid3{ &reg };
+    ct_functor< lamp_t >      lamp42{ &reg };
+
+    return reg;
+}
+
+static_assert(ct_after_startup().energize_vac_solenoid2 == 0,  "ut00: the ctor sets solenoid2 to vacuum:OFF");
+static_assert(ct_after_startup().energize_vac_solenoid3 == 0,  "ut01: the ctor sets solenoid3 to vacuum:OFF");
+static_assert(ct_after_startup().lamp_pwr == LIGHTS_OUT,       "ut02: the ctor sets the lamp to LIGHTS_OUT");
+
+// ut03..ut06: a solenoid's setter returns its previous state, and its
+// getter returns the new one. Returns the register's final word
+template< typename field >
+constexpr std::uint16_t ct_cycle_solenoid(vacuum final_state)
+{
+    genpurpIO_register23 reg {};
+    ct_functor< field > vac_solenoid{ &reg };
+
+    const bool ok = vac_solenoid(vacuum::ON)  == vacuum::OFF && vac_solenoid() == vacuum::ON
+                 && vac_solenoid(vacuum::ON)  == vacuum::ON                                     // elided
+                 && vac_solenoid(vacuum::OFF) == vacuum::ON  && vac_solenoid() == vacuum::OFF
+                 && vac_solenoid(final_state) == vacuum::OFF && vac_solenoid() == final_state;
+
+    return ok ? ct_word(reg) : 0xFFFF;
+}
+
+static_assert(ct_cycle_solenoid< solenoid2_t >(vacuum::ON)  == 0x0001, "ut03: solenoid2's functor energizes solenoid2, and only it");
+static_assert(ct_cycle_solenoid< solenoid3_t >(vacuum::ON)  == 0x0002, "ut04: solenoid3's functor energizes solenoid3, and only it");
+static_assert(ct_cycle_solenoid< solenoid2_t >(vacuum::OFF) == 0x0000, "ut05: solenoid2's functor de-energizes solenoid2");
+static_assert(ct_cycle_solenoid< solenoid3_t >(vacuum::OFF) == 0x0000, "ut06: solenoid3's functor de-energizes solenoid3");
+
+// ut07..ut11: the lamp's setter returns the previous power setting, and its
+// getter returns the new one. Returns the register's final word
+constexpr std::uint16_t ct_set_lamp(lamp_t level)
+{
+    genpurpIO_register23 reg {};
+    ct_functor< lamp_t > lamp42{ &reg };
+
+    const bool ok = lamp42(level) == LIGHTS_OUT && lamp42() == level;
+
+    return ok ? ct_word(reg) : 0xFFFF;
+}
+
+static_assert(ct_set_lamp(FULL_ILLUMINATION) == (FULL_ILLUMINATION << 2), "ut07: the lamp's functor sets max power");
+static_assert(ct_set_lamp(BRIGHT_LIGHTS)     == (BRIGHT_LIGHTS     << 2), "ut08: walking 1's: lamp power 100");
+static_assert(ct_set_lamp(MOOD_LIGHTING)     == (MOOD_LIGHTING     << 2), "ut09: walking 1's: lamp power 010");
+static_assert(ct_set_lamp(VERY_DIM_LIGHTS)   == (VERY_DIM_LIGHTS   << 2), "ut10: walking 1's: lamp power 001");
+static_assert(ct_set_lamp(LIGHTS_OUT)        == 0,                        "ut11: the lamp's functor removes power");
+
+// ut12: an out of range lamp setting throws, so it is not a constant expression
+template< lamp_t LEVEL, typename = void >
+struct ct_lamp_setting_is_constant : std::false_type {};
+
+template< lamp_t LEVEL >
+struct ct_lamp_setting_is_constant< LEVEL, std::void_t< std::integral_constant< std::uint16_t, ct_set_lamp(LEVEL) > > >
+    : std::true_type {};
+
+static_assert( ct_lamp_setting_is_constant< FULL_ILLUMINATION >::value, "ut12: the highest lamp setting is in range");
+static_assert(!ct_lamp_setting_is_constant< LAMP_OOR >::value,          "ut12: LAMP_OOR is out of range");
+
 //======================= Unit Tests Begin ======================================
 //
 // verify that the ctor set solenoid2 to vacuum:OFF
@@ -853,78 +885,98 @@ int ut12()
 
     return something_failed;
 }
+
+// verify that the field descriptors agree with the bit-field's layout
+int ut13()
+{
+    int something_failed = 0;
+
+    //------------------------------------------------------------
+    //
+    // setup for unit test
+    //
+    static struct genpurpIO_register23 reg23_image;
+
+    gpio_register_23< solenoid2_t > vac_solenoid2{ &reg23_image };
+    gpio_register_23< solenoid3_t > vac_solenoid3{ &reg23_image };
+    gpio_register_23< lamp_t >      lamp42{ &reg23_image };
+
+    //------------------------------------------------------------
+    //
+    // conduct unit test
+    //
+    vac_solenoid2(vacuum::ON);
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing SOLENOID2_FIELD's mask" },
+                                   reg23_to_word(reg23_image),
+                                   SOLENOID2_FIELD.mask() );
+    vac_solenoid2(vacuum::OFF);
+
+    vac_solenoid3(vacuum::ON);
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing SOLENOID3_FIELD's mask" },
+                                   reg23_to_word(reg23_image),
+                                   SOLENOID3_FIELD.mask() );
+    vac_solenoid3(vacuum::OFF);
+
+    lamp42(FULL_ILLUMINATION);
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing LAMP_PWR_FIELD's mask" },
+                                   reg23_to_word(reg23_image),
+                                   LAMP_PWR_FIELD.mask() );
+
+    lamp42(MOOD_LIGHTING);
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that LAMP_PWR_FIELD extracts the lamp's power setting" },
+                                   LAMP_PWR_FIELD.extract(reg23_to_word(reg23_image)),
+                                   MOOD_LIGHTING );
+
+    return something_failed;
+}
 //-----------------------------------------------------
 
 int main( int argc, char * argv[] )
 {
-    bool something_failed = false;
-
-    try
-    {
-        //something_failed += deliberately_throw_exception();
+    return ut_run( argc, argv, {
+        //{ "deliberately_throw_exception", deliberately_throw_exception },
         //
         //-------------------------------------------------------------
         //
         // UT ctor
         //
-        something_failed += ut00();     // verify that the ctor sets solenoid2 to vacuum:OFF
-        something_failed += ut01();     // verify that the ctor sets solenoid3 to vacuum:OFF
-        something_failed += ut02();     // verify that the ctor sets lamp to LIGHTS_OUT
+        { "ut00", ut00 },     // verify that the ctor sets solenoid2 to vacuum:OFF
+        { "ut01", ut01 },     // verify that the ctor sets solenoid3 to vacuum:OFF
+        { "ut02", ut02 },     // verify that the ctor sets lamp to LIGHTS_OUT
         //
         //-------------------------------------------------------------
         //
         // UT solenoid functors
         //
-        something_failed += ut03();     // verify solenoid2's functor
-        something_failed += ut04();     // verify solenoid3's functor
-        something_failed += ut05();     // verify solenoid2's functor
-        something_failed += ut06();     // verify solenoid3's functor
+        { "ut03", ut03 },     // verify solenoid2's functor
+        { "ut04", ut04 },     // verify solenoid3's functor
+        { "ut05", ut05 },     // verify solenoid2's functor
+        { "ut06", ut06 },     // verify solenoid3's functor
         //
         //-------------------------------------------------------------
         //
         // Floodlamp functors
         //
-        something_failed += ut07();     // verify lamp's functor can set lamp to max power
-        something_failed += ut08();     // walking 1's testing: lamp's power-level == 100
-        something_failed += ut09();     // walking 1's testing: lamp's power-level == 010
-        something_failed += ut10();     // walking 1's testing: lamp's power-level == 001
-        something_failed += ut11();     // verify lamp's functor remove power from lamp
+        { "ut07", ut07 },     // verify lamp's functor can set lamp to max power
+        { "ut08", ut08 },     // walking 1's testing: lamp's power-level == 100
+        { "ut09", ut09 },     // walking 1's testing: lamp's power-level == 010
+        { "ut10", ut10 },     // walking 1's testing: lamp's power-level == 001
+        { "ut11", ut11 },     // verify lamp's functor remove power from lamp
         //
         //-------------------------------------------------------------
         //
         // Floodlamp Out of range exception
         //
-        something_failed += ut12();     // Floodlamp Out of range exception
-    }
-    catch (std::exception& e)
-    {
-        std::cerr << std::endl << "UNEXPECTED exception thrown: " << e.what() << std::endl << std::endl; // sent to console
-        std::cout << std::endl << "UNEXPECTED exception thrown: " << e.what() << std::endl << std::endl; // sent to bitfield_ut_output.txt
-        something_failed = 1;
-    }
-
-    if ( something_failed )
-    {
-        // note3:   One of the desired affects of a UT failure to
-        //          "break the build". In this way UT failures
-        //          cannot be ignored.
+        { "ut12", ut12 },     // Floodlamp Out of range exception
         //
-        //          make aborts processing a Makefile wherever one of the
-        //          Makefile's recipes terminates with non-zero exit status.
+        //-------------------------------------------------------------
         //
-        //          Consequently, this app must terminate with a
-        //          non-zero exit status when any unit if its tests fail
-        //          so as to break the build on UT failure.
+        // raw register word layout
         //
-        std::cerr << std::endl << "UNIT TEST FAILED!" << std::endl;  // sent to the console
-        std::cout << std::endl << "UNIT TEST FAILED!" << std::endl;  // sent to bitfield_ut_output.txt
-        exit(EXIT_FAILURE);   // note3
-    }
-    else
-    {
-        std::cout << std::endl << "UNIT TEST passed!" << std::endl;
-    }
-
-    return 0;
+        { "ut13", ut13 },     // field descriptors agree with the bit-field
+    } );
 }
-
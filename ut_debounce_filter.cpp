@@ -0,0 +1,167 @@
+// ut_debounce_filter.cpp
+
+#include <cstdint>      //  std::uint16_t, std::uint32_t
+#include <deque>        //  std::deque
+#include <iostream>     //  for sending text to stdout, stderr
+#include <string>       //  std::string
+
+#include "control_board_gpio_reg23.h"
+#include "debounce_filter.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+// a noisy readback word: each bit mostly holds a slowly changing level,
+// with the occasional glitch
+std::uint16_t noisy_sample(int t)
+{
+    const std::uint16_t level  = static_cast<std::uint16_t>(((t / 37) & 1) ? 0x5A5A : 0x0FF0);
+    const std::uint16_t glitch = static_cast<std::uint16_t>(ut_random() & ut_random() & ut_random());
+
+    return level ^ glitch;
+}
+
+//======================= Unit Tests Begin ======================================
+//
+// verify the bit-sliced majority vote against a bit-at-a-time reference
+int ut00()
+{
+    int something_failed = 0;
+
+    debounce_filter< majority_vote<5> > filter;
+    std::deque<std::uint16_t>           window(5, 0);
+
+    bool agrees = true;
+    for (int t = 0; t < 10000; ++t)
+    {
+        const std::uint16_t word = noisy_sample(t);
+
+        window.pop_front();
+        window.push_back(word);
+
+        std::uint16_t expected = 0;
+        for (unsigned bit = 0; bit < 16; ++bit)
+        {
+            unsigned ones = 0;
+            for (std::uint16_t w : window)
+            {
+                ones += (w >> bit) & 1u;
+            }
+            if (ones >= 3)
+            {
+                expected |= static_cast<std::uint16_t>(1u << bit);
+            }
+        }
+
+        agrees = agrees && filter.sample(word) == expected;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the majority of 5 against a per-bit reference, over 10000 samples" },
+                                   agrees );
+
+    return something_failed;
+}
+
+// verify the stable-for-k filter against a bit-at-a-time reference
+int ut01()
+{
+    int something_failed = 0;
+
+    debounce_filter< stable_for<3> > filter;
+    std::deque<std::uint16_t>        window(3, 0);
+    std::uint16_t                    expected = 0;
+
+    bool agrees = true;
+    for (int t = 0; t < 10000; ++t)
+    {
+        const std::uint16_t word = noisy_sample(t);
+
+        window.pop_front();
+        window.push_back(word);
+
+        for (unsigned bit = 0; bit < 16; ++bit)
+        {
+            unsigned ones = 0;
+            for (std::uint16_t w : window)
+            {
+                ones += (w >> bit) & 1u;
+            }
+            if (ones == 3)
+            {
+                expected |= static_cast<std::uint16_t>(1u << bit);
+            }
+            else if (ones == 0)
+            {
+                expected &= static_cast<std::uint16_t>(~(1u << bit));
+            }
+        }
+
+        agrees = agrees && filter.sample(word) == expected;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing stable for 3 samples against a per-bit reference, over 10000 samples" },
+                                   agrees );
+
+    return something_failed;
+}
+
+// verify that the debounced getters ignore a glitch but follow a real change
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< solenoid2_t > vac_solenoid2{ &mock_reg23 };
+    gpio_register_23< lamp_t >      lamp42{ &mock_reg23 };
+
+    debounce_filter< stable_for<3> > filter;
+
+    debounced_gpio_register_23< solenoid2_t, stable_for<3> > debounced_solenoid2{ filter };
+    debounced_gpio_register_23< lamp_t,      stable_for<3> > debounced_lamp42{ filter };
+
+    const volatile std::uint16_t* word = reinterpret_cast<const volatile std::uint16_t*>(&mock_reg23);
+
+    vac_solenoid2(vacuum::ON);          // a one sample glitch
+    filter.sample(word);
+    vac_solenoid2(vacuum::OFF);
+    filter.sample(word);
+    filter.sample(word);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a one sample glitch of solenoid2 was filtered out" },
+                                   debounced_solenoid2() == vacuum::OFF );
+
+    vac_solenoid2(vacuum::ON);
+    lamp42(BRIGHT_LIGHTS);
+    filter.sample(word);
+    filter.sample(word);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that solenoid2 is not yet debounced after two samples" },
+                                   debounced_solenoid2() == vacuum::OFF );
+
+    filter.sample(word);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that solenoid2 is debounced on after three samples" },
+                                   debounced_solenoid2() == vacuum::ON );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the lamp's debounced power setting" },
+                                   debounced_lamp42(),
+                                   BRIGHT_LIGHTS );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // majority vote
+        { "ut01", ut01 },     // stable for k samples
+        { "ut02", ut02 },     // debounced getters
+    } );
+}
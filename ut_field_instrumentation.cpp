@@ -0,0 +1,192 @@
+// ut_field_instrumentation.cpp
+
+#include <cstdint>      //  std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+#include <thread>       //  std::thread
+
+#include "control_board_gpio_reg23.h"
+#include "field_instrumentation.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+//==================================================================
+//
+//  Each UT uses its own mock register, so that the counts a UT
+//  observes are not disturbed by any other UT.
+//
+//  The counters are cumulative, so each UT compares the counts
+//  before and after the accesses it makes.
+//
+//==================================================================
+
+typedef gpio_register_23< solenoid2_t, counting_instrumentation >   counted_solenoid2_t;
+typedef gpio_register_23< solenoid3_t, counting_instrumentation >   counted_solenoid3_t;
+typedef gpio_register_23< lamp_t,      counting_instrumentation >   counted_lamp_t;
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that getter calls are counted as reads
+int ut00()
+{
+    static struct genpurpIO_register23 mock_reg23;
+
+    counted_solenoid2_t vac_solenoid2{ &mock_reg23 };
+
+    const field_stats before = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID2_FIELD_ID);
+
+    vac_solenoid2();
+    vac_solenoid2();
+    vac_solenoid2();
+
+    const field_stats after = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID2_FIELD_ID);
+
+    return ut_verify( std::string { __func__ },
+                      std::string { "verifing that solenoid2's getter calls are counted as reads" },
+                      after.reads - before.reads,
+                      std::uint64_t { 3 } );
+}
+
+// verify that setter calls which change the field are counted as writes
+// and the ones which leave the field unchanged as elided writes
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    counted_solenoid3_t vac_solenoid3{ &mock_reg23 };
+
+    const field_stats before = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID3_FIELD_ID);
+
+    vac_solenoid3(vacuum::ON);      // write
+    vac_solenoid3(vacuum::ON);      // elided, already ON
+    vac_solenoid3(vacuum::OFF);     // write
+
+    const field_stats after = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID3_FIELD_ID);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that solenoid3's setter calls are counted as writes" },
+                                   after.writes - before.writes,
+                                   std::uint64_t { 2 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that solenoid3's redundant setter calls are counted as elided writes" },
+                                   after.elided_writes - before.elided_writes,
+                                   std::uint64_t { 1 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the elided write left solenoid3 as it was" },
+                                   static_cast<std::uint64_t>(mock_reg23.energize_vac_solenoid3),
+                                   std::uint64_t { 0 } );
+
+    return something_failed;
+}
+
+// verify that the lamp's rejected power settings are counted as range errors
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    counted_lamp_t lamp42{ &mock_reg23 };
+
+    const field_stats before = counting_instrumentation::this_thread(GPIO_REG23_ID, LAMP_PWR_FIELD_ID);
+
+    lamp42(MOOD_LIGHTING);
+    lamp42(MOOD_LIGHTING);
+
+    try
+    {
+        lamp42(LAMP_OOR);
+    }
+    catch (std::range_error &)
+    {
+        // expected. The UT checks that the range error was counted
+    }
+
+    const field_stats after = counting_instrumentation::this_thread(GPIO_REG23_ID, LAMP_PWR_FIELD_ID);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the lamp's out of range settings are counted as range errors" },
+                                   after.range_errors - before.range_errors,
+                                   std::uint64_t { 1 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the lamp's writes are counted" },
+                                   after.writes - before.writes,
+                                   std::uint64_t { 1 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the lamp's elided writes are counted" },
+                                   after.elided_writes - before.elided_writes,
+                                   std::uint64_t { 1 } );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that ticks spent in the lamp's functors are counted" },
+                                   after.ticks > before.ticks );
+
+    return something_failed;
+}
+
+// verify that the counts made by another thread are kept apart from
+// this thread's counts, yet still show up in the all-thread totals
+// after the other thread exits
+int ut03()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    const field_stats mine_before = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID2_FIELD_ID);
+    const field_stats all_before  = counting_instrumentation::all_threads(GPIO_REG23_ID, SOLENOID2_FIELD_ID);
+
+    std::thread worker( []()
+                        {
+                            counted_solenoid2_t vac_solenoid2{ &mock_reg23 };
+
+                            for (int i = 0; i < 10; ++i)
+                            {
+                                vac_solenoid2();
+                            }
+                        } );
+    worker.join();
+
+    const field_stats mine_after = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID2_FIELD_ID);
+    const field_stats all_after  = counting_instrumentation::all_threads(GPIO_REG23_ID, SOLENOID2_FIELD_ID);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that another thread's reads are not counted as this thread's" },
+                                   mine_after.reads - mine_before.reads,
+                                   std::uint64_t { 0 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that an exited thread's reads are kept in the totals" },
+                                   all_after.reads - all_before.reads,
+                                   std::uint64_t { 10 } );
+
+    return something_failed;
+}
+
+// verify that the default policy adds nothing to a functor
+int ut04()
+{
+    return ut_verify( std::string { __func__ },
+                      std::string { "verifing that an uninstrumented functor is no larger than its pointer" },
+                      sizeof(gpio_register_23< lamp_t >),
+                      sizeof(gpio_reg23_ptr_t) );
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // reads are counted
+        { "ut01", ut01 },     // writes and elided writes are counted
+        { "ut02", ut02 },     // range errors and ticks are counted
+        { "ut03", ut03 },     // per-thread counters, all-thread totals
+        { "ut04", ut04 },     // no_instrumentation costs nothing
+    } );
+}
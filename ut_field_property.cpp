@@ -0,0 +1,375 @@
+// ut_field_property.cpp
+
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint8_t, std::uint16_t, std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <string>       //  std::string, std::to_string
+#include <utility>      //  std::index_sequence, std::make_index_sequence
+#include <vector>       //  std::vector
+
+#include "board_handle.h"
+#include "control_board_gpio_reg23.h"
+#include "field_property.h"
+#include "ic_register_driver.h"
+#include "mcp23017.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+// the random check's length, in field writes
+const std::uint64_t RANDOM_ITERATIONS { 1000000 };
+
+//-------------------- register #23 --------------------
+//
+// the fields' footprints, as g++ lays out the bitfield struct: each field
+// set to its largest value in an otherwise clear register. This oracle is
+// independent of the field descriptors the functors use. Note2 of field_property.h
+std::uint16_t solenoid2_footprint()
+{
+    genpurpIO_register23 reg = word_to_reg23(0);
+    reg.energize_vac_solenoid2 = 1;
+    return reg23_to_word(reg);
+}
+
+std::uint16_t solenoid3_footprint()
+{
+    genpurpIO_register23 reg = word_to_reg23(0);
+    reg.energize_vac_solenoid3 = 1;
+    return reg23_to_word(reg);
+}
+
+std::uint16_t lamp_footprint()
+{
+    genpurpIO_register23 reg = word_to_reg23(0);
+    reg.lamp_pwr = 7;
+    return reg23_to_word(reg);
+}
+
+// the functors, attached to a register holding regs[0]. Note7 of control_board_gpio_reg23.h
+template< typename field >
+void functor_set_solenoid(std::uint16_t* regs, std::uint16_t val)
+{
+    genpurpIO_register23 reg = word_to_reg23(regs[0]);
+    gpio_register_23< field >{ &reg, REG23_ATTACH }(val == 0 ? vacuum::OFF : vacuum::ON);
+    regs[0] = reg23_to_word(reg);
+}
+
+template< typename field >
+std::uint16_t functor_get_solenoid(std::uint16_t* regs)
+{
+    genpurpIO_register23 reg = word_to_reg23(regs[0]);
+    return (gpio_register_23< field >{ &reg, REG23_ATTACH }() == vacuum::ON ? 1 : 0);
+}
+
+void functor_set_lamp(std::uint16_t* regs, std::uint16_t val)
+{
+    genpurpIO_register23 reg = word_to_reg23(regs[0]);
+    gpio_register_23< lamp_t >{ &reg, REG23_ATTACH }(val);
+    regs[0] = reg23_to_word(reg);
+}
+
+std::uint16_t functor_get_lamp(std::uint16_t* regs)
+{
+    genpurpIO_register23 reg = word_to_reg23(regs[0]);
+    return gpio_register_23< lamp_t >{ &reg, REG23_ATTACH }();
+}
+
+// a board handle pointed at a register holding regs[0]
+genpurpIO_register23 handle_reg23;
+board_handle<>       handle{ &handle_reg23 };
+
+void handle_set_solenoid2(std::uint16_t* regs, std::uint16_t val)
+{
+    handle_reg23 = word_to_reg23(regs[0]);
+    handle.vac_solenoid2(val == 0 ? vacuum::OFF : vacuum::ON);
+    regs[0] = reg23_to_word(handle_reg23);
+}
+
+std::uint16_t handle_get_solenoid2(std::uint16_t* regs)
+{
+    handle_reg23 = word_to_reg23(regs[0]);
+    return (handle.vac_solenoid2() == vacuum::ON ? 1 : 0);
+}
+
+void handle_set_solenoid3(std::uint16_t* regs, std::uint16_t val)
+{
+    handle_reg23 = word_to_reg23(regs[0]);
+    handle.vac_solenoid3(val == 0 ? vacuum::OFF : vacuum::ON);
+    regs[0] = reg23_to_word(handle_reg23);
+}
+
+std::uint16_t handle_get_solenoid3(std::uint16_t* regs)
+{
+    handle_reg23 = word_to_reg23(regs[0]);
+    return (handle.vac_solenoid3() == vacuum::ON ? 1 : 0);
+}
+
+void handle_set_lamp(std::uint16_t* regs, std::uint16_t val)
+{
+    handle_reg23 = word_to_reg23(regs[0]);
+    handle.lamp42(val);
+    regs[0] = reg23_to_word(handle_reg23);
+}
+
+std::uint16_t handle_get_lamp(std::uint16_t* regs)
+{
+    handle_reg23 = word_to_reg23(regs[0]);
+    return handle.lamp42();
+}
+
+// a lamp descriptor with a mask bug: one bit too wide, so it reaches into the filler
+constexpr field_descriptor MISMASKED_LAMP_PWR_FIELD { GPIO_REG23_ID, LAMP_PWR_FIELD_ID, 2, 4 };
+
+void mismasked_set_lamp(std::uint16_t* regs, std::uint16_t val)
+{
+    regs[0] = MISMASKED_LAMP_PWR_FIELD.insert(regs[0], val);
+}
+
+std::uint16_t mismasked_get_lamp(std::uint16_t* regs)
+{
+    return MISMASKED_LAMP_PWR_FIELD.extract(regs[0]);
+}
+
+// the number of writes the exhaustive check makes of register #23's three fields
+const std::uint64_t REG23_EXHAUSTIVE_CHECKS { 65536 * (2 + 2 + 8) + 65536 };
+
+//-------------------- MCP23017 --------------------
+//
+// the field tag's functors, on the register file regs
+template< typename field >
+void ic_set(ic_reg_t* regs, std::uint16_t val)
+{
+    ic_field_functor< field >{ mmio_window{ regs } }(val);
+}
+
+template< typename field >
+std::uint16_t ic_get(ic_reg_t* regs)
+{
+    return ic_field_functor< field >{ mmio_window{ regs } }();
+}
+
+// a field tag, with its register and bits as the datasheet has them. Note2 of field_property.h
+template< typename field >
+field_under_test<ic_reg_t> mcp23017_field(const std::string& name, std::uint8_t addr, unsigned mask)
+{
+    return field_under_test<ic_reg_t>{ name, addr, static_cast<ic_reg_t>(mask), ic_set<field>, ic_get<field>, true };
+}
+
+// a per-pin field family's 16 fields: bit PIN of the port A register at
+// port_a_addr, and of its port B twin at the next address (Note1 of mcp23017.h)
+template< template< mcp23017_port, std::uint8_t > class family, std::size_t... PIN >
+void add_pins(std::vector< field_under_test<ic_reg_t> >& fields, const std::string& name, std::uint8_t port_a_addr,
+              std::index_sequence<PIN...>)
+{
+    (fields.push_back(mcp23017_field< family< mcp23017_port::A, PIN > >(name + "<A," + std::to_string(PIN) + ">",
+                                                                      port_a_addr, 1u << PIN)), ...);
+    (fields.push_back(mcp23017_field< family< mcp23017_port::B, PIN > >(name + "<B," + std::to_string(PIN) + ">",
+                                                                      static_cast<std::uint8_t>(port_a_addr + 1), 1u << PIN)), ...);
+}
+
+// every writable MCP23017 field
+std::vector< field_under_test<ic_reg_t> > mcp23017_fields()
+{
+    std::vector< field_under_test<ic_reg_t> > fields;
+
+    add_pins< mcp23017_direction >(fields, "mcp23017_direction", 0x00, std::make_index_sequence<8>{});
+    add_pins< mcp23017_polarity  >(fields, "mcp23017_polarity",  0x02, std::make_index_sequence<8>{});
+    add_pins< mcp23017_pullup    >(fields, "mcp23017_pullup",    0x0C, std::make_index_sequence<8>{});
+    add_pins< mcp23017_output    >(fields, "mcp23017_output",    0x14, std::make_index_sequence<8>{});
+
+    fields.push_back(mcp23017_field< mcp23017_port_direction< mcp23017_port::A > >("mcp23017_port_direction<A>", 0x00, 0xFF));
+    fields.push_back(mcp23017_field< mcp23017_port_direction< mcp23017_port::B > >("mcp23017_port_direction<B>", 0x01, 0xFF));
+    fields.push_back(mcp23017_field< mcp23017_port_output< mcp23017_port::A > >("mcp23017_port_output<A>", 0x14, 0xFF));
+    fields.push_back(mcp23017_field< mcp23017_port_output< mcp23017_port::B > >("mcp23017_port_output<B>", 0x15, 0xFF));
+
+    fields.push_back(mcp23017_field< mcp23017_iocon_mirror_t  >("mcp23017_iocon_mirror_t",  0x0A, 0x40));
+    fields.push_back(mcp23017_field< mcp23017_iocon_seqop_t   >("mcp23017_iocon_seqop_t",   0x0A, 0x20));
+    fields.push_back(mcp23017_field< mcp23017_iocon_disslw_t  >("mcp23017_iocon_disslw_t",  0x0A, 0x10));
+    fields.push_back(mcp23017_field< mcp23017_iocon_odr_t     >("mcp23017_iocon_odr_t",     0x0A, 0x04));
+    fields.push_back(mcp23017_field< mcp23017_iocon_intpol_t  >("mcp23017_iocon_intpol_t",  0x0A, 0x02));
+
+    return fields;
+}
+
+// the number of writes the exhaustive check makes of every MCP23017 field:
+// per register word, 64 one bit fields take 2 values, 4 port wide fields
+// 256, and 5 IOCON bits 2, and each field one out of range value
+const std::uint64_t MCP23017_EXHAUSTIVE_CHECKS { 256 * (64 * 2 + 4 * 256 + 5 * 2 + 73) };
+
+// a field tag with the bug a generated header might have: port B's output
+// pin 3, placed in port A's register
+typedef ic_field< MCP23017_OLATA, 3, 1 > misplaced_output_b3_t;
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that register #23's functors never disturb a neighbouring field,
+// nor the filler, from any register word
+int ut00()
+{
+    int something_failed = 0;
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the named fields leave an 11 bit filler" },
+                                   __builtin_popcount(0xFFFFu & ~(solenoid2_footprint() | solenoid3_footprint() | lamp_footprint())),
+                                   11 );
+
+    const std::vector< field_under_test<std::uint16_t> > fields {
+        { "vac_solenoid2", 0, solenoid2_footprint(), functor_set_solenoid<solenoid2_t>, functor_get_solenoid<solenoid2_t>, false },
+        { "vac_solenoid3", 0, solenoid3_footprint(), functor_set_solenoid<solenoid3_t>, functor_get_solenoid<solenoid3_t>, false },
+        { "lamp42",        0, lamp_footprint(),      functor_set_lamp,                  functor_get_lamp,                  true  },
+    };
+
+    const field_property_result r = check_fields_exhaustively(fields, 1, field_property_seed(0x23));
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the functors' field isolation from every register word" },
+                                   r.passed );
+    if (!r.passed)
+    {
+        std::cout << r.counterexample;
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every word was checked with every value" },
+                                   r.checks,
+                                   REG23_EXHAUSTIVE_CHECKS );
+
+    return something_failed;
+}
+
+// verify that a board handle's accessors never disturb a neighbouring
+// field, nor the filler, from any register word
+int ut01()
+{
+    int something_failed = 0;
+
+    const std::vector< field_under_test<std::uint16_t> > fields {
+        { "vac_solenoid2", 0, solenoid2_footprint(), handle_set_solenoid2, handle_get_solenoid2, false },
+        { "vac_solenoid3", 0, solenoid3_footprint(), handle_set_solenoid3, handle_get_solenoid3, false },
+        { "lamp42",        0, lamp_footprint(),      handle_set_lamp,      handle_get_lamp,      true  },
+    };
+
+    const field_property_result r = check_fields_exhaustively(fields, 1, field_property_seed(0x23));
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the board handle's field isolation from every register word" },
+                                   r.passed );
+    if (!r.passed)
+    {
+        std::cout << r.counterexample;
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every word was checked with every value" },
+                                   r.checks,
+                                   REG23_EXHAUSTIVE_CHECKS );
+
+    return something_failed;
+}
+
+// verify that no MCP23017 field disturbs another bit of the register file,
+// from any value of its register
+int ut02()
+{
+    int something_failed = 0;
+
+    const field_property_result r = check_fields_exhaustively(mcp23017_fields(), mcp23017_map::REGISTER_COUNT,
+                                                              field_property_seed(0x23017));
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the MCP23017 fields' isolation from every register word" },
+                                   r.passed );
+    if (!r.passed)
+    {
+        std::cout << r.counterexample;
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every word was checked with every value" },
+                                   r.checks,
+                                   MCP23017_EXHAUSTIVE_CHECKS );
+
+    return something_failed;
+}
+
+// verify, over random register files, that no MCP23017 field disturbs another bit
+int ut03()
+{
+    int something_failed = 0;
+
+    const field_property_result r = check_fields_randomly(mcp23017_fields(), mcp23017_map::REGISTER_COUNT,
+                                                          RANDOM_ITERATIONS, field_property_seed(0x23017));
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the MCP23017 fields' isolation over random register files" },
+                                   r.passed );
+    if (!r.passed)
+    {
+        std::cout << r.counterexample;
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the number of random writes checked" },
+                                   r.checks,
+                                   RANDOM_ITERATIONS );
+
+    return something_failed;
+}
+
+// verify that the exhaustive check catches a mask bug that only shows when the filler isn't clear
+int ut04()
+{
+    int something_failed = 0;
+
+    const std::vector< field_under_test<std::uint16_t> > fields {
+        { "lamp42", 0, lamp_footprint(), mismasked_set_lamp, mismasked_get_lamp, false },
+    };
+
+    const field_property_result r = check_fields_exhaustively(fields, 1, field_property_seed(0x23));
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a mask reaching into the filler was caught" },
+                                   !r.passed && r.counterexample.find("disturbing bits 0x20 outside the field") != std::string::npos );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that it was caught at the first word with the filler bit set" },
+                                   r.checks,
+                                   std::uint64_t { 0x20 * 8 + 1 } );
+
+    return something_failed;
+}
+
+// verify that the random check catches a misplaced field, and that its seed replays the counterexample
+int ut05()
+{
+    int something_failed = 0;
+
+    std::vector< field_under_test<ic_reg_t> > fields = mcp23017_fields();
+    fields.push_back(mcp23017_field< misplaced_output_b3_t >("mcp23017_output<B,3>", 0x15, 0x08));
+
+    const std::uint64_t         seed   = field_property_seed(0x23017);
+    const field_property_result first  = check_fields_randomly(fields, mcp23017_map::REGISTER_COUNT, RANDOM_ITERATIONS, seed);
+    const field_property_result replay = check_fields_randomly(fields, mcp23017_map::REGISTER_COUNT, RANDOM_ITERATIONS, seed);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a field placed in its twin's register was caught" },
+                                   !first.passed && first.counterexample.find("field mcp23017_output<B,3>") == 0 );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the seed replayed the same counterexample" },
+                                   !replay.passed && replay.checks == first.checks && replay.counterexample == first.counterexample );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // register #23's functors, exhaustively
+        { "ut01", ut01 },     // board_handle, exhaustively
+        { "ut02", ut02 },     // the MCP23017, exhaustively
+        { "ut03", ut03 },     // the MCP23017, randomly
+        { "ut04", ut04 },     // a mask bug
+        { "ut05", ut05 },     // a misplaced field, and replay
+    } );
+}
@@ -0,0 +1,189 @@
+// ut_field_subscription.cpp
+
+#include <chrono>       //  std::chrono::milliseconds
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <string>       //  std::string
+#include <thread>       //  std::thread, std::this_thread::sleep_for
+#include <vector>       //  std::vector
+
+#include <sys/epoll.h>  //  epoll_create1, epoll_ctl, epoll_wait
+#include <unistd.h>     //  close
+
+#include "control_board_gpio_reg23.h"
+#include "field_subscription.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that each change of the lamp's power setting is notified, and
+// that elided writes are not
+int ut00()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t, notifying_instrumentation > lamp42{ &mock_reg23 };
+
+    field_subscription lamp_changes{ GPIO_REG23_ID, LAMP_PWR_FIELD_ID };
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the eventfd is not readable before any change" },
+                                   !lamp_changes.wait(0) );
+
+    lamp42(BRIGHT_LIGHTS);
+    lamp42(BRIGHT_LIGHTS);      // elided
+    lamp42(MOOD_LIGHTING);
+    lamp42();
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the eventfd is readable after a change" },
+                                   lamp_changes.wait(0) );
+
+    std::vector<field_notification> notifications;
+    lamp_changes.drain(notifications);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the number of lamp changes notified" },
+                                   notifications.size(),
+                                   std::size_t { 2 } );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the old and new power settings of the second change" },
+                                   notifications.size() == 2
+                                   && notifications[1].old_val == BRIGHT_LIGHTS
+                                   && notifications[1].new_val == MOOD_LIGHTING );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the eventfd is not readable once drained" },
+                                   !lamp_changes.wait(0) );
+
+    return something_failed;
+}
+
+// verify that a subscription to solenoid3 de-energizing sees only that
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< solenoid3_t, notifying_instrumentation > vac_solenoid3{ &mock_reg23 };
+    gpio_register_23< lamp_t,      notifying_instrumentation > lamp42{ &mock_reg23 };
+
+    field_subscription solenoid3_off{ GPIO_REG23_ID, SOLENOID3_FIELD_ID, notify_when::BECOMES, 0 };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        vac_solenoid3(vacuum::ON);
+        lamp42(static_cast<lamp_t>(i + 1));
+        vac_solenoid3(vacuum::OFF);
+    }
+
+    std::vector<field_notification> notifications;
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that only solenoid3's de-energizing was notified" },
+                                   solenoid3_off.drain(notifications),
+                                   std::size_t { 3 } );
+
+    return something_failed;
+}
+
+// verify that a change made on another thread wakes a thread waiting in epoll
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    field_subscription lamp_changes{ GPIO_REG23_ID, LAMP_PWR_FIELD_ID, notify_when::LEAVES, LIGHTS_OUT };
+
+    const int epfd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event ev {};
+    ev.events = EPOLLIN;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, lamp_changes.fd(), &ev);
+
+    std::thread hmi_writer( []()
+                            {
+                                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                                gpio_register_23< lamp_t, notifying_instrumentation > lamp42{ &mock_reg23 };
+                                lamp42(FULL_ILLUMINATION);
+                            } );
+
+    epoll_event ready {};
+    const int woken = epoll_wait(epfd, &ready, 1, 5000);
+    hmi_writer.join();
+    close(epfd);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that epoll woke for the other thread's change" },
+                                   woken,
+                                   1 );
+
+    std::vector<field_notification> notifications;
+    lamp_changes.drain(notifications);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the lamp was notified leaving lights out for full power" },
+                                   notifications.size() == 1 && notifications[0].new_val == FULL_ILLUMINATION );
+
+    return something_failed;
+}
+
+// verify that a full queue drops notifications rather than block, and that
+// unsubscribing leaves the field's other subscribers subscribed
+int ut03()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< solenoid2_t, notifying_instrumentation > vac_solenoid2{ &mock_reg23 };
+
+    field_subscription flooded{ GPIO_REG23_ID, SOLENOID2_FIELD_ID };
+    {
+        field_subscription short_lived{ GPIO_REG23_ID, SOLENOID2_FIELD_ID };
+    }
+
+    for (std::size_t i = 0; i < SUBSCRIPTION_QUEUE_CAPACITY + 100; ++i)
+    {
+        vac_solenoid2((i & 1) ? vacuum::OFF : vacuum::ON);
+    }
+
+    std::vector<field_notification> notifications;
+    flooded.drain(notifications);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a full queue's notifications were dropped" },
+                                   flooded.dropped(),
+                                   std::uint64_t { 100 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the queue delivered up to its capacity" },
+                                   notifications.size(),
+                                   SUBSCRIPTION_QUEUE_CAPACITY );
+
+    vac_solenoid2(vacuum::ON);
+    notifications.clear();
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the drained queue accepts notifications again" },
+                                   flooded.drain(notifications),
+                                   std::size_t { 1 } );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // lamp changes
+        { "ut01", ut01 },     // filtered changes
+        { "ut02", ut02 },     // epoll wakeup
+        { "ut03", ut03 },     // full queue, unsubscribing
+    } );
+}
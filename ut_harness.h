@@ -0,0 +1,313 @@
+// ut_harness.h
+//
+// ut_run() -- runs a UT executable's unit tests in parallel, each isolated
+//             in a process of its own, and reports each test's outcome and
+//             timing
+//
+//      A UT's main() hands ut_run() its tests:
+//
+//          int main( int argc, char * argv[] )
+//          {
+//              return ut_run( argc, argv, {
+//                  { "ut00", ut00 },     // ctor
+//                  { "ut01", ut01 },     // getters
+//              } );
+//          }
+//
+//      Each test runs in a child process forked for it, so it starts from
+//      the executable's initial state: its own mock registers, its own
+//      statics, whatever earlier tests did to theirs. Up to -j tests run at
+//      once (by default, one per hardware thread). A test fails if it
+//      returns non-zero, throws, or dies.
+//
+//      The report is TAP (Test Anything Protocol), one line per test in
+//      the order given, with the test's wall time. A failed test's chatter
+//      follows its line as TAP diagnostics ("# " lines). The exit status
+//      is non-zero if any test failed, which is what breaks the build.
+//      See Note1
+//
+//          TAP version 13
+//          1..2
+//          ok 1 - ut00 # time=0.152ms
+//          not ok 2 - ut01 # time=0.204ms
+//          # ut01: verifing lamp42's getter............................FAILED!
+//          # ...
+//          # 1 passed, 1 failed, 0.311ms
+//
+//      usage: ut_foo.exe [-j jobs] [--golden] [test ...]
+//
+//          -j jobs     runs at most jobs tests at once
+//          --golden    runs the tests one at a time, and prints their
+//                      chatter followed by the UT's verdict, as the
+//                      'known good' output in ./ut_ref_output has it.
+//                      See Note2
+//          test ...    runs only the named tests. A name matching none
+//                      of the UT's tests is an error: nothing runs, and
+//                      the exit status is non-zero
+//
+//  Note1:  the harness uses fork(), so it is POSIX only, as the Makefile's
+//          recipes already are.
+//
+//  Note2:  the golden output doesn't depend on timing or scheduling, so
+//          'make golden_check' still compares it with ./ut_ref_output.
+//          The build relies on the exit status instead.
+
+#ifndef UT_HARNESS_H
+#define UT_HARNESS_H
+
+#include <chrono>               //  std::chrono::steady_clock
+#include <cstddef>              //  std::size_t, std::ptrdiff_t
+#include <cstdio>               //  std::snprintf
+#include <cstdlib>              //  std::atoi, EXIT_FAILURE
+#include <cstring>              //  std::strcmp
+#include <exception>            //  std::exception
+#include <initializer_list>     //  std::initializer_list
+#include <iostream>             //  std::cout, std::cerr
+#include <sstream>              //  std::stringstream
+#include <stdexcept>            //  std::runtime_error
+#include <string>               //  std::string, std::getline
+#include <thread>               //  std::thread::hardware_concurrency
+#include <vector>               //  std::vector
+
+#include <poll.h>               //  poll
+#include <sys/wait.h>           //  waitpid
+#include <unistd.h>             //  fork, pipe, dup2, read, close, _exit
+
+struct ut_case
+{
+    const char*     name;       // ut00, ut01, etc.
+    int           (*run)();     // returns non-zero if the test failed
+};
+
+struct ut_outcome
+{
+    bool            passed  {false};
+    double          ms      {0.0};      // wall time, fork to exit
+    std::string     chatter {};         // what the test sent to stdout
+};
+
+// runs a test in the calling process. The child's half of ut_run()
+inline int ut_run_case(const ut_case& test)
+{
+    int something_failed = 1;
+
+    try
+    {
+        something_failed = test.run();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << std::endl << "UNEXPECTED exception thrown: " << e.what() << std::endl << std::endl; // sent to console
+        std::cout << std::endl << "UNEXPECTED exception thrown: " << e.what() << std::endl << std::endl; // sent to UT output
+    }
+
+    return something_failed;
+}
+
+// a test running in a child process
+struct ut_child
+{
+    std::size_t                                     index;
+    pid_t                                           pid;
+    int                                             fd;     // the read end of the child's stdout
+    std::chrono::steady_clock::time_point           start;
+};
+
+// runs tests, at most jobs at a time, each in a child process of its own
+inline std::vector<ut_outcome> ut_run_isolated(const std::vector<ut_case>& tests, unsigned jobs)
+{
+    std::vector<ut_outcome> outcomes(tests.size());
+    std::vector<ut_child>   running;
+    std::size_t             next = 0;
+
+    std::cout.flush();      // or the children inherit, and repeat, the parent's buffered output
+
+    while (next < tests.size() || !running.empty())
+    {
+        // start tests until jobs are running
+        while (next < tests.size() && running.size() < jobs)
+        {
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                throw std::runtime_error("ut_run: pipe() failed");
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            const pid_t pid  = fork();
+            if (pid < 0)
+            {
+                throw std::runtime_error("ut_run: fork() failed");
+            }
+
+            if (pid == 0)
+            {
+                close(fds[0]);
+                dup2(fds[1], STDOUT_FILENO);
+                close(fds[1]);
+
+                const int something_failed = ut_run_case(tests[next]);
+                std::cout.flush();
+                _exit(something_failed ? 1 : 0);
+            }
+
+            close(fds[1]);
+            running.push_back(ut_child{ next, pid, fds[0], start });
+            ++next;
+        }
+
+        // collect the running tests' chatter, and their exit once their stdout closes
+        std::vector<pollfd> fds;
+        for (const ut_child& child : running)
+        {
+            fds.push_back(pollfd{ child.fd, POLLIN, 0 });
+        }
+        poll(fds.data(), fds.size(), -1);
+
+        for (std::size_t i = running.size(); i-- > 0;)
+        {
+            if (fds[i].revents == 0)
+            {
+                continue;
+            }
+
+            ut_child& child = running[i];
+            char      buf[4096];
+            const ssize_t got = read(child.fd, buf, sizeof(buf));
+            if (got > 0)
+            {
+                outcomes[child.index].chatter.append(buf, static_cast<std::size_t>(got));
+                continue;
+            }
+
+            int status = 0;
+            close(child.fd);
+            waitpid(child.pid, &status, 0);
+
+            ut_outcome& outcome = outcomes[child.index];
+            outcome.ms     = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - child.start).count();
+            outcome.passed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            if (WIFSIGNALED(status))
+            {
+                std::stringstream msg{};
+                msg << "killed by signal " << WTERMSIG(status) << std::endl;
+                outcome.chatter += msg.str();
+            }
+
+            running.erase(running.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+    }
+
+    return outcomes;
+}
+
+inline int ut_run(int argc, char* argv[], std::initializer_list<ut_case> cases)
+{
+    unsigned                jobs    = std::thread::hardware_concurrency();
+    bool                    golden  = false;
+    bool                    unknown = false;    // a test name matched no test
+    std::vector<ut_case>    tests;
+
+    for (int a = 1; a < argc; ++a)
+    {
+        if (std::strcmp(argv[a], "-j") == 0 && a + 1 < argc)
+        {
+            jobs = static_cast<unsigned>(std::atoi(argv[++a]));
+        }
+        else if (std::strcmp(argv[a], "--golden") == 0)
+        {
+            golden = true;
+        }
+        else
+        {
+            bool known = false;
+            for (const ut_case& test : cases)
+            {
+                if (std::strcmp(argv[a], test.name) == 0)
+                {
+                    tests.push_back(test);
+                    known = true;
+                }
+            }
+
+            if (!known)
+            {
+                std::cerr << argv[0] << ": no test named '" << argv[a] << "'" << std::endl;
+                unknown = true;
+            }
+        }
+    }
+
+    if (unknown)
+    {
+        return EXIT_FAILURE;
+    }
+    if (tests.empty())
+    {
+        tests.assign(cases.begin(), cases.end());
+    }
+    if (golden || jobs == 0)
+    {
+        jobs = 1;
+    }
+
+    const auto                    start    = std::chrono::steady_clock::now();
+    const std::vector<ut_outcome> outcomes = ut_run_isolated(tests, jobs);
+    const double                  wall_ms  = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::size_t failed = 0;
+    for (const ut_outcome& outcome : outcomes)
+    {
+        failed += !outcome.passed;
+    }
+
+    if (golden)
+    {
+        for (const ut_outcome& outcome : outcomes)
+        {
+            std::cout << outcome.chatter;
+        }
+
+        if (failed != 0)
+        {
+            std::cerr << std::endl << "UNIT TEST FAILED!" << std::endl;  // sent to the console
+            std::cout << std::endl << "UNIT TEST FAILED!" << std::endl;  // sent to the UT's output file
+        }
+        else
+        {
+            std::cout << std::endl << "UNIT TEST passed!" << std::endl;
+        }
+    }
+    else
+    {
+        std::cout << "TAP version 13" << std::endl;
+        std::cout << "1.." << tests.size() << std::endl;
+
+        for (std::size_t t = 0; t < tests.size(); ++t)
+        {
+            char time[32];
+            std::snprintf(time, sizeof(time), "%.3fms", outcomes[t].ms);
+
+            std::cout << (outcomes[t].passed ? "ok " : "not ok ") << t + 1 << " - " << tests[t].name
+                      << " # time=" << time << std::endl;
+
+            if (!outcomes[t].passed)
+            {
+                std::stringstream chatter{ outcomes[t].chatter };
+                std::string       line;
+                while (std::getline(chatter, line))
+                {
+                    std::cout << "# " << line << std::endl;
+                }
+            }
+        }
+
+        char wall[32];
+        std::snprintf(wall, sizeof(wall), "%.3fms", wall_ms);
+        std::cout << "# " << tests.size() - failed << " passed, " << failed << " failed, " << wall << std::endl;
+    }
+
+    return (failed != 0 ? EXIT_FAILURE : 0);
+}
+
+#endif // UT_HARNESS_H
@@ -0,0 +1,166 @@
+// ut_heap_guard.h
+//
+// heap_guard -- a test hook which catches heap allocations made while it is
+//               in scope
+//
+//      Including this header replaces the global operator new and operator
+//      delete (every form: plain, array, nothrow, aligned, sized) with ones
+//      which allocate from malloc, as the default ones do, but which first
+//      check whether a heap_guard is armed. An allocation made while one is
+//      armed, by any thread, is counted or, with heap_guard_policy::ABORT,
+//      reported on stderr and the process aborted. Arm a guard around a
+//      real-time loop's steady state:
+//
+//          board.lamp42(VERY_DIM_LIGHTS);              // setup may allocate
+//          {
+//              heap_guard guard{ heap_guard_policy::ABORT };
+//              for (int tick = 0; tick < 1000; ++tick)
+//              {
+//                  ...                                 // must not allocate
+//              }
+//          }
+//
+//      Under heap_guard_policy::COUNT the test reads guard.allocations()
+//      and reports it once the guard is disarmed, since reporting allocates.
+//
+//  Note1:  replacement allocation functions may be defined only once in a
+//          program, so include this header in exactly one translation unit:
+//          the UT's.
+//
+//  Note2:  only operator new is watched. The C++ runtime allocates thrown
+//          exception objects with malloc (__cxa_allocate_exception), which
+//          is why the library's exceptions carry their message in a fixed
+//          buffer (see register_error.h): throwing one doesn't reach
+//          operator new.
+
+#ifndef UT_HEAP_GUARD_H
+#define UT_HEAP_GUARD_H
+
+#include <atomic>       //  std::atomic
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint64_t
+#include <cstdlib>      //  std::malloc, std::aligned_alloc, std::free, std::abort
+#include <new>          //  std::bad_alloc, std::nothrow_t, std::align_val_t
+
+#include <unistd.h>     //  write
+
+enum class heap_guard_policy
+{
+    COUNT,      // count the allocations, for the test to check
+    ABORT       // report the first allocation, and abort
+};
+
+namespace heap_guard_detail
+{
+    inline std::atomic<bool>            armed       {false};
+    inline std::atomic<bool>            aborting    {false};
+    inline std::atomic<std::uint64_t>   allocations {0};
+    inline std::atomic<std::uint64_t>   bytes       {0};
+
+    inline void note(std::size_t size)
+    {
+        if (!armed.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+
+        if (aborting.load(std::memory_order_relaxed))
+        {
+            static const char msg[] = "heap_guard: heap allocation during steady state\n";
+            (void)!::write(STDERR_FILENO, msg, sizeof(msg) - 1);    // no stream: it might allocate
+            std::abort();
+        }
+    }
+
+    inline void* allocate(std::size_t size)
+    {
+        note(size);
+        void* p = std::malloc(size != 0 ? size : 1);
+        if (p == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    inline void* allocate(std::size_t size, std::align_val_t align)
+    {
+        note(size);
+        const std::size_t a = static_cast<std::size_t>(align);
+        void* p = std::aligned_alloc(a, (size + a - 1) / a * a + (size == 0 ? a : 0));
+        if (p == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+}
+
+class heap_guard
+{
+public:
+    explicit heap_guard(heap_guard_policy policy = heap_guard_policy::ABORT)
+        : allocations_at_arming(heap_guard_detail::allocations.load()),
+          bytes_at_arming(heap_guard_detail::bytes.load())
+    {
+        heap_guard_detail::aborting.store(policy == heap_guard_policy::ABORT);
+        heap_guard_detail::armed.store(true);
+    }
+
+    ~heap_guard()
+    {
+        heap_guard_detail::armed.store(false);
+    }
+
+    heap_guard(const heap_guard&)            = delete;
+    heap_guard& operator=(const heap_guard&) = delete;
+
+    // the heap allocations made, and the bytes asked for, since the guard was armed
+    std::uint64_t allocations() const { return heap_guard_detail::allocations.load() - allocations_at_arming; }
+    std::uint64_t bytes()       const { return heap_guard_detail::bytes.load() - bytes_at_arming; }
+
+private:
+    const std::uint64_t allocations_at_arming;
+    const std::uint64_t bytes_at_arming;
+};
+
+// the replacement allocation functions. Note1
+void* operator new  (std::size_t size)                                          { return heap_guard_detail::allocate(size); }
+void* operator new[](std::size_t size)                                          { return heap_guard_detail::allocate(size); }
+void* operator new  (std::size_t size, std::align_val_t align)                  { return heap_guard_detail::allocate(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align)                  { return heap_guard_detail::allocate(size, align); }
+
+void* operator new  (std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return heap_guard_detail::allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return heap_guard_detail::allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new  (std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    try { return heap_guard_detail::allocate(size, align); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    try { return heap_guard_detail::allocate(size, align); } catch (...) { return nullptr; }
+}
+
+void operator delete  (void* p) noexcept                                        { std::free(p); }
+void operator delete[](void* p) noexcept                                        { std::free(p); }
+void operator delete  (void* p, std::size_t) noexcept                           { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept                           { std::free(p); }
+void operator delete  (void* p, std::align_val_t) noexcept                      { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept                      { std::free(p); }
+void operator delete  (void* p, std::size_t, std::align_val_t) noexcept         { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept         { std::free(p); }
+void operator delete  (void* p, const std::nothrow_t&) noexcept                 { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept                 { std::free(p); }
+void operator delete  (void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+
+#endif // UT_HEAP_GUARD_H
@@ -0,0 +1,234 @@
+// ut_ic_register_driver.cpp
+
+#include <cstdint>      //  std::uint8_t, std::uint16_t, std::uint64_t
+#include <cstring>      //  std::memset
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+
+#include "control_board_gpio_reg23.h"
+#include "field_instrumentation.h"
+#include "ic_register_driver.h"
+#include "mcp23017.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+static_assert(sizeof(ic_field_functor< mcp23017_output< mcp23017_port::A, 0 > >) == sizeof(volatile ic_reg_t*),
+              "the uninstrumented functor must be nothing more than the register window's address");
+
+static_assert(mcp23017_output< mcp23017_port::B, 7 >::FIELD.reg_id == MCP23017_OLATB, "port B registers follow their port A twins");
+static_assert(mcp23017_output< mcp23017_port::B, 7 >::FIELD.mask() == 0x80, "pin 7 is the register's top bit");
+
+// a tag is writable only if the map's register is, and not every tag of a writable register is
+static_assert(!mcp23017_interrupt_flags< mcp23017_port::A >::WRITABLE, "INTF is read-only in the map");
+static_assert(!mcp23017_input< mcp23017_port::A, 0 >::WRITABLE && !mcp23017_port_input< mcp23017_port::B >::WRITABLE,
+              "a pin's level is read-only: writing GPIO writes OLAT");
+static_assert(!mcp23017_iocon_bank_t::WRITABLE, "setting IOCON.BANK would remap every register");
+static_assert(mcp23017_iocon_mirror_t::WRITABLE && mcp23017_output< mcp23017_port::B, 7 >::WRITABLE,
+              "the other fields of writable registers are writable");
+
+// a stand-in for an MCP23017's register file
+static ic_reg_t mock_mcp23017[mcp23017_map::REGISTER_COUNT];
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that reset() restores the writable registers' reset values only
+int ut00()
+{
+    int something_failed = 0;
+
+    std::memset(mock_mcp23017, 0xAA, sizeof(mock_mcp23017));
+
+    ic_device< mcp23017_map > expander{ mmio_window{ mock_mcp23017 } };
+    expander.reset();
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that reset made every pin an input" },
+                                   mock_mcp23017[MCP23017_IODIRA] == 0xFF && mock_mcp23017[MCP23017_IODIRB] == 0xFF );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that reset cleared the output latches and IOCON" },
+                                   mock_mcp23017[MCP23017_OLATA] == 0 && mock_mcp23017[MCP23017_OLATB] == 0
+                                   && mock_mcp23017[MCP23017_IOCON] == 0 );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that reset left the read-only registers alone" },
+                                   mock_mcp23017[MCP23017_INTFA] == 0xAA && mock_mcp23017[MCP23017_INTCAPB] == 0xAA );
+
+    return something_failed;
+}
+
+// verify the pin functors
+int ut01()
+{
+    int something_failed = 0;
+
+    mmio_window window{ mock_mcp23017 };
+    ic_device< mcp23017_map >{ window }.reset();
+
+    ic_field_functor< mcp23017_direction< mcp23017_port::A, 3 > > gpa3_dir{ window };
+    ic_field_functor< mcp23017_output< mcp23017_port::A, 3 > >    gpa3{ window };
+    ic_field_functor< mcp23017_output< mcp23017_port::B, 0 > >    gpb0{ window };
+
+    gpa3_dir(MCP23017_OUTPUT);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that only pin 3 of port A became an output" },
+                                   unsigned { mock_mcp23017[MCP23017_IODIRA] },
+                                   0xF7u );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the setter returns the pin's previous level" },
+                                   gpa3(1),
+                                   std::uint16_t { 0 } );
+
+    gpb0(1);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that each pin landed in its own port's latch" },
+                                   mock_mcp23017[MCP23017_OLATA] == 0x08 && mock_mcp23017[MCP23017_OLATB] == 0x01 );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the getter reads the pin back" },
+                                   gpa3(),
+                                   std::uint16_t { 1 } );
+
+    return something_failed;
+}
+
+// verify range checking, and the whole-port functors
+int ut02()
+{
+    int something_failed = 0;
+
+    mmio_window window{ mock_mcp23017 };
+    ic_device< mcp23017_map >{ window }.reset();
+
+    ic_field_functor< mcp23017_output< mcp23017_port::A, 5 > > gpa5{ window };
+    ic_field_functor< mcp23017_port_output< mcp23017_port::B > > port_b{ window };
+
+    bool threw = false;
+    try
+    {
+        gpa5(2);
+    }
+    catch (std::range_error&)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a 1 bit field rejects 2, leaving the latch alone" },
+                                   threw && mock_mcp23017[MCP23017_OLATA] == 0 );
+
+    port_b(0xA5);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a whole port is set with one write" },
+                                   unsigned { mock_mcp23017[MCP23017_OLATB] },
+                                   0xA5u );
+
+    return something_failed;
+}
+
+// verify burst reads, and that instrumentation identifies fields by register address
+int ut03()
+{
+    int something_failed = 0;
+
+    mmio_window window{ mock_mcp23017 };
+    ic_device< mcp23017_map > expander{ window };
+    expander.reset();
+
+    mock_mcp23017[MCP23017_GPIOB] = 0x40;     // pin 6 of port B is high
+
+    const ic_device< mcp23017_map >::image_t image = expander.read_all();
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing a pin's level within a burst read image" },
+                                   ic_device< mcp23017_map >::field_of< mcp23017_input< mcp23017_port::B, 6 > >(image),
+                                   std::uint16_t { 1 } );
+
+    typedef mcp23017_input< mcp23017_port::B, 6 > gpb6_t;
+    ic_field_functor< gpb6_t, mmio_window, counting_instrumentation > gpb6{ window };
+
+    const register_key_t gpiob = register_key(IC_REGISTER_SPACE, MCP23017_GPIOB);
+
+    const field_stats before = counting_instrumentation::this_thread(gpiob, gpb6_t::FIELD.field_id);
+    gpb6();
+    gpb6();
+    const field_stats after  = counting_instrumentation::this_thread(gpiob, gpb6_t::FIELD.field_id);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the reads were counted against GPIOB's pin 6" },
+                                   after.reads - before.reads,
+                                   std::uint64_t { 2 } );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+// verify that an IC register whose address matches a board register id is
+// counted apart from the board register, and that an address the counting
+// instrumentation can't hold is not counted out of bounds
+int ut04()
+{
+    int something_failed = 0;
+
+    static ic_reg_t mock_ic[256];
+    mmio_window window{ mock_ic };
+
+    typedef ic_field< GPIO_REG23_ID, 0, 1 >  addr23_t;     // IC register 0x17, not register #23
+    ic_field_functor< addr23_t, mmio_window, counting_instrumentation > addr23{ window };
+
+    const field_stats ic_before    = counting_instrumentation::this_thread(register_key(IC_REGISTER_SPACE, GPIO_REG23_ID), 0);
+    const field_stats board_before = counting_instrumentation::this_thread(GPIO_REG23_ID, 0);
+    addr23(1);
+    const field_stats ic_after     = counting_instrumentation::this_thread(register_key(IC_REGISTER_SPACE, GPIO_REG23_ID), 0);
+    const field_stats board_after  = counting_instrumentation::this_thread(GPIO_REG23_ID, 0);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that IC register 0x17's write is counted as the IC's" },
+                                   ic_after.writes - ic_before.writes == 1 && board_after.writes == board_before.writes );
+
+    // an address beyond counting_instrumentation's tables can't be counted,
+    // so a counting functor for it doesn't compile. Uninstrumented, it works
+    typedef ic_field< 0x80, 0, 1 >  far_t;
+    const register_key_t far_key { register_key(IC_REGISTER_SPACE, 0x80) };
+    static_assert(!counting_instrumentation::tracks(far_key, 0), "IC register 0x80 is beyond the tables");
+    static_assert(noexcept(counting_instrumentation::write(far_key, 0, 0, 0, 1)), "the hooks run after the store");
+
+    ic_field_functor< far_t, mmio_window > far_field{ window };
+    far_field(1);
+
+    // the hooks skip an untracked field rather than throw; the queries reject it
+    counting_instrumentation::write(far_key, 0, counting_instrumentation::begin(), 0, 1);
+
+    bool rejected = false;
+    try
+    {
+        counting_instrumentation::this_thread(far_key, 0);
+    }
+    catch (std::range_error&)
+    {
+        rejected = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that an IC address beyond the table is written, but not counted" },
+                                   mock_ic[0x80] == 1 && rejected );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // reset
+        { "ut01", ut01 },     // pin functors
+        { "ut02", ut02 },     // range check, whole port
+        { "ut03", ut03 },     // burst read, instrumentation
+        { "ut04", ut04 },     // register spaces
+    } );
+}
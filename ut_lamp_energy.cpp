@@ -0,0 +1,206 @@
+// ut_lamp_energy.cpp
+
+#include <atomic>       //  std::atomic
+#include <cstdint>      //  std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+#include <thread>       //  std::thread
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "lamp_energy.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+//======================= Unit Tests Begin ======================================
+//
+// verify the meter's integral, on a made up clock
+int ut00()
+{
+    int something_failed = 0;
+
+    lamp_energy_meter meter{ 42, LIGHTS_OUT, 0 };
+
+    meter.change(FULL_ILLUMINATION, 100);    // dark for 100 ticks
+    meter.change(MOOD_LIGHTING,     300);    // 7 for 200 ticks
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the energy at the last change" },
+                                   meter.level_ticks(300),
+                                   std::uint64_t { 7 * 200 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the current setting accrues up to now" },
+                                   meter.level_ticks(400),
+                                   std::uint64_t { 7 * 200 + 2 * 100 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the conversion into level-seconds" },
+                                   meter.level_seconds(400, 100.0),
+                                   16.0 );
+
+    return something_failed;
+}
+
+// verify the ledger's per-lamp and aggregate totals, retired lamps included
+int ut01()
+{
+    int something_failed = 0;
+
+    lamp_energy_ledger ledger;
+
+    lamp_energy_meter lamp1{ 1, LIGHTS_OUT, 0 };
+    lamp_energy_meter lamp2{ 2, BRIGHT_LIGHTS, 0 };
+    ledger.attach(lamp1);
+    ledger.attach(lamp2);
+
+    lamp1.change(VERY_DIM_LIGHTS, 0);
+
+    const std::vector<lamp_energy_reading> readings = ledger.readings(1000);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing each lamp's reading" },
+                                   readings.size() == 2
+                                   && readings[0].lamp_id == 1 && readings[0].level_ticks == 1000
+                                   && readings[1].lamp_id == 2 && readings[1].level_ticks == 4000 );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the total over both lamps" },
+                                   ledger.total_level_ticks(1000),
+                                   std::uint64_t { 5000 } );
+
+    ledger.detach(lamp2, 1000);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a retired lamp's energy stays in the total" },
+                                   ledger.total_level_ticks(2000),
+                                   std::uint64_t { 2000 + 4000 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a retired lamp is no longer read" },
+                                   ledger.readings(2000).size(),
+                                   std::size_t { 1 } );
+
+    return something_failed;
+}
+
+// verify that only the metered lamp's changes drive its meter
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    lamp_energy_ledger ledger;
+    {
+        metered_lamp<> lamp42{ &mock_reg23, 42, ledger };
+
+        const std::uint64_t dark = lamp42.energy().level_ticks();
+
+        something_failed += ut_verify( std::string { __func__ },
+                                       std::string { "verifing that a lamp which was never lit used no energy" },
+                                       dark,
+                                       std::uint64_t { 0 } );
+
+        const std::uint64_t t_on = read_cycle_counter();      // brackets the lit interval
+        lamp42(FULL_ILLUMINATION);
+
+        bool threw = false;
+        try
+        {
+            lamp42(LAMP_OOR);
+        }
+        catch (std::range_error&)
+        {
+            threw = true;
+        }
+
+        lamp42(FULL_ILLUMINATION);      // elided
+        lamp42(LIGHTS_OUT);
+        const std::uint64_t t_off = read_cycle_counter();
+
+        something_failed += ut_report( std::string { __func__ },
+                                       std::string { "verifing that the out of range setting was rejected" },
+                                       threw && mock_reg23.lamp_pwr == LIGHTS_OUT );
+
+        const std::uint64_t lit = lamp42.energy().level_ticks(t_off);
+
+        something_failed += ut_report( std::string { __func__ },
+                                       std::string { "verifing that the lit interval accrued at full illumination" },
+                                       lit > 0 && lit <= FULL_ILLUMINATION * (t_off - t_on) && lit % FULL_ILLUMINATION == 0 );
+
+        something_failed += ut_verify( std::string { __func__ },
+                                       std::string { "verifing that a dark lamp accrues nothing more" },
+                                       lamp42.energy().level_ticks(t_off + 1000000),
+                                       lit );
+
+        something_failed += ut_verify( std::string { __func__ },
+                                       std::string { "verifing that the ledger's total is the lamp's" },
+                                       ledger.total_level_ticks(t_off),
+                                       lit );
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the destroyed lamp was detached from the ledger" },
+                                   ledger.readings().size(),
+                                   std::size_t { 0 } );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the ledger's total survived the lamp" },
+                                   ledger.total_level_ticks() > 0 );
+
+    return something_failed;
+}
+
+// verify that a reader on another thread never sees a torn, shrinking total
+int ut03()
+{
+    int something_failed = 0;
+
+    lamp_energy_meter meter{ 7, LIGHTS_OUT, 0 };
+
+    std::atomic<bool>          stop   {false};
+    std::atomic<bool>          shrank {false};
+    std::atomic<std::uint64_t> clock  {0};      // the writer's clock, shared with the reader
+
+    std::thread reader( [&]()
+    {
+        std::uint64_t previous = 0;
+        while (!stop.load())
+        {
+            const std::uint64_t total = meter.level_ticks(clock.load());
+            if (total < previous)
+            {
+                shrank = true;
+            }
+            previous = total;
+        }
+    });
+
+    for (std::uint64_t t = 1; t <= 200000; ++t)
+    {
+        clock.store(t);
+        meter.change(static_cast<std::uint16_t>(t % 8), t);
+    }
+
+    stop = true;
+    reader.join();
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the total the reader saw never shrank" },
+                                   !shrank );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // meter
+        { "ut01", ut01 },     // ledger
+        { "ut02", ut02 },     // metered_lamp
+        { "ut03", ut03 },     // concurrent reader
+    } );
+}
@@ -0,0 +1,179 @@
+// ut_latency_histogram.cpp
+
+#include <cstdint>      //  std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <string>       //  std::string
+#include <thread>       //  std::thread
+
+#include "control_board_gpio_reg23.h"
+#include "latency_histogram.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that each latency lands in a bucket which brackets it, within
+// the histogram's promised precision
+int ut00()
+{
+    int something_failed = 0;
+
+    bool exact_below_linear_limit = true;
+    for (std::uint64_t ticks = 0; ticks < latency_histogram::LINEAR_LIMIT; ++ticks)
+    {
+        const std::size_t i = latency_histogram::bucket_index(ticks);
+        exact_below_linear_limit = exact_below_linear_limit
+                                   && latency_histogram::bucket_lowest(i)  == ticks
+                                   && latency_histogram::bucket_highest(i) == ticks;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that latencies below 64 ticks are counted exactly" },
+                                   exact_below_linear_limit );
+
+    bool bracketed = true;
+    for (std::uint64_t ticks = latency_histogram::LINEAR_LIMIT; ticks < (std::uint64_t{1} << 62); ticks = ticks / 2 * 3 + 7)
+    {
+        const std::size_t   i       = latency_histogram::bucket_index(ticks);
+        const std::uint64_t lowest  = latency_histogram::bucket_lowest(i);
+        const std::uint64_t highest = latency_histogram::bucket_highest(i);
+
+        bracketed = bracketed
+                    && i < latency_histogram::BUCKETS
+                    && lowest <= ticks && ticks <= highest
+                    && (highest - lowest) <= lowest / 32;     // within ~3%
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that larger latencies are bracketed to within 1/32 of their value" },
+                                   bracketed );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the largest latency lands in the last bucket" },
+                                   latency_histogram::bucket_index(~std::uint64_t{0}),
+                                   latency_histogram::BUCKETS - 1 );
+
+    return something_failed;
+}
+
+// verify the percentiles of a known distribution
+int ut01()
+{
+    int something_failed = 0;
+
+    latency_histogram h {};
+
+    // 1..1000 ticks, once each
+    for (std::uint64_t ticks = 1; ticks <= 1000; ++ticks)
+    {
+        h.record(ticks);
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the count of recorded latencies" },
+                                   h.count(),
+                                   std::uint64_t { 1000 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the p50 latency" },
+                                   h.percentile(50.0),
+                                   std::uint64_t { 503 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the p99.9 latency" },
+                                   h.percentile(99.9),
+                                   std::uint64_t { 1000 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the max latency" },
+                                   h.max(),
+                                   std::uint64_t { 1000 } );
+
+    return something_failed;
+}
+
+// verify that merging histograms adds up their counts
+int ut02()
+{
+    int something_failed = 0;
+
+    latency_histogram fast {};
+    latency_histogram slow {};
+
+    for (int i = 0; i < 999; ++i)
+    {
+        fast.record(10);
+    }
+    slow.record(5000);
+
+    latency_histogram merged { fast };
+    merged.merge(slow);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the merged count" },
+                                   merged.count(),
+                                   std::uint64_t { 1000 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the merged p99" },
+                                   merged.percentile(99.0),
+                                   std::uint64_t { 10 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the merged p99.99 is the lone slow latency" },
+                                   merged.percentile(99.99),
+                                   std::uint64_t { 5000 } );
+
+    return something_failed;
+}
+
+// verify that latency_instrumentation records getter and setter calls,
+// including those made by threads which have since exited
+int ut03()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t, latency_instrumentation > lamp42{ &mock_reg23 };
+
+    lamp42(BRIGHT_LIGHTS);
+    lamp42(BRIGHT_LIGHTS);
+    lamp42();
+
+    std::thread worker( []()
+                        {
+                            gpio_register_23< lamp_t, latency_instrumentation > lamp42{ &mock_reg23 };
+                            lamp42();
+                            lamp42();
+                        } );
+    worker.join();
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the number of setter latencies recorded" },
+                                   latency_instrumentation::merged(GPIO_REG23_ID, LAMP_PWR_FIELD_ID, LATENCY_SETTER).count(),
+                                   std::uint64_t { 2 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the number of getter latencies recorded, over both threads" },
+                                   latency_instrumentation::merged(GPIO_REG23_ID, LAMP_PWR_FIELD_ID, LATENCY_GETTER).count(),
+                                   std::uint64_t { 3 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that no latencies were recorded for an unused field" },
+                                   latency_instrumentation::merged(GPIO_REG23_ID, SOLENOID2_FIELD_ID, LATENCY_GETTER).count(),
+                                   std::uint64_t { 0 } );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // bucket precision
+        { "ut01", ut01 },     // percentiles
+        { "ut02", ut02 },     // merging
+        { "ut03", ut03 },     // latency_instrumentation
+    } );
+}
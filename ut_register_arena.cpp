@@ -0,0 +1,389 @@
+// ut_register_arena.cpp
+//
+// Built in the allocation-free mode (see register_arena.h), with the heap
+// guard hooked in (see ut_heap_guard.h): setup draws from the arena, and
+// the steady state makes no heap allocation at all.
+
+#ifndef REGISTER_STATIC_ARENAS
+#define REGISTER_STATIC_ARENAS
+#endif
+
+#include <csignal>      //  SIGABRT
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint64_t, std::uintptr_t
+#include <cstring>      //  std::strncpy
+#include <iostream>     //  for sending text to stdout, stderr
+#include <new>          //  std::bad_alloc
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+#include <type_traits>  //  std::is_same
+#include <vector>       //  std::vector
+
+#include <fcntl.h>      //  open
+#include <sys/wait.h>   //  waitpid
+#include <unistd.h>     //  fork, dup2, _exit
+
+#include "board_handle.h"
+#include "control_board_gpio_reg23.h"
+#include "field_subscription.h"
+#include "latency_histogram.h"
+#include "mcp23017.h"
+#include "register_arena.h"
+#include "register_bus.h"
+#include "register_fleet.h"
+#include "register_frame.h"
+#include "register_interlock.h"
+#include "register_trace.h"
+#include "tick_read_cache.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+#include "ut_heap_guard.h"
+
+static_assert(std::is_same< register_allocator<int>, arena_allocator<int> >::value,
+              "REGISTER_STATIC_ARENAS selects the arena");
+
+const int          TICKS         { 1000 };
+const std::uint8_t EXPANDER_ADDR { 0x20 };
+
+typedef batch_window< mcp23017_map > mcp23017_batch_window;
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that setting the runtime structures up draws from the arena, not the heap
+int ut00()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 frame_regs[4];
+
+    const std::size_t used_before = register_arena::used();
+    std::uint64_t     allocations = 0;
+    bool              aligned     = false;
+    {
+        heap_guard guard{ heap_guard_policy::COUNT };
+
+        reg23_frame_buffer<> frames{ register_vector<gpio_reg23_ptr_t>{ &frame_regs[0], &frame_regs[1], &frame_regs[2], &frame_regs[3] } };
+        board_handle_array<> boards{ 16 };
+        field_subscription   lamp_changes{ GPIO_REG23_ID, LAMP_PWR_FIELD_ID };
+
+        simulated_bus bus;
+        bus.attach(EXPANDER_ADDR);
+
+        register_fleet fleet{ 1000 };
+        fleet.images(GPIO_REG23_ID);
+
+        aligned     = reinterpret_cast<std::uintptr_t>(&boards[0]) % CACHE_LINE_SIZE == 0;
+        allocations = guard.allocations();
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the setup made no heap allocation" },
+                                   allocations,
+                                   std::uint64_t { 0 } );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the setup drew from the arena" },
+                                   register_arena::used() > used_before );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the board handles kept their alignment" },
+                                   aligned );
+
+    return something_failed;
+}
+
+// verify that register #23's steady state, errors included, makes no heap allocation
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+    static struct genpurpIO_register23 handle_reg23;
+    static struct genpurpIO_register23 cached_reg23;
+    static struct genpurpIO_register23 txn_reg23;
+    static struct genpurpIO_register23 frame_regs[4];
+
+    gpio_register_23< solenoid2_t >                       vac_solenoid2{ &mock_reg23 };
+    gpio_register_23< lamp_t >                            lamp42{ &mock_reg23 };
+    gpio_register_23< lamp_t, counting_instrumentation >  counted_lamp42{ &mock_reg23 };
+    board_handle<>                                        board{ &handle_reg23 };
+    reg23_read_cache                                      cache{ &cached_reg23 };
+    cached_gpio_register_23< lamp_t >                     cached_lamp42{ cache };
+    reg23_frame_buffer<>                                  frames{ register_vector<gpio_reg23_ptr_t>{ &frame_regs[0], &frame_regs[1], &frame_regs[2], &frame_regs[3] } };
+
+    bool          as_set       = true;
+    int           range_errors = 0;
+    int           violations   = 0;
+    char          message[REGISTER_ERROR_MESSAGE_BYTES] {};
+    std::uint64_t allocations  = 0;
+    {
+        heap_guard guard{ heap_guard_policy::COUNT };
+
+        for (int tick = 0; tick < TICKS; ++tick)
+        {
+            const lamp_t level = static_cast<lamp_t>(tick % LAMP_OOR);
+
+            vac_solenoid2((tick & 1) ? vacuum::ON : vacuum::OFF);
+            lamp42(level);
+            counted_lamp42(level);
+            board.lamp42(level);
+            board.vac_solenoid3((tick & 1) ? vacuum::OFF : vacuum::ON);
+            {
+                tick_scope scope{ cache };
+                cached_lamp42(level);
+                as_set = as_set && cached_lamp42() == level;
+            }
+            as_set = as_set && lamp42() == level && board.lamp42() == level;
+
+            register_transaction txn{ reg23_word(&txn_reg23), REG23_INTERLOCKS };
+            txn.set(SOLENOID2_FIELD, 1).set(SOLENOID3_FIELD, 0).set(LAMP_PWR_FIELD, MOOD_LIGHTING).commit();
+
+            gpio_register_23< lamp_t > frame_lamp42{ frames.back(static_cast<std::size_t>(tick) % 4), REG23_ATTACH };
+            frame_lamp42(level);
+            frames.commit();
+
+            // every way of rejecting a value or a word
+            try { lamp42(LAMP_OOR); }                    catch (std::range_error& e) { ++range_errors; std::strncpy(message, e.what(), sizeof(message) - 1); }
+            try { board.lamp42(LAMP_OOR); }              catch (std::range_error&)   { ++range_errors; }
+            try { cached_lamp42(LAMP_OOR); }             catch (std::range_error&)   { ++range_errors; }
+            try { txn.set(LAMP_PWR_FIELD, LAMP_OOR); }   catch (std::range_error&)   { ++range_errors; }
+            try { txn.set(SOLENOID3_FIELD, 1).commit(); } catch (interlock_violation&) { ++violations; }
+
+            gpio_register_23< solenoid2_t > frame_solenoid2{ frames.back(0), REG23_ATTACH };
+            gpio_register_23< solenoid3_t > frame_solenoid3{ frames.back(0), REG23_ATTACH };
+            frame_solenoid2(vacuum::ON);
+            frame_solenoid3(vacuum::ON);
+            try { frames.commit(); }                     catch (interlock_violation&) { ++violations; }
+            frame_solenoid3(vacuum::OFF);
+            frame_solenoid2(vacuum::OFF);
+        }
+
+        allocations = guard.allocations();
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the ticks made no heap allocation" },
+                                   allocations,
+                                   std::uint64_t { 0 } );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the fields took what was set" },
+                                   as_set );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the range errors were all thrown" },
+                                   range_errors,
+                                   4 * TICKS );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the interlock violations were all thrown" },
+                                   violations,
+                                   2 * TICKS );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the range error's message" },
+                                   std::string { message },
+                                   std::string { "Incorrect attempt to set lamp #42 pwr value to (8). "
+                                                 "Valid pwr settings range for lamp #42 is 0:7. " } );
+
+    return something_failed;
+}
+
+// verify that a bus batch's ticks, errors included, make no heap allocation
+int ut02()
+{
+    int something_failed = 0;
+
+    simulated_bus bus;
+    bus.attach(EXPANDER_ADDR);
+
+    bus_batch< mcp23017_map > batch{ bus, EXPANDER_ADDR };
+
+    ic_field_functor< mcp23017_output< mcp23017_port::A, 3 >, mcp23017_batch_window > gpa3{ batch.window() };
+    ic_field_functor< mcp23017_port_output< mcp23017_port::B >, mcp23017_batch_window > portb{ batch.window() };
+
+    const std::uint64_t round_trips_before = bus.round_trips();
+
+    int           range_errors = 0;
+    std::uint64_t allocations  = 0;
+    {
+        heap_guard guard{ heap_guard_policy::COUNT };
+
+        for (int tick = 0; tick < TICKS; ++tick)
+        {
+            batch.fetch_all();
+            gpa3(static_cast<std::uint16_t>(tick & 1));
+            portb(static_cast<std::uint16_t>((tick + 1) & 0xFF));
+            batch.flush();
+
+            try { portb(0x100); } catch (std::range_error&) { ++range_errors; }
+        }
+
+        allocations = guard.allocations();
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the ticks made no heap allocation" },
+                                   allocations,
+                                   std::uint64_t { 0 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing a fetch and a flush per tick" },
+                                   bus.round_trips() - round_trips_before,
+                                   std::uint64_t { 2 * TICKS } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the range errors were all thrown" },
+                                   range_errors,
+                                   TICKS );
+
+    return something_failed;
+}
+
+// verify that notifications, tracing and latency recording make no heap allocation
+int ut03()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 notified_reg23;
+    static struct genpurpIO_register23 traced_reg23;
+    static struct genpurpIO_register23 timed_reg23;
+
+    field_subscription lamp_changes{ GPIO_REG23_ID, LAMP_PWR_FIELD_ID };
+
+    gpio_register_23< lamp_t,      notifying_instrumentation > notified_lamp42{ &notified_reg23 };
+    gpio_register_23< solenoid2_t, tracing_instrumentation >   traced_solenoid2{ &traced_reg23 };
+    gpio_register_23< lamp_t,      latency_instrumentation >   timed_lamp42{ &timed_reg23 };
+
+    // the consumers' buffers are sized up front, as a real-time loop's would be
+    std::vector<field_notification> notifications;
+    std::vector<trace_record>       records;
+    notifications.reserve(TICKS + 1);
+    records.reserve(2 * TICKS);
+
+    lamp_changes.drain(notifications);
+    notifications.clear();
+    tracing_instrumentation::drain(records);    // start from an empty trace
+    records.clear();
+
+    std::uint64_t allocations = 0;
+    {
+        heap_guard guard{ heap_guard_policy::COUNT };
+
+        for (int tick = 0; tick < TICKS; ++tick)
+        {
+            notified_lamp42((tick & 1) ? BRIGHT_LIGHTS : VERY_DIM_LIGHTS);
+            traced_solenoid2((tick & 1) ? vacuum::ON : vacuum::OFF);
+            traced_solenoid2();
+            timed_lamp42(static_cast<lamp_t>(tick % LAMP_OOR));
+
+            if (tick % 64 == 63)
+            {
+                lamp_changes.drain(notifications);
+            }
+        }
+
+        lamp_changes.drain(notifications);
+        tracing_instrumentation::drain(records);
+
+        allocations = guard.allocations();
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the ticks made no heap allocation" },
+                                   allocations,
+                                   std::uint64_t { 0 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every change was notified" },
+                                   notifications.size(),
+                                   static_cast<std::size_t>(TICKS) );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every access was traced" },
+                                   records.size(),
+                                   static_cast<std::size_t>(2 * TICKS) );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every setting's latency was recorded" },
+                                   latency_instrumentation::merged(GPIO_REG23_ID, LAMP_PWR_FIELD_ID, LATENCY_SETTER).count(),
+                                   static_cast<std::uint64_t>(TICKS) );
+
+    return something_failed;
+}
+
+// verify the guard itself, and the arena's limit
+int ut04()
+{
+    int something_failed = 0;
+
+    static int* volatile escaped = nullptr;      // so the allocation can't be optimized away
+
+    std::uint64_t allocations = 0;
+    {
+        heap_guard guard{ heap_guard_policy::COUNT };
+        escaped     = new int{ 42 };
+        allocations = guard.allocations();
+    }
+    delete escaped;
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the guard counted an allocation" },
+                                   allocations,
+                                   std::uint64_t { 1 } );
+
+    // an ABORT guard kills the process on the first allocation
+    std::cout.flush();
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        const int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDERR_FILENO);                   // keep its report off the console
+
+        heap_guard guard{ heap_guard_policy::ABORT };
+        escaped = new int{ 42 };
+        _exit(0);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that an ABORT guard aborted the process" },
+                                   WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT );
+
+    // the arena is fixed: asking for more than is left throws, and takes nothing
+    const std::size_t used_before = register_arena::used();
+    bool threw = false;
+    try
+    {
+        make_register_array<unsigned char>(register_arena::capacity() - register_arena::used() + 1);
+    }
+    catch (std::bad_alloc&)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that an exhausted arena throws std::bad_alloc" },
+                                   threw );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the failed allocation took nothing" },
+                                   register_arena::used(),
+                                   used_before );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // setup draws from the arena
+        { "ut01", ut01 },     // register #23's steady state
+        { "ut02", ut02 },     // bus batches
+        { "ut03", ut03 },     // notifications, tracing, latency
+        { "ut04", ut04 },     // the guard and the arena's limit
+    } );
+}
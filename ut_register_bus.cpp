@@ -0,0 +1,253 @@
+// ut_register_bus.cpp
+
+#include <chrono>       //  std::chrono::steady_clock, std::chrono::microseconds
+#include <cstdint>      //  std::uint8_t, std::uint16_t, std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+#include <vector>       //  std::vector
+
+#include "ic_register_driver.h"
+#include "mcp23017.h"
+#include "register_bus.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+const std::uint8_t EXPANDER_ADDR { 0x20 };
+
+typedef batch_window< mcp23017_map > mcp23017_batch_window;
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that functors using a bus_window make a round trip per register access
+int ut00()
+{
+    int something_failed = 0;
+
+    simulated_bus bus;
+    ic_reg_t* regs = bus.attach(EXPANDER_ADDR);
+
+    ic_field_functor< mcp23017_output< mcp23017_port::A, 3 >, bus_window > gpa3{ bus_window{ bus, EXPANDER_ADDR } };
+
+    gpa3(1);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the setter reached the device's latch" },
+                                   unsigned { regs[MCP23017_OLATA] },
+                                   0x08u );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a read-modify-write took two round trips" },
+                                   bus.round_trips(),
+                                   std::uint64_t { 2 } );
+
+    return something_failed;
+}
+
+// verify that a batch coalesces adjacent registers into one burst
+int ut01()
+{
+    int something_failed = 0;
+
+    simulated_bus bus;
+    ic_reg_t* regs = bus.attach(EXPANDER_ADDR);
+    regs[MCP23017_OLATB] = 0x80;
+
+    bus_batch< mcp23017_map > batch{ bus, EXPANDER_ADDR };
+    batch.fetch_all();
+
+    ic_field_functor< mcp23017_output< mcp23017_port::A, 3 >, mcp23017_batch_window > gpa3{ batch.window() };
+    ic_field_functor< mcp23017_output< mcp23017_port::A, 4 >, mcp23017_batch_window > gpa4{ batch.window() };
+    ic_field_functor< mcp23017_output< mcp23017_port::B, 0 >, mcp23017_batch_window > gpb0{ batch.window() };
+
+    gpa3(1);
+    gpa4(1);
+    gpb0(1);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that nothing reached the device before the flush" },
+                                   unsigned { regs[MCP23017_OLATA] },
+                                   0u );
+
+    batch.flush();
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the flush updated both latches, keeping the fetched bits" },
+                                   regs[MCP23017_OLATA] == 0x18 && regs[MCP23017_OLATB] == 0x81 );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing one round trip to fetch and one to flush" },
+                                   bus.round_trips(),
+                                   std::uint64_t { 2 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the flush was a single 2 register burst" },
+                                   bus.bytes() - mcp23017_map::REGISTER_COUNT,
+                                   std::uint64_t { 2 } );
+
+    return something_failed;
+}
+
+// verify when short gaps are bridged, and that distant runs share a round trip
+int ut02()
+{
+    int something_failed = 0;
+
+    simulated_bus bus;
+    bus.attach(EXPANDER_ADDR);
+
+    {
+        bus_batch< mcp23017_map > batch{ bus, EXPANDER_ADDR };
+        batch.fetch_all();
+
+        ic_field_functor< mcp23017_port_direction< mcp23017_port::A >, mcp23017_batch_window > iodira{ batch.window() };
+        ic_field_functor< mcp23017_polarity< mcp23017_port::B, 1 >,    mcp23017_batch_window > ipolb1{ batch.window() };
+        ic_field_functor< mcp23017_pullup< mcp23017_port::A, 2 >,      mcp23017_batch_window > gppua2{ batch.window() };
+
+        iodira(0x0F);       // 0x00
+        ipolb1(1);          // 0x03, two registers further on
+        gppua2(1);          // 0x0C, far away
+
+        std::vector<bus_transfer> transfers;
+        batch.stage_flush(transfers);
+
+        something_failed += ut_report( std::string { __func__ },
+                                       std::string { "verifing that a 2 register gap was bridged, and a long one was not" },
+                                       transfers.size() == 2
+                                       && transfers[0].first == MCP23017_IODIRA && transfers[0].count == 4
+                                       && transfers[1].first == MCP23017_GPPUA  && transfers[1].count == 1 );
+
+        const std::uint64_t before = bus.round_trips();
+        bus.execute(transfers);
+
+        something_failed += ut_verify( std::string { __func__ },
+                                       std::string { "verifing that both bursts shared one round trip" },
+                                       bus.round_trips() - before,
+                                       std::uint64_t { 1 } );
+    }
+
+    {
+        // nothing fetched, so the gap's values are unknown
+        bus_batch< mcp23017_map > batch{ bus, EXPANDER_ADDR };
+
+        ic_field_functor< mcp23017_port_direction< mcp23017_port::A >, mcp23017_batch_window > iodira{ batch.window() };
+        ic_field_functor< mcp23017_polarity< mcp23017_port::A, 0 >,    mcp23017_batch_window > ipola0{ batch.window() };
+
+        iodira(0x0F);       // 0x00
+        ipola0(1);          // 0x02
+
+        std::vector<bus_transfer> transfers;
+        batch.stage_flush(transfers);
+
+        something_failed += ut_verify( std::string { __func__ },
+                                       std::string { "verifing that a gap which was never fetched is not bridged" },
+                                       transfers.size(),
+                                       std::size_t { 2 } );
+    }
+
+    return something_failed;
+}
+
+// verify pipelining across devices, and a missing device
+int ut03()
+{
+    int something_failed = 0;
+
+    simulated_bus bus;
+    ic_reg_t* regs1 = bus.attach(0x20);
+    ic_reg_t* regs2 = bus.attach(0x21);
+
+    bus_batch< mcp23017_map > batch1{ bus, 0x20 };
+    bus_batch< mcp23017_map > batch2{ bus, 0x21 };
+
+    ic_field_functor< mcp23017_port_output< mcp23017_port::A >, mcp23017_batch_window > olata1{ batch1.window() };
+    ic_field_functor< mcp23017_port_output< mcp23017_port::A >, mcp23017_batch_window > olata2{ batch2.window() };
+
+    olata1(0x11);
+    olata2(0x22);
+
+    std::vector<bus_transfer> transfers;
+    batch1.stage_flush(transfers);
+    batch2.stage_flush(transfers);
+    bus.execute(transfers);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that both devices were written in one round trip" },
+                                   regs1[MCP23017_OLATA] == 0x11 && regs2[MCP23017_OLATA] == 0x22 && bus.round_trips() == 1 );
+
+    bool threw = false;
+    try
+    {
+        bus_window{ bus, 0x27 }.read(MCP23017_GPIOA);
+    }
+    catch (bus_error&)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a missing device raises bus_error" },
+                                   threw );
+
+    return something_failed;
+}
+
+// verify the simulated latency
+int ut04()
+{
+    int something_failed = 0;
+
+    simulated_bus bus{ bus_latency{ std::chrono::microseconds(200), std::chrono::microseconds(0), std::chrono::microseconds(0) } };
+    bus.attach(EXPANDER_ADDR);
+
+    const auto start = std::chrono::steady_clock::now();
+    bus_window{ bus, EXPANDER_ADDR }.read(MCP23017_GPIOA);
+    const auto took  = std::chrono::steady_clock::now() - start;
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a round trip takes at least the configured latency" },
+                                   took >= std::chrono::microseconds(200) );
+
+    return something_failed;
+}
+
+// verify that a fetch running past the device's last register is rejected,
+// rather than overrunning the batch's buffers
+int ut05()
+{
+    int something_failed = 0;
+
+    simulated_bus bus;
+    bus.attach(EXPANDER_ADDR);
+
+    bus_batch< mcp23017_map > batch{ bus, EXPANDER_ADDR };
+
+    bool threw = false;
+    try
+    {
+        batch.fetch(MCP23017_OLATB, 2);
+    }
+    catch (std::range_error&)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a fetch past OLATB is rejected" },
+                                   threw && bus.round_trips() == 0 );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // bus_window
+        { "ut01", ut01 },     // coalescing
+        { "ut02", ut02 },     // gap bridging
+        { "ut03", ut03 },     // pipelining
+        { "ut04", ut04 },     // latency
+        { "ut05", ut05 },     // fetch range
+    } );
+}
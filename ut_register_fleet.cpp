@@ -0,0 +1,210 @@
+// ut_register_fleet.cpp
+
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "register_fleet.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+// an odd number of boards, so the kernels' scalar tails get exercised
+const std::size_t UT_BOARDS { 1000 + 13 };
+
+std::vector<std::uint64_t> random_selection(std::size_t boards)
+{
+    std::vector<std::uint64_t> select((boards + 63) / 64);
+    for (auto& bits : select)
+    {
+        bits = (std::uint64_t{ut_random()} << 32) | ut_random();
+    }
+    return select;
+}
+
+bool same_images(const register_image_array& a, const register_image_array& b)
+{
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i] != b[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that each SIMD level's field write agrees with a per-board
+// reference write, both for selected boards and for every board
+int ut00()
+{
+    int something_failed = 0;
+
+    register_fleet fleet{ UT_BOARDS };
+    register_image_array& images = fleet.images(GPIO_REG23_ID);
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        randomize(images);
+        const std::vector<std::uint64_t> select = random_selection(UT_BOARDS);
+
+        register_image_array expected{ UT_BOARDS, 0 };
+        for (std::size_t i = 0; i < UT_BOARDS; ++i)
+        {
+            genpurpIO_register23 reg = word_to_reg23(images[i]);
+            if ((select[i / 64] >> (i % 64)) & 1u)
+            {
+                reg.energize_vac_solenoid2 = 1;
+            }
+            reg.lamp_pwr = MOOD_LIGHTING;
+            expected[i] = reg23_to_word(reg);
+        }
+
+        fleet_write_field(images, SOLENOID2_FIELD, 1, select.data(), level);
+        fleet_write_field(images, LAMP_PWR_FIELD, MOOD_LIGHTING, nullptr, level);
+
+        something_failed += ut_report( std::string { __func__ },
+                                       "verifing that the " + std::string { simd_level_name(level) }
+                                       + " kernel energizes solenoid2 on the selected boards only",
+                                       same_images(images, expected) );
+    }
+
+    return something_failed;
+}
+
+// verify that each SIMD level's clamp agrees with a per-board reference clamp
+int ut01()
+{
+    int something_failed = 0;
+
+    register_image_array images{ UT_BOARDS, 0 };
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        randomize(images);
+
+        register_image_array expected{ UT_BOARDS, 0 };
+        for (std::size_t i = 0; i < UT_BOARDS; ++i)
+        {
+            genpurpIO_register23 reg = word_to_reg23(images[i]);
+            if (reg.lamp_pwr > MOOD_LIGHTING)
+            {
+                reg.lamp_pwr = MOOD_LIGHTING;
+            }
+            expected[i] = reg23_to_word(reg);
+        }
+
+        fleet_clamp_field(images, LAMP_PWR_FIELD, MOOD_LIGHTING, level);
+
+        something_failed += ut_report( std::string { __func__ },
+                                       "verifing that the " + std::string { simd_level_name(level) }
+                                       + " kernel clamps lamp_pwr, leaving the other fields alone",
+                                       same_images(images, expected) );
+    }
+
+    return something_failed;
+}
+
+// verify that a functor pointed at one board's image sees the kernels' writes
+int ut02()
+{
+    int something_failed = 0;
+
+    register_image_array images{ UT_BOARDS, 0 };
+
+    gpio_register_23< lamp_t > lamp42{ images.board(700) };
+
+    fleet_write_field(images, LAMP_PWR_FIELD, FULL_ILLUMINATION);
+    fleet_clamp_field(images, LAMP_PWR_FIELD, BRIGHT_LIGHTS);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that board 700's lamp functor sees the clamped power setting" },
+                                   lamp42(),
+                                   BRIGHT_LIGHTS );
+
+    lamp42(VERY_DIM_LIGHTS);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that board 700's lamp functor writes into the fleet's image" },
+                                   LAMP_PWR_FIELD.extract(images[700]),
+                                   VERY_DIM_LIGHTS );
+
+    return something_failed;
+}
+
+// verify that a register id beyond the fleet's arrays is rejected
+int ut03()
+{
+    int something_failed = 0;
+
+    register_fleet fleet{ UT_BOARDS };
+
+    bool rejected = false;
+    try
+    {
+        fleet.images(register_fleet::MAX_REGISTERS);
+    }
+    catch (std::range_error&)
+    {
+        rejected = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that register id 32 is rejected" },
+                                   rejected );
+
+    return something_failed;
+}
+
+// verify that each SIMD level rejects a value too wide for the field,
+// writing nothing, rather than storing its truncated low bits
+int ut04()
+{
+    int something_failed = 0;
+
+    register_image_array images{ UT_BOARDS, 0 };
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        randomize(images);
+
+        register_image_array expected{ UT_BOARDS, 0 };
+        for (std::size_t i = 0; i < UT_BOARDS; ++i)
+        {
+            expected[i] = images[i];
+        }
+
+        bool rejected = false;
+        try
+        {
+            fleet_write_field(images, LAMP_PWR_FIELD, std::uint16_t { 9 }, nullptr, level);
+        }
+        catch (std::range_error&)
+        {
+            rejected = true;
+        }
+
+        something_failed += ut_report( std::string { __func__ },
+                                       "verifing that the " + std::string { simd_level_name(level) }
+                                       + " write rejects lamp_pwr 9, leaving the images alone",
+                                       rejected && same_images(images, expected) );
+    }
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // masked field writes
+        { "ut01", ut01 },     // clamping
+        { "ut02", ut02 },     // functor interop
+        { "ut03", ut03 },     // register id range
+        { "ut04", ut04 },     // value range
+    } );
+}
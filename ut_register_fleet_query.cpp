@@ -0,0 +1,257 @@
+// ut_register_fleet_query.cpp
+
+#include <cstdint>      //  std::uint16_t, std::uint32_t, std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "register_fleet_query.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+// an odd number of boards, so the kernels' scalar tails get exercised
+const std::size_t UT_BOARDS { 1000 + 13 };
+
+// register #23's 11 bit filler, above lamp_pwr: too wide for the SIMD histograms
+constexpr field_descriptor UT_FILLER_FIELD { GPIO_REG23_ID, 3, 5, 11 };
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that each SIMD level counts the boards with solenoid2 energized
+// the same as a per-board bit-field read does
+int ut00()
+{
+    int something_failed = 0;
+
+    register_image_array images{ UT_BOARDS, 0 };
+    randomize(images);
+
+    std::size_t expected = 0;
+    for (std::size_t i = 0; i < UT_BOARDS; ++i)
+    {
+        expected += word_to_reg23(images[i]).energize_vac_solenoid2;
+    }
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        something_failed += ut_verify( std::string { __func__ },
+                                       "verifing the " + std::string { simd_level_name(level) }
+                                       + " count of boards with solenoid2 energized",
+                                       fleet_count_field(images, SOLENOID2_FIELD, 1, level),
+                                       expected );
+    }
+
+    return something_failed;
+}
+
+// verify that each SIMD level's histogram of lamp_pwr levels agrees with
+// per-board bit-field reads
+int ut01()
+{
+    int something_failed = 0;
+
+    register_image_array images{ UT_BOARDS, 0 };
+    randomize(images);
+
+    std::vector<std::uint64_t> expected(LAMP_PWR_FIELD.max_value() + 1u, 0);
+    for (std::size_t i = 0; i < UT_BOARDS; ++i)
+    {
+        ++expected[word_to_reg23(images[i]).lamp_pwr];
+    }
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        something_failed += ut_report( std::string { __func__ },
+                                       "verifing the " + std::string { simd_level_name(level) }
+                                       + " histogram of lamp_pwr levels",
+                                       fleet_field_histogram(images, LAMP_PWR_FIELD, level) == expected );
+    }
+
+    return something_failed;
+}
+
+// verify that each SIMD level finds the boards whose lamp is not at the
+// target power setting, in ascending order
+int ut02()
+{
+    int something_failed = 0;
+
+    register_image_array images{ UT_BOARDS, 0 };
+    randomize(images);
+
+    std::vector<std::uint32_t> expected;
+    for (std::size_t i = 0; i < UT_BOARDS; ++i)
+    {
+        if (word_to_reg23(images[i]).lamp_pwr != MOOD_LIGHTING)
+        {
+            expected.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        std::vector<std::uint32_t> indices;
+        fleet_find_field_differs(images, LAMP_PWR_FIELD, MOOD_LIGHTING, indices, level);
+
+        something_failed += ut_report( std::string { __func__ },
+                                       "verifing the " + std::string { simd_level_name(level) }
+                                       + " list of boards whose lamp differs from the target",
+                                       indices == expected );
+
+        std::vector<std::uint32_t> buffer(UT_BOARDS, 0xFFFFFFFFu);
+        const std::size_t found = fleet_find_field_differs(images, LAMP_PWR_FIELD, MOOD_LIGHTING, buffer.data(), level);
+        buffer.resize(found);
+
+        something_failed += ut_report( std::string { __func__ },
+                                       "verifing the " + std::string { simd_level_name(level) }
+                                       + " list stored into a buffer of the caller's",
+                                       buffer == expected );
+    }
+
+    return something_failed;
+}
+
+// verify that the histogram's and the count's 16 bit lane counters are
+// drained before they overflow, on a fleet large enough to overflow them
+int ut03()
+{
+    int something_failed = 0;
+
+    const std::size_t boards = 16 * 0x10000 + 5;
+
+    register_image_array images{ boards, 0 };
+    fleet_write_field(images, LAMP_PWR_FIELD, VERY_DIM_LIGHTS);
+    images[3] = LAMP_PWR_FIELD.insert(images[3], LIGHTS_OUT);
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        const std::vector<std::uint64_t> bins = fleet_field_histogram(images, LAMP_PWR_FIELD, level);
+
+        something_failed += ut_verify( std::string { __func__ },
+                                       "verifing the " + std::string { simd_level_name(level) }
+                                       + " count of dim lamps over a million boards",
+                                       bins[VERY_DIM_LIGHTS],
+                                       std::uint64_t { boards - 1 } );
+
+        something_failed += ut_verify( std::string { __func__ },
+                                       "verifing the " + std::string { simd_level_name(level) }
+                                       + " count of boards holding the dim setting",
+                                       fleet_count_field(images, LAMP_PWR_FIELD, VERY_DIM_LIGHTS, level),
+                                       std::size_t { boards - 1 } );
+    }
+
+    return something_failed;
+}
+
+// verify that each SIMD level rejects a target too wide for the field,
+// rather than matching it against the field's masked bits
+int ut04()
+{
+    int something_failed = 0;
+
+    register_image_array images{ 100, 0 };
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        bool count_rejected = false;
+        try
+        {
+            fleet_count_field(images, LAMP_PWR_FIELD, LAMP_OOR, level);
+        }
+        catch (std::range_error&)
+        {
+            count_rejected = true;
+        }
+
+        bool differs_rejected = false;
+        std::vector<std::uint32_t> indices;
+        try
+        {
+            fleet_find_field_differs(images, LAMP_PWR_FIELD, LAMP_OOR, indices, level);
+        }
+        catch (std::range_error&)
+        {
+            differs_rejected = true;
+        }
+
+        something_failed += ut_report( std::string { __func__ },
+                                       "verifing that the " + std::string { simd_level_name(level) }
+                                       + " queries reject lamp_pwr target 8",
+                                       count_rejected && differs_rejected && indices.empty() );
+    }
+
+    return something_failed;
+}
+
+// verify that a field too wide for the SIMD histograms' lane counters gets
+// its histogram, at every level, rather than overrunning the counters
+int ut05()
+{
+    int something_failed = 0;
+
+    register_image_array images{ UT_BOARDS, 0 };
+    randomize(images);
+
+    std::vector<std::uint64_t> expected(UT_FILLER_FIELD.max_value() + 1u, 0);
+    for (std::size_t i = 0; i < UT_BOARDS; ++i)
+    {
+        ++expected[UT_FILLER_FIELD.extract(images[i])];
+    }
+
+    for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+    {
+        something_failed += ut_report( std::string { __func__ },
+                                       "verifing the " + std::string { simd_level_name(level) }
+                                       + " histogram of the 11 bit filler",
+                                       fleet_field_histogram(images, UT_FILLER_FIELD, level) == expected );
+    }
+
+    return something_failed;
+}
+
+// verify each SIMD level's histogram of fields 1 to 4 bits wide, each of
+// which takes its own kernel, or the scalar one
+int ut06()
+{
+    int something_failed = 0;
+
+    register_image_array images{ UT_BOARDS, 0 };
+    randomize(images);
+
+    for (std::uint8_t width = 1; width <= 4; ++width)
+    {
+        const field_descriptor field { GPIO_REG23_ID, 3, 5, width };
+
+        std::vector<std::uint64_t> expected(field.max_value() + 1u, 0);
+        for (std::size_t i = 0; i < UT_BOARDS; ++i)
+        {
+            ++expected[field.extract(images[i])];
+        }
+
+        for (simd_level level : { simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2 })
+        {
+            something_failed += ut_report( std::string { __func__ },
+                                           "verifing the " + std::string { simd_level_name(level) }
+                                           + " histogram of a " + std::to_string(width) + " bit field",
+                                           fleet_field_histogram(images, field, level) == expected );
+        }
+    }
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // counting
+        { "ut01", ut01 },     // histogram
+        { "ut02", ut02 },     // finding differing boards
+        { "ut03", ut03 },     // lane counter overflow
+        { "ut04", ut04 },     // target range
+        { "ut05", ut05 },     // histogram of a wide field
+        { "ut06", ut06 },     // histogram of each narrow field width
+    } );
+}
@@ -0,0 +1,187 @@
+// ut_register_frame.cpp
+
+#include <cstddef>      //  std::size_t
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <string>       //  std::string
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "register_frame.h"
+#include "register_interlock.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+const std::size_t BOARDS { 200 };
+
+// the boards' mock registers, and their addresses
+std::vector<gpio_reg23_ptr_t> mock_registers(std::vector<genpurpIO_register23>& regs)
+{
+    std::vector<gpio_reg23_ptr_t> addrs;
+    for (genpurpIO_register23& reg : regs)
+    {
+        addrs.push_back(&reg);
+    }
+    return addrs;
+}
+
+// the number of registers whose lamp is at level
+std::size_t lamps_at(const std::vector<genpurpIO_register23>& regs, std::uint16_t level)
+{
+    std::size_t count = 0;
+    for (const genpurpIO_register23& reg : regs)
+    {
+        count += (reg.lamp_pwr == level);
+    }
+    return count;
+}
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that the frame buffer puts every register in its startup state
+int ut00()
+{
+    int something_failed = 0;
+
+    std::vector<genpurpIO_register23> regs(BOARDS, word_to_reg23(0));
+    for (genpurpIO_register23& reg : regs)
+    {
+        reg.energize_vac_solenoid2 = 1;
+        reg.lamp_pwr               = FULL_ILLUMINATION;
+    }
+
+    reg23_frame_buffer<> frames{ mock_registers(regs) };
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every lamp was killed on startup" },
+                                   lamps_at(regs, LIGHTS_OUT),
+                                   BOARDS );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every valve was closed on startup" },
+                                   reg23_to_word(regs[BOARDS - 1]),
+                                   std::uint16_t { 0 } );
+
+    return something_failed;
+}
+
+// verify that a frame reaches the registers at commit, and only then
+int ut01()
+{
+    int something_failed = 0;
+
+    std::vector<genpurpIO_register23> regs(BOARDS, word_to_reg23(0));
+    reg23_frame_buffer<> frames{ mock_registers(regs) };
+
+    for (std::size_t b = 0; b < frames.size(); ++b)
+    {
+        gpio_register_23< lamp_t > lamp42{ frames.back(b), REG23_ATTACH };
+        lamp42(MOOD_LIGHTING);
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that nothing reached the registers before the commit" },
+                                   lamps_at(regs, LIGHTS_OUT),
+                                   BOARDS );
+
+    frames.commit();
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the commit updated every register" },
+                                   lamps_at(regs, MOOD_LIGHTING),
+                                   BOARDS );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the front frame holds the committed frame" },
+                                   frames.front(0).lamp_pwr == MOOD_LIGHTING && frames.front(BOARDS - 1).lamp_pwr == MOOD_LIGHTING );
+
+    return something_failed;
+}
+
+// verify that the next frame starts from the committed one
+int ut02()
+{
+    int something_failed = 0;
+
+    std::vector<genpurpIO_register23> regs(BOARDS, word_to_reg23(0));
+    reg23_frame_buffer<> frames{ mock_registers(regs) };
+
+    gpio_register_23< solenoid3_t > vac_solenoid3{ frames.back(7), REG23_ATTACH };
+    vac_solenoid3(vacuum::ON);
+    frames.commit();
+
+    // the next frame only changes another board's lamp
+    gpio_register_23< lamp_t > lamp42{ frames.back(9), REG23_ATTACH };
+    lamp42(VERY_DIM_LIGHTS);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the new back frame was seeded from the front" },
+                                   gpio_register_23< solenoid3_t >{ frames.back(7), REG23_ATTACH }() == vacuum::ON );
+
+    frames.commit();
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the second commit kept the first frame's change" },
+                                   regs[7].energize_vac_solenoid3 == 1 && regs[9].lamp_pwr == VERY_DIM_LIGHTS );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the number of commits" },
+                                   frames.commits(),
+                                   std::uint64_t { 2 } );
+
+    return something_failed;
+}
+
+// verify that a frame breaking an interlock is rejected whole
+int ut03()
+{
+    int something_failed = 0;
+
+    std::vector<genpurpIO_register23> regs(BOARDS, word_to_reg23(0));
+    reg23_frame_buffer<> frames{ mock_registers(regs) };
+
+    for (std::size_t b = 0; b < frames.size(); ++b)
+    {
+        gpio_register_23< lamp_t > lamp42{ frames.back(b), REG23_ATTACH };
+        lamp42(BRIGHT_LIGHTS);
+    }
+
+    // a bright lamp while solenoid2 applies vacuum
+    gpio_register_23< solenoid2_t > vac_solenoid2{ frames.back(BOARDS / 2), REG23_ATTACH };
+    vac_solenoid2(vacuum::ON);
+
+    bool threw = false;
+    try
+    {
+        frames.commit();
+    }
+    catch (interlock_violation&)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the frame was rejected, leaving every register untouched" },
+                                   threw && lamps_at(regs, LIGHTS_OUT) == BOARDS && frames.commits() == 0 );
+
+    vac_solenoid2(vacuum::OFF);
+    frames.commit();
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the corrected frame was committed" },
+                                   lamps_at(regs, BRIGHT_LIGHTS),
+                                   BOARDS );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // startup
+        { "ut01", ut01 },     // commit
+        { "ut02", ut02 },     // seeding
+        { "ut03", ut03 },     // interlocks
+    } );
+}
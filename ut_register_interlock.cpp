@@ -0,0 +1,207 @@
+// ut_register_interlock.cpp
+
+#include <cstdint>      //  std::uint16_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+
+#include "control_board_gpio_reg23.h"
+#include "register_interlock.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+// the table is built by the compiler
+static_assert( REG23_INTERLOCKS.forbidden(SOLENOID2_FIELD.insert(SOLENOID3_FIELD.insert(0, 1), 1)),
+               "both solenoids energized is forbidden" );
+static_assert( !REG23_INTERLOCKS.forbidden(LAMP_PWR_FIELD.insert(SOLENOID2_FIELD.insert(0, 1), MOOD_LIGHTING)),
+               "mood lighting under vacuum is allowed" );
+
+//======================= Unit Tests Begin ======================================
+//
+// verify the compiled table against the rules, for every register word
+int ut00()
+{
+    int something_failed = 0;
+
+    bool agrees = true;
+    for (unsigned word = 0; word <= 0xFFFF; ++word)
+    {
+        const genpurpIO_register23 reg = word_to_reg23(static_cast<std::uint16_t>(word));
+
+        const bool expected = (reg.energize_vac_solenoid2 && reg.energize_vac_solenoid3)
+                              || ((reg.energize_vac_solenoid2 || reg.energize_vac_solenoid3) && reg.lamp_pwr > MOOD_LIGHTING);
+
+        agrees = agrees && REG23_INTERLOCKS.forbidden(static_cast<std::uint16_t>(word)) == expected;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the forbidden-state table against the rules, for all 65536 words" },
+                                   agrees );
+
+    return something_failed;
+}
+
+// verify that an allowed batch commits in full
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t >      lamp42{ &mock_reg23 };
+    gpio_register_23< solenoid2_t > vac_solenoid2{ &mock_reg23 };
+
+    lamp42(FULL_ILLUMINATION);
+
+    // dim the lamp and apply vacuum, together
+    register_transaction txn{ reg23_word(&mock_reg23), REG23_INTERLOCKS };
+    txn.set(LAMP_PWR_FIELD, MOOD_LIGHTING).set(SOLENOID2_FIELD, 1);
+    txn.commit();
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the batch dimmed the lamp and applied vacuum" },
+                                   lamp42() == MOOD_LIGHTING && vac_solenoid2() == vacuum::ON );
+
+    return something_failed;
+}
+
+// verify that a forbidden batch is rejected in full, naming the broken rule
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t >      lamp42{ &mock_reg23 };
+    gpio_register_23< solenoid2_t > vac_solenoid2{ &mock_reg23 };
+    gpio_register_23< solenoid3_t > vac_solenoid3{ &mock_reg23 };
+
+    vac_solenoid2(vacuum::ON);
+
+    const std::uint16_t before = *reg23_word(&mock_reg23);
+
+    std::string what;
+    try
+    {
+        register_transaction txn{ reg23_word(&mock_reg23), REG23_INTERLOCKS };
+        txn.set(LAMP_PWR_FIELD, VERY_DIM_LIGHTS).set(SOLENOID3_FIELD, 1);
+        txn.commit();
+    }
+    catch (interlock_violation & e)
+    {
+        what = e.what();
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the violation names the broken rule" },
+                                   what,
+                                   std::string { "Transaction rejected: it would break interlock rule "
+                                                 "'solenoid2 and solenoid3 must never both be energized'. " } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that none of the rejected batch reached the register" },
+                                   static_cast<std::uint16_t>(*reg23_word(&mock_reg23)),
+                                   before );
+
+    return something_failed;
+}
+
+// verify that a batch may swap solenoids, and that an out of range value
+// is rejected while staging
+int ut03()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< solenoid2_t > vac_solenoid2{ &mock_reg23 };
+    gpio_register_23< solenoid3_t > vac_solenoid3{ &mock_reg23 };
+
+    vac_solenoid2(vacuum::ON);
+
+    register_transaction swap{ reg23_word(&mock_reg23), REG23_INTERLOCKS };
+    swap.set(SOLENOID3_FIELD, 1).set(SOLENOID2_FIELD, 0);
+    swap.commit();
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the solenoids were swapped" },
+                                   vac_solenoid2() == vacuum::OFF && vac_solenoid3() == vacuum::ON );
+
+    bool threw = false;
+    try
+    {
+        register_transaction txn{ reg23_word(&mock_reg23), REG23_INTERLOCKS };
+        txn.set(LAMP_PWR_FIELD, LAMP_OOR);
+    }
+    catch (std::range_error &)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that an out of range lamp setting is rejected while staging" },
+                                   threw );
+
+    return something_failed;
+}
+
+// verify that a commit keeps another writer's update, made after the batch
+// was staged, and checks the interlock against the word it would publish
+int ut04()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t,      no_instrumentation, no_rate_limit, acq_rel_ordering > lamp42{ &mock_reg23 };
+    gpio_register_23< solenoid2_t, no_instrumentation, no_rate_limit, acq_rel_ordering > vac_solenoid2{ &mock_reg23 };
+    gpio_register_23< solenoid3_t, no_instrumentation, no_rate_limit, acq_rel_ordering > vac_solenoid3{ &mock_reg23 };
+
+    register_transaction< acq_rel_ordering > txn{ reg23_word(&mock_reg23), REG23_INTERLOCKS };
+    txn.set(SOLENOID3_FIELD, 1);
+
+    lamp42(MOOD_LIGHTING);      // another writer, after the batch was staged
+
+    txn.commit();
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the commit kept the other writer's lamp setting" },
+                                   lamp42() == MOOD_LIGHTING && vac_solenoid3() == vacuum::ON );
+
+    vac_solenoid3(vacuum::OFF);
+
+    register_transaction< acq_rel_ordering > again{ reg23_word(&mock_reg23), REG23_INTERLOCKS };
+    again.set(SOLENOID3_FIELD, 1);
+
+    vac_solenoid2(vacuum::ON);  // allowed on its own, forbidden with the staged solenoid3
+
+    const std::uint16_t before = reg23_load< acq_rel_ordering >(&mock_reg23);
+
+    bool threw = false;
+    try
+    {
+        again.commit();
+    }
+    catch (interlock_violation &)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the interlock is checked against the merged word" },
+                                   threw && reg23_load< acq_rel_ordering >(&mock_reg23) == before );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // table vs rules
+        { "ut01", ut01 },     // allowed batch
+        { "ut02", ut02 },     // rejected batch
+        { "ut03", ut03 },     // swap, range
+        { "ut04", ut04 },     // merge with another writer's update
+    } );
+}
@@ -0,0 +1,157 @@
+// ut_register_ordering.cpp
+
+#include <cstdint>      //  std::uint16_t, std::uint32_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <string>       //  std::string
+#include <thread>       //  std::thread, std::this_thread::yield
+
+#include "board_handle.h"
+#include "control_board_gpio_reg23.h"
+#include "register_ordering.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+// drives a register's three functors through a short sequence, returning
+// whether each call saw what it should have
+template< typename ordering >
+bool drive_functors(gpio_reg23_ptr_t preg)
+{
+    gpio_register_23< solenoid2_t, no_instrumentation, no_rate_limit, ordering > vac_solenoid2{ preg };
+    gpio_register_23< solenoid3_t, no_instrumentation, no_rate_limit, ordering > vac_solenoid3{ preg };
+    gpio_register_23< lamp_t,      no_instrumentation, no_rate_limit, ordering > lamp42{ preg };
+
+    bool ok = vac_solenoid2(vacuum::ON) == vacuum::OFF;
+    ok = ok && lamp42(MOOD_LIGHTING) == LIGHTS_OUT;
+    ok = ok && vac_solenoid2() == vacuum::ON && vac_solenoid3() == vacuum::OFF && lamp42() == MOOD_LIGHTING;
+    ok = ok && vac_solenoid2(vacuum::OFF) == vacuum::ON;
+    ok = ok && preg->energize_vac_solenoid2 == 0 && preg->energize_vac_solenoid3 == 0 && preg->lamp_pwr == MOOD_LIGHTING;
+
+    return ok;
+}
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that the functors behave the same under every ordering policy
+int ut00()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 relaxed_reg23;
+    static struct genpurpIO_register23 acq_rel_reg23;
+    static struct genpurpIO_register23 device_reg23;
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the functors with relaxed_ordering" },
+                                   drive_functors< relaxed_ordering >(&relaxed_reg23) );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the functors with acq_rel_ordering" },
+                                   drive_functors< acq_rel_ordering >(&acq_rel_reg23) );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing the functors with device_ordering" },
+                                   drive_functors< device_ordering >(&device_reg23) );
+
+    return something_failed;
+}
+
+// verify that an acquiring reader sees what a releasing writer did before its store
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mirror_reg23;
+    static std::uint32_t               payload[64];
+
+    const int rounds = 2000;
+    int       torn   = 0;
+
+    gpio_register_23< lamp_t, no_instrumentation, no_rate_limit, acq_rel_ordering > writer_lamp{ &mirror_reg23 };
+
+    std::thread reader([&torn]()
+    {
+        // the reader loads the word directly: constructing a functor would kill the lamp
+        for (int r = 0; r < rounds; ++r)
+        {
+            const std::uint16_t expected = (r & 1) ? FULL_ILLUMINATION : VERY_DIM_LIGHTS;
+            while (LAMP_PWR_FIELD.extract(reg23_load< acq_rel_ordering >(&mirror_reg23)) != expected)
+            {
+                std::this_thread::yield();      // the writer may share our core
+            }
+
+            for (std::uint32_t p : payload)
+            {
+                torn += (p != static_cast<std::uint32_t>(r));
+            }
+
+            // hand the turn back
+            reg23_store< acq_rel_ordering >(&mirror_reg23, SOLENOID3_FIELD.insert(reg23_load< acq_rel_ordering >(&mirror_reg23), 1));
+        }
+    });
+
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (std::uint32_t& p : payload)
+        {
+            p = static_cast<std::uint32_t>(r);
+        }
+
+        writer_lamp((r & 1) ? FULL_ILLUMINATION : VERY_DIM_LIGHTS);      // releases the payload
+
+        while (SOLENOID3_FIELD.extract(reg23_load< acq_rel_ordering >(&mirror_reg23)) != 1)
+        {
+            std::this_thread::yield();
+        }
+        reg23_store< acq_rel_ordering >(&mirror_reg23, SOLENOID3_FIELD.insert(reg23_load< acq_rel_ordering >(&mirror_reg23), 0));
+    }
+
+    reader.join();
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the reader never saw a stale payload" },
+                                   torn,
+                                   0 );
+
+    return something_failed;
+}
+
+// verify that a board handle takes an ordering policy
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 device_reg23;
+    device_reg23.lamp_pwr = FULL_ILLUMINATION;
+
+    board_handle< no_instrumentation, no_rate_limit, device_ordering > board{ &device_reg23 };
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the handle killed the lamp on startup" },
+                                   board.lamp42(),
+                                   LIGHTS_OUT );
+
+    board.vac_solenoid3(vacuum::ON);
+    board.lamp42(VERY_DIM_LIGHTS);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the handle's writes reached the register" },
+                                   device_reg23.energize_vac_solenoid3 == 1 && device_reg23.lamp_pwr == VERY_DIM_LIGHTS
+                                   && board.vac_solenoid3() == vacuum::ON );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the ordering policy takes no space" },
+                                   sizeof(board),
+                                   sizeof(board_handle<>) );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // the three policies
+        { "ut01", ut01 },     // acquire/release
+        { "ut02", ut02 },     // board_handle
+    } );
+}
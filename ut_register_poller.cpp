@@ -0,0 +1,262 @@
+// ut_register_poller.cpp
+
+#include <atomic>       //  std::atomic
+#include <chrono>       //  std::chrono::microseconds
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <string>       //  std::string
+#include <thread>       //  std::thread
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "register_poller.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+using std::chrono::microseconds;
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that only the callbacks of fields whose bits changed are called,
+// with the field's old and new values
+int ut00()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t >      lamp42{ &mock_reg23 };
+    gpio_register_23< solenoid2_t > vac_solenoid2{ &mock_reg23 };
+
+    register_poller poller{ microseconds(100), microseconds(1600) };
+
+    std::vector<std::uint16_t> lamp_changes;
+    int                        solenoid2_changes = 0;
+
+    const register_poller::time_point_t t0 {};
+
+    poller.watch(reg23_word(&mock_reg23), LAMP_PWR_FIELD,
+                 [&](const field_descriptor&, std::uint16_t old_val, std::uint16_t new_val)
+                 {
+                     lamp_changes.push_back(old_val);
+                     lamp_changes.push_back(new_val);
+                 }, t0);
+    poller.watch(reg23_word(&mock_reg23), SOLENOID2_FIELD,
+                 [&](const field_descriptor&, std::uint16_t, std::uint16_t) { ++solenoid2_changes; }, t0);
+
+    poller.poll_due(t0);                            // baseline
+    lamp42(MOOD_LIGHTING);
+    poller.poll_due(t0 + microseconds(100));
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the lamp's callback saw it go from lights out to mood lighting" },
+                                   lamp_changes == std::vector<std::uint16_t>{ LIGHTS_OUT, MOOD_LIGHTING } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that solenoid2's callback was not called" },
+                                   solenoid2_changes,
+                                   0 );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that both fields share a single register read per poll" },
+                                   poller.polls(),
+                                   std::uint64_t { 2 } );
+
+    return something_failed;
+}
+
+// verify that the interval backs off while quiet and tightens on activity
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t > lamp42{ &mock_reg23 };
+
+    register_poller poller{ microseconds(100), microseconds(1600) };
+
+    register_poller::time_point_t now {};
+    poller.watch(reg23_word(&mock_reg23), LAMP_PWR_FIELD, [](const field_descriptor&, std::uint16_t, std::uint16_t) {}, now);
+
+    // poll whenever due, for 100 quiet polls
+    for (int i = 0; i < 100; ++i)
+    {
+        poller.poll_due(now);
+        now = poller.next_due();
+    }
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a quiet register backed off to the maximum interval" },
+                                   poller.interval(reg23_word(&mock_reg23)).count(),
+                                   std::chrono::nanoseconds(microseconds(1600)).count() );
+
+    lamp42(BRIGHT_LIGHTS);
+    poller.poll_due(now);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a change snapped the interval back to the minimum" },
+                                   poller.interval(reg23_word(&mock_reg23)).count(),
+                                   std::chrono::nanoseconds(microseconds(100)).count() );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the next poll is due a minimum interval later" },
+                                   poller.next_due() == now + microseconds(100) );
+
+    return something_failed;
+}
+
+// verify that a change to bits no one watches is a quiet poll
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< solenoid3_t > vac_solenoid3{ &mock_reg23 };
+
+    register_poller poller{ microseconds(100), microseconds(1600) };
+
+    int lamp_changes = 0;
+
+    const register_poller::time_point_t t0 {};
+    poller.watch(reg23_word(&mock_reg23), LAMP_PWR_FIELD,
+                 [&](const field_descriptor&, std::uint16_t, std::uint16_t) { ++lamp_changes; }, t0);
+
+    poller.poll_due(t0);
+    vac_solenoid3(vacuum::ON);
+    poller.poll_due(t0 + microseconds(100));
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that solenoid3's change called no callback" },
+                                   lamp_changes,
+                                   0 );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that both polls counted as quiet" },
+                                   poller.quiet_polls(),
+                                   std::uint64_t { 2 } );
+
+    return something_failed;
+}
+
+// verify that run() notices a change made by another thread
+int ut03()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t > lamp42{ &mock_reg23 };
+
+    register_poller poller{ microseconds(100), microseconds(2000) };
+
+    std::atomic<bool> stop {false};
+    std::atomic<int>  full_power_seen {0};
+
+    poller.watch(reg23_word(&mock_reg23), LAMP_PWR_FIELD,
+                 [&](const field_descriptor&, std::uint16_t, std::uint16_t new_val)
+                 {
+                     if (new_val == FULL_ILLUMINATION)
+                     {
+                         ++full_power_seen;
+                     }
+                 });
+
+    std::thread polling( [&]() { poller.run(stop); } );
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    lamp42(FULL_ILLUMINATION);
+
+    for (int waited = 0; waited < 5000 && full_power_seen == 0; ++waited)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    stop = true;
+    polling.join();
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the polling thread saw the lamp go to full power" },
+                                   full_power_seen.load(),
+                                   1 );
+
+    return something_failed;
+}
+
+// verify that a callback may start watching other fields, of its own
+// register and of another, while the poller is calling it
+int ut04()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+    static struct genpurpIO_register23 other_reg23;
+
+    gpio_register_23< lamp_t >      lamp42{ &mock_reg23 };
+    gpio_register_23< solenoid2_t > vac_solenoid2{ &mock_reg23 };
+    gpio_register_23< solenoid3_t > other_solenoid3{ &other_reg23 };
+
+    register_poller poller{ microseconds(100), microseconds(1600) };
+
+    const std::size_t WATCHES { 64 };   // enough to outgrow whatever room the watches had
+    int solenoid2_changes = 0;
+    int solenoid3_changes = 0;
+
+    const register_poller::time_point_t t0 {};
+
+    poller.watch(reg23_word(&mock_reg23), LAMP_PWR_FIELD,
+                 [&](const field_descriptor&, std::uint16_t, std::uint16_t)
+                 {
+                     for (std::size_t i = 0; i < WATCHES; ++i)
+                     {
+                         poller.watch(reg23_word(&mock_reg23), SOLENOID2_FIELD,
+                                      [&](const field_descriptor&, std::uint16_t, std::uint16_t) { ++solenoid2_changes; },
+                                      t0);
+                     }
+                     poller.watch(reg23_word(&other_reg23), SOLENOID3_FIELD,
+                                  [&](const field_descriptor&, std::uint16_t, std::uint16_t) { ++solenoid3_changes; },
+                                  t0);
+                 },
+                 t0);
+
+    poller.poll_due(t0);                                // baseline
+
+    lamp42(FULL_ILLUMINATION);
+    vac_solenoid2(vacuum::ON);                          // changes along with the lamp
+    poller.poll_due(t0 + microseconds(100));            // the lamp's callback adds the watches
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the watches added by the callback missed its change" },
+                                   solenoid2_changes,
+                                   0 );
+
+    poller.poll_due(t0 + microseconds(200));            // baselines the other register
+    vac_solenoid2(vacuum::OFF);
+    other_solenoid3(vacuum::ON);
+    poller.poll_due(t0 + microseconds(300));
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that each added watch on the callback's register was called" },
+                                   solenoid2_changes,
+                                   static_cast<int>(WATCHES) );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the added watch on another register was called" },
+                                   solenoid3_changes,
+                                   1 );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // changed fields only
+        { "ut01", ut01 },     // adaptive interval
+        { "ut02", ut02 },     // unwatched bits
+        { "ut03", ut03 },     // run()
+        { "ut04", ut04 },     // watching from a callback
+    } );
+}
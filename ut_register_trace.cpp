@@ -0,0 +1,257 @@
+// ut_register_trace.cpp
+
+#include <cstdint>      //  std::uint64_t
+#include <cstdio>       //  std::remove, std::fopen, std::fread, std::fwrite
+#include <iostream>     //  for sending text to stdout, stderr
+#include <sstream>      //  std::stringstream
+#include <string>       //  std::string
+#include <thread>       //  std::thread
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "register_trace.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+typedef gpio_register_23< solenoid2_t, tracing_instrumentation >   traced_solenoid2_t;
+typedef gpio_register_23< lamp_t,      tracing_instrumentation >   traced_lamp_t;
+
+const std::string UT_TRACE_FILE { "./ut_register_trace.bin" };
+
+// renders the records as text, time stamps omitted, so that UTs
+// can compare them against the expected accesses
+std::string records_as_text(const std::vector<trace_record>& records)
+{
+    std::stringstream text {};
+
+    for (const trace_record& rec : records)
+    {
+        std::stringstream line {};
+        format_trace_record(line, rec, rec.tsc);    // time stamp renders as 0
+
+        text << line.str().substr(12);              // toss the time stamp column
+    }
+
+    return text.str();
+}
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that each access through a traced functor is recorded
+int ut00()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    std::vector<trace_record> discard;
+    tracing_instrumentation::drain(discard);    // start from an empty trace
+
+    traced_lamp_t lamp42{ &mock_reg23 };
+
+    lamp42(BRIGHT_LIGHTS);
+    lamp42(BRIGHT_LIGHTS);
+    lamp42();
+    try
+    {
+        lamp42(LAMP_OOR);
+    }
+    catch (std::range_error &)
+    {
+        // expected
+    }
+
+    std::vector<trace_record> records;
+    tracing_instrumentation::drain(records);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that each of the lamp's accesses was recorded" },
+                                   records.size(),
+                                   std::size_t { 4 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the recorded accesses" },
+                                   records_as_text(records),
+                                   std::string { "  reg23  field2  write        0 -> 4\n"
+                                                 "  reg23  field2  elided       4\n"
+                                                 "  reg23  field2  read         4\n"
+                                                 "  reg23  field2  range_error  rejected 8\n" } );
+
+    bool in_order = true;
+    for (std::size_t i = 1; i < records.size(); ++i)
+    {
+        in_order = in_order && (records[i - 1].tsc <= records[i].tsc);
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the records' time stamps are in order" },
+                                   in_order );
+
+    return something_failed;
+}
+
+// verify that a full ring drops, and counts, the accesses it cannot hold
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    std::vector<trace_record> records;
+    tracing_instrumentation::drain(records);
+    records.clear();
+
+    const std::uint64_t dropped_before = tracing_instrumentation::dropped();
+
+    traced_solenoid2_t vac_solenoid2{ &mock_reg23 };
+
+    for (std::size_t i = 0; i < TRACE_RING_CAPACITY + 5; ++i)
+    {
+        vac_solenoid2();
+    }
+
+    tracing_instrumentation::drain(records);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a full ring holds exactly its capacity" },
+                                   records.size(),
+                                   TRACE_RING_CAPACITY );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the accesses a full ring cannot hold are counted as dropped" },
+                                   tracing_instrumentation::dropped() - dropped_before,
+                                   std::uint64_t { 5 } );
+
+    return something_failed;
+}
+
+// verify that the records survive a round trip through a trace file,
+// including the records of a thread which has since exited
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    std::vector<trace_record> discard;
+    tracing_instrumentation::drain(discard);
+    std::remove(UT_TRACE_FILE.c_str());
+
+    traced_solenoid2_t vac_solenoid2{ &mock_reg23 };
+    vac_solenoid2(vacuum::ON);
+
+    std::thread worker( []()
+                        {
+                            traced_lamp_t lamp42{ &mock_reg23 };
+                            lamp42(VERY_DIM_LIGHTS);
+                        } );
+    worker.join();
+
+    const std::size_t first_flush = flush_trace(UT_TRACE_FILE);
+
+    vac_solenoid2(vacuum::OFF);
+
+    const std::size_t second_flush = flush_trace(UT_TRACE_FILE);
+
+    trace_file_header hdr {};
+    std::vector<trace_record> records = read_trace(UT_TRACE_FILE, hdr);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that both flushes were appended to the trace file" },
+                                   first_flush + second_flush,
+                                   std::size_t { 3 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the records read back from the trace file" },
+                                   records_as_text(records),
+                                   std::string { "  reg23  field2  write        0 -> 1\n"
+                                                 "  reg23  field0  write        0 -> 1\n"
+                                                 "  reg23  field0  write        1 -> 0\n" } );
+
+    std::remove(UT_TRACE_FILE.c_str());
+
+    return something_failed;
+}
+
+// verify that a file which is not a trace file is rejected
+int ut03()
+{
+    std::string ut_intent { "verifing that a file which is not a trace file is rejected" };
+
+    int something_failed = 1;   // init to UT failure
+
+    try
+    {
+        trace_file_header hdr {};
+        read_trace("./Makefile", hdr);
+    }
+    catch (std::runtime_error &)
+    {
+        something_failed = 0;
+    }
+
+    return ut_report( std::string { __func__ }, ut_intent, something_failed == 0 );
+}
+
+// verify that a header whose record count overruns the file is rejected,
+// including a count so large that its byte size wraps around
+int ut04()
+{
+    int something_failed = 0;
+
+    std::remove(UT_TRACE_FILE.c_str());
+    append_trace(UT_TRACE_FILE, std::vector<trace_record>(2));
+
+    for (const std::uint64_t count : { std::uint64_t{3}, std::uint64_t{ (~std::uint64_t{0} / sizeof(trace_record)) + 2 } })
+    {
+        trace_file_header hdr {};
+        {
+            std::FILE* f = std::fopen(UT_TRACE_FILE.c_str(), "r+b");
+            (void)!std::fread(&hdr, sizeof(hdr), 1, f);
+            hdr.count = count;
+            std::fseek(f, 0, SEEK_SET);
+            std::fwrite(&hdr, sizeof(hdr), 1, f);
+            std::fclose(f);
+        }
+
+        bool read_rejected = false;
+        try
+        {
+            read_trace(UT_TRACE_FILE, hdr);
+        }
+        catch (std::runtime_error &)
+        {
+            read_rejected = true;
+        }
+
+        bool append_rejected = false;
+        try
+        {
+            append_trace(UT_TRACE_FILE, std::vector<trace_record>(1));
+        }
+        catch (std::runtime_error &)
+        {
+            append_rejected = true;
+        }
+
+        something_failed += ut_report( std::string { __func__ },
+                                       std::string { "verifing that a count of " } + std::to_string(count) + " records is rejected",
+                                       read_rejected && append_rejected );
+    }
+
+    std::remove(UT_TRACE_FILE.c_str());
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // accesses are recorded
+        { "ut01", ut01 },     // full ring drops and counts
+        { "ut02", ut02 },     // trace file round trip
+        { "ut03", ut03 },     // non-trace files are rejected
+        { "ut04", ut04 },     // overlong record counts are rejected
+    } );
+}
@@ -0,0 +1,241 @@
+// ut_solenoid_rate_limit.cpp
+
+#include <chrono>       //  std::chrono::hours, std::chrono::milliseconds
+#include <cstdint>      //  std::uint32_t, std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::invalid_argument
+#include <string>       //  std::string
+#include <utility>      //  std::move
+
+#include "board_handle.h"
+#include "control_board_gpio_reg23.h"
+#include "field_instrumentation.h"
+#include "solenoid_rate_limit.h"
+#include "solenoid_typestate.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+static_assert(sizeof(gpio_register_23< solenoid2_t >) == sizeof(gpio_reg23_ptr_t),
+              "no_rate_limit must add nothing to the functor");
+
+// limits no UT toggles its way past: one toggle, then a long rest
+void configure_one_toggle_per_hour()
+{
+    coil_rate_limit::configure(std::chrono::hours(1), 1, std::chrono::hours(1));
+}
+
+//======================= Unit Tests Begin ======================================
+//
+// verify the bucket's dwell and toggles-per-window limits, on a made up clock
+int ut00()
+{
+    int something_failed = 0;
+
+    // at least 10 ticks apart, at most 4 toggles within any 400 ticks
+    const toggle_limits limits { 10, 100, 300 };
+    toggle_bucket       bucket {};
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the first toggle is admitted" },
+                                   bucket.admit(limits, 1000) );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a toggle within the dwell time is refused" },
+                                   !bucket.admit(limits, 1005) );
+
+    const bool burst_admitted = bucket.admit(limits, 1010) && bucket.admit(limits, 1020) && bucket.admit(limits, 1030);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that 4 toggles in a row are admitted" },
+                                   burst_admitted );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a 5th toggle within the window is refused" },
+                                   !bucket.admit(limits, 1040) );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a toggle is admitted again once an interval has passed" },
+                                   bucket.admit(limits, 1100) );
+
+    return something_failed;
+}
+
+// verify that the functor refuses a toggle, and reports it to the instrumentation
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    configure_one_toggle_per_hour();
+
+    gpio_register_23< solenoid2_t, counting_instrumentation, coil_rate_limit > vac_solenoid2{ &mock_reg23 };
+
+    const field_stats before = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID2_FIELD_ID);
+
+    vac_solenoid2(vacuum::ON);
+    vac_solenoid2(vacuum::ON);      // elided, so it uses up no toggle
+    vac_solenoid2(vacuum::OFF);     // too soon
+
+    const field_stats after = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID2_FIELD_ID);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the refused toggle left the solenoid energized" },
+                                   vac_solenoid2() == vacuum::ON );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that one toggle was counted as rate limited" },
+                                   after.rate_limited - before.rate_limited,
+                                   std::uint64_t { 1 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that one write and one elided write were counted" },
+                                   (after.writes - before.writes) + (after.elided_writes - before.elided_writes),
+                                   std::uint64_t { 2 } );
+
+    return something_failed;
+}
+
+// verify that a board handle keeps a bucket per solenoid, and counts refusals
+int ut02()
+{
+    int something_failed = 0;
+
+    configure_one_toggle_per_hour();
+
+    board_handle< no_instrumentation, coil_rate_limit > board;
+
+    board.vac_solenoid2(vacuum::ON);
+    board.vac_solenoid3(vacuum::ON);    // solenoid3's own bucket is still full
+    board.vac_solenoid2(vacuum::OFF);
+    board.vac_solenoid3(vacuum::OFF);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that each solenoid got its one toggle" },
+                                   board.reg23.energize_vac_solenoid2 == 1 && board.reg23.energize_vac_solenoid3 == 1 );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the board counted both refusals" },
+                                   board.stats.rate_limited,
+                                   std::uint32_t { 2 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the board counted only the admitted toggles as writes" },
+                                   board.stats.writes,
+                                   std::uint32_t { 2 } );
+
+    return something_failed;
+}
+
+// verify the conversion of limits in time into limits in ticks
+int ut03()
+{
+    int something_failed = 0;
+
+    // 50ms dwell, 10 toggles a second, on a 1GHz counter
+    const toggle_limits limits = to_toggle_limits(std::chrono::milliseconds(50), 10, std::chrono::seconds(1), 1e9);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the dwell time in ticks" },
+                                   limits.min_dwell,
+                                   std::uint64_t { 50000000 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the interval between toggles in ticks" },
+                                   limits.interval,
+                                   std::uint64_t { 100000000 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing the burst allowance in ticks" },
+                                   limits.burst,
+                                   std::uint64_t { 900000000 } );
+
+    bool threw = false;
+    try
+    {
+        to_toggle_limits(std::chrono::milliseconds(50), 0, std::chrono::seconds(1), 1e9);
+    }
+    catch (std::invalid_argument&)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that zero toggles per window is refused" },
+                                   threw );
+
+    return something_failed;
+}
+
+// verify that every accessor of a solenoid shares its one toggle budget
+int ut04()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    configure_one_toggle_per_hour();
+
+    gpio_register_23< solenoid2_t, no_instrumentation, coil_rate_limit > vac_solenoid2{ &mock_reg23 };
+    gpio_register_23< solenoid2_t, no_instrumentation, coil_rate_limit > also_vac_solenoid2{ &mock_reg23, REG23_ATTACH };
+    gpio_register_23< solenoid3_t, no_instrumentation, coil_rate_limit > vac_solenoid3{ &mock_reg23 };
+    board_handle< no_instrumentation, coil_rate_limit >                  board{ &mock_reg23 };
+
+    vac_solenoid2(vacuum::ON);              // the solenoid's one toggle
+    also_vac_solenoid2(vacuum::OFF);        // too soon, through another functor
+    board.vac_solenoid2(vacuum::OFF);       // too soon, through the board's accessor
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that a second functor and a board handle were refused the toggle" },
+                                   vac_solenoid2() == vacuum::ON && board.stats.rate_limited == 1 );
+
+    vac_solenoid3(vacuum::ON);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the register's other solenoid kept its own budget" },
+                                   vac_solenoid3() == vacuum::ON );
+
+    return something_failed;
+}
+
+// verify that a refused typestate transition throws, leaving its state as it was
+int ut05()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    configure_one_toggle_per_hour();
+
+    auto off = solenoid_startup< solenoid3_t, no_instrumentation, coil_rate_limit >(&mock_reg23);
+    auto on  = std::move(off).energize();   // the solenoid's one toggle
+
+    bool threw = false;
+    try
+    {
+        off = std::move(on).deenergize();   // too soon
+    }
+    catch (toggle_refused&)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the refused transition threw, and left the solenoid energized" },
+                                   threw && mock_reg23.energize_vac_solenoid3 == 1 );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // bucket
+        { "ut01", ut01 },     // functor
+        { "ut02", ut02 },     // board handle
+        { "ut03", ut03 },     // limits in ticks
+        { "ut04", ut04 },     // one bucket per field
+        { "ut05", ut05 },     // typestate
+    } );
+}
@@ -0,0 +1,152 @@
+// ut_solenoid_typestate.cpp
+
+#include <cstdint>      //  std::uint16_t, std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <string>       //  std::string
+#include <type_traits>  //  std::is_copy_constructible
+#include <utility>      //  std::move
+
+#include "control_board_gpio_reg23.h"
+#include "field_instrumentation.h"
+#include "solenoid_typestate.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+// what the compiler must refuse is covered by typestate_misuse.cpp; these
+// are the properties the refusals rest on
+static_assert( !std::is_copy_constructible< solenoid_off< solenoid2_t > >::value, "a state can't be duplicated" );
+static_assert( !std::is_copy_constructible< solenoid_on< solenoid2_t > >::value,  "a state can't be duplicated" );
+static_assert( sizeof(solenoid_on< solenoid3_t >) == sizeof(gpio_reg23_ptr_t),
+               "a state is nothing more than the register's address" );
+static_assert( sizeof(vacuum_pair_off<>) == sizeof(gpio_reg23_ptr_t),
+               "without a rate limiting policy, a pair state is nothing more than the register's address" );
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that startup closes the valve, and that transitions drive the solenoid
+int ut00()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    mock_reg23.energize_vac_solenoid2 = 1;
+    mock_reg23.lamp_pwr               = MOOD_LIGHTING;
+
+    auto off = solenoid_startup< solenoid2_t >(&mock_reg23);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that startup closed solenoid2's valve" },
+                                   static_cast<unsigned>(mock_reg23.energize_vac_solenoid2),
+                                   0u );
+
+    auto on = std::move(off).energize();
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that energize() energized solenoid2" },
+                                   static_cast<unsigned>(mock_reg23.energize_vac_solenoid2),
+                                   1u );
+
+    off = std::move(on).deenergize();
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that deenergize() de-energized solenoid2" },
+                                   static_cast<unsigned>(mock_reg23.energize_vac_solenoid2),
+                                   0u );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the lamp was left alone" },
+                                   static_cast<unsigned>(mock_reg23.lamp_pwr),
+                                   unsigned { MOOD_LIGHTING } );
+
+    return something_failed;
+}
+
+// verify that transitions report writes to the instrumentation, and never read
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    auto off = solenoid_startup< solenoid3_t, counting_instrumentation >(&mock_reg23);
+
+    const field_stats before = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID3_FIELD_ID);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        off = std::move(off).energize().deenergize();
+    }
+
+    const field_stats after = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID3_FIELD_ID);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that 10 on/off cycles counted 20 writes" },
+                                   after.writes - before.writes,
+                                   std::uint64_t { 20 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the transitions read nothing back" },
+                                   after.reads - before.reads,
+                                   std::uint64_t { 0 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that no write was elided" },
+                                   after.elided_writes - before.elided_writes,
+                                   std::uint64_t { 0 } );
+
+    return something_failed;
+}
+
+// verify that the vacuum pair alternates its solenoids without breaking the interlock
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    mock_reg23.energize_vac_solenoid2 = 1;
+    mock_reg23.energize_vac_solenoid3 = 1;
+
+    auto idle = vacuum_pair_startup(&mock_reg23);
+
+    bool never_forbidden = !REG23_INTERLOCKS.forbidden(*reg23_word(&mock_reg23));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        auto two_on = std::move(idle).energize_solenoid2();
+        never_forbidden = never_forbidden && !REG23_INTERLOCKS.forbidden(*reg23_word(&mock_reg23));
+
+        idle = std::move(two_on).deenergize_solenoid2();
+
+        auto three_on = std::move(idle).energize_solenoid3();
+        never_forbidden = never_forbidden && !REG23_INTERLOCKS.forbidden(*reg23_word(&mock_reg23));
+
+        something_failed += ut_report( std::string { __func__ },
+                                       std::string { "verifing that only solenoid3 is energized" },
+                                       mock_reg23.energize_vac_solenoid2 == 0 && mock_reg23.energize_vac_solenoid3 == 1 );
+
+        idle = std::move(three_on).deenergize_solenoid3();
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the register never held a forbidden word" },
+                                   never_forbidden );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that both solenoids ended de-energized" },
+                                   static_cast<unsigned>(mock_reg23.energize_vac_solenoid2 | mock_reg23.energize_vac_solenoid3),
+                                   0u );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // single solenoid
+        { "ut01", ut01 },     // instrumentation
+        { "ut02", ut02 },     // vacuum pair
+    } );
+}
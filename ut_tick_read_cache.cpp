@@ -0,0 +1,215 @@
+// ut_tick_read_cache.cpp
+
+#include <chrono>       //  std::chrono::hours
+#include <cstdint>      //  std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <stdexcept>    //  std::range_error
+#include <string>       //  std::string
+
+#include "control_board_gpio_reg23.h"
+#include "field_instrumentation.h"
+#include "register_ordering.h"
+#include "solenoid_rate_limit.h"
+#include "tick_read_cache.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that a tick's getters share one register read
+int ut00()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t > lamp42{ &mock_reg23 };
+    lamp42(BRIGHT_LIGHTS);
+
+    reg23_read_cache cache{ &mock_reg23 };
+    cached_gpio_register_23< solenoid2_t > cached_solenoid2{ cache };
+    cached_gpio_register_23< solenoid3_t > cached_solenoid3{ cache };
+    cached_gpio_register_23< lamp_t >      cached_lamp42{ cache };
+
+    bool as_read = false;
+    {
+        tick_scope tick{ cache };
+        as_read = cached_solenoid2() == vacuum::OFF && cached_solenoid3() == vacuum::OFF && cached_lamp42() == BRIGHT_LIGHTS;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the getters returned the register's fields" },
+                                   as_read );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that three getters read the register once" },
+                                   cache.loads(),
+                                   std::uint64_t { 1 } );
+
+    return something_failed;
+}
+
+// verify that a tick does not see outside changes, and the next tick does
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< lamp_t > lamp42{ &mock_reg23 };
+
+    reg23_read_cache cache{ &mock_reg23 };
+    cached_gpio_register_23< lamp_t > cached_lamp42{ cache };
+
+    {
+        tick_scope tick{ cache };
+        cached_lamp42();
+        lamp42(FULL_ILLUMINATION);      // not through the cache
+
+        something_failed += ut_verify( std::string { __func__ },
+                                       std::string { "verifing that the tick kept its word" },
+                                       cached_lamp42(),
+                                       LIGHTS_OUT );
+    }
+
+    {
+        tick_scope tick{ cache };
+
+        something_failed += ut_verify( std::string { __func__ },
+                                       std::string { "verifing that the next tick read the register afresh" },
+                                       cached_lamp42(),
+                                       FULL_ILLUMINATION );
+    }
+
+    cache.invalidate();
+    lamp42(MOOD_LIGHTING);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that an explicit invalidate also refreshes" },
+                                   cached_lamp42(),
+                                   MOOD_LIGHTING );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing one register read per tick" },
+                                   cache.loads(),
+                                   std::uint64_t { 3 } );
+
+    return something_failed;
+}
+
+// verify that the setters write through, keeping the tick's word in step
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    reg23_read_cache cache{ &mock_reg23 };
+    cached_gpio_register_23< solenoid2_t > cached_solenoid2{ cache };
+    cached_gpio_register_23< solenoid3_t > cached_solenoid3{ cache };
+    cached_gpio_register_23< lamp_t >      cached_lamp42{ cache };
+
+    tick_scope tick{ cache };
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the setter returned the solenoid's previous state" },
+                                   cached_solenoid3(vacuum::ON) == vacuum::OFF );
+
+    cached_lamp42(MOOD_LIGHTING);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the writes reached the register" },
+                                   mock_reg23.energize_vac_solenoid3 == 1 && mock_reg23.lamp_pwr == MOOD_LIGHTING
+                                   && mock_reg23.energize_vac_solenoid2 == 0 );
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the getters see the writes" },
+                                   cached_solenoid3() == vacuum::ON && cached_lamp42() == MOOD_LIGHTING
+                                   && cached_solenoid2() == vacuum::OFF );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that only the two setters read the register" },
+                                   cache.loads(),
+                                   std::uint64_t { 2 } );
+
+    bool threw = false;
+    try
+    {
+        cached_lamp42(LAMP_OOR);
+    }
+    catch (std::range_error&)
+    {
+        threw = true;
+    }
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that an out of range lamp setting is rejected" },
+                                   threw && mock_reg23.lamp_pwr == MOOD_LIGHTING );
+
+    return something_failed;
+}
+
+// verify that a setter keeps another writer's change made within the tick
+int ut03()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    gpio_register_23< solenoid2_t, no_instrumentation, no_rate_limit, acq_rel_ordering > vac_solenoid2{ &mock_reg23 };
+
+    reg23_read_cache< acq_rel_ordering > cache{ &mock_reg23 };
+    cached_gpio_register_23< lamp_t, no_instrumentation, no_rate_limit, acq_rel_ordering > cached_lamp42{ cache };
+
+    tick_scope tick{ cache };
+
+    cached_lamp42();                    // the tick's word
+    vac_solenoid2(vacuum::ON);          // not through the cache
+    cached_lamp42(MOOD_LIGHTING);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the setter kept the other writer's solenoid setting" },
+                                   mock_reg23.energize_vac_solenoid2 == 1 && mock_reg23.lamp_pwr == MOOD_LIGHTING );
+
+    return something_failed;
+}
+
+// verify that a cached solenoid shares its toggle budget with the functors
+int ut04()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 mock_reg23;
+
+    coil_rate_limit::configure(std::chrono::hours(1), 1, std::chrono::hours(1));
+
+    gpio_register_23< solenoid3_t, no_instrumentation, coil_rate_limit > vac_solenoid3{ &mock_reg23 };
+
+    reg23_read_cache cache{ &mock_reg23 };
+    cached_gpio_register_23< solenoid3_t, counting_instrumentation, coil_rate_limit > cached_solenoid3{ cache };
+
+    const field_stats before = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID3_FIELD_ID);
+
+    vac_solenoid3(vacuum::ON);          // the solenoid's one toggle
+    cached_solenoid3(vacuum::OFF);      // too soon
+
+    const field_stats after = counting_instrumentation::this_thread(GPIO_REG23_ID, SOLENOID3_FIELD_ID);
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that the cached setter was refused the toggle" },
+                                   mock_reg23.energize_vac_solenoid3 == 1 && after.rate_limited - before.rate_limited == 1 );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // coalesced reads
+        { "ut01", ut01 },     // invalidation
+        { "ut02", ut02 },     // write through
+        { "ut03", ut03 },     // setters read afresh
+        { "ut04", ut04 },     // policies
+    } );
+}
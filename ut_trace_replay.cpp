@@ -0,0 +1,191 @@
+// ut_trace_replay.cpp
+
+#include <chrono>       //  std::chrono::steady_clock
+#include <cstdint>      //  std::uint64_t
+#include <iostream>     //  for sending text to stdout, stderr
+#include <string>       //  std::string
+#include <vector>       //  std::vector
+
+#include "control_board_gpio_reg23.h"
+#include "register_trace.h"
+#include "trace_replay.h"
+#include "ut_common.h"
+#include "ut_harness.h"
+
+// capture_shift() -- drives traced functors through a short "production
+//                    shift" and returns the trace it left behind
+std::vector<trace_record> capture_shift()
+{
+    static struct genpurpIO_register23 mock_reg23;
+
+    std::vector<trace_record> records;
+    tracing_instrumentation::drain(records);    // start from an empty trace
+    records.clear();
+
+    gpio_register_23< solenoid2_t, tracing_instrumentation > vac_solenoid2{ &mock_reg23 };
+    gpio_register_23< solenoid3_t, tracing_instrumentation > vac_solenoid3{ &mock_reg23 };
+    gpio_register_23< lamp_t,      tracing_instrumentation > lamp42{ &mock_reg23 };
+
+    for (int cycle = 0; cycle < 100; ++cycle)
+    {
+        lamp42(BRIGHT_LIGHTS);
+        vac_solenoid2(vacuum::ON);
+        vac_solenoid2();
+        vac_solenoid3(vacuum::ON);
+        vac_solenoid2(vacuum::OFF);
+        lamp42(MOOD_LIGHTING);
+        lamp42(MOOD_LIGHTING);
+        vac_solenoid3(vacuum::OFF);
+        lamp42();
+    }
+
+    lamp42(FULL_ILLUMINATION);
+    vac_solenoid3(vacuum::ON);
+    try
+    {
+        lamp42(LAMP_OOR);
+    }
+    catch (std::range_error &)
+    {
+        // expected. The trace records the range error
+    }
+
+    tracing_instrumentation::drain(records);
+
+    return records;
+}
+
+//======================= Unit Tests Begin ======================================
+//
+// verify that a captured trace replays without a mismatch
+int ut00()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 replay_reg23_image;
+
+    const std::vector<trace_record> records = capture_shift();
+
+    replay_result result = replay_reg23(records, &replay_reg23_image);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that every record of the shift was replayed" },
+                                   result.replayed,
+                                   records.size() );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the replay reproduced every intermediate and the final state" },
+                                   result.mismatches,
+                                   std::size_t { 0 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the replay left the lamp at the shift's final power setting" },
+                                   static_cast<std::uint16_t>(replay_reg23_image.lamp_pwr),
+                                   FULL_ILLUMINATION );
+
+    return something_failed;
+}
+
+// verify that a tampered trace is caught at the record that was tampered with
+int ut01()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 replay_reg23_image;
+
+    std::vector<trace_record> records = capture_shift();
+
+    // claim that the lamp was at full power before its first write
+    records[0].old_val = FULL_ILLUMINATION;
+
+    replay_result result = replay_reg23(records, &replay_reg23_image);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a tampered intermediate state is caught" },
+                                   result.mismatches,
+                                   std::size_t { 1 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the mismatch is reported at the tampered record" },
+                                   result.first_mismatches.empty() ? records.size() : result.first_mismatches[0].index,
+                                   std::size_t { 0 } );
+
+    return something_failed;
+}
+
+// verify that the values returned by the getters are checked too
+int ut02()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 replay_reg23_image;
+
+    std::vector<trace_record> records = capture_shift();
+
+    // record #2 is solenoid2's getter, called right after energizing it.
+    // Claim it read back as de-energized
+    records[2].old_val = 0;
+    records[2].new_val = 0;
+
+    replay_result result = replay_reg23(records, &replay_reg23_image);
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that a tampered read is caught" },
+                                   result.mismatches,
+                                   std::size_t { 1 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the mismatch is reported at the tampered read" },
+                                   result.first_mismatches.empty() ? records.size() : result.first_mismatches[0].index,
+                                   std::size_t { 2 } );
+
+    return something_failed;
+}
+
+// verify that original timing paces the replay to the trace's time stamps,
+// and that records of other registers are skipped
+int ut03()
+{
+    int something_failed = 0;
+
+    static struct genpurpIO_register23 replay_reg23_image;
+
+    // two lamp writes, 20ms apart, with another register's write between them
+    const double hz = cycle_counter_hz();
+    std::vector<trace_record> records {
+        trace_record{ 1000,                                        GPIO_REG23_ID, LAMP_PWR_FIELD_ID, LIGHTS_OUT,    MOOD_LIGHTING, TRACE_WRITE, 0 },
+        trace_record{ 2000,                                        7,             0,                 0,             1,             TRACE_WRITE, 0 },
+        trace_record{ 1000 + static_cast<std::uint64_t>(hz / 50), GPIO_REG23_ID, LAMP_PWR_FIELD_ID, MOOD_LIGHTING, LIGHTS_OUT,    TRACE_WRITE, 0 }
+    };
+
+    const auto t0 = std::chrono::steady_clock::now();
+    replay_result result = replay_reg23(records, &replay_reg23_image, replay_timing::ORIGINAL, hz);
+    const auto t1 = std::chrono::steady_clock::now();
+
+    something_failed += ut_report( std::string { __func__ },
+                                   std::string { "verifing that original timing took at least as long as the trace" },
+                                   (t1 - t0) >= std::chrono::milliseconds(19) );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that another register's record was skipped" },
+                                   result.skipped,
+                                   std::size_t { 1 } );
+
+    something_failed += ut_verify( std::string { __func__ },
+                                   std::string { "verifing that the paced replay reproduced the trace" },
+                                   result.mismatches,
+                                   std::size_t { 0 } );
+
+    return something_failed;
+}
+//-----------------------------------------------------
+
+int main( int argc, char * argv[] )
+{
+    return ut_run( argc, argv, {
+        { "ut00", ut00 },     // clean replay
+        { "ut01", ut01 },     // tampered intermediate state
+        { "ut02", ut02 },     // tampered read
+        { "ut03", ut03 },     // original timing, skipped records
+    } );
+}